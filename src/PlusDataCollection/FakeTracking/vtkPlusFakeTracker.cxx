@@ -278,7 +278,9 @@ PlusStatus vtkPlusFakeTracker::InternalUpdate()
   case (FakeTrackerMode_Default): // Spins the tools around different axis to fake movement
   {
     const double unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
-    for (DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it)
+    this->ToolUpdates.clear();
+    unsigned int toolIndex = 0;
+    for (DataSourceContainerConstIterator it = this->GetToolIteratorBegin(); it != this->GetToolIteratorEnd(); ++it, ++toolIndex)
     {
       ToolStatus toolStatus = TOOL_OK;
 
@@ -312,8 +314,15 @@ PlusStatus vtkPlusFakeTracker::InternalUpdate()
         this->InternalTransform->RotateX(rotation);
       }
 
-      this->ToolTimeStampedUpdate(it->second->GetId(), this->InternalTransform->GetMatrix(), toolStatus, this->Frame, unfilteredTimestamp);
+      if (toolIndex >= this->ToolMatrices.size())
+      {
+        this->ToolMatrices.push_back(vtkSmartPointer<vtkMatrix4x4>::New());
+      }
+      this->ToolMatrices[toolIndex]->DeepCopy(this->InternalTransform->GetMatrix());
+      this->ToolUpdates.push_back(ToolTimeStampedUpdateItem(it->second, this->ToolMatrices[toolIndex], toolStatus));
     }
+    // All the tools are measured at the same time, add them at once
+    this->ToolTimeStampedUpdate(this->ToolUpdates, this->Frame, unfilteredTimestamp);
   }
   break;
 
@@ -14,6 +14,10 @@ See License.txt for details.
 #include "vtkIGSIOTrackedFrameList.h"
 #include "vtkPoints.h"
 
+#include <vtkSmartPointer.h>
+
+#include <vector>
+
 /*! Fake tracker modes */
 enum FakeTrackerMode
 {
@@ -96,6 +100,10 @@ protected:
   /*! Internal transform used for simulating tool movements */
   vtkTransform *InternalTransform;
 
+  /*! Tool transforms of the current update in default mode, the matrices are reused between updates */
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > ToolMatrices;
+  std::vector<ToolTimeStampedUpdateItem> ToolUpdates;
+
   /*! Stores the selected fake tracker mode */
   FakeTrackerMode Mode;
 
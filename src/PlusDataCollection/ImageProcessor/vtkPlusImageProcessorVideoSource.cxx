@@ -235,8 +235,9 @@ PlusStatus vtkPlusImageProcessorVideoSource::InternalUpdate()
       this->LastProcessedInputDataTimestamp = oldestTrackingTimestamp;
     }
   }
+  // The frame is only read by the processor algorithm, it is copied into its input list
   igsioTrackedFrame trackedFrame;
-  if (this->InputChannels[0]->GetTrackedFrame(trackedFrame) != PLUS_SUCCESS)
+  if (this->InputChannels[0]->GetTrackedFrameView(trackedFrame) != PLUS_SUCCESS)
   {
     LOG_ERROR("Error while getting latest tracked frame. Last recorded timestamp: " << std::fixed << this->LastProcessedInputDataTimestamp << ". Device ID: " << this->GetDeviceId());
     this->LastProcessedInputDataTimestamp = vtkIGSIOAccurateTimer::GetSystemTime(); // forget about the past, try to add frames that are acquired from now on
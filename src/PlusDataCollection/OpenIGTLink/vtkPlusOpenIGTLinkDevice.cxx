@@ -186,6 +186,7 @@ PlusStatus vtkPlusOpenIGTLinkDevice::SendRequestedMessageTypes()
     is.Name = this->ImageMessageEmbeddedTransformName.From();
     is.EmbeddedTransformToFrame = this->ImageMessageEmbeddedTransformName.To();
     clientInfo.ImageStreams.push_back(is);
+    clientInfo.UpdateStreamNames();
   }
 
   // We need the following tool names from the server
@@ -0,0 +1,212 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusAcquisitionScheduler.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+  const unsigned int DEFAULT_MAXIMUM_NUMBER_OF_WORKER_THREADS = 4;
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler::PlusAcquisitionScheduler()
+  : LastTaskId(INVALID_TASK_ID)
+  , StopRequested(false)
+  , NumberOfWorkerThreads(std::max(1u, std::min(DEFAULT_MAXIMUM_NUMBER_OF_WORKER_THREADS, std::thread::hardware_concurrency())))
+{
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler::~PlusAcquisitionScheduler()
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+  this->StopWorkers();
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::SetNumberOfWorkerThreads(unsigned int numberOfWorkerThreads)
+{
+  std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+  this->NumberOfWorkerThreads = std::max(1u, numberOfWorkerThreads);
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusAcquisitionScheduler::GetNumberOfWorkerThreads() const
+{
+  std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+  return this->NumberOfWorkerThreads;
+}
+
+//----------------------------------------------------------------------------
+PlusAcquisitionScheduler::TaskIdType PlusAcquisitionScheduler::AddTask(double periodSec, const UpdateFunctionType& update)
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+
+  TaskIdType taskId(INVALID_TASK_ID);
+  {
+    std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+    taskId = ++this->LastTaskId;
+    Task& task = this->Tasks[taskId];
+    task.PeriodSec = periodSec;
+    task.Update = update;
+    task.NextDeadline = vtkIGSIOAccurateTimer::GetSystemTime();
+    task.NumberOfMissedDeadlines = 0;
+    task.Running = false;
+    task.Removed = false;
+    this->Deadlines.push(std::make_pair(task.NextDeadline, taskId));
+
+    if (this->WorkerThreads.empty())
+    {
+      LOG_DEBUG("Start " << this->NumberOfWorkerThreads << " acquisition scheduler worker threads");
+      this->StopRequested = false;
+      for (unsigned int workerIndex = 0; workerIndex < this->NumberOfWorkerThreads; ++workerIndex)
+      {
+        this->WorkerThreads.push_back(std::thread(&PlusAcquisitionScheduler::Worker, this));
+      }
+    }
+  }
+  this->TasksChanged.notify_all();
+
+  return taskId;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusAcquisitionScheduler::RemoveTask(TaskIdType taskId)
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+
+  bool noTasksLeft(false);
+  {
+    std::unique_lock<std::mutex> tasksLock(this->TasksMutex);
+    std::map<TaskIdType, Task>::iterator taskIt = this->Tasks.find(taskId);
+    if (taskIt == this->Tasks.end())
+    {
+      LOG_ERROR("Unable to remove acquisition task " << taskId << ": the task is not scheduled");
+      return PLUS_FAIL;
+    }
+    if (taskIt->second.Running)
+    {
+      // The worker removes the task when the update returns
+      taskIt->second.Removed = true;
+      this->TasksChanged.wait(tasksLock, [this, taskId]() { return this->Tasks.find(taskId) == this->Tasks.end(); });
+    }
+    else
+    {
+      this->Tasks.erase(taskIt);
+    }
+    noTasksLeft = this->Tasks.empty();
+  }
+
+  if (noTasksLeft)
+  {
+    this->StopWorkers();
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int PlusAcquisitionScheduler::GetNumberOfTasks() const
+{
+  std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+  return static_cast<int>(this->Tasks.size());
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::StopWorkers()
+{
+  {
+    std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+    if (this->WorkerThreads.empty())
+    {
+      return;
+    }
+    this->StopRequested = true;
+  }
+  this->TasksChanged.notify_all();
+  for (std::vector<std::thread>::iterator it = this->WorkerThreads.begin(); it != this->WorkerThreads.end(); ++it)
+  {
+    it->join();
+  }
+
+  std::lock_guard<std::mutex> tasksLock(this->TasksMutex);
+  this->WorkerThreads.clear();
+  // all the entries are stale now
+  this->Deadlines = std::priority_queue<std::pair<double, TaskIdType>, std::vector<std::pair<double, TaskIdType> >, std::greater<std::pair<double, TaskIdType> > >();
+  LOG_DEBUG("Acquisition scheduler worker threads stopped");
+}
+
+//----------------------------------------------------------------------------
+void PlusAcquisitionScheduler::Worker()
+{
+  std::unique_lock<std::mutex> tasksLock(this->TasksMutex);
+  while (!this->StopRequested)
+  {
+    if (this->Deadlines.empty())
+    {
+      this->TasksChanged.wait(tasksLock);
+      continue;
+    }
+
+    const std::pair<double, TaskIdType> deadline = this->Deadlines.top();
+    std::map<TaskIdType, Task>::iterator taskIt = this->Tasks.find(deadline.second);
+    if (taskIt == this->Tasks.end() || taskIt->second.Running || taskIt->second.NextDeadline != deadline.first)
+    {
+      // the task is removed or the entry is outdated
+      this->Deadlines.pop();
+      continue;
+    }
+
+    const double waitTimeSec = deadline.first - vtkIGSIOAccurateTimer::GetSystemTime();
+    if (waitTimeSec > 0)
+    {
+      // an earlier deadline may be added while waiting, so the queue is checked again after waking up
+      this->TasksChanged.wait_for(tasksLock, std::chrono::duration<double>(waitTimeSec));
+      continue;
+    }
+
+    this->Deadlines.pop();
+    taskIt->second.Running = true;
+    const TaskIdType taskId = deadline.second;
+    const UpdateFunctionType update = taskIt->second.Update;
+    const double periodSec = taskIt->second.PeriodSec;
+    const unsigned int numberOfMissedDeadlines = taskIt->second.NumberOfMissedDeadlines;
+    taskIt->second.NumberOfMissedDeadlines = 0;
+
+    tasksLock.unlock();
+    update(deadline.first, numberOfMissedDeadlines);
+    tasksLock.lock();
+
+    // A running task is only erased by the worker that runs it, so it is still in the map
+    taskIt = this->Tasks.find(taskId);
+    taskIt->second.Running = false;
+    if (taskIt->second.Removed)
+    {
+      this->Tasks.erase(taskIt);
+      this->TasksChanged.notify_all();
+      continue;
+    }
+
+    // If the update finished late then the next update runs immediately, at the latest deadline that has passed.
+    // Only the deadlines before that one are missed.
+    double nextDeadline = deadline.first + periodSec;
+    const double now = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (nextDeadline <= now && periodSec > 0)
+    {
+      const double numberOfSkippedPeriods = std::floor((now - nextDeadline) / periodSec);
+      nextDeadline += numberOfSkippedPeriods * periodSec;
+      taskIt->second.NumberOfMissedDeadlines += static_cast<unsigned int>(numberOfSkippedPeriods);
+    }
+    taskIt->second.NextDeadline = nextDeadline;
+    this->Deadlines.push(std::make_pair(nextDeadline, taskId));
+    // another worker may be waiting for a later deadline
+    this->TasksChanged.notify_all();
+  }
+}
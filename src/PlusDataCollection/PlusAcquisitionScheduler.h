@@ -0,0 +1,110 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusAcquisitionScheduler_h
+#define __PlusAcquisitionScheduler_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// STL includes
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*!
+  \class PlusAcquisitionScheduler
+  \brief Runs the periodic updates of many devices on a small, fixed-size pool of worker threads
+
+  Without the scheduler each rate-driven device polls its hardware in its own thread, which sleeps between updates.
+  The scheduler keeps the next deadline of each periodic task in a deadline-ordered queue and the first idle worker
+  runs the task whose deadline comes first. If an update finishes after the next deadline of the task then the
+  next update runs immediately, at the latest deadline that has passed, and the deadlines before it are skipped,
+  so a slow device does not delay the other devices by trying to catch up.
+
+  The worker threads are started when the first task is added and stopped when the last task is removed.
+  Each vtkPlusDataCollector owns a scheduler for its devices, so the settings of one data collector do not affect the others.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusAcquisitionScheduler
+{
+public:
+  typedef unsigned long long TaskIdType;
+  /*!
+    Function that is called periodically, with the time when the call was scheduled and the number of deadlines
+    that were skipped since the previous call, because the previous call finished too late
+  */
+  typedef std::function<void(double scheduledTime, unsigned int numberOfMissedDeadlines)> UpdateFunctionType;
+
+  static const TaskIdType INVALID_TASK_ID = 0;
+
+  PlusAcquisitionScheduler();
+  /*! All tasks must be removed before the scheduler is deleted */
+  ~PlusAcquisitionScheduler();
+
+  /*!
+    Set the number of worker threads. Takes effect when the workers are started next time, i.e., when the
+    first task is added after all tasks were removed.
+  */
+  void SetNumberOfWorkerThreads(unsigned int numberOfWorkerThreads);
+  unsigned int GetNumberOfWorkerThreads() const;
+
+  /*! Start calling the update function periodically. The first call is scheduled immediately. */
+  TaskIdType AddTask(double periodSec, const UpdateFunctionType& update);
+
+  /*!
+    Stop calling the update function of the task. If the update function is running then the method waits
+    until it returns, therefore it must not be called from the update function.
+  */
+  PlusStatus RemoveTask(TaskIdType taskId);
+
+  /*! Number of tasks that are currently scheduled */
+  int GetNumberOfTasks() const;
+
+protected:
+  struct Task
+  {
+    double PeriodSec;
+    UpdateFunctionType Update;
+    double NextDeadline;
+    /*! Deadlines that were skipped since the last call of the update function */
+    unsigned int NumberOfMissedDeadlines;
+    bool Running;
+    bool Removed;
+  };
+
+  /*! Run the tasks when their deadlines come, until the workers are stopped */
+  void Worker();
+  /*! Join the worker threads. Must be called with ControlMutex locked and TasksMutex unlocked. */
+  void StopWorkers();
+
+  /*! Serializes adding and removing tasks, so that the workers are started and stopped only once */
+  std::mutex ControlMutex;
+
+  mutable std::mutex TasksMutex;
+  std::condition_variable TasksChanged;
+  std::map<TaskIdType, Task> Tasks;
+  /*! Deadline and id of the tasks, earliest deadline first. Entries that do not match the next deadline of their task are ignored. */
+  std::priority_queue<std::pair<double, TaskIdType>, std::vector<std::pair<double, TaskIdType> >, std::greater<std::pair<double, TaskIdType> > > Deadlines;
+  TaskIdType LastTaskId;
+  bool StopRequested;
+
+  unsigned int NumberOfWorkerThreads;
+  std::vector<std::thread> WorkerThreads;
+
+private:
+  PlusAcquisitionScheduler(const PlusAcquisitionScheduler&);
+  void operator=(const PlusAcquisitionScheduler&);
+};
+
+#endif
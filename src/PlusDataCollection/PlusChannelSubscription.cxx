@@ -0,0 +1,78 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusChannelSubscription.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+
+//----------------------------------------------------------------------------
+PlusChannelSubscription::PlusChannelSubscription(unsigned int maximumQueueDepth, OverflowPolicyType overflowPolicy)
+  : MaximumQueueDepth(std::max(maximumQueueDepth, 1u))
+  , OverflowPolicy(overflowPolicy)
+  , NumberOfPushedFrames(0)
+  , NumberOfDroppedFrames(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusChannelSubscription::PopFrame(FramePointer& frame, double timeoutSec/*=0.0*/)
+{
+  std::unique_lock<std::mutex> queueLock(this->QueueMutex);
+  if (this->Frames.empty() && timeoutSec > 0)
+  {
+    this->FrameAvailableCondition.wait_for(queueLock, std::chrono::duration<double>(timeoutSec), [this] { return !this->Frames.empty(); });
+  }
+  if (this->Frames.empty())
+  {
+    return PLUS_FAIL;
+  }
+  frame = this->Frames.front();
+  this->Frames.pop_front();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusChannelSubscription::PushFrame(const FramePointer& frame)
+{
+  {
+    std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+    this->NumberOfPushedFrames++;
+    if (this->Frames.size() >= this->MaximumQueueDepth)
+    {
+      this->NumberOfDroppedFrames++;
+      if (this->OverflowPolicy == DROP_NEWEST)
+      {
+        return;
+      }
+      this->Frames.pop_front();
+    }
+    this->Frames.push_back(frame);
+  }
+  this->FrameAvailableCondition.notify_one();
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusChannelSubscription::GetQueueDepth() const
+{
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  return static_cast<unsigned int>(this->Frames.size());
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusChannelSubscription::GetNumberOfPushedFrames() const
+{
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  return this->NumberOfPushedFrames;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long PlusChannelSubscription::GetNumberOfDroppedFrames() const
+{
+  std::lock_guard<std::mutex> queueLock(this->QueueMutex);
+  return this->NumberOfDroppedFrames;
+}
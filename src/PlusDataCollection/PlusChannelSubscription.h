@@ -0,0 +1,85 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusChannelSubscription_h
+#define __PlusChannelSubscription_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+
+// STL includes
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+/*!
+  \class PlusChannelSubscription
+  \brief Bounded queue of the tracked frames that a channel delivers to one subscriber
+
+  Created by vtkPlusChannel::Subscribe. The channel assembles each new tracked frame once and pushes the same
+  shared, read-only frame into the queue of every subscriber, so the subscribers do not have to look up and copy
+  the data of the channel themselves. If the queue is full when a new frame arrives then either the oldest frame
+  of the queue or the new frame is dropped, depending on the overflow policy.
+
+  The queue can be read from any thread.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusChannelSubscription
+{
+public:
+  enum OverflowPolicyType
+  {
+    DROP_OLDEST, ///< the oldest frame of the queue is discarded to make room for the new frame
+    DROP_NEWEST ///< the new frame is discarded
+  };
+
+  /*! Frames are shared between all the subscribers of the channel, therefore they must not be modified */
+  typedef std::shared_ptr<const igsioTrackedFrame> FramePointer;
+
+  PlusChannelSubscription(unsigned int maximumQueueDepth, OverflowPolicyType overflowPolicy);
+
+  /*!
+    Remove the oldest frame from the queue. If the queue is empty then wait until a frame is delivered or the timeout expires.
+    Returns PLUS_FAIL if no frame is available.
+  */
+  PlusStatus PopFrame(FramePointer& frame, double timeoutSec = 0.0);
+
+  /*! Add a frame to the queue, applying the overflow policy if the queue is full. Called by the channel. */
+  void PushFrame(const FramePointer& frame);
+
+  /*! Number of frames that are waiting in the queue */
+  unsigned int GetQueueDepth() const;
+  /*! Maximum number of frames that are kept in the queue */
+  unsigned int GetMaximumQueueDepth() const { return this->MaximumQueueDepth; }
+  OverflowPolicyType GetOverflowPolicy() const { return this->OverflowPolicy; }
+
+  /*! Number of frames that the channel delivered to the subscriber (including the dropped ones) */
+  unsigned long long GetNumberOfPushedFrames() const;
+  /*! Number of frames that were dropped because the queue was full */
+  unsigned long long GetNumberOfDroppedFrames() const;
+
+protected:
+  const unsigned int MaximumQueueDepth;
+  const OverflowPolicyType OverflowPolicy;
+
+  mutable std::mutex QueueMutex;
+  std::condition_variable FrameAvailableCondition;
+  std::deque<FramePointer> Frames;
+  unsigned long long NumberOfPushedFrames;
+  unsigned long long NumberOfDroppedFrames;
+
+private:
+  PlusChannelSubscription(const PlusChannelSubscription&);
+  void operator=(const PlusChannelSubscription&);
+};
+
+#endif
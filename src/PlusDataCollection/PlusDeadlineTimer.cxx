@@ -0,0 +1,104 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusDeadlineTimer.h"
+
+// STL includes
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// OS includes
+#ifdef __linux__
+  #include <errno.h>
+  #include <time.h>
+#endif
+
+//----------------------------------------------------------------------------
+PlusDeadlineTimer::PlusDeadlineTimer(double periodSec, double spinTimeSec/*=0.0*/)
+  : PeriodSec(periodSec)
+  , SpinTimeSec(spinTimeSec)
+  , StartTime(0.0)
+  , DeadlineIndex(0)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusDeadlineTimer::Start()
+{
+  this->StartTime = GetMonotonicTime();
+  this->DeadlineIndex = 0;
+}
+
+//----------------------------------------------------------------------------
+double PlusDeadlineTimer::GetCurrentDeadline() const
+{
+  return this->StartTime + this->DeadlineIndex * this->PeriodSec;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusDeadlineTimer::WaitForNextDeadline()
+{
+  this->DeadlineIndex++;
+  const double now = GetMonotonicTime();
+  if (this->PeriodSec > 0 && this->GetCurrentDeadline() <= now)
+  {
+    // The iteration is late, it runs immediately. Only the deadlines before the latest one that has passed are missed.
+    unsigned int numberOfSkippedDeadlines(0);
+    unsigned long long latestPassedDeadlineIndex = static_cast<unsigned long long>(std::floor((now - this->StartTime) / this->PeriodSec));
+    if (latestPassedDeadlineIndex > this->DeadlineIndex)
+    {
+      numberOfSkippedDeadlines = static_cast<unsigned int>(latestPassedDeadlineIndex - this->DeadlineIndex);
+      this->DeadlineIndex = latestPassedDeadlineIndex;
+    }
+    return numberOfSkippedDeadlines;
+  }
+  SleepUntil(this->GetCurrentDeadline(), this->SpinTimeSec);
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+double PlusDeadlineTimer::GetMonotonicTime()
+{
+#ifdef __linux__
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+#else
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//----------------------------------------------------------------------------
+void PlusDeadlineTimer::SleepUntil(double monotonicTimeSec, double spinTimeSec/*=0.0*/)
+{
+  const double wakeupTime = monotonicTimeSec - (spinTimeSec > 0 ? spinTimeSec : 0.0);
+  if (wakeupTime > GetMonotonicTime())
+  {
+#ifdef __linux__
+    struct timespec wakeup;
+    wakeup.tv_sec = static_cast<time_t>(std::floor(wakeupTime));
+    wakeup.tv_nsec = static_cast<long>((wakeupTime - wakeup.tv_sec) * 1e9);
+    if (wakeup.tv_nsec >= 1000000000L)
+    {
+      wakeup.tv_sec++;
+      wakeup.tv_nsec -= 1000000000L;
+    }
+    // The sleep is restarted with the same absolute deadline if it is interrupted by a signal
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeup, NULL) == EINTR)
+    {
+    }
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+                                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(wakeupTime))));
+#endif
+  }
+
+  while (GetMonotonicTime() < monotonicTimeSec)
+  {
+    // spin until the deadline
+  }
+}
@@ -0,0 +1,65 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusDeadlineTimer_h
+#define __PlusDeadlineTimer_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+/*!
+  \class PlusDeadlineTimer
+  \brief Paces a periodic loop by absolute deadlines on a monotonic clock
+
+  The deadlines are computed from the start time and the number of elapsed periods, therefore the time that the loop
+  body takes and the inaccuracy of the wakeups do not accumulate, and the long-term rate equals the requested rate.
+  On Linux the timer sleeps with clock_nanosleep(TIMER_ABSTIME) on CLOCK_MONOTONIC. To get below the wakeup latency
+  of the operating system, the last part of the wait can be spent polling the clock (spinning).
+
+  If the loop body finishes after the next deadline then the next iteration starts immediately (late).
+  If more than one period has passed, the deadlines that have passed before the latest one are skipped
+  and the loop continues with the latest deadline that has passed, without waiting.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusDeadlineTimer
+{
+public:
+  /*!
+    \param periodSec Time between the deadlines
+    \param spinTimeSec The timer wakes up this much earlier than the deadline and polls the clock until the deadline
+  */
+  PlusDeadlineTimer(double periodSec, double spinTimeSec = 0.0);
+
+  /*! Make the current time the first deadline */
+  void Start();
+
+  /*! Deadline of the current period, in the time base of GetMonotonicTime */
+  double GetCurrentDeadline() const;
+
+  /*!
+    Advance to the next deadline and wait until it comes. If the next deadline has already passed then it returns
+    immediately, so the late iteration is still executed. If later deadlines have passed as well then the timer
+    advances to the latest deadline that has passed, and returns the number of deadlines that are skipped this way.
+  */
+  unsigned int WaitForNextDeadline();
+
+  /*! Current time of the monotonic clock in seconds */
+  static double GetMonotonicTime();
+
+  /*! Sleep until the monotonic clock reaches the specified time. The last spinTimeSec of the wait is spent polling the clock. */
+  static void SleepUntil(double monotonicTimeSec, double spinTimeSec = 0.0);
+
+protected:
+  double PeriodSec;
+  double SpinTimeSec;
+  double StartTime;
+  /*! Number of periods between the start time and the current deadline */
+  unsigned long long DeadlineIndex;
+};
+
+#endif
@@ -0,0 +1,329 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusEventDrivenUpdateDispatcher.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDevice.h"
+
+// STL includes
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <set>
+
+namespace
+{
+  const unsigned int DEFAULT_MAXIMUM_NUMBER_OF_WORKER_THREADS = 4;
+}
+
+//----------------------------------------------------------------------------
+PlusEventDrivenUpdateDispatcher::PlusEventDrivenUpdateDispatcher()
+  : LastPendingSequence(0)
+  , StopRequested(false)
+  , NumberOfWorkerThreads(std::max(1u, std::min(DEFAULT_MAXIMUM_NUMBER_OF_WORKER_THREADS, std::thread::hardware_concurrency())))
+{
+}
+
+//----------------------------------------------------------------------------
+PlusEventDrivenUpdateDispatcher::~PlusEventDrivenUpdateDispatcher()
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+  this->StopWorkers();
+}
+
+//----------------------------------------------------------------------------
+void PlusEventDrivenUpdateDispatcher::SetNumberOfWorkerThreads(unsigned int numberOfWorkerThreads)
+{
+  std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+  this->NumberOfWorkerThreads = std::max(1u, numberOfWorkerThreads);
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusEventDrivenUpdateDispatcher::GetNumberOfWorkerThreads() const
+{
+  std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+  return this->NumberOfWorkerThreads;
+}
+
+//----------------------------------------------------------------------------
+int PlusEventDrivenUpdateDispatcher::GetNumberOfDevices() const
+{
+  std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+  return static_cast<int>(this->Nodes.size());
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusEventDrivenUpdateDispatcher::Start(const std::vector<vtkPlusDevice*>& devices)
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+  this->StopWorkers();
+
+  // Sort all the devices in dependency order (Kahn's algorithm), a device depends on the owners of its input channels
+  std::map<vtkPlusDevice*, size_t> deviceIndices;
+  for (size_t deviceIndex = 0; deviceIndex < devices.size(); ++deviceIndex)
+  {
+    deviceIndices[devices[deviceIndex]] = deviceIndex;
+  }
+  std::vector<std::set<size_t> > inputDeviceIndices(devices.size());
+  std::vector<std::vector<size_t> > dependentDeviceIndices(devices.size());
+  for (size_t deviceIndex = 0; deviceIndex < devices.size(); ++deviceIndex)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    devices[deviceIndex]->GetInputDevices(inputDevices);
+    for (std::vector<vtkPlusDevice*>::iterator it = inputDevices.begin(); it != inputDevices.end(); ++it)
+    {
+      std::map<vtkPlusDevice*, size_t>::iterator inputDevice = deviceIndices.find(*it);
+      if (inputDevice != deviceIndices.end() && inputDevice->second != deviceIndex
+          && inputDeviceIndices[deviceIndex].insert(inputDevice->second).second)
+      {
+        dependentDeviceIndices[inputDevice->second].push_back(deviceIndex);
+      }
+    }
+  }
+  std::vector<size_t> dependencyOrder;
+  std::vector<size_t> numberOfPendingInputs(devices.size());
+  for (size_t deviceIndex = 0; deviceIndex < devices.size(); ++deviceIndex)
+  {
+    numberOfPendingInputs[deviceIndex] = inputDeviceIndices[deviceIndex].size();
+    if (numberOfPendingInputs[deviceIndex] == 0)
+    {
+      dependencyOrder.push_back(deviceIndex);
+    }
+  }
+  for (size_t orderIndex = 0; orderIndex < dependencyOrder.size(); ++orderIndex)
+  {
+    const std::vector<size_t>& dependents = dependentDeviceIndices[dependencyOrder[orderIndex]];
+    for (std::vector<size_t>::const_iterator it = dependents.begin(); it != dependents.end(); ++it)
+    {
+      if (--numberOfPendingInputs[*it] == 0)
+      {
+        dependencyOrder.push_back(*it);
+      }
+    }
+  }
+  if (dependencyOrder.size() < devices.size())
+  {
+    LOG_ERROR("Unable to start the event-driven update dispatcher: the input channels of the devices form a cycle");
+    return PLUS_FAIL;
+  }
+
+  // Collect the event-driven ancestors of each device, the ancestors of the inputs are already known in dependency order
+  std::vector<std::set<size_t> > ancestorNodeIndices(devices.size());
+  std::vector<size_t> nodeIndices(devices.size(), std::numeric_limits<size_t>::max());
+  std::vector<Node> nodes;
+  for (std::vector<size_t>::iterator it = dependencyOrder.begin(); it != dependencyOrder.end(); ++it)
+  {
+    for (std::set<size_t>::iterator inputIt = inputDeviceIndices[*it].begin(); inputIt != inputDeviceIndices[*it].end(); ++inputIt)
+    {
+      ancestorNodeIndices[*it].insert(ancestorNodeIndices[*inputIt].begin(), ancestorNodeIndices[*inputIt].end());
+      if (nodeIndices[*inputIt] != std::numeric_limits<size_t>::max())
+      {
+        ancestorNodeIndices[*it].insert(nodeIndices[*inputIt]);
+      }
+    }
+
+    vtkPlusDevice* device = devices[*it];
+    if (device->GetEventDrivenUpdateDispatcher().get() != this || device->GetAcquisitionMode() != vtkPlusDevice::ACQUISITION_MODE_EVENT_DRIVEN)
+    {
+      continue;
+    }
+    nodeIndices[*it] = nodes.size();
+    Node node;
+    node.Device = device;
+    node.Ancestors.assign(ancestorNodeIndices[*it].begin(), ancestorNodeIndices[*it].end());
+    node.PeriodSec = (device->GetAcquisitionRate() > 0 ? 1.0 / device->GetAcquisitionRate() : 0.0);
+    node.NextPeriodicUpdateTime = 0.0;
+    node.Pending = false;
+    node.PendingSequence = 0;
+    node.Running = false;
+    node.RunningSequence = 0;
+    nodes.push_back(node);
+  }
+  if (nodes.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  {
+    std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+    this->Nodes.swap(nodes);
+    this->StopRequested = false;
+    LOG_DEBUG("Start " << this->NumberOfWorkerThreads << " event-driven update dispatcher worker threads for " << this->Nodes.size() << " devices");
+    for (unsigned int workerIndex = 0; workerIndex < this->NumberOfWorkerThreads; ++workerIndex)
+    {
+      this->WorkerThreads.push_back(std::thread(&PlusEventDrivenUpdateDispatcher::Worker, this));
+    }
+  }
+
+  // One function for each buffer, so that the devices that read the same buffer are marked with the same sequence number
+  // and the ones that depend on the others are updated after them
+  std::map<vtkPlusBuffer*, std::vector<size_t> > bufferNodeIndices;
+  for (size_t nodeIndex = 0; nodeIndex < this->Nodes.size(); ++nodeIndex)
+  {
+    std::vector<vtkPlusBuffer*> inputBuffers;
+    this->Nodes[nodeIndex].Device->GetInputBuffers(inputBuffers);
+    for (std::vector<vtkPlusBuffer*>::iterator it = inputBuffers.begin(); it != inputBuffers.end(); ++it)
+    {
+      bufferNodeIndices[*it].push_back(nodeIndex);
+    }
+  }
+  for (std::map<vtkPlusBuffer*, std::vector<size_t> >::iterator it = bufferNodeIndices.begin(); it != bufferNodeIndices.end(); ++it)
+  {
+    const std::vector<size_t> signaledNodeIndices = it->second;
+    unsigned long callbackId = it->first->AddNewItemCallback([this, signaledNodeIndices]()
+    {
+      this->SignalInputData(signaledNodeIndices);
+    });
+    this->InputDataCallbacks.push_back(std::make_pair(vtkSmartPointer<vtkPlusBuffer>(it->first), callbackId));
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusEventDrivenUpdateDispatcher::Stop()
+{
+  std::lock_guard<std::mutex> controlLock(this->ControlMutex);
+  this->StopWorkers();
+}
+
+//----------------------------------------------------------------------------
+void PlusEventDrivenUpdateDispatcher::StopWorkers()
+{
+  // When the callbacks are removed they are not running anymore, so no device is marked after this
+  for (std::vector<std::pair<vtkSmartPointer<vtkPlusBuffer>, unsigned long> >::iterator it = this->InputDataCallbacks.begin(); it != this->InputDataCallbacks.end(); ++it)
+  {
+    it->first->RemoveNewItemCallback(it->second);
+  }
+  this->InputDataCallbacks.clear();
+
+  {
+    std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+    if (this->WorkerThreads.empty())
+    {
+      this->Nodes.clear();
+      return;
+    }
+    this->StopRequested = true;
+  }
+  this->NodesChanged.notify_all();
+  for (std::vector<std::thread>::iterator it = this->WorkerThreads.begin(); it != this->WorkerThreads.end(); ++it)
+  {
+    it->join();
+  }
+
+  std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+  this->WorkerThreads.clear();
+  this->Nodes.clear();
+  LOG_DEBUG("Event-driven update dispatcher worker threads stopped");
+}
+
+//----------------------------------------------------------------------------
+void PlusEventDrivenUpdateDispatcher::SignalInputData(const std::vector<size_t>& nodeIndices)
+{
+  {
+    std::lock_guard<std::mutex> nodesLock(this->NodesMutex);
+    const unsigned long long sequence = ++this->LastPendingSequence;
+    for (std::vector<size_t>::const_iterator it = nodeIndices.begin(); it != nodeIndices.end(); ++it)
+    {
+      Node& node = this->Nodes[*it];
+      if (!node.Pending)
+      {
+        node.Pending = true;
+        node.PendingSequence = sequence;
+      }
+    }
+  }
+  this->NodesChanged.notify_all();
+}
+
+//----------------------------------------------------------------------------
+size_t PlusEventDrivenUpdateDispatcher::FindRunnableNode() const
+{
+  size_t runnableNodeIndex = this->Nodes.size();
+  for (size_t nodeIndex = 0; nodeIndex < this->Nodes.size(); ++nodeIndex)
+  {
+    const Node& node = this->Nodes[nodeIndex];
+    if (!node.Pending || node.Running
+        || (runnableNodeIndex < this->Nodes.size() && this->Nodes[runnableNodeIndex].PendingSequence <= node.PendingSequence))
+    {
+      continue;
+    }
+    // Newer data of the ancestors does not hold back the device, so that a busy ancestor cannot starve it
+    bool waitingForAncestor(false);
+    for (std::vector<size_t>::const_iterator it = node.Ancestors.begin(); it != node.Ancestors.end(); ++it)
+    {
+      const Node& ancestor = this->Nodes[*it];
+      if ((ancestor.Pending && ancestor.PendingSequence <= node.PendingSequence)
+          || (ancestor.Running && ancestor.RunningSequence <= node.PendingSequence))
+      {
+        waitingForAncestor = true;
+        break;
+      }
+    }
+    if (!waitingForAncestor)
+    {
+      runnableNodeIndex = nodeIndex;
+    }
+  }
+  return runnableNodeIndex;
+}
+
+//----------------------------------------------------------------------------
+void PlusEventDrivenUpdateDispatcher::Worker()
+{
+  std::unique_lock<std::mutex> nodesLock(this->NodesMutex);
+  while (!this->StopRequested)
+  {
+    // Devices that have not been updated for their acquisition period are updated even without new data
+    const double now = vtkIGSIOAccurateTimer::GetSystemTime();
+    double nextPeriodicUpdateTime = std::numeric_limits<double>::max();
+    for (std::vector<Node>::iterator it = this->Nodes.begin(); it != this->Nodes.end(); ++it)
+    {
+      if (it->PeriodSec <= 0 || it->Running)
+      {
+        continue;
+      }
+      if (it->NextPeriodicUpdateTime <= now && !it->Pending)
+      {
+        it->Pending = true;
+        it->PendingSequence = ++this->LastPendingSequence;
+      }
+      nextPeriodicUpdateTime = std::min(nextPeriodicUpdateTime, it->NextPeriodicUpdateTime);
+    }
+
+    const size_t nodeIndex = this->FindRunnableNode();
+    if (nodeIndex == this->Nodes.size())
+    {
+      if (nextPeriodicUpdateTime == std::numeric_limits<double>::max())
+      {
+        this->NodesChanged.wait(nodesLock);
+      }
+      else
+      {
+        this->NodesChanged.wait_for(nodesLock, std::chrono::duration<double>(std::max(0.0, nextPeriodicUpdateTime - now)));
+      }
+      continue;
+    }
+
+    // Data that arrives during the update marks the device again, so it is processed by the next update
+    Node& node = this->Nodes[nodeIndex];
+    node.Pending = false;
+    node.Running = true;
+    node.RunningSequence = node.PendingSequence;
+    vtkPlusDevice* device = node.Device;
+
+    nodesLock.unlock();
+    device->RunEventDrivenUpdate();
+    nodesLock.lock();
+
+    node.Running = false;
+    node.NextPeriodicUpdateTime = vtkIGSIOAccurateTimer::GetSystemTime() + node.PeriodSec;
+    // the dependents of the device may be waiting for it
+    this->NodesChanged.notify_all();
+  }
+}
@@ -0,0 +1,123 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusEventDrivenUpdateDispatcher_h
+#define __PlusEventDrivenUpdateDispatcher_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class vtkPlusBuffer;
+class vtkPlusDevice;
+
+/*!
+  \class PlusEventDrivenUpdateDispatcher
+  \brief Runs the internal updates of event-driven devices on a small pool of worker threads when their input channels receive new data
+
+  The dependency order of the devices (each device after the devices of its input channels) is computed once, when the dispatcher is started.
+  The buffers of the input channels only mark the devices that read them as pending, in the thread that adds the item, and the workers
+  run the pending devices after the lock of the buffer is released. A device is not updated while a device that it depends on
+  (directly or through other devices) has older pending data or is processing it, so new data propagates through a chain of devices
+  in dependency order within one pass. Independent devices are updated in parallel. A device is updated at least at its acquisition rate,
+  even if its inputs do not receive new data.
+
+  Each vtkPlusDataCollector owns a dispatcher for its event-driven devices (see vtkPlusDevice::SetRequestedAcquisitionMode).
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusEventDrivenUpdateDispatcher
+{
+public:
+  PlusEventDrivenUpdateDispatcher();
+  /*! Stops the dispatcher if it is running */
+  ~PlusEventDrivenUpdateDispatcher();
+
+  /*! Set the number of worker threads. Takes effect when the dispatcher is started next time. */
+  void SetNumberOfWorkerThreads(unsigned int numberOfWorkerThreads);
+  unsigned int GetNumberOfWorkerThreads() const;
+
+  /*!
+    Start updating the devices that are event-driven with this dispatcher (see vtkPlusDevice::GetAcquisitionMode).
+    The other devices in the list are only used for finding the dependencies between the event-driven devices.
+    The devices should be recording already. A running dispatcher is stopped first.
+    Returns PLUS_FAIL if the input channels of the devices form a cycle.
+  */
+  PlusStatus Start(const std::vector<vtkPlusDevice*>& devices);
+
+  /*!
+    Stop updating the devices. If updates are running then the method waits until they return,
+    therefore it must not be called from an internal update of a device.
+  */
+  void Stop();
+
+  /*! Number of devices that are updated by the dispatcher */
+  int GetNumberOfDevices() const;
+
+protected:
+  struct Node
+  {
+    vtkSmartPointer<vtkPlusDevice> Device;
+    /*! Indices of the event-driven devices that this device depends on, directly or through other devices */
+    std::vector<size_t> Ancestors;
+    /*! Minimum update period (0 if the device is only updated when its inputs receive new data) */
+    double PeriodSec;
+    double NextPeriodicUpdateTime;
+    bool Pending;
+    /*! Order in which the pending data arrived, devices that are marked by the same new item share the same number */
+    unsigned long long PendingSequence;
+    bool Running;
+    /*! PendingSequence of the data that is being processed */
+    unsigned long long RunningSequence;
+  };
+
+  /*! Remove the callbacks from the buffers and join the worker threads. Must be called with ControlMutex locked and NodesMutex unlocked. */
+  void StopWorkers();
+
+  /*! Run the pending devices, until the dispatcher is stopped */
+  void Worker();
+
+  /*! Mark the devices as pending, called by the buffers of their input channels */
+  void SignalInputData(const std::vector<size_t>& nodeIndices);
+
+  /*!
+    Returns the index of the device that was marked pending the earliest among the devices whose ancestors have no older
+    pending or running data, or the number of nodes if no device can run. Must be called with NodesMutex locked.
+  */
+  size_t FindRunnableNode() const;
+
+  /*! Serializes starting and stopping, guards InputDataCallbacks */
+  std::mutex ControlMutex;
+
+  mutable std::mutex NodesMutex;
+  std::condition_variable NodesChanged;
+  /*! Event-driven devices in dependency order, not modified while the workers run */
+  std::vector<Node> Nodes;
+  unsigned long long LastPendingSequence;
+  bool StopRequested;
+
+  /*! Buffers of the input channels and the ids of the functions that are registered in them while the dispatcher runs */
+  std::vector<std::pair<vtkSmartPointer<vtkPlusBuffer>, unsigned long> > InputDataCallbacks;
+
+  unsigned int NumberOfWorkerThreads;
+  std::vector<std::thread> WorkerThreads;
+
+private:
+  PlusEventDrivenUpdateDispatcher(const PlusEventDrivenUpdateDispatcher&);
+  void operator=(const PlusEventDrivenUpdateDispatcher&);
+};
+
+#endif
@@ -0,0 +1,135 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusFrameFieldNameTable.h"
+
+// STL includes
+#include <functional>
+
+//----------------------------------------------------------------------------
+PlusFrameFieldNameTable::PlusFrameFieldNameTable()
+  : NumberOfNames(0)
+{
+  for (unsigned int chunkIndex = 0; chunkIndex < MAXIMUM_NUMBER_OF_CHUNKS; ++chunkIndex)
+  {
+    this->Chunks[chunkIndex].store(NULL, std::memory_order_relaxed);
+  }
+  for (unsigned int bucketIndex = 0; bucketIndex < NUMBER_OF_BUCKETS; ++bucketIndex)
+  {
+    this->Buckets[bucketIndex].store(NULL, std::memory_order_relaxed);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFieldNameTable::~PlusFrameFieldNameTable()
+{
+  for (unsigned int chunkIndex = 0; chunkIndex < MAXIMUM_NUMBER_OF_CHUNKS; ++chunkIndex)
+  {
+    delete[] this->Chunks[chunkIndex].load(std::memory_order_relaxed);
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFieldNameTable::KeyType PlusFrameFieldNameTable::Intern(const std::string& fieldName)
+{
+  KeyType key(0);
+  if (this->Find(fieldName, key))
+  {
+    return key;
+  }
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  // Another thread may have added the name since the lookup
+  if (this->Find(fieldName, key))
+  {
+    return key;
+  }
+
+  key = this->NumberOfNames.load(std::memory_order_relaxed);
+  unsigned int chunkIndex(0);
+  unsigned int indexInChunk(0);
+  GetChunkPosition(key, chunkIndex, indexInChunk);
+  Entry* chunk = this->Chunks[chunkIndex].load(std::memory_order_relaxed);
+  if (chunk == NULL)
+  {
+    chunk = new Entry[static_cast<unsigned int>(FIRST_CHUNK_SIZE) << chunkIndex];
+    this->Chunks[chunkIndex].store(chunk, std::memory_order_release);
+  }
+
+  std::atomic<const Entry*>& bucket = this->Buckets[GetBucketIndex(fieldName)];
+  Entry& entry = chunk[indexInChunk];
+  entry.Name = fieldName;
+  entry.TransformField = (fieldName.find("Transform") != std::string::npos);
+  entry.Key = key;
+  entry.Next = bucket.load(std::memory_order_relaxed);
+
+  // Publish the entry, readers that find it see its complete content
+  bucket.store(&entry, std::memory_order_release);
+  this->NumberOfNames.store(key + 1, std::memory_order_release);
+  return key;
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFieldNameTable::Find(const std::string& fieldName, KeyType& key) const
+{
+  for (const Entry* entry = this->Buckets[GetBucketIndex(fieldName)].load(std::memory_order_acquire); entry != NULL; entry = entry->Next)
+  {
+    if (entry->Name == fieldName)
+    {
+      key = entry->Key;
+      return true;
+    }
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------
+const std::string& PlusFrameFieldNameTable::GetName(KeyType key) const
+{
+  return this->GetEntry(key).Name;
+}
+
+//----------------------------------------------------------------------------
+bool PlusFrameFieldNameTable::IsTransformField(KeyType key) const
+{
+  return this->GetEntry(key).TransformField;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFieldNameTable::GetNumberOfNames() const
+{
+  return this->NumberOfNames.load(std::memory_order_acquire);
+}
+
+//----------------------------------------------------------------------------
+const PlusFrameFieldNameTable::Entry& PlusFrameFieldNameTable::GetEntry(KeyType key) const
+{
+  unsigned int chunkIndex(0);
+  unsigned int indexInChunk(0);
+  GetChunkPosition(key, chunkIndex, indexInChunk);
+  return this->Chunks[chunkIndex].load(std::memory_order_acquire)[indexInChunk];
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFieldNameTable::GetChunkPosition(KeyType key, unsigned int& chunkIndex, unsigned int& indexInChunk)
+{
+  chunkIndex = 0;
+  unsigned long long chunkSize = FIRST_CHUNK_SIZE;
+  unsigned long long remainingKeys = key;
+  while (remainingKeys >= chunkSize)
+  {
+    remainingKeys -= chunkSize;
+    chunkSize *= 2;
+    ++chunkIndex;
+  }
+  indexInChunk = static_cast<unsigned int>(remainingKeys);
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFieldNameTable::GetBucketIndex(const std::string& fieldName)
+{
+  return static_cast<unsigned int>(std::hash<std::string>()(fieldName) % NUMBER_OF_BUCKETS);
+}
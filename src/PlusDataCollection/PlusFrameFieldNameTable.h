@@ -0,0 +1,97 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFieldNameTable_h
+#define __PlusFrameFieldNameTable_h
+
+// Local includes
+#include "vtkPlusDataCollectionExport.h"
+
+// STL includes
+#include <atomic>
+#include <mutex>
+#include <string>
+
+/*!
+  \class PlusFrameFieldNameTable
+  \brief Assigns integer keys to frame field names
+
+  The items of a buffer share one table, so each field name is stored once per buffer and items only store
+  the integer key of their fields. Keys are assigned in increasing order starting from 0 and they are never removed,
+  so a key identifies the same name for the lifetime of the table. Whether the name refers to a transform
+  is determined once, when the name is added.
+
+  The table is thread-safe and its reads (Find, GetName, IsTransformField, GetNumberOfNames and Intern of
+  a name that is already in the table) do not lock. The table is append-only: the entries are stored in chunks
+  that are never moved or reallocated (each chunk is twice as large as the previous one) and they are linked into
+  a fixed number of hash buckets. Adding a name writes one new entry under a mutex and then publishes it, nothing
+  is copied. References returned by GetName remain valid for the lifetime of the table.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusFrameFieldNameTable
+{
+public:
+  typedef unsigned int KeyType;
+
+  PlusFrameFieldNameTable();
+  ~PlusFrameFieldNameTable();
+
+  /*! Get the key of a field name, the name is added to the table if it is not in the table yet */
+  KeyType Intern(const std::string& fieldName);
+
+  /*! Get the key of a field name. Returns false if the name is not in the table. */
+  bool Find(const std::string& fieldName, KeyType& key) const;
+
+  /*! Get the name of a key that was returned by Intern */
+  const std::string& GetName(KeyType key) const;
+
+  /*! Returns true if the field name contains "Transform" (the field stores a transform or a transform status) */
+  bool IsTransformField(KeyType key) const;
+
+  /*! Get the number of names in the table */
+  unsigned int GetNumberOfNames() const;
+
+protected:
+  /*! Entries are not modified after they are published */
+  struct Entry
+  {
+    std::string Name;
+    bool TransformField;
+    KeyType Key;
+    /*! Next entry in the same hash bucket */
+    const Entry* Next;
+  };
+
+  enum
+  {
+    FIRST_CHUNK_SIZE = 16,
+    /*! Enough chunks for all the keys */
+    MAXIMUM_NUMBER_OF_CHUNKS = 32,
+    NUMBER_OF_BUCKETS = 64
+  };
+
+  /*! The table is shared by the items of a buffer, it is not copied */
+  PlusFrameFieldNameTable(const PlusFrameFieldNameTable&);
+  PlusFrameFieldNameTable& operator=(const PlusFrameFieldNameTable&);
+
+  /*! Get the entry of a key that is already published */
+  const Entry& GetEntry(KeyType key) const;
+  /*! Get the chunk that holds a key and the index of the key in the chunk */
+  static void GetChunkPosition(KeyType key, unsigned int& chunkIndex, unsigned int& indexInChunk);
+  static unsigned int GetBucketIndex(const std::string& fieldName);
+
+  /*! Chunk i holds FIRST_CHUNK_SIZE * 2^i entries, allocated when the first of its keys is added */
+  std::atomic<Entry*> Chunks[MAXIMUM_NUMBER_OF_CHUNKS];
+  /*! Latest added entry of each hash bucket, the entries of a bucket are linked by Entry::Next */
+  std::atomic<const Entry*> Buckets[NUMBER_OF_BUCKETS];
+  std::atomic<unsigned int> NumberOfNames;
+
+  /*! Serializes adding names */
+  std::mutex Mutex;
+};
+
+#endif
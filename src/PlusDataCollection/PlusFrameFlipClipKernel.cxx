@@ -0,0 +1,488 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusFrameFlipClipKernel.h"
+
+// STL includes
+#include <cstring>
+
+// AVX2 and SSSE3 loops are compiled into separate files (PLUS_FLIP_CLIP_X86_KERNELS is defined by CMake on x86)
+// and are used if the CPU supports them. SSE2 and NEON are selected at compile time, from the compiler flags of the library.
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+  #include "PlusFrameFlipClipKernelSimd.h"
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define PLUS_FLIP_CLIP_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define PLUS_FLIP_CLIP_NEON
+#endif
+
+namespace
+{
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+  struct CpuFeatures
+  {
+    bool Avx2;
+    bool Ssse3;
+  };
+
+  //----------------------------------------------------------------------------
+  // Returns false if the CPU does not support the requested CPUID leaf
+  bool GetCpuId(unsigned int leaf, unsigned int registers[4])
+  {
+#if defined(_MSC_VER)
+    int values[4] = { 0 };
+    __cpuid(values, 0);
+    if (static_cast<unsigned int>(values[0]) < leaf)
+    {
+      return false;
+    }
+    __cpuidex(values, static_cast<int>(leaf), 0);
+    for (int i = 0; i < 4; ++i)
+    {
+      registers[i] = static_cast<unsigned int>(values[i]);
+    }
+#else
+    if (__get_cpuid_max(0, NULL) < leaf)
+    {
+      return false;
+    }
+    __cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  CpuFeatures DetectCpuFeatures()
+  {
+    CpuFeatures features = { false, false };
+    unsigned int registers[4] = { 0 };
+    if (!GetCpuId(1, registers))
+    {
+      return features;
+    }
+    const unsigned int ecx = registers[2];
+    features.Ssse3 = (ecx & (1u << 9)) != 0;
+
+    // AVX2 also requires the operating system to save the YMM registers on context switches
+    const bool osxsave = (ecx & (1u << 27)) != 0;
+    const bool avx = (ecx & (1u << 28)) != 0;
+    if (!osxsave || !avx)
+    {
+      return features;
+    }
+#if defined(_MSC_VER)
+    const unsigned long long xcr0 = _xgetbv(0);
+#else
+    unsigned int xcr0Low = 0;
+    unsigned int xcr0High = 0;
+    __asm__ __volatile__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    const unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0High) << 32) | xcr0Low;
+#endif
+    if ((xcr0 & 0x6) != 0x6)
+    {
+      return features;
+    }
+    if (GetCpuId(7, registers))
+    {
+      features.Avx2 = (registers[1] & (1u << 5)) != 0;
+    }
+    return features;
+  }
+
+  //----------------------------------------------------------------------------
+  const CpuFeatures& GetCpuFeatures()
+  {
+    static const CpuFeatures features = DetectCpuFeatures();
+    return features;
+  }
+#endif
+
+  // The mirror functions copy numberOfPixels pixels from the input row to the output row in reverse order.
+  // The SIMD loops read blocks from the end of the input row and write them to the beginning of the output row,
+  // the remaining pixels are copied one by one.
+
+  //----------------------------------------------------------------------------
+  void MirrorRow8(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+  {
+    const unsigned char* input = inputRow + numberOfPixels;
+    unsigned char* output = outputRow;
+    unsigned int remainingPixels = numberOfPixels;
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Avx2)
+    {
+      const unsigned int mirroredPixels = PlusFrameFlipClipSimd::MirrorRow8Avx2(inputRow, outputRow, numberOfPixels);
+      input -= mirroredPixels;
+      output += mirroredPixels;
+      remainingPixels -= mirroredPixels;
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_SSE2)
+    for (; remainingPixels >= 16; remainingPixels -= 16)
+    {
+      input -= 16;
+      __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+      // reverse 32-bit words, then 16-bit words within them, then bytes within 16-bit words
+      pixels = _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3));
+      pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+      pixels = _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+      pixels = _mm_or_si128(_mm_slli_epi16(pixels, 8), _mm_srli_epi16(pixels, 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output), pixels);
+      output += 16;
+    }
+#elif defined(PLUS_FLIP_CLIP_NEON)
+    for (; remainingPixels >= 16; remainingPixels -= 16)
+    {
+      input -= 16;
+      uint8x16_t pixels = vrev64q_u8(vld1q_u8(input));
+      vst1q_u8(output, vcombine_u8(vget_high_u8(pixels), vget_low_u8(pixels)));
+      output += 16;
+    }
+#endif
+    for (; remainingPixels > 0; --remainingPixels)
+    {
+      *output++ = *--input;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void MirrorRow16(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+  {
+    const unsigned char* input = inputRow + numberOfPixels * 2;
+    unsigned char* output = outputRow;
+    unsigned int remainingPixels = numberOfPixels;
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Avx2)
+    {
+      const unsigned int mirroredPixels = PlusFrameFlipClipSimd::MirrorRow16Avx2(inputRow, outputRow, numberOfPixels);
+      input -= mirroredPixels * 2;
+      output += mirroredPixels * 2;
+      remainingPixels -= mirroredPixels;
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_SSE2)
+    for (; remainingPixels >= 8; remainingPixels -= 8)
+    {
+      input -= 16;
+      __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+      pixels = _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3));
+      pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+      pixels = _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(2, 3, 0, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output), pixels);
+      output += 16;
+    }
+#elif defined(PLUS_FLIP_CLIP_NEON)
+    for (; remainingPixels >= 8; remainingPixels -= 8)
+    {
+      input -= 16;
+      uint16x8_t pixels = vrev64q_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(input)));
+      vst1q_u16(reinterpret_cast<uint16_t*>(output), vcombine_u16(vget_high_u16(pixels), vget_low_u16(pixels)));
+      output += 16;
+    }
+#endif
+    for (; remainingPixels > 0; --remainingPixels)
+    {
+      input -= 2;
+      memcpy(output, input, 2);
+      output += 2;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void MirrorRow24(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+  {
+    const unsigned char* input = inputRow + numberOfPixels * 3;
+    unsigned char* output = outputRow;
+    unsigned int remainingPixels = numberOfPixels;
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Ssse3)
+    {
+      const unsigned int mirroredPixels = PlusFrameFlipClipSimd::MirrorRow24Ssse3(inputRow, outputRow, numberOfPixels);
+      input -= mirroredPixels * 3;
+      output += mirroredPixels * 3;
+      remainingPixels -= mirroredPixels;
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_NEON)
+    for (; remainingPixels >= 16; remainingPixels -= 16)
+    {
+      input -= 48;
+      uint8x16x3_t pixels = vld3q_u8(input);
+      for (int component = 0; component < 3; ++component)
+      {
+        uint8x16_t reversed = vrev64q_u8(pixels.val[component]);
+        pixels.val[component] = vcombine_u8(vget_high_u8(reversed), vget_low_u8(reversed));
+      }
+      vst3q_u8(output, pixels);
+      output += 48;
+    }
+#endif
+    for (; remainingPixels > 0; --remainingPixels)
+    {
+      input -= 3;
+      output[0] = input[0];
+      output[1] = input[1];
+      output[2] = input[2];
+      output += 3;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  void MirrorRow32(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+  {
+    const unsigned char* input = inputRow + numberOfPixels * 4;
+    unsigned char* output = outputRow;
+    unsigned int remainingPixels = numberOfPixels;
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Avx2)
+    {
+      const unsigned int mirroredPixels = PlusFrameFlipClipSimd::MirrorRow32Avx2(inputRow, outputRow, numberOfPixels);
+      input -= mirroredPixels * 4;
+      output += mirroredPixels * 4;
+      remainingPixels -= mirroredPixels;
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_SSE2)
+    for (; remainingPixels >= 4; remainingPixels -= 4)
+    {
+      input -= 16;
+      __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3)));
+      output += 16;
+    }
+#elif defined(PLUS_FLIP_CLIP_NEON)
+    for (; remainingPixels >= 4; remainingPixels -= 4)
+    {
+      input -= 16;
+      uint32x4_t pixels = vrev64q_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(input)));
+      vst1q_u32(reinterpret_cast<uint32_t*>(output), vcombine_u32(vget_high_u32(pixels), vget_low_u32(pixels)));
+      output += 16;
+    }
+#endif
+    for (; remainingPixels > 0; --remainingPixels)
+    {
+      input -= 4;
+      memcpy(output, input, 4);
+      output += 4;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFlipClipKernel::PlusFrameFlipClipKernel()
+  : Type(KERNEL_GENERIC)
+  , Configured(false)
+  , ImageType(US_IMG_TYPE_XX)
+  , PixelType(VTK_VOID)
+  , NumberOfScalarComponents(0)
+  , BytesPerPixel(0)
+{
+  this->InputFrameSizeInPx.fill(0);
+  this->ClipRectangleOrigin.fill(0);
+  this->ClipRectangleSize.fill(0);
+  this->OutputFrameSizeInPx.fill(0);
+  this->OutputOriginInPx.fill(0);
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFlipClipKernel::KernelType PlusFrameFlipClipKernel::Configure(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+    unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+{
+  if (this->Configured
+      && this->FlipInfo.hFlip == flipInfo.hFlip && this->FlipInfo.vFlip == flipInfo.vFlip && this->FlipInfo.eFlip == flipInfo.eFlip
+      && this->FlipInfo.tranpose == flipInfo.tranpose && this->ImageType == imageType && this->PixelType == pixelType
+      && this->NumberOfScalarComponents == numberOfScalarComponents && this->InputFrameSizeInPx == inputFrameSizeInPx
+      && this->ClipRectangleOrigin == clipRectangleOrigin && this->ClipRectangleSize == clipRectangleSize)
+  {
+    return this->Type;
+  }
+
+  this->Configured = true;
+  this->FlipInfo = flipInfo;
+  this->ImageType = imageType;
+  this->PixelType = pixelType;
+  this->NumberOfScalarComponents = numberOfScalarComponents;
+  this->InputFrameSizeInPx = inputFrameSizeInPx;
+  this->ClipRectangleOrigin = clipRectangleOrigin;
+  this->ClipRectangleSize = clipRectangleSize;
+  this->Type = KERNEL_GENERIC;
+
+  // RF images may require keeping pairs of rows or columns together, transposing changes the memory layout
+  if ((imageType != US_IMG_BRIGHTNESS && imageType != US_IMG_RGB_COLOR) || flipInfo.tranpose != igsioVideoFrame::TRANSPOSE_NONE)
+  {
+    return this->Type;
+  }
+  this->BytesPerPixel = igsioVideoFrame::GetNumberOfBytesPerScalar(pixelType) * numberOfScalarComponents;
+  if (this->BytesPerPixel == 0 || inputFrameSizeInPx[0] == 0 || inputFrameSizeInPx[1] == 0 || inputFrameSizeInPx[2] == 0)
+  {
+    return this->Type;
+  }
+
+  bool clipping = igsioCommon::IsClippingRequested(clipRectangleOrigin, clipRectangleSize);
+  for (int i = 0; i < 3; ++i)
+  {
+    if (!clipping)
+    {
+      this->OutputOriginInPx[i] = 0;
+      this->OutputFrameSizeInPx[i] = inputFrameSizeInPx[i];
+      continue;
+    }
+    // Invalid clip rectangles are reported by the generic implementation
+    if (clipRectangleOrigin[i] < 0 || clipRectangleSize[i] <= 0
+        || static_cast<unsigned int>(clipRectangleOrigin[i]) + static_cast<unsigned int>(clipRectangleSize[i]) > inputFrameSizeInPx[i])
+    {
+      return this->Type;
+    }
+    this->OutputOriginInPx[i] = static_cast<unsigned int>(clipRectangleOrigin[i]);
+    this->OutputFrameSizeInPx[i] = static_cast<unsigned int>(clipRectangleSize[i]);
+  }
+
+  if (flipInfo.hFlip)
+  {
+    if (this->BytesPerPixel > 4)
+    {
+      return this->Type;
+    }
+    this->Type = KERNEL_MIRROR_ROWS;
+  }
+  else if (flipInfo.vFlip || flipInfo.eFlip || clipping)
+  {
+    this->Type = KERNEL_COPY_ROWS;
+  }
+  else
+  {
+    this->Type = KERNEL_COPY_FRAME;
+  }
+  return this->Type;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusFrameFlipClipKernel::Apply(const unsigned char* inputFrame, unsigned char* outputFrame) const
+{
+  if (this->Type == KERNEL_GENERIC || inputFrame == NULL || outputFrame == NULL)
+  {
+    return PLUS_FAIL;
+  }
+
+  const size_t inputRowSizeInBytes = static_cast<size_t>(this->InputFrameSizeInPx[0]) * this->BytesPerPixel;
+  const size_t inputSliceSizeInBytes = inputRowSizeInBytes * this->InputFrameSizeInPx[1];
+  const size_t outputRowSizeInBytes = static_cast<size_t>(this->OutputFrameSizeInPx[0]) * this->BytesPerPixel;
+  const unsigned int numberOfRows = this->OutputFrameSizeInPx[1];
+  const unsigned int numberOfSlices = this->OutputFrameSizeInPx[2];
+
+  if (this->Type == KERNEL_COPY_FRAME)
+  {
+    memcpy(outputFrame, inputFrame, inputSliceSizeInBytes * numberOfSlices);
+    return PLUS_SUCCESS;
+  }
+
+  const unsigned char* firstInputPixel = inputFrame + this->OutputOriginInPx[2] * inputSliceSizeInBytes
+                                         + this->OutputOriginInPx[1] * inputRowSizeInBytes + this->OutputOriginInPx[0] * this->BytesPerPixel;
+  for (unsigned int slice = 0; slice < numberOfSlices; ++slice)
+  {
+    const unsigned int outputSlice = this->FlipInfo.eFlip ? numberOfSlices - 1 - slice : slice;
+    for (unsigned int row = 0; row < numberOfRows; ++row)
+    {
+      const unsigned int outputRow = this->FlipInfo.vFlip ? numberOfRows - 1 - row : row;
+      const unsigned char* input = firstInputPixel + slice * inputSliceSizeInBytes + row * inputRowSizeInBytes;
+      unsigned char* output = outputFrame + (static_cast<size_t>(outputSlice) * numberOfRows + outputRow) * outputRowSizeInBytes;
+      if (this->Type == KERNEL_MIRROR_ROWS)
+      {
+        this->MirrorRow(input, output);
+      }
+      else
+      {
+        memcpy(output, input, outputRowSizeInBytes);
+      }
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void PlusFrameFlipClipKernel::MirrorRow(const unsigned char* inputRow, unsigned char* outputRow) const
+{
+  switch (this->BytesPerPixel)
+  {
+  case 1:
+    MirrorRow8(inputRow, outputRow, this->OutputFrameSizeInPx[0]);
+    break;
+  case 2:
+    MirrorRow16(inputRow, outputRow, this->OutputFrameSizeInPx[0]);
+    break;
+  case 3:
+    MirrorRow24(inputRow, outputRow, this->OutputFrameSizeInPx[0]);
+    break;
+  case 4:
+    MirrorRow32(inputRow, outputRow, this->OutputFrameSizeInPx[0]);
+    break;
+  default:
+    break;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* PlusFrameFlipClipKernel::GetKernelTypeAsString(KernelType type)
+{
+  switch (type)
+  {
+  case KERNEL_COPY_FRAME:
+    return "CopyFrame";
+  case KERNEL_COPY_ROWS:
+    return "CopyRows";
+  case KERNEL_MIRROR_ROWS:
+    return "MirrorRows";
+  default:
+    return "Generic";
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* PlusFrameFlipClipKernel::GetMirrorInstructionSet(unsigned int bytesPerPixel)
+{
+  switch (bytesPerPixel)
+  {
+  case 1:
+  case 2:
+  case 4:
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Avx2)
+    {
+      return "AVX2";
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_SSE2)
+    return "SSE2";
+#elif defined(PLUS_FLIP_CLIP_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+  case 3:
+#if defined(PLUS_FLIP_CLIP_X86_KERNELS)
+    if (GetCpuFeatures().Ssse3)
+    {
+      return "SSSE3";
+    }
+#endif
+#if defined(PLUS_FLIP_CLIP_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+  default:
+    return "scalar";
+  }
+}
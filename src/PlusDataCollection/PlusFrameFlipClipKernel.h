@@ -0,0 +1,102 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFlipClipKernel_h
+#define __PlusFrameFlipClipKernel_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// IGSIO includes
+#include <igsioVideoFrame.h>
+
+// STL includes
+#include <array>
+
+/*!
+  \class PlusFrameFlipClipKernel
+  \brief Specialized copy of a video frame into the buffer for the common flip and clip settings
+
+  igsioVideoFrame::GetOrientedClippedImage supports any orientation change, but it copies pixel by pixel
+  whenever a flip is requested. This class selects a specialized kernel for the cases that acquisition
+  devices use most often:
+  - no flip and no clipping: one memcpy of the whole frame
+  - clipping, vertical and/or elevational flip: one memcpy for each row, in reverse row or slice order if flipped
+  - horizontal flip of 1, 2, 3 or 4 bytes per pixel: rows are reversed with SIMD byte shuffles (AVX2 or SSSE3 if the CPU
+    supports them, otherwise SSE2 or NEON if the library is compiled for them), combined with the row order of the vertical flip.
+
+  Transposed outputs and RF images (where pairs of rows or columns are kept together) are not handled,
+  in these cases IsGeneric() returns true and GetOrientedClippedImage has to be used.
+
+  The kernel is selected by Configure, which only does work when the frame format or the flip and clip settings change,
+  so it can be called for each frame.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusFrameFlipClipKernel
+{
+public:
+  enum KernelType
+  {
+    KERNEL_GENERIC,          /*!< No specialized kernel, use igsioVideoFrame::GetOrientedClippedImage */
+    KERNEL_COPY_FRAME,       /*!< Copy the whole frame at once */
+    KERNEL_COPY_ROWS,        /*!< Copy each row, in reverse order for vertical flip */
+    KERNEL_MIRROR_ROWS       /*!< Copy each row with reversed pixel order, in reverse row order for vertical flip */
+  };
+
+  PlusFrameFlipClipKernel();
+
+  /*!
+    Select the kernel for copying frames with the specified properties. The clip rectangle is in input image coordinates,
+    the clipped region is flipped. Returns the selected kernel.
+  */
+  KernelType Configure(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+                       unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+                       const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize);
+
+  /*! Returns true if no specialized kernel is available for the current configuration */
+  bool IsGeneric() const { return this->Type == KERNEL_GENERIC; }
+  KernelType GetType() const { return this->Type; }
+
+  /*! Get the size of the output frame (size of the clipped region) */
+  const FrameSizeType& GetOutputFrameSizeInPx() const { return this->OutputFrameSizeInPx; }
+
+  /*!
+    Copy the input frame into the output frame, which must be allocated with the output frame size and pixel format.
+    Fails if the current configuration is generic.
+  */
+  PlusStatus Apply(const unsigned char* inputFrame, unsigned char* outputFrame) const;
+
+  static const char* GetKernelTypeAsString(KernelType type);
+
+  /*! Get the name of the instruction set used for horizontal flips of the specified pixel size ("AVX2", "SSSE3", "SSE2", "NEON" or "scalar") */
+  static const char* GetMirrorInstructionSet(unsigned int bytesPerPixel);
+
+protected:
+  /*! Copy a row of pixels into the output row in reverse pixel order */
+  void MirrorRow(const unsigned char* inputRow, unsigned char* outputRow) const;
+
+protected:
+  KernelType Type;
+
+  /*! Settings of the current configuration, the kernel is selected again only if they change */
+  bool Configured;
+  igsioVideoFrame::FlipInfoType FlipInfo;
+  US_IMAGE_TYPE ImageType;
+  igsioCommon::VTKScalarPixelType PixelType;
+  unsigned int NumberOfScalarComponents;
+  FrameSizeType InputFrameSizeInPx;
+  std::array<int, 3> ClipRectangleOrigin;
+  std::array<int, 3> ClipRectangleSize;
+
+  /*! Derived copy parameters */
+  unsigned int BytesPerPixel;
+  FrameSizeType OutputFrameSizeInPx;
+  std::array<unsigned int, 3> OutputOriginInPx;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// This file is compiled with AVX2 enabled, its functions must only be called if the CPU supports AVX2
+
+#include "PlusFrameFlipClipKernelSimd.h"
+
+#include <immintrin.h>
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFlipClipSimd::MirrorRow8Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+{
+  const unsigned char* input = inputRow + numberOfPixels;
+  unsigned char* output = outputRow;
+  unsigned int remainingPixels = numberOfPixels;
+  const __m256i reverseBytesInLanes = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                      15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+  for (; remainingPixels >= 32; remainingPixels -= 32)
+  {
+    input -= 32;
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+    pixels = _mm256_shuffle_epi8(pixels, reverseBytesInLanes);
+    pixels = _mm256_permute2x128_si256(pixels, pixels, 0x01);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), pixels);
+    output += 32;
+  }
+  return numberOfPixels - remainingPixels;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFlipClipSimd::MirrorRow16Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+{
+  const unsigned char* input = inputRow + numberOfPixels * 2;
+  unsigned char* output = outputRow;
+  unsigned int remainingPixels = numberOfPixels;
+  const __m256i reverseWordsInLanes = _mm256_setr_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+                                      14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+  for (; remainingPixels >= 16; remainingPixels -= 16)
+  {
+    input -= 32;
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+    pixels = _mm256_shuffle_epi8(pixels, reverseWordsInLanes);
+    pixels = _mm256_permute2x128_si256(pixels, pixels, 0x01);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), pixels);
+    output += 32;
+  }
+  return numberOfPixels - remainingPixels;
+}
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFlipClipSimd::MirrorRow32Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+{
+  const unsigned char* input = inputRow + numberOfPixels * 4;
+  unsigned char* output = outputRow;
+  unsigned int remainingPixels = numberOfPixels;
+  const __m256i reversePixels = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  for (; remainingPixels >= 8; remainingPixels -= 8)
+  {
+    input -= 32;
+    __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_permutevar8x32_epi32(pixels, reversePixels));
+    output += 32;
+  }
+  return numberOfPixels - remainingPixels;
+}
@@ -0,0 +1,31 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// This file is compiled with SSSE3 enabled, its functions must only be called if the CPU supports SSSE3
+
+#include "PlusFrameFlipClipKernelSimd.h"
+
+#include <tmmintrin.h>
+
+//----------------------------------------------------------------------------
+unsigned int PlusFrameFlipClipSimd::MirrorRow24Ssse3(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels)
+{
+  const unsigned char* input = inputRow + numberOfPixels * 3;
+  unsigned char* output = outputRow;
+  unsigned int remainingPixels = numberOfPixels;
+  // Each iteration reads the 16 bytes that end at the current input position: 5 pixels and the last byte of the 6th pixel,
+  // and writes 16 bytes: 5 pixels and a byte that is overwritten by the next pixel. At least 6 remaining pixels are needed
+  // so that neither access goes outside the rows.
+  const __m128i reversePixels = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -1);
+  for (; remainingPixels >= 6; remainingPixels -= 5)
+  {
+    input -= 15;
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input - 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi8(pixels, reversePixels));
+    output += 15;
+  }
+  return numberOfPixels - remainingPixels;
+}
@@ -0,0 +1,31 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFrameFlipClipKernelSimd_h
+#define __PlusFrameFlipClipKernelSimd_h
+
+/*!
+  \file PlusFrameFlipClipKernelSimd.h
+  \brief Row mirror loops of PlusFrameFlipClipKernel for instruction sets that the library is not compiled for
+
+  Each instruction set has its own translation unit, which is compiled with the flags of that instruction set
+  (PlusFrameFlipClipKernelAVX2.cxx, PlusFrameFlipClipKernelSSSE3.cxx). PlusFrameFlipClipKernel only calls these
+  functions if the CPU supports the instruction set, so the rest of the library runs on any CPU.
+
+  The functions copy the last pixels of the input row into the beginning of the output row in reverse order,
+  in whole blocks, and return the number of copied pixels. The remaining pixels are copied by the caller.
+
+  \ingroup PlusLibDataCollection
+*/
+namespace PlusFrameFlipClipSimd
+{
+  unsigned int MirrorRow8Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels);
+  unsigned int MirrorRow16Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels);
+  unsigned int MirrorRow32Avx2(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels);
+  unsigned int MirrorRow24Ssse3(const unsigned char* inputRow, unsigned char* outputRow, unsigned int numberOfPixels);
+}
+
+#endif
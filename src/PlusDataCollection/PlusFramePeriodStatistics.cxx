@@ -0,0 +1,222 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusFramePeriodStatistics.h"
+
+// STL includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::RunningStatistics::Add(double value)
+{
+  this->Count++;
+  double difference = value - this->Mean;
+  this->Mean += difference / this->Count;
+  this->SumOfSquaredDifferences += difference * (value - this->Mean);
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::RunningStatistics::Remove(double value)
+{
+  this->Count--;
+  if (this->Count <= 0)
+  {
+    this->Count = 0;
+    this->Mean = 0;
+    this->SumOfSquaredDifferences = 0;
+    return;
+  }
+  double difference = value - this->Mean;
+  this->Mean -= difference / this->Count;
+  this->SumOfSquaredDifferences -= difference * (value - this->Mean);
+  if (this->SumOfSquaredDifferences < 0)
+  {
+    // rounding error
+    this->SumOfSquaredDifferences = 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusFramePeriodStatistics::PlusFramePeriodStatistics()
+  : OldestPeriodIndex(0)
+  , NumberOfPeriods(0)
+  , NumberOfInvalidFrameIndices(0)
+  , NumberOfPeriodsSinceRecompute(0)
+  , HasPreviousItem(false)
+  , PreviousTimestamp(0)
+  , PreviousFrameIndex(0)
+  , PublishedNumberOfPeriods(0)
+  , PublishedMeanPeriod(0)
+  , PublishedPeriodStdev(0)
+  , PublishedNumberOfIdealPeriods(0)
+  , PublishedMeanIdealPeriod(0)
+  , PublishedIdealPeriodStdev(0)
+  , PublishedFrameIndicesValid(true)
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::Clear()
+{
+  this->OldestPeriodIndex = 0;
+  this->NumberOfPeriods = 0;
+  this->HasPreviousItem = false;
+  this->Recompute();
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::SetWindowSize(int numberOfFramePeriods)
+{
+  if (numberOfFramePeriods < 0)
+  {
+    numberOfFramePeriods = 0;
+  }
+  this->Periods.assign(numberOfFramePeriods, 0.0);
+  this->IdealPeriods.assign(numberOfFramePeriods, 0.0);
+  this->InvalidFrameIndices.assign(numberOfFramePeriods, false);
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::AddItem(double timestamp, unsigned long frameIndex)
+{
+  const bool hasPreviousItem = this->HasPreviousItem;
+  const double framePeriod = timestamp - this->PreviousTimestamp;
+  const int frameDiff = frameIndex - this->PreviousFrameIndex;
+  this->HasPreviousItem = true;
+  this->PreviousTimestamp = timestamp;
+  this->PreviousFrameIndex = frameIndex;
+  const int windowSize = this->GetWindowSize();
+  if (!hasPreviousItem || windowSize == 0)
+  {
+    return;
+  }
+
+  int periodIndex = this->OldestPeriodIndex + this->NumberOfPeriods;
+  if (this->NumberOfPeriods == windowSize)
+  {
+    // the window is full, remove the oldest period
+    periodIndex = this->OldestPeriodIndex;
+    if (this->Periods[periodIndex] > 0)
+    {
+      this->PeriodStatistics.Remove(this->Periods[periodIndex]);
+    }
+    if (this->IdealPeriods[periodIndex] > 0)
+    {
+      this->IdealPeriodStatistics.Remove(this->IdealPeriods[periodIndex]);
+    }
+    if (this->InvalidFrameIndices[periodIndex])
+    {
+      this->NumberOfInvalidFrameIndices--;
+    }
+    this->OldestPeriodIndex = (this->OldestPeriodIndex + 1) % windowSize;
+  }
+  else
+  {
+    this->NumberOfPeriods++;
+  }
+  if (periodIndex >= windowSize)
+  {
+    periodIndex -= windowSize;
+  }
+
+  // the same frame number was set for different frame indexes; this should not happen (probably no frame number is available)
+  const bool invalidFrameIndex = (frameDiff <= 0);
+  this->Periods[periodIndex] = framePeriod;
+  this->IdealPeriods[periodIndex] = (invalidFrameIndex ? framePeriod : framePeriod / frameDiff);
+  this->InvalidFrameIndices[periodIndex] = invalidFrameIndex;
+
+  if (++this->NumberOfPeriodsSinceRecompute >= windowSize)
+  {
+    this->Recompute();
+    return;
+  }
+
+  if (framePeriod > 0)
+  {
+    this->PeriodStatistics.Add(this->Periods[periodIndex]);
+  }
+  if (this->IdealPeriods[periodIndex] > 0)
+  {
+    this->IdealPeriodStatistics.Add(this->IdealPeriods[periodIndex]);
+  }
+  if (invalidFrameIndex)
+  {
+    this->NumberOfInvalidFrameIndices++;
+  }
+  this->Publish();
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::Recompute()
+{
+  this->PeriodStatistics = RunningStatistics();
+  this->IdealPeriodStatistics = RunningStatistics();
+  this->NumberOfInvalidFrameIndices = 0;
+  const int windowSize = this->GetWindowSize();
+  for (int i = 0; i < this->NumberOfPeriods; ++i)
+  {
+    int periodIndex = (this->OldestPeriodIndex + i) % windowSize;
+    if (this->Periods[periodIndex] > 0)
+    {
+      this->PeriodStatistics.Add(this->Periods[periodIndex]);
+    }
+    if (this->IdealPeriods[periodIndex] > 0)
+    {
+      this->IdealPeriodStatistics.Add(this->IdealPeriods[periodIndex]);
+    }
+    if (this->InvalidFrameIndices[periodIndex])
+    {
+      this->NumberOfInvalidFrameIndices++;
+    }
+  }
+  this->NumberOfPeriodsSinceRecompute = 0;
+  this->Publish();
+}
+
+//----------------------------------------------------------------------------
+void PlusFramePeriodStatistics::Publish()
+{
+  // Standard deviation of sampling period
+  // stdev = sqrt ( 1/N * sum[ (xi-mean)^2 ] )
+  this->PublishedMeanPeriod.store(this->PeriodStatistics.Mean, std::memory_order_relaxed);
+  this->PublishedPeriodStdev.store(this->PeriodStatistics.Count > 0 ? sqrt(this->PeriodStatistics.SumOfSquaredDifferences / this->PeriodStatistics.Count) : 0.0, std::memory_order_relaxed);
+  this->PublishedMeanIdealPeriod.store(this->IdealPeriodStatistics.Mean, std::memory_order_relaxed);
+  this->PublishedIdealPeriodStdev.store(this->IdealPeriodStatistics.Count > 0 ? sqrt(this->IdealPeriodStatistics.SumOfSquaredDifferences / this->IdealPeriodStatistics.Count) : 0.0, std::memory_order_relaxed);
+  this->PublishedFrameIndicesValid.store(this->NumberOfInvalidFrameIndices == 0, std::memory_order_relaxed);
+  this->PublishedNumberOfIdealPeriods.store(this->IdealPeriodStatistics.Count, std::memory_order_release);
+  this->PublishedNumberOfPeriods.store(this->PeriodStatistics.Count, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusFramePeriodStatistics::GetFrameRate(bool ideal, double& frameRate, double& framePeriodStdevSec, bool& frameIndicesValid) const
+{
+  int numberOfPeriods(0);
+  double meanPeriod(0);
+  if (ideal)
+  {
+    numberOfPeriods = this->PublishedNumberOfIdealPeriods.load(std::memory_order_acquire);
+    meanPeriod = this->PublishedMeanIdealPeriod.load(std::memory_order_relaxed);
+    framePeriodStdevSec = this->PublishedIdealPeriodStdev.load(std::memory_order_relaxed);
+    frameIndicesValid = this->PublishedFrameIndicesValid.load(std::memory_order_relaxed);
+  }
+  else
+  {
+    numberOfPeriods = this->PublishedNumberOfPeriods.load(std::memory_order_acquire);
+    meanPeriod = this->PublishedMeanPeriod.load(std::memory_order_relaxed);
+    framePeriodStdevSec = this->PublishedPeriodStdev.load(std::memory_order_relaxed);
+    frameIndicesValid = true;
+  }
+
+  if (numberOfPeriods < 1)
+  {
+    frameRate = 0;
+    framePeriodStdevSec = 0;
+    return PLUS_FAIL;
+  }
+  frameRate = (meanPeriod != 0 ? 1.0 / meanPeriod : 0);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusFramePeriodStatistics_h
+#define __PlusFramePeriodStatistics_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// STL includes
+#include <atomic>
+#include <vector>
+
+/*!
+  \class PlusFramePeriodStatistics
+  \brief Mean and standard deviation of the frame periods between consecutive items of a buffer, updated as items are added
+
+  The statistics are computed over a sliding window of the latest frame periods (a buffer of N items contains N-1 frame periods).
+  Each added item updates the mean and variance with Welford's method (the period that leaves the window is removed
+  the same way), so adding an item and querying the statistics take constant time. The sums are recomputed from the
+  stored periods after each full window to prevent accumulation of rounding errors.
+
+  Both the measured frame periods (timestamp differences) and the ideal frame periods (timestamp difference divided by
+  the frame index difference, which is not affected by skipped frames) are tracked. Non-positive periods are ignored,
+  as in the original buffer scan.
+
+  Items must be added by a single thread (the buffer writer, with the buffer lock held). GetFrameRate does not lock,
+  it may be called from any thread.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusFramePeriodStatistics
+{
+public:
+  PlusFramePeriodStatistics();
+
+  /*! Remove all items. The window size is not changed. */
+  void Clear();
+
+  /*! Set the maximum number of frame periods in the window (number of items in the buffer minus one). All items are removed. */
+  void SetWindowSize(int numberOfFramePeriods);
+  int GetWindowSize() const { return static_cast<int>(this->Periods.size()); }
+
+  /*! Add the timestamp and frame index of the latest item of the buffer */
+  void AddItem(double timestamp, unsigned long frameIndex);
+
+  /*!
+    Get the frame rate (1/mean frame period) and the standard deviation of the frame periods.
+    If ideal is true then the frame periods are normalized by the frame index differences.
+    frameIndicesValid is set to false if ideal frame periods are requested, but some consecutive items
+    have non-increasing frame indices (their periods are not normalized).
+    Returns PLUS_FAIL if there are no frame periods in the window.
+  */
+  PlusStatus GetFrameRate(bool ideal, double& frameRate, double& framePeriodStdevSec, bool& frameIndicesValid) const;
+
+protected:
+  /*! Running mean and sum of squared differences from the mean (Welford) */
+  struct RunningStatistics
+  {
+    RunningStatistics() : Count(0), Mean(0), SumOfSquaredDifferences(0) {}
+    void Add(double value);
+    void Remove(double value);
+    int Count;
+    double Mean;
+    double SumOfSquaredDifferences;
+  };
+
+  /*! Recompute the running statistics from the periods in the window */
+  void Recompute();
+
+  /*! Make the current statistics visible to GetFrameRate */
+  void Publish();
+
+  /*! Measured and ideal frame periods in the window, stored in a ring (oldest at OldestPeriodIndex) */
+  std::vector<double> Periods;
+  std::vector<double> IdealPeriods;
+  /*! For each period: true if the frame index did not increase, so the ideal period could not be computed */
+  std::vector<bool> InvalidFrameIndices;
+  int OldestPeriodIndex;
+  int NumberOfPeriods;
+
+  RunningStatistics PeriodStatistics;
+  RunningStatistics IdealPeriodStatistics;
+  int NumberOfInvalidFrameIndices;
+  int NumberOfPeriodsSinceRecompute;
+
+  bool HasPreviousItem;
+  double PreviousTimestamp;
+  unsigned long PreviousFrameIndex;
+
+  /*! Statistics that can be read without locking */
+  std::atomic<int> PublishedNumberOfPeriods;
+  std::atomic<double> PublishedMeanPeriod;
+  std::atomic<double> PublishedPeriodStdev;
+  std::atomic<int> PublishedNumberOfIdealPeriods;
+  std::atomic<double> PublishedMeanIdealPeriod;
+  std::atomic<double> PublishedIdealPeriodStdev;
+  std::atomic<bool> PublishedFrameIndicesValid;
+
+private:
+  PlusFramePeriodStatistics(const PlusFramePeriodStatistics&);
+  void operator=(const PlusFramePeriodStatistics&);
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusPoseInterpolator.h"
+
+// VTK includes
+#include <vtkMath.h>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+
+static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
+static const double SLERP_EPSILON = 1e-5; // same as in igsioMath::Slerp, below this angle linear interpolation is used
+static const double ORTHONORMALITY_TOLERANCE = 1e-10; // max deviation of R*R^T from identity where the closed form quaternion conversion is used
+static const int MATRIX_ELEMENT_COUNT = 16;
+static const unsigned int BLOCK_SIZE = 8; // number of samples processed together, the arrays of a block are on the stack so the compiler can vectorize the loops
+
+//----------------------------------------------------------------------------
+PlusPoseInterpolationSample::PlusPoseInterpolationSample()
+  : InterpolationRequired(false)
+  , SearchHintUid(0)
+  , ItemBWeight(0)
+  , UnfilteredTimestampA(0)
+  , UnfilteredTimestampB(0)
+{
+  std::fill(this->MatrixA, this->MatrixA + MATRIX_ELEMENT_COUNT, 0.0);
+  std::fill(this->MatrixB, this->MatrixB + MATRIX_ELEMENT_COUNT, 0.0);
+}
+
+//----------------------------------------------------------------------------
+PlusPoseInterpolator::PlusPoseInterpolator()
+{
+}
+
+//----------------------------------------------------------------------------
+void PlusPoseInterpolator::MatrixToQuaternion(const double* m, double* quat)
+{
+  // Check that the rotation part is orthonormal and is not a reflection
+  double maxDeviation = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = i; j < 3; j++)
+    {
+      double dot = m[i * 4 + 0] * m[j * 4 + 0] + m[i * 4 + 1] * m[j * 4 + 1] + m[i * 4 + 2] * m[j * 4 + 2];
+      maxDeviation = std::max(maxDeviation, fabs(dot - (i == j ? 1.0 : 0.0)));
+    }
+  }
+  double determinant = m[0] * (m[5] * m[10] - m[6] * m[9]) - m[1] * (m[4] * m[10] - m[6] * m[8]) + m[2] * (m[4] * m[9] - m[5] * m[8]);
+  if (maxDeviation > ORTHONORMALITY_TOLERANCE || determinant <= 0)
+  {
+    // Not a rotation, compute the closest one
+    double matrix[3][3] = {{m[0], m[1], m[2]}, {m[4], m[5], m[6]}, {m[8], m[9], m[10]}};
+    vtkMath::Matrix3x3ToQuaternion(matrix, quat);
+    return;
+  }
+
+  // Closed form conversion, the largest component is computed first for numerical stability
+  const double trace = m[0] + m[5] + m[10];
+  if (trace >= m[0] && trace >= m[5] && trace >= m[10])
+  {
+    double s = 2.0 * sqrt(1.0 + trace);
+    quat[0] = 0.25 * s;
+    quat[1] = (m[9] - m[6]) / s;
+    quat[2] = (m[2] - m[8]) / s;
+    quat[3] = (m[4] - m[1]) / s;
+  }
+  else if (m[0] >= m[5] && m[0] >= m[10])
+  {
+    double s = 2.0 * sqrt(1.0 + m[0] - m[5] - m[10]);
+    quat[0] = (m[9] - m[6]) / s;
+    quat[1] = 0.25 * s;
+    quat[2] = (m[1] + m[4]) / s;
+    quat[3] = (m[2] + m[8]) / s;
+  }
+  else if (m[5] >= m[10])
+  {
+    double s = 2.0 * sqrt(1.0 - m[0] + m[5] - m[10]);
+    quat[0] = (m[2] - m[8]) / s;
+    quat[1] = (m[1] + m[4]) / s;
+    quat[2] = 0.25 * s;
+    quat[3] = (m[6] + m[9]) / s;
+  }
+  else
+  {
+    double s = 2.0 * sqrt(1.0 - m[0] - m[5] + m[10]);
+    quat[0] = (m[4] - m[1]) / s;
+    quat[1] = (m[2] + m[8]) / s;
+    quat[2] = (m[6] + m[9]) / s;
+    quat[3] = 0.25 * s;
+  }
+}
+
+//----------------------------------------------------------------------------
+void PlusPoseInterpolator::Interpolate(std::vector<PlusPoseInterpolationSample>& samples, unsigned int numberOfSamples)
+{
+  numberOfSamples = std::min(numberOfSamples, static_cast<unsigned int>(samples.size()));
+
+  this->SampleIndices.clear();
+  for (unsigned int sampleIndex = 0; sampleIndex < numberOfSamples; ++sampleIndex)
+  {
+    if (samples[sampleIndex].InterpolationRequired)
+    {
+      this->SampleIndices.push_back(sampleIndex);
+    }
+  }
+  const unsigned int numberOfInterpolatedSamples = static_cast<unsigned int>(this->SampleIndices.size());
+
+  double maxAngleDiffDeg = 0;
+  for (unsigned int blockStart = 0; blockStart < numberOfInterpolatedSamples; blockStart += BLOCK_SIZE)
+  {
+    const unsigned int blockLength = std::min(BLOCK_SIZE, numberOfInterpolatedSamples - blockStart);
+
+    //============== Pack the orientations as quaternions ==================
+
+    // Unused elements of the block are interpolated between identity rotations
+    double weight[BLOCK_SIZE] = {0};
+    double qaw[BLOCK_SIZE] = {0};
+    double qax[BLOCK_SIZE] = {0};
+    double qay[BLOCK_SIZE] = {0};
+    double qaz[BLOCK_SIZE] = {0};
+    double qbw[BLOCK_SIZE] = {0};
+    double qbx[BLOCK_SIZE] = {0};
+    double qby[BLOCK_SIZE] = {0};
+    double qbz[BLOCK_SIZE] = {0};
+    std::fill(qaw, qaw + BLOCK_SIZE, 1.0);
+    std::fill(qbw, qbw + BLOCK_SIZE, 1.0);
+    for (unsigned int k = 0; k < blockLength; ++k)
+    {
+      const PlusPoseInterpolationSample& sample = samples[this->SampleIndices[blockStart + k]];
+      double quat[4] = {0, 0, 0, 0};
+      MatrixToQuaternion(sample.MatrixA, quat);
+      qaw[k] = quat[0];
+      qax[k] = quat[1];
+      qay[k] = quat[2];
+      qaz[k] = quat[3];
+      MatrixToQuaternion(sample.MatrixB, quat);
+      qbw[k] = quat[0];
+      qbx[k] = quat[1];
+      qby[k] = quat[2];
+      qbz[k] = quat[3];
+      weight[k] = sample.ItemBWeight;
+    }
+
+    //============== Interpolate rotation (same as igsioMath::Slerp) ==================
+
+    double cosom[BLOCK_SIZE];
+    double sign[BLOCK_SIZE];
+    for (unsigned int k = 0; k < BLOCK_SIZE; ++k)
+    {
+      const double dot = qaw[k] * qbw[k] + qax[k] * qbx[k] + qay[k] * qby[k] + qaz[k] * qbz[k];
+      // take the shorter path
+      sign[k] = (dot < 0.0 ? -1.0 : 1.0);
+      cosom[k] = dot * sign[k];
+    }
+    double scale0[BLOCK_SIZE];
+    double scale1[BLOCK_SIZE];
+    for (unsigned int k = 0; k < BLOCK_SIZE; ++k)
+    {
+      const double t = weight[k];
+      if ((1.0 - cosom[k]) > SLERP_EPSILON)
+      {
+        const double omega = acos(cosom[k]);
+        const double sinom = sin(omega);
+        scale0[k] = sin((1.0 - t) * omega) / sinom;
+        scale1[k] = sin(t * omega) / sinom;
+      }
+      else
+      {
+        scale0[k] = 1.0 - t;
+        scale1[k] = t;
+      }
+    }
+    double qw[BLOCK_SIZE], qx[BLOCK_SIZE], qy[BLOCK_SIZE], qz[BLOCK_SIZE];
+    for (unsigned int k = 0; k < BLOCK_SIZE; ++k)
+    {
+      const double signedScale1 = scale1[k] * sign[k];
+      qw[k] = scale0[k] * qaw[k] + signedScale1 * qbw[k];
+      qx[k] = scale0[k] * qax[k] + signedScale1 * qbx[k];
+      qy[k] = scale0[k] * qay[k] + signedScale1 * qby[k];
+      qz[k] = scale0[k] * qaz[k] + signedScale1 * qbz[k];
+    }
+
+    //============== Convert to rotation matrix (same as vtkMath::QuaternionToMatrix3x3) ==================
+
+    double rotation[9][BLOCK_SIZE];
+    for (unsigned int k = 0; k < BLOCK_SIZE; ++k)
+    {
+      const double ww = qw[k] * qw[k];
+      const double wx = qw[k] * qx[k];
+      const double wy = qw[k] * qy[k];
+      const double wz = qw[k] * qz[k];
+      const double xx = qx[k] * qx[k];
+      const double yy = qy[k] * qy[k];
+      const double zz = qz[k] * qz[k];
+      const double xy = qx[k] * qy[k];
+      const double xz = qx[k] * qz[k];
+      const double yz = qy[k] * qz[k];
+      const double rr = xx + yy + zz;
+      // normalization factor, just in case quaternion was not normalized
+      double f = 1.0 / (ww + rr);
+      const double s = (ww - rr) * f;
+      f *= 2.0;
+      rotation[0][k] = xx * f + s;
+      rotation[1][k] = (xy - wz) * f;
+      rotation[2][k] = (xz + wy) * f;
+      rotation[3][k] = (xy + wz) * f;
+      rotation[4][k] = yy * f + s;
+      rotation[5][k] = (yz - wx) * f;
+      rotation[6][k] = (xz - wy) * f;
+      rotation[7][k] = (yz + wx) * f;
+      rotation[8][k] = zz * f + s;
+    }
+
+    //============== Write interpolated results into the items ==================
+
+    for (unsigned int k = 0; k < blockLength; ++k)
+    {
+      PlusPoseInterpolationSample& sample = samples[this->SampleIndices[blockStart + k]];
+      const double itemBweight = weight[k];
+      const double itemAweight = 1.0 - itemBweight;
+      const double* elementsA = sample.MatrixA;
+      const double* elementsB = sample.MatrixB;
+
+      double interpolatedElements[MATRIX_ELEMENT_COUNT] =
+      {
+        rotation[0][k], rotation[1][k], rotation[2][k], elementsA[3] * itemAweight + elementsB[3] * itemBweight,
+        rotation[3][k], rotation[4][k], rotation[5][k], elementsA[7] * itemAweight + elementsB[7] * itemBweight,
+        rotation[6][k], rotation[7][k], rotation[8][k], elementsA[11] * itemAweight + elementsB[11] * itemBweight,
+        0, 0, 0, 1
+      };
+      sample.Item.SetMatrix(interpolatedElements);
+      sample.Item.SetUnfilteredTimestamp(sample.UnfilteredTimestampA * itemAweight + sample.UnfilteredTimestampB * itemBweight);
+
+      // Rotation angle between the interpolated and the original orientations: 2*acos(|<q1,q2>|)
+      double angleDiffA = 2.0 * vtkMath::DegreesFromRadians(acos(std::min(1.0, fabs(qw[k] * qaw[k] + qx[k] * qax[k] + qy[k] * qay[k] + qz[k] * qaz[k]))));
+      double angleDiffB = 2.0 * vtkMath::DegreesFromRadians(acos(std::min(1.0, fabs(qw[k] * qbw[k] + qx[k] * qbx[k] + qy[k] * qby[k] + qz[k] * qbz[k]))));
+      maxAngleDiffDeg = std::max(maxAngleDiffDeg, std::min(angleDiffA, angleDiffB));
+    }
+  }
+
+  if (maxAngleDiffDeg > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
+  {
+    static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+    if (helper.ShouldWeLog(true))
+    {
+      LOG_WARNING("Angle difference between interpolated orientations is large (" << maxAngleDiffDeg << " deg, warning threshold is " << ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG << "), interpolation may be inaccurate. Consider moving the tools slower.");
+    }
+  }
+}
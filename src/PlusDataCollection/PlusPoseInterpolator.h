@@ -0,0 +1,88 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusPoseInterpolator_h
+#define __PlusPoseInterpolator_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+#include "PlusStreamBufferItem.h"
+
+// STL includes
+#include <vector>
+
+/*!
+  \struct PlusPoseInterpolationSample
+  \brief Input and result of the interpolation of a pose at a requested time
+
+  Filled by vtkPlusBuffer::GetInterpolationSamplesFromTime. If no interpolation is needed (exact match, tool missing, etc.)
+  then Item already contains the final result. Otherwise Item contains the closest item with the filtered timestamp set
+  to the requested time, and its transform and unfiltered timestamp are computed by PlusPoseInterpolator from the two
+  bracketing poses.
+
+  \ingroup PlusLibDataCollection
+*/
+struct vtkPlusDataCollectionExport PlusPoseInterpolationSample
+{
+  PlusPoseInterpolationSample();
+
+  /*! Resulting item */
+  StreamBufferItem Item;
+  /*! If false then Item is already final and the remaining members are ignored */
+  bool InterpolationRequired;
+  /*! Transform matrix elements (row-major) of the closest item (A) and of the item on the other side of the requested time (B) */
+  double MatrixA[16];
+  double MatrixB[16];
+  /*!
+    UID of the item that was found by the previous lookup with this sample, the next lookup starts from here (0 if none).
+    Keeping the sample between consecutive lookups of the same tool makes the search by time faster.
+  */
+  BufferItemUidType SearchHintUid;
+  /*! Weight of item B, between 0 and 1 */
+  double ItemBWeight;
+  /*! Unfiltered timestamps of the two items, in local time */
+  double UnfilteredTimestampA;
+  double UnfilteredTimestampB;
+};
+
+/*!
+  \class PlusPoseInterpolator
+  \brief Interpolates the poses of many tools at once
+
+  Produces the same results as vtkPlusBuffer::GetStreamBufferItemFromTime with INTERPOLATED mode (spherical linear
+  interpolation of the orientation, linear interpolation of the position and the unfiltered timestamp),
+  but all the samples are processed together: the quaternions are packed into blocks of fixed size with one array per
+  component, so that the interpolation loops are free of dependencies between samples and can be vectorized by the compiler.
+
+  Orthonormal rotation matrices are converted to quaternions in closed form. Other matrices are converted
+  by vtkMath::Matrix3x3ToQuaternion, same as in the buffers.
+
+  No memory is allocated once the instance has processed the number of tools.
+  An instance must not be used from multiple threads at the same time.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusPoseInterpolator
+{
+public:
+  PlusPoseInterpolator();
+
+  /*! Compute the result of the first numberOfSamples samples that require interpolation */
+  void Interpolate(std::vector<PlusPoseInterpolationSample>& samples, unsigned int numberOfSamples);
+
+  /*!
+    Convert the rotation part of a row-major 4x4 matrix to a (w, x, y, z) quaternion.
+    Same result as vtkMath::Matrix3x3ToQuaternion (up to the sign of the quaternion).
+  */
+  static void MatrixToQuaternion(const double* matrixElements, double* quat);
+
+protected:
+  /*! Indices of the samples that require interpolation, kept to avoid allocation */
+  std::vector<unsigned int> SampleIndices;
+};
+
+#endif
@@ -6,8 +6,41 @@
 
 #include "PlusConfigure.h"
 #include "PlusStreamBufferItem.h"
+#include "vtkCommand.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationIntegerKey.h"
 #include "vtkMatrix4x4.h"
 
+#include <utility>
+
+vtkInformationKeyMacro(StreamBufferItem, FRAME_VIEW, Integer);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Releases a view of the pixel data of a buffer item when the view image is deleted */
+  class FrameViewReleaseCommand : public vtkCommand
+  {
+  public:
+    static FrameViewReleaseCommand* New()
+    {
+      return new FrameViewReleaseCommand;
+    }
+
+    virtual void Execute(vtkObject* vtkNotUsed(caller), unsigned long vtkNotUsed(eventId), void* vtkNotUsed(callData))
+    {
+      if (this->FrameViewCount != NULL)
+      {
+        this->FrameViewCount->fetch_sub(1);
+        this->FrameViewCount.reset();
+      }
+    }
+
+    std::shared_ptr<std::atomic<int> > FrameViewCount;
+  };
+}
+
 //----------------------------------------------------------------------------
 //            DataBufferItem
 //----------------------------------------------------------------------------
@@ -16,6 +49,7 @@ StreamBufferItem::StreamBufferItem()
   , UnfilteredTimeStamp(0)
   , Index(0)
   , Uid(0)
+  , NumberOfFrameFields(0)
   , ValidTransformData(false)
   , Matrix(vtkSmartPointer<vtkMatrix4x4>::New())
   , Status(TOOL_OK)
@@ -32,6 +66,7 @@ StreamBufferItem::StreamBufferItem(const StreamBufferItem& dataItem)
 {
   this->Matrix = vtkSmartPointer<vtkMatrix4x4>::New();
   this->Status = TOOL_OK;
+  this->NumberOfFrameFields = 0;
   *this = dataItem;
 }
 
@@ -44,12 +79,14 @@ StreamBufferItem& StreamBufferItem::operator=(StreamBufferItem const& dataItem)
     return *this;
   }
 
+  // The assignment reuses the image of the frame if it has the same size, which must not change pixel data that is referenced by others
+  this->ReleaseSharedFrame();
   this->Frame = dataItem.Frame;
   this->FilteredTimeStamp = dataItem.FilteredTimeStamp;
   this->UnfilteredTimeStamp = dataItem.UnfilteredTimeStamp;
   this->Index = dataItem.Index;
   this->Uid = dataItem.Uid;
-  this->FrameFields = dataItem.FrameFields;
+  this->CopyFrameFields(dataItem);
   this->Status = dataItem.Status;
   this->Matrix->DeepCopy(dataItem.Matrix);
   this->ValidTransformData = dataItem.ValidTransformData;
@@ -58,10 +95,53 @@ StreamBufferItem& StreamBufferItem::operator=(StreamBufferItem const& dataItem)
 }
 
 //----------------------------------------------------------------------------
-void StreamBufferItem::SetFrameField(std::string fieldName, std::string fieldValue, igsioFrameFieldFlags flags)
+void StreamBufferItem::SetFrameFieldNameTable(const std::shared_ptr<PlusFrameFieldNameTable>& nameTable)
 {
-  this->FrameFields[fieldName].first = flags;
-  this->FrameFields[fieldName].second = fieldValue;
+  if (this->FrameFieldNames == nameTable)
+  {
+    return;
+  }
+  if (this->FrameFieldNames != NULL && nameTable != NULL)
+  {
+    // Keys of the current fields are replaced by the keys of the new table
+    for (unsigned int i = 0; i < this->NumberOfFrameFields; ++i)
+    {
+      this->FrameFields[i].Key = nameTable->Intern(this->FrameFieldNames->GetName(this->FrameFields[i].Key));
+    }
+  }
+  else
+  {
+    this->NumberOfFrameFields = 0;
+  }
+  this->FrameFieldNames = nameTable;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetFrameField(const std::string& fieldName, const std::string& fieldValue, igsioFrameFieldFlags flags)
+{
+  if (this->FrameFieldNames == NULL)
+  {
+    this->FrameFieldNames = std::make_shared<PlusFrameFieldNameTable>();
+  }
+  this->SetFrameFieldByKey(this->FrameFieldNames->Intern(fieldName), fieldValue, flags);
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetFrameFieldByKey(PlusFrameFieldNameTable::KeyType key, const std::string& fieldValue, igsioFrameFieldFlags flags)
+{
+  int fieldIndex = this->FindFrameField(key);
+  if (fieldIndex < 0)
+  {
+    if (this->NumberOfFrameFields == this->FrameFields.size())
+    {
+      this->FrameFields.push_back(FrameField());
+    }
+    fieldIndex = this->NumberOfFrameFields++;
+    this->FrameFields[fieldIndex].Key = key;
+  }
+  this->FrameFields[fieldIndex].Flags = flags;
+  // the string keeps its memory, assignment does not allocate if the previous value was at least as long
+  this->FrameFields[fieldIndex].Value.assign(fieldValue);
 }
 
 //----------------------------------------------------------------------------
@@ -72,14 +152,101 @@ std::string StreamBufferItem::GetFrameField(const std::string& fieldName) const
     LOG_ERROR("Unable to get frame field: field name is NULL!");
     return "";
   }
+  return this->GetFrameFieldValue(fieldName);
+}
+
+//----------------------------------------------------------------------------
+const std::string& StreamBufferItem::GetFrameFieldValue(const std::string& fieldName) const
+{
+  static const std::string emptyValue;
+  PlusFrameFieldNameTable::KeyType key(0);
+  if (this->FrameFieldNames == NULL || !this->FrameFieldNames->Find(fieldName, key))
+  {
+    return emptyValue;
+  }
+  int fieldIndex = this->FindFrameField(key);
+  if (fieldIndex < 0)
+  {
+    return emptyValue;
+  }
+  return this->FrameFields[fieldIndex].Value;
+}
+
+//----------------------------------------------------------------------------
+const std::string& StreamBufferItem::GetFrameFieldNameAt(unsigned int fieldIndex) const
+{
+  return this->FrameFieldNames->GetName(this->FrameFields[fieldIndex].Key);
+}
+
+//----------------------------------------------------------------------------
+bool StreamBufferItem::IsTransformFrameFieldAt(unsigned int fieldIndex) const
+{
+  return this->FrameFieldNames->IsTransformField(this->FrameFields[fieldIndex].Key);
+}
+
+//----------------------------------------------------------------------------
+igsioFieldMapType StreamBufferItem::GetFrameFieldMap() const
+{
+  igsioFieldMapType fields;
+  for (unsigned int i = 0; i < this->NumberOfFrameFields; ++i)
+  {
+    fields[this->GetFrameFieldNameAt(i)] = std::make_pair(this->FrameFields[i].Flags, this->FrameFields[i].Value);
+  }
+  return fields;
+}
 
-  igsioFieldMapType::const_iterator fieldIterator;
-  fieldIterator = this->FrameFields.find(fieldName);
-  if (fieldIterator != this->FrameFields.end())
+//----------------------------------------------------------------------------
+void StreamBufferItem::SetFrameFieldMap(const igsioFieldMapType& fields)
+{
+  this->ClearFrameFields();
+  for (igsioFieldMapType::const_iterator it = fields.begin(); it != fields.end(); ++it)
   {
-    return fieldIterator->second.second;
+    this->SetFrameField(it->first, it->second.second, it->second.first);
   }
-  return "";
+}
+
+//----------------------------------------------------------------------------
+int StreamBufferItem::FindFrameField(PlusFrameFieldNameTable::KeyType key) const
+{
+  // items have a few dozen fields at most, a linear search is faster than a lookup structure
+  for (unsigned int i = 0; i < this->NumberOfFrameFields; ++i)
+  {
+    if (this->FrameFields[i].Key == key)
+    {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::CopyFrameFields(const StreamBufferItem& dataItem)
+{
+  if (this->FrameFieldNames == NULL)
+  {
+    this->FrameFieldNames = dataItem.FrameFieldNames;
+  }
+  if (this->FrameFieldNames != dataItem.FrameFieldNames)
+  {
+    // different name tables, fields are copied by name
+    this->ClearFrameFields();
+    for (unsigned int i = 0; i < dataItem.NumberOfFrameFields; ++i)
+    {
+      this->SetFrameField(dataItem.GetFrameFieldNameAt(i), dataItem.FrameFields[i].Value, dataItem.FrameFields[i].Flags);
+    }
+    return;
+  }
+  if (this->FrameFields.size() < dataItem.NumberOfFrameFields)
+  {
+    this->FrameFields.resize(dataItem.NumberOfFrameFields);
+  }
+  for (unsigned int i = 0; i < dataItem.NumberOfFrameFields; ++i)
+  {
+    this->FrameFields[i].Key = dataItem.FrameFields[i].Key;
+    this->FrameFields[i].Flags = dataItem.FrameFields[i].Flags;
+    this->FrameFields[i].Value.assign(dataItem.FrameFields[i].Value);
+  }
+  this->NumberOfFrameFields = dataItem.NumberOfFrameFields;
 }
 
 //----------------------------------------------------------------------------
@@ -91,10 +258,17 @@ PlusStatus StreamBufferItem::DeleteFrameField(const char* fieldName)
     return PLUS_FAIL;
   }
 
-  igsioFieldMapType::iterator field = this->FrameFields.find(fieldName);
-  if (field != this->FrameFields.end())
+  PlusFrameFieldNameTable::KeyType key(0);
+  int fieldIndex = -1;
+  if (this->FrameFieldNames != NULL && this->FrameFieldNames->Find(fieldName, key))
+  {
+    fieldIndex = this->FindFrameField(key);
+  }
+  if (fieldIndex >= 0)
   {
-    this->FrameFields.erase(field);
+    // the last field is moved to the place of the deleted field, the memory of the deleted value is kept for reuse
+    std::swap(this->FrameFields[fieldIndex], this->FrameFields[this->NumberOfFrameFields - 1]);
+    this->NumberOfFrameFields--;
     return PLUS_SUCCESS;
   }
   LOG_DEBUG("Failed to delete frame field - could find field " << fieldName);
@@ -116,11 +290,130 @@ PlusStatus StreamBufferItem::DeepCopy(StreamBufferItem* dataItem)
     return PLUS_FAIL;
   }
 
+  // The assignment releases the pixel data of this item first if it is shared (see ReleaseSharedFrame)
   (*this) = (*dataItem);
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::ShallowCopy(StreamBufferItem* dataItem)
+{
+  if (dataItem == NULL)
+  {
+    LOG_ERROR("Failed to shallow copy data buffer item - buffer item NULL!");
+    return PLUS_FAIL;
+  }
+
+  if (IsFrameViewImage(this->Frame.GetImage()))
+  {
+    // The previous view is released, the frame assignment below must not write into the pixel data of the view
+    this->Frame.SetImageData(vtkSmartPointer<vtkImageData>::New());
+  }
+
+  if (dataItem->Frame.IsFrameEncoded() || dataItem->Frame.GetImage() == NULL)
+  {
+    // Encoded frames are not shared
+    this->Frame = dataItem->Frame;
+  }
+  else
+  {
+    // The view image shares the pixel array, the view is counted in the source item until the view image is deleted
+    if (dataItem->FrameViewCount == NULL)
+    {
+      dataItem->FrameViewCount = std::make_shared<std::atomic<int> >(0);
+    }
+    vtkSmartPointer<vtkImageData> viewImage = vtkSmartPointer<vtkImageData>::New();
+    viewImage->ShallowCopy(dataItem->Frame.GetImage());
+    viewImage->GetInformation()->Set(FRAME_VIEW(), 1);
+    vtkSmartPointer<FrameViewReleaseCommand> releaseCommand = vtkSmartPointer<FrameViewReleaseCommand>::New();
+    releaseCommand->FrameViewCount = dataItem->FrameViewCount;
+    dataItem->FrameViewCount->fetch_add(1);
+    viewImage->AddObserver(vtkCommand::DeleteEvent, releaseCommand);
+
+    this->Frame.SetImageData(viewImage);
+    this->Frame.SetImageType(dataItem->Frame.GetImageType());
+    this->Frame.SetImageOrientation(dataItem->Frame.GetImageOrientation());
+  }
+  this->FilteredTimeStamp = dataItem->FilteredTimeStamp;
+  this->UnfilteredTimeStamp = dataItem->UnfilteredTimeStamp;
+  this->Index = dataItem->Index;
+  this->Uid = dataItem->Uid;
+  this->CopyFrameFields(*dataItem);
+  this->Status = dataItem->Status;
+  this->Matrix->DeepCopy(dataItem->Matrix);
+  this->ValidTransformData = dataItem->ValidTransformData;
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool StreamBufferItem::IsFrameShared() const
+{
+  return IsFrameViewImage(this->Frame.GetImage()) || this->GetNumberOfFrameViews() > 0;
+}
+
+//----------------------------------------------------------------------------
+int StreamBufferItem::GetNumberOfFrameViews() const
+{
+  return (this->FrameViewCount != NULL ? this->FrameViewCount->load() : 0);
+}
+
+//----------------------------------------------------------------------------
+bool StreamBufferItem::IsFrameViewImage(vtkImageData* image)
+{
+  return image != NULL && image->GetInformation()->Has(FRAME_VIEW());
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::ReleaseSharedFrame()
+{
+  if (!this->IsFrameShared())
+  {
+    return;
+  }
+
+  // The views keep the previous pixel data, they do not count in this item anymore
+  this->FrameViewCount.reset();
+  this->Frame.SetImageData(vtkSmartPointer<vtkImageData>::New());
+}
+
+//----------------------------------------------------------------------------
+void StreamBufferItem::SwapFramePixelData(StreamBufferItem* item)
+{
+  vtkSmartPointer<vtkImageData> image = this->Frame.GetImage();
+  this->Frame.SetImageData(item->Frame.GetImage());
+  item->Frame.SetImageData(image);
+  std::swap(this->FrameViewCount, item->FrameViewCount);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::DetachSharedFrame()
+{
+  if (!this->IsFrameShared())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  FrameSizeType frameSize = { 0, 0, 0 };
+  this->Frame.GetFrameSize(frameSize);
+  unsigned int numberOfScalarComponents(1);
+  this->Frame.GetNumberOfScalarComponents(numberOfScalarComponents);
+  igsioCommon::VTKScalarPixelType pixelType = this->Frame.GetVTKScalarPixelType();
+
+  // The views keep the previous pixel data, they do not count in this item anymore
+  this->FrameViewCount.reset();
+  vtkSmartPointer<vtkImageData> detachedImage = vtkSmartPointer<vtkImageData>::New();
+  this->Frame.SetImageData(detachedImage);
+  if (this->Frame.AllocateFrame(frameSize, pixelType, numberOfScalarComponents) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to allocate memory for detaching shared frame");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus StreamBufferItem::SetMatrix(vtkMatrix4x4* matrix)
 {
@@ -137,6 +430,22 @@ PlusStatus StreamBufferItem::SetMatrix(vtkMatrix4x4* matrix)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus StreamBufferItem::SetMatrix(const double matrixElements[16])
+{
+  if (matrixElements == NULL)
+  {
+    LOG_ERROR("Failed to set matrix - input matrix is NULL!");
+    return PLUS_FAIL;
+  }
+
+  ValidTransformData = true;
+
+  this->Matrix->DeepCopy(matrixElements);
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus StreamBufferItem::GetMatrix(vtkMatrix4x4* outputMatrix)
 {
@@ -166,5 +475,5 @@ ToolStatus StreamBufferItem::GetStatus() const
 //----------------------------------------------------------------------------
 bool StreamBufferItem::HasValidFieldData() const
 {
-  return this->FrameFields.size() > 0;
+  return this->NumberOfFrameFields > 0;
 }
\ No newline at end of file
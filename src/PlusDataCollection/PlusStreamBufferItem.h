@@ -7,6 +7,7 @@ See License.txt for details.
 #ifndef __StreamBufferItem_h
 #define __StreamBufferItem_h
 
+#include "PlusFrameFieldNameTable.h"
 #include "vtkPlusDataCollectionExport.h"
 
 // IGSIO includes
@@ -15,8 +16,12 @@ See License.txt for details.
 // VTK includes
 #include <vtkSmartPointer.h>
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
+class vtkImageData;
+class vtkInformationIntegerKey;
 class vtkMatrix4x4;
 class vtkPlusDevice;
 class vtkPlusChannel;
@@ -42,6 +47,11 @@ public:
   virtual ~StreamBufferItem();
 
   StreamBufferItem(const StreamBufferItem& dataItem);
+  /*!
+    Copy the item. If the pixel data of this item is shared (see IsFrameShared) then it is released first
+    (see ReleaseSharedFrame) and the copy is made into a newly allocated image. vtkPlusBuffer releases
+    its shared slots itself before it assigns them, so that the released pixel data is accounted for.
+  */
   StreamBufferItem& operator=(StreamBufferItem const& dataItem);
 
   /*! Get timestamp for the current buffer item in global time (global = local + offset) */
@@ -71,24 +81,104 @@ public:
   BufferItemUidType GetUid() { return this->Uid; };
   void SetUid(BufferItemUidType uid) { this->Uid = uid; };
 
+  /*!
+    Set the table that assigns integer keys to the frame field names. The items of a buffer share the table of the buffer.
+    Fields that are already set are kept. If no table is set then the item creates its own table when the first field is set.
+  */
+  void SetFrameFieldNameTable(const std::shared_ptr<PlusFrameFieldNameTable>& nameTable);
+  /*! Get the table that assigns integer keys to the frame field names */
+  const std::shared_ptr<PlusFrameFieldNameTable>& GetFrameFieldNameTable() const { return this->FrameFieldNames; }
+
   /*! Set frame field */
-  void SetFrameField(std::string fieldName, std::string fieldValue, igsioFrameFieldFlags flags = FRAMEFIELD_NONE);
+  void SetFrameField(const std::string& fieldName, const std::string& fieldValue, igsioFrameFieldFlags flags = FRAMEFIELD_NONE);
+  /*! Set frame field, the key is obtained from the frame field name table of the item */
+  void SetFrameFieldByKey(PlusFrameFieldNameTable::KeyType key, const std::string& fieldValue, igsioFrameFieldFlags flags = FRAMEFIELD_NONE);
 
   /*! Get frame field value */
   std::string GetFrameField(const std::string& fieldName) const;
-  /*! Get frame field map */
-  igsioFieldMapType GetFrameFieldMap() {return this->FrameFields;}
+  /*! Get a reference to a frame field value (empty string if the field is not set). The reference is valid until the item is modified. */
+  const std::string& GetFrameFieldValue(const std::string& fieldName) const;
+
+  /*!
+    Get the number of frame fields. The fields can be accessed by index (0 <= index < number of fields)
+    with the ...At methods without copying.
+  */
+  unsigned int GetNumberOfFrameFields() const { return this->NumberOfFrameFields; }
+  const std::string& GetFrameFieldNameAt(unsigned int fieldIndex) const;
+  const std::string& GetFrameFieldValueAt(unsigned int fieldIndex) const { return this->FrameFields[fieldIndex].Value; }
+  igsioFrameFieldFlags GetFrameFieldFlagsAt(unsigned int fieldIndex) const { return this->FrameFields[fieldIndex].Flags; }
+  /*! Returns true if the name of the frame field contains "Transform" */
+  bool IsTransformFrameFieldAt(unsigned int fieldIndex) const;
+
+  /*! Get frame field map. The map is built from the fields of the item, the ...At methods are faster. */
+  igsioFieldMapType GetFrameFieldMap() const;
+  /*! Replace all frame fields */
+  void SetFrameFieldMap(const igsioFieldMapType& fields);
+  /*! Remove all frame fields. The memory of the field values is kept for reuse. */
+  void ClearFrameFields() { this->NumberOfFrameFields = 0; }
   /*! Delete frame field */
   PlusStatus DeleteFrameField(const char* fieldName);
   PlusStatus DeleteFrameField(const std::string& fieldName);
 
-  /*! Copy stream buffer item */
+  /*! Copy stream buffer item. Pixel data that this item shares with others is released first, so it is never overwritten. */
   PlusStatus DeepCopy(StreamBufferItem* dataItem);
 
+  /*!
+    Copy stream buffer item, but reference the pixel data of the source frame instead of copying it.
+    The frame of this item gets a view image: a separate image object that shares the pixel array of the source frame.
+    The view is counted in the source item until the view image is deleted, wherever the view image is passed on
+    (e.g., to a tracked frame). The referenced pixel data must be treated as read-only. The buffer does not
+    overwrite pixel data that is still referenced by views (see DetachSharedFrame).
+  */
+  PlusStatus ShallowCopy(StreamBufferItem* dataItem);
+
+  /*!
+    Returns true if the frame is a view of the pixel data of another item, or if views of the pixel data of this item exist.
+    Other references of the image (e.g., by VTK filters or temporary smart pointers) are not counted.
+  */
+  bool IsFrameShared() const;
+
+  /*! Get the number of view images of the pixel data of this item that still exist (see ShallowCopy) */
+  int GetNumberOfFrameViews() const;
+
+  /*!
+    Get the counter of the views of the pixel data of this item. The views decrement it when they are deleted,
+    therefore it can be used to find out when the views of pixel data that was detached are gone. NULL if no view was created.
+  */
+  std::shared_ptr<const std::atomic<int> > GetFrameViewCounter() const { return this->FrameViewCount; }
+
+  /*! Returns true if the image is a view of the pixel data of a buffer item (see ShallowCopy) */
+  static bool IsFrameViewImage(vtkImageData* image);
+
+  /*! Key that marks view images in their information */
+  static vtkInformationIntegerKey* FRAME_VIEW();
+
+  /*!
+    Replace the pixel data of the frame by a newly allocated image with the same format, so that the
+    previous pixel data remains unchanged for the views that still reference it. Views of the previous
+    pixel data are not counted in this item anymore. Buffer slots are detached by vtkPlusBuffer::DetachSharedSlotFrame,
+    which accounts for the previous pixel data.
+  */
+  PlusStatus DetachSharedFrame();
+
+  /*!
+    Replace shared pixel data of the frame by an empty image, without allocating new pixel data.
+    The views keep the previous pixel data and are not counted in this item anymore.
+  */
+  void ReleaseSharedFrame();
+
+  /*!
+    Exchange the pixel data of the frames of two items, together with the counters of their views.
+    Used by vtkPlusBuffer to give the pixel data of a slot to another slot without copying.
+  */
+  void SwapFramePixelData(StreamBufferItem* item);
+
   igsioVideoFrame& GetFrame() { return this->Frame; };
 
   /*! Set tracker matrix */
   PlusStatus SetMatrix(vtkMatrix4x4* matrix);
+  /*! Set tracker matrix from 16 elements (row-major) */
+  PlusStatus SetMatrix(const double matrixElements[16]);
   /*! Get tracker matrix */
   PlusStatus GetMatrix(vtkMatrix4x4* outputMatrix);
 
@@ -105,6 +195,21 @@ public:
     return Frame.IsImageValid();
   }
 
+protected:
+  /*! Copy the frame fields of another item, the values are copied into the existing strings if possible */
+  void CopyFrameFields(const StreamBufferItem& dataItem);
+
+  /*! Get the index of the field with the specified key, -1 if the field is not set */
+  int FindFrameField(PlusFrameFieldNameTable::KeyType key) const;
+
+  struct FrameField
+  {
+    FrameField() : Key(0), Flags(FRAMEFIELD_NONE) {}
+    PlusFrameFieldNameTable::KeyType Key;
+    igsioFrameFieldFlags Flags;
+    std::string Value;
+  };
+
 protected:
   double FilteredTimeStamp;
   double UnfilteredTimeStamp;
@@ -115,11 +220,22 @@ protected:
   /*! unique identifier assigned by the storage buffer, it is guaranteed to increase monotonously, by one for each frame that is added to the buffer*/
   BufferItemUidType Uid;
 
-  /*! Custom frame fields */
-  igsioFieldMapType FrameFields;
+  /*! Assigns keys to the custom frame field names, shared by the items of a buffer */
+  std::shared_ptr<PlusFrameFieldNameTable> FrameFieldNames;
+  /*!
+    Custom frame fields. Only the first NumberOfFrameFields elements are valid, the rest are kept
+    so that the memory of their values can be reused when the item is overwritten in the buffer.
+  */
+  std::vector<FrameField> FrameFields;
+  unsigned int NumberOfFrameFields;
 
   bool ValidTransformData;
   igsioVideoFrame Frame;
+  /*!
+    Number of view images of the pixel data of the frame that still exist, created by the first ShallowCopy of this item.
+    It is shared with the views, so that they can decrement it from any thread when they are deleted.
+  */
+  std::shared_ptr<std::atomic<int> > FrameViewCount;
   vtkSmartPointer<vtkMatrix4x4> Matrix;
   ToolStatus Status;
 };
@@ -0,0 +1,293 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusThreadSettings.h"
+
+// VTK includes
+#include <vtkXMLDataElement.h>
+
+// STL includes
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+// OS includes
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetSchedulingPolicyAsString(PlusThreadSettings::SchedulingPolicyType policy)
+  {
+    switch (policy)
+    {
+      case PlusThreadSettings::SCHEDULING_POLICY_FIFO:
+        return "FIFO";
+      case PlusThreadSettings::SCHEDULING_POLICY_RR:
+        return "RR";
+      default:
+        return "OTHER";
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusThreadSettings::PlusThreadSettings()
+  : SchedulingPolicy(SCHEDULING_POLICY_OTHER)
+  , Priority(0)
+{
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadSettings::ParseCpuList(const std::string& cpuList, std::vector<int>& cpuIndices)
+{
+  cpuIndices.clear();
+  std::string normalizedList(cpuList);
+  std::replace(normalizedList.begin(), normalizedList.end(), ',', ' ');
+  std::istringstream listStream(normalizedList);
+  std::string item;
+  while (listStream >> item)
+  {
+    int first(-1);
+    int last(-1);
+    std::string::size_type separatorPos = item.find('-', 1);
+    if (separatorPos == std::string::npos)
+    {
+      if (igsioCommon::StringToInt<int>(item.c_str(), first) != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      last = first;
+    }
+    else if (igsioCommon::StringToInt<int>(item.substr(0, separatorPos).c_str(), first) != PLUS_SUCCESS
+             || igsioCommon::StringToInt<int>(item.substr(separatorPos + 1).c_str(), last) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    if (first < 0 || last < first)
+    {
+      return PLUS_FAIL;
+    }
+    for (int cpuIndex = first; cpuIndex <= last; ++cpuIndex)
+    {
+      if (std::find(cpuIndices.begin(), cpuIndices.end(), cpuIndex) == cpuIndices.end())
+      {
+        cpuIndices.push_back(cpuIndex);
+      }
+    }
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadSettings::ReadConfiguration(vtkXMLDataElement* element, const std::string& attributePrefix/*=""*/)
+{
+  if (element == NULL)
+  {
+    LOG_ERROR("Unable to read thread settings: xml data element is NULL");
+    return PLUS_FAIL;
+  }
+
+  const std::string cpuAffinityAttributeName = attributePrefix + "CpuAffinity";
+  const char* cpuAffinity = element->GetAttribute(cpuAffinityAttributeName.c_str());
+  if (cpuAffinity != NULL)
+  {
+    if (ParseCpuList(cpuAffinity, this->CpuAffinity) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid " << cpuAffinityAttributeName << " \"" << cpuAffinity << "\". Expected a list of CPU indices, e.g., \"0 2\" or \"0-3\"");
+      return PLUS_FAIL;
+    }
+  }
+
+  const std::string schedulingPolicyAttributeName = attributePrefix + "ThreadSchedulingPolicy";
+  const char* schedulingPolicy = element->GetAttribute(schedulingPolicyAttributeName.c_str());
+  if (schedulingPolicy != NULL)
+  {
+    if (STRCASECMP(schedulingPolicy, "OTHER") == 0)
+    {
+      this->SchedulingPolicy = SCHEDULING_POLICY_OTHER;
+    }
+    else if (STRCASECMP(schedulingPolicy, "FIFO") == 0)
+    {
+      this->SchedulingPolicy = SCHEDULING_POLICY_FIFO;
+    }
+    else if (STRCASECMP(schedulingPolicy, "RR") == 0)
+    {
+      this->SchedulingPolicy = SCHEDULING_POLICY_RR;
+    }
+    else
+    {
+      LOG_ERROR("Invalid " << schedulingPolicyAttributeName << " \"" << schedulingPolicy << "\". Valid values: OTHER, FIFO, RR");
+      return PLUS_FAIL;
+    }
+  }
+
+  const std::string priorityAttributeName = attributePrefix + "ThreadPriority";
+  int priority(0);
+  if (element->GetScalarAttribute(priorityAttributeName.c_str(), priority))
+  {
+    if (priority < 0)
+    {
+      LOG_ERROR("Invalid " << priorityAttributeName << ": " << priority);
+      return PLUS_FAIL;
+    }
+    this->Priority = priority;
+  }
+
+  const std::string threadNameAttributeName = attributePrefix + "ThreadName";
+  const char* threadName = element->GetAttribute(threadNameAttributeName.c_str());
+  if (threadName != NULL)
+  {
+    this->ThreadName = threadName;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadSettings::WriteConfiguration(vtkXMLDataElement* element, const std::string& attributePrefix/*=""*/) const
+{
+  if (element == NULL)
+  {
+    LOG_ERROR("Unable to write thread settings: xml data element is NULL");
+    return PLUS_FAIL;
+  }
+
+  if (!this->CpuAffinity.empty())
+  {
+    std::ostringstream cpuAffinity;
+    for (std::vector<int>::const_iterator it = this->CpuAffinity.begin(); it != this->CpuAffinity.end(); ++it)
+    {
+      cpuAffinity << (it == this->CpuAffinity.begin() ? "" : " ") << *it;
+    }
+    element->SetAttribute((attributePrefix + "CpuAffinity").c_str(), cpuAffinity.str().c_str());
+  }
+  if (this->SchedulingPolicy != SCHEDULING_POLICY_OTHER)
+  {
+    element->SetAttribute((attributePrefix + "ThreadSchedulingPolicy").c_str(), GetSchedulingPolicyAsString(this->SchedulingPolicy).c_str());
+    element->SetIntAttribute((attributePrefix + "ThreadPriority").c_str(), this->Priority);
+  }
+  if (!this->ThreadName.empty())
+  {
+    element->SetAttribute((attributePrefix + "ThreadName").c_str(), this->ThreadName.c_str());
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+bool PlusThreadSettings::IsDefault() const
+{
+  return this->CpuAffinity.empty() && this->SchedulingPolicy == SCHEDULING_POLICY_OTHER && this->ThreadName.empty();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus PlusThreadSettings::ApplyToCurrentThread() const
+{
+  PlusStatus status(PLUS_SUCCESS);
+
+#ifdef _WIN32
+  if (!this->CpuAffinity.empty())
+  {
+    DWORD_PTR affinityMask(0);
+    for (std::vector<int>::const_iterator it = this->CpuAffinity.begin(); it != this->CpuAffinity.end(); ++it)
+    {
+      if (*it < static_cast<int>(sizeof(DWORD_PTR) * 8))
+      {
+        affinityMask |= (static_cast<DWORD_PTR>(1) << *it);
+      }
+    }
+    if (affinityMask == 0 || SetThreadAffinityMask(GetCurrentThread(), affinityMask) == 0)
+    {
+      LOG_WARNING("Failed to set the CPU affinity of thread " << this->ThreadName << " (error code: " << GetLastError() << ")");
+      status = PLUS_FAIL;
+    }
+  }
+  if (this->SchedulingPolicy != SCHEDULING_POLICY_OTHER)
+  {
+    // Windows has no real-time scheduling policies, the highest priority of the process priority class is the closest match
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+    {
+      LOG_WARNING("Failed to set the priority of thread " << this->ThreadName << " (error code: " << GetLastError() << ")");
+      status = PLUS_FAIL;
+    }
+  }
+  if (!this->ThreadName.empty())
+  {
+    LOG_DEBUG("Thread names are not set on Windows, thread " << this->ThreadName << " keeps its default name");
+  }
+#else
+  if (!this->CpuAffinity.empty())
+  {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (std::vector<int>::const_iterator it = this->CpuAffinity.begin(); it != this->CpuAffinity.end(); ++it)
+    {
+      if (*it < CPU_SETSIZE)
+      {
+        CPU_SET(*it, &cpuSet);
+      }
+    }
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+    if (error != 0)
+    {
+      LOG_WARNING("Failed to set the CPU affinity of thread " << this->ThreadName << ": " << strerror(error));
+      status = PLUS_FAIL;
+    }
+#else
+    LOG_WARNING("CPU affinity is not supported on this platform, thread " << this->ThreadName << " may run on any CPU");
+    status = PLUS_FAIL;
+#endif
+  }
+
+  if (this->SchedulingPolicy != SCHEDULING_POLICY_OTHER)
+  {
+    int policy = (this->SchedulingPolicy == SCHEDULING_POLICY_FIFO ? SCHED_FIFO : SCHED_RR);
+    struct sched_param schedulingParameters;
+    memset(&schedulingParameters, 0, sizeof(schedulingParameters));
+    schedulingParameters.sched_priority = this->Priority;
+    int error(0);
+    if (this->Priority < sched_get_priority_min(policy) || this->Priority > sched_get_priority_max(policy))
+    {
+      LOG_WARNING("Priority " << this->Priority << " of thread " << this->ThreadName << " is out of the valid range (" << sched_get_priority_min(policy)
+                  << "-" << sched_get_priority_max(policy) << ") of " << GetSchedulingPolicyAsString(this->SchedulingPolicy) << " scheduling");
+      status = PLUS_FAIL;
+    }
+    else if ((error = pthread_setschedparam(pthread_self(), policy, &schedulingParameters)) != 0)
+    {
+      // EPERM is expected if the process is not allowed to use real-time scheduling
+      LOG_WARNING("Failed to set " << GetSchedulingPolicyAsString(this->SchedulingPolicy) << " scheduling with priority " << this->Priority
+                  << " for thread " << this->ThreadName << ": " << strerror(error) << ". The thread uses the default scheduling.");
+      status = PLUS_FAIL;
+    }
+  }
+
+  if (!this->ThreadName.empty())
+  {
+#if defined(__linux__)
+    // The name of a thread is limited to 16 bytes, including the terminating null character
+    int error = pthread_setname_np(pthread_self(), this->ThreadName.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+    int error = pthread_setname_np(this->ThreadName.substr(0, 63).c_str());
+#else
+    int error(0);
+#endif
+    if (error != 0)
+    {
+      LOG_WARNING("Failed to set the name of thread " << this->ThreadName << ": " << strerror(error));
+      status = PLUS_FAIL;
+    }
+  }
+#endif
+
+  return status;
+}
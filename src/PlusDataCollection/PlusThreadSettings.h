@@ -0,0 +1,88 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __PlusThreadSettings_h
+#define __PlusThreadSettings_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// STL includes
+#include <string>
+#include <vector>
+
+class vtkXMLDataElement;
+
+/*!
+  \class PlusThreadSettings
+  \brief CPU affinity, scheduling policy, priority and name of a thread
+
+  The settings are read from XML attributes and applied by the thread itself when it starts, by calling ApplyToCurrentThread.
+  The attribute names are prefixed, so that one element can hold the settings of several threads:
+
+  - <prefix>CpuAffinity: indices of the CPUs that the thread may run on, separated by spaces or commas, ranges are allowed (e.g., "2 3" or "0-3")
+  - <prefix>ThreadSchedulingPolicy: OTHER (default time-sharing scheduling), FIFO or RR (real-time scheduling)
+  - <prefix>ThreadPriority: real-time priority (1-99 on Linux), only used with FIFO and RR scheduling
+  - <prefix>ThreadName: name of the thread, as shown by debuggers and system tools (truncated to 15 characters on Linux)
+
+  Real-time scheduling usually requires elevated privileges (e.g., CAP_SYS_NICE or an rtprio limit on Linux). If a setting
+  cannot be applied then a warning is logged and the thread runs with the settings that it inherited.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport PlusThreadSettings
+{
+public:
+  enum SchedulingPolicyType
+  {
+    SCHEDULING_POLICY_OTHER, ///< default time-sharing scheduling
+    SCHEDULING_POLICY_FIFO, ///< real-time, first in first out
+    SCHEDULING_POLICY_RR ///< real-time, round robin
+  };
+
+  PlusThreadSettings();
+
+  /*! Read the settings from the attributes of the element. Attributes that are not present leave the setting unchanged. */
+  PlusStatus ReadConfiguration(vtkXMLDataElement* element, const std::string& attributePrefix = "");
+
+  /*! Write the settings that differ from the defaults to the attributes of the element */
+  PlusStatus WriteConfiguration(vtkXMLDataElement* element, const std::string& attributePrefix = "") const;
+
+  /*! Returns true if none of the settings are changed, i.e., applying them would leave the thread unchanged */
+  bool IsDefault() const;
+
+  /*!
+    Apply the settings to the calling thread. Returns PLUS_FAIL if any of the settings could not be applied.
+    Failures are logged as warnings, because the thread can still run, only with less predictable timing.
+  */
+  PlusStatus ApplyToCurrentThread() const;
+
+  void SetCpuAffinity(const std::vector<int>& cpuIndices) { this->CpuAffinity = cpuIndices; }
+  const std::vector<int>& GetCpuAffinity() const { return this->CpuAffinity; }
+
+  void SetSchedulingPolicy(SchedulingPolicyType policy) { this->SchedulingPolicy = policy; }
+  SchedulingPolicyType GetSchedulingPolicy() const { return this->SchedulingPolicy; }
+
+  void SetPriority(int priority) { this->Priority = priority; }
+  int GetPriority() const { return this->Priority; }
+
+  void SetThreadName(const std::string& threadName) { this->ThreadName = threadName; }
+  const std::string& GetThreadName() const { return this->ThreadName; }
+
+  /*! Parse a list of CPU indices, e.g., "0 2" or "0-3,6". Returns PLUS_FAIL if the list is malformed. */
+  static PlusStatus ParseCpuList(const std::string& cpuList, std::vector<int>& cpuIndices);
+
+protected:
+  /*! Empty means that the thread may run on any CPU */
+  std::vector<int> CpuAffinity;
+  SchedulingPolicyType SchedulingPolicy;
+  int Priority;
+  /*! Empty means that the name is not changed */
+  std::string ThreadName;
+};
+
+#endif
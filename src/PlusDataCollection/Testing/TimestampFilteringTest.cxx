@@ -16,6 +16,7 @@ See License.txt for details.
 #endif
 #include "vtkPlusBuffer.h"
 #include "vtkPlusHTMLGenerator.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
 #include "vtkIGSIOSequenceIO.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
@@ -24,7 +25,328 @@ See License.txt for details.
 #include <vtksys/SystemTools.hxx>
 #include <vtkTable.h>
 
+// STL includes
+#include <random>
 
+//----------------------------------------------------------------------------
+// Filter the timestamps of a long simulated acquisition (several hours at a constant frame rate with random transfer delays)
+// and check that the filtered timestamps remain accurate until the end of the acquisition.
+int TestLongRunFiltering(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method, int numberOfItems, int averagedItemsForFiltering, double maxTimestampDifference)
+{
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1.5e9; // large absolute time, as with system clock based timestamps
+  const double maxDelaySec = 0.002;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->SetTimestampFilteringMethod(method);
+
+  std::mt19937 randomGenerator(12345);
+  std::uniform_real_distribution<double> delayDistribution(-maxDelaySec, maxDelaySec);
+
+  int numberOfErrors(0);
+  double maxFilteredTimestampError(0);
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    double exactTimestamp = startTimeSec + itemIndex * framePeriodSec;
+    double filteredTimestamp(0);
+    bool filteredTimestampProbablyValid(true);
+    if (buffer->CreateFilteredTimeStampForItem(itemIndex, exactTimestamp + delayDistribution(randomGenerator), filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS
+        || !filteredTimestampProbablyValid)
+    {
+      LOG_ERROR("Failed to create filtered timestamp for item " << itemIndex);
+      numberOfErrors++;
+      continue;
+    }
+    if (itemIndex < averagedItemsForFiltering)
+    {
+      // filtering starts when enough items are collected
+      continue;
+    }
+    double filteredTimestampError = fabs(filteredTimestamp - exactTimestamp);
+    if (filteredTimestampError > maxFilteredTimestampError)
+    {
+      maxFilteredTimestampError = filteredTimestampError;
+    }
+  }
+  double elapsedTime = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+  LOG_INFO("Long run filtering of " << numberOfItems << " items (averaged items: " << averagedItemsForFiltering << "): maximum error: " << std::fixed << maxFilteredTimestampError * 1000 << "ms, "
+           << (elapsedTime > 0 ? numberOfItems / elapsedTime : 0) << " items/sec");
+
+  if (maxFilteredTimestampError > maxTimestampDifference)
+  {
+    LOG_ERROR("Long run filtered timestamp error is higher than the threshold (error: " << std::fixed << maxFilteredTimestampError << ", threshold: " << maxTimestampDifference << ")");
+    numberOfErrors++;
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+// Filter the timestamps of a simulated acquisition where some items are delivered late, in bursts
+// (e.g., because of network congestion) and check that delayed items are not rejected
+// and their filtered timestamps are not affected by the delay.
+int TestBurstDelivery(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method, int averagedItemsForFiltering, double maxTimestampDifference)
+{
+  const int numberOfItems = 20000;
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1.5e9;
+  const double maxDelaySec = 0.002;
+  const int burstPeriodItems = 500;
+  const int burstLengthItems = 10;
+  const double maxBurstDelaySec = 0.030;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->SetTimestampFilteringMethod(method);
+
+  std::mt19937 randomGenerator(12345);
+  std::uniform_real_distribution<double> delayDistribution(-maxDelaySec, maxDelaySec);
+
+  int numberOfErrors(0);
+  double maxFilteredTimestampError(0);
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    double exactTimestamp = startTimeSec + itemIndex * framePeriodSec;
+    double unfilteredTimestamp = exactTimestamp + delayDistribution(randomGenerator);
+    int itemsToBurstEnd = burstPeriodItems - itemIndex % burstPeriodItems;
+    if (itemsToBurstEnd <= burstLengthItems)
+    {
+      // the first item of the burst is delayed the most, the rest of the items arrive right after it
+      unfilteredTimestamp += maxBurstDelaySec * itemsToBurstEnd / burstLengthItems;
+    }
+    double filteredTimestamp(0);
+    bool filteredTimestampProbablyValid(true);
+    if (buffer->CreateFilteredTimeStampForItem(itemIndex, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS
+        || !filteredTimestampProbablyValid)
+    {
+      LOG_ERROR("Failed to create filtered timestamp for item " << itemIndex);
+      numberOfErrors++;
+      continue;
+    }
+    if (itemIndex < averagedItemsForFiltering)
+    {
+      continue;
+    }
+    double filteredTimestampError = fabs(filteredTimestamp - exactTimestamp);
+    if (filteredTimestampError > maxFilteredTimestampError)
+    {
+      maxFilteredTimestampError = filteredTimestampError;
+    }
+  }
+
+  LOG_INFO("Burst delivery filtering (averaged items: " << averagedItemsForFiltering << "): maximum error: " << std::fixed << maxFilteredTimestampError * 1000 << "ms");
+
+  if (maxFilteredTimestampError > maxTimestampDifference)
+  {
+    LOG_ERROR("Burst delivery filtered timestamp error is higher than the threshold (error: " << std::fixed << maxFilteredTimestampError << ", threshold: " << maxTimestampDifference << ")");
+    numberOfErrors++;
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+// Filter the timestamps of a simulated acquisition where the jitter of half of the items increases 20 times
+// and check that the outlier threshold widens, i.e., the items with larger jitter are not all treated as outliers.
+int TestJitterIncrease(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method, int averagedItemsForFiltering)
+{
+  const int numberOfItems = 4000;
+  const int jitterIncreaseItemIndex = 1000;
+  const int firstCheckedItemIndex = 2000;
+  const double maxOutlierRatio = 0.05;
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1.5e9;
+  const double maxDelaySec = 0.0002;
+  const double maxIncreasedDelaySec = 0.004;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->SetTimestampFilteringMethod(method);
+  buffer->TimeStampReportingOn();
+
+  std::mt19937 randomGenerator(12345);
+  std::uniform_real_distribution<double> delayDistribution(-1.0, 1.0);
+  std::bernoulli_distribution increasedDelayDistribution(0.5);
+
+  int numberOfErrors(0);
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    double exactTimestamp = startTimeSec + itemIndex * framePeriodSec;
+    bool increasedDelay = (itemIndex >= jitterIncreaseItemIndex && increasedDelayDistribution(randomGenerator));
+    double unfilteredTimestamp = exactTimestamp + (increasedDelay ? maxIncreasedDelaySec : maxDelaySec) * delayDistribution(randomGenerator);
+    double filteredTimestamp(0);
+    bool filteredTimestampProbablyValid(true);
+    if (buffer->CreateFilteredTimeStampForItem(itemIndex, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS
+        || !filteredTimestampProbablyValid)
+    {
+      LOG_ERROR("Failed to create filtered timestamp for item " << itemIndex);
+      numberOfErrors++;
+    }
+  }
+
+  vtkSmartPointer<vtkTable> timestampReportTable = vtkSmartPointer<vtkTable>::New();
+  if (buffer->GetTimeStampReportTable(timestampReportTable) != PLUS_SUCCESS || timestampReportTable->GetNumberOfRows() != numberOfItems)
+  {
+    LOG_ERROR("Failed to get the timestamp report of the jitter increase test");
+    return numberOfErrors + 1;
+  }
+  int numberOfOutliers(0);
+  for (vtkIdType row = firstCheckedItemIndex; row < numberOfItems; ++row)
+  {
+    if (timestampReportTable->GetValueByName(row, "Outlier").ToDouble() > 0)
+    {
+      numberOfOutliers++;
+    }
+  }
+  const double outlierRatio = static_cast<double>(numberOfOutliers) / (numberOfItems - firstCheckedItemIndex);
+
+  LOG_INFO("Jitter increase filtering (averaged items: " << averagedItemsForFiltering << "): outlier ratio: " << std::fixed << outlierRatio);
+
+  if (outlierRatio > maxOutlierRatio)
+  {
+    LOG_ERROR("The outlier threshold does not follow the increased jitter (outlier ratio: " << std::fixed << outlierRatio << ", threshold: " << maxOutlierRatio << ")");
+    numberOfErrors++;
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+// Filter the timestamps of a simulated acquisition where one item is delivered much later than MaxAllowedFilteringTimeDifference
+// and check that the item is kept with a timestamp that is close to its exact timestamp.
+int TestLateItem(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method, int averagedItemsForFiltering, double maxTimestampDifference)
+{
+  const int numberOfItems = 1000;
+  const int lateItemIndex = 500;
+  const double lateItemDelaySec = 1.0;
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1.5e9;
+  const double maxDelaySec = 0.002;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->SetTimestampFilteringMethod(method);
+
+  std::mt19937 randomGenerator(12345);
+  std::uniform_real_distribution<double> delayDistribution(-maxDelaySec, maxDelaySec);
+
+  int numberOfErrors(0);
+  for (int itemIndex = 0; itemIndex < numberOfItems; ++itemIndex)
+  {
+    double exactTimestamp = startTimeSec + itemIndex * framePeriodSec;
+    double unfilteredTimestamp = exactTimestamp + delayDistribution(randomGenerator) + (itemIndex == lateItemIndex ? lateItemDelaySec : 0.0);
+    double filteredTimestamp(0);
+    bool filteredTimestampProbablyValid(true);
+    if (buffer->CreateFilteredTimeStampForItem(itemIndex, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS
+        || !filteredTimestampProbablyValid)
+    {
+      LOG_ERROR("Item " << itemIndex << " is rejected by the timestamp filter");
+      numberOfErrors++;
+      continue;
+    }
+    if (itemIndex == lateItemIndex && fabs(filteredTimestamp - exactTimestamp) > maxTimestampDifference)
+    {
+      LOG_ERROR("Filtered timestamp of the late item is incorrect (error: " << std::fixed << fabs(filteredTimestamp - exactTimestamp) << ", threshold: " << maxTimestampDifference << ")");
+      numberOfErrors++;
+    }
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+// Filter the timestamps of items that all have the same item index (e.g., the device does not provide frame numbers)
+// and check that the items are kept with their unfiltered timestamps.
+int TestIdenticalItemIndexes(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method, int averagedItemsForFiltering)
+{
+  const int numberOfItems = 3 * averagedItemsForFiltering;
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1.5e9;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->SetTimestampFilteringMethod(method);
+
+  int numberOfErrors(0);
+  for (int itemNumber = 0; itemNumber < numberOfItems; ++itemNumber)
+  {
+    double unfilteredTimestamp = startTimeSec + itemNumber * framePeriodSec;
+    double filteredTimestamp(0);
+    bool filteredTimestampProbablyValid(true);
+    if (buffer->CreateFilteredTimeStampForItem(0, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS
+        || !filteredTimestampProbablyValid)
+    {
+      LOG_ERROR("Item " << itemNumber << " with identical item index is rejected by the timestamp filter");
+      numberOfErrors++;
+      continue;
+    }
+    if (filteredTimestamp != unfilteredTimestamp)
+    {
+      LOG_ERROR("Filtered timestamp of item " << itemNumber << " with identical item index differs from the unfiltered timestamp (" << std::fixed
+                << filteredTimestamp << " instead of " << unfilteredTimestamp << ")");
+      numberOfErrors++;
+    }
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
+// Check that the columns of the timestamp report follow the filtering method, also if the method is changed
+int TestReportColumns(int averagedItemsForFiltering)
+{
+  const int numberOfItems = 3 * averagedItemsForFiltering;
+  const double framePeriodSec = 1.0 / 60.0;
+  const double startTimeSec = 1000.0;
+
+  vtkSmartPointer<vtkPlusTimestampedCircularBuffer> buffer = vtkSmartPointer<vtkPlusTimestampedCircularBuffer>::New();
+  buffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  buffer->TimeStampReportingOn();
+
+  int numberOfErrors(0);
+  unsigned long itemIndex(0);
+  const vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType methods[2] =
+  {
+    vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_LINEAR_FIT,
+    vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_CLOCK_RECOVERY
+  };
+  for (int methodIndex = 0; methodIndex < 2; ++methodIndex)
+  {
+    buffer->SetTimestampFilteringMethod(methods[methodIndex]);
+    const char* methodName = vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodAsString(methods[methodIndex]);
+    for (int itemNumber = 0; itemNumber < numberOfItems; ++itemNumber, ++itemIndex)
+    {
+      double filteredTimestamp(0);
+      bool filteredTimestampProbablyValid(true);
+      buffer->CreateFilteredTimeStampForItem(itemIndex, startTimeSec + itemIndex * framePeriodSec, filteredTimestamp, filteredTimestampProbablyValid);
+    }
+
+    vtkSmartPointer<vtkTable> timestampReportTable = vtkSmartPointer<vtkTable>::New();
+    if (buffer->GetTimeStampReportTable(timestampReportTable) != PLUS_SUCCESS || timestampReportTable->GetNumberOfRows() != numberOfItems)
+    {
+      LOG_ERROR("The timestamp report of the " << methodName << " method does not contain the " << numberOfItems << " reported items");
+      numberOfErrors++;
+      continue;
+    }
+    const bool clockRecovery = (methods[methodIndex] == vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_CLOCK_RECOVERY);
+    if (timestampReportTable->GetNumberOfColumns() != (clockRecovery ? 6 : 5)
+        || std::string(timestampReportTable->GetColumnName(0)) != "FrameNumber"
+        || (clockRecovery && timestampReportTable->GetColumnByName("Outlier") == NULL))
+    {
+      LOG_ERROR("The timestamp report of the " << methodName << " method has " << timestampReportTable->GetNumberOfColumns() << " columns, starting with "
+                << timestampReportTable->GetColumnName(0));
+      numberOfErrors++;
+      continue;
+    }
+    double estimatedFramePeriodSec = timestampReportTable->GetValueByName(numberOfItems - 1, "EstimatedFramePeriod").ToDouble();
+    if (fabs(estimatedFramePeriodSec - framePeriodSec) > 1e-6)
+    {
+      LOG_ERROR("The " << methodName << " method reports an estimated frame period of " << std::fixed << estimatedFramePeriodSec << " sec instead of " << framePeriodSec);
+      numberOfErrors++;
+    }
+  }
+  return numberOfErrors;
+}
+
+//----------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
   int numberOfErrors(0);
@@ -36,6 +358,11 @@ int main(int argc, char** argv)
   double inputMaxTimestampDifference(0.080);
   double inputMinStdevReductionFactor(3.0);
   std::string inputTransformName;
+  int inputLongRunNumberOfItems(864000);
+  int inputLongRunAveragedItemsForFiltering(500);
+  double inputLongRunMaxTimestampDifference(0.001);
+  std::string inputTimestampFilteringMethod("LinearFit");
+  double inputBurstMaxTimestampDifference(0.005);
 
   int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
 
@@ -48,6 +375,11 @@ int main(int argc, char** argv)
   args.AddArgument("--averaged-items-for-filtering", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputAveragedItemsForFiltering, "Number of averaged items used for filtering (Default: 20).");
   args.AddArgument("--max-timestamp-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMaxTimestampDifference, "The maximum difference between the filtered and nonfiltered timestamps for each frame (Default: 0.08s).");
   args.AddArgument("--min-stdev-reduction-factor", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputMinStdevReductionFactor, "Minimum factor that the filtering should reduces the standard deviation of the frame periods on filtered data (Default: 3.0 ).");
+  args.AddArgument("--long-run-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputLongRunNumberOfItems, "Number of simulated items in the long run filtering test, 0 disables the test (Default: 864000, 4 hours at 60fps).");
+  args.AddArgument("--long-run-averaged-items-for-filtering", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputLongRunAveragedItemsForFiltering, "Number of averaged items used for filtering in the long run test (Default: 500).");
+  args.AddArgument("--long-run-max-timestamp-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputLongRunMaxTimestampDifference, "The maximum difference between the filtered and exact timestamps in the long run test (Default: 0.001s).");
+  args.AddArgument("--timestamp-filtering-method", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputTimestampFilteringMethod, "Timestamp filtering method: LinearFit or ClockRecovery (Default: LinearFit).");
+  args.AddArgument("--burst-max-timestamp-difference", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &inputBurstMaxTimestampDifference, "The maximum difference between the filtered and exact timestamps when items are delivered in bursts, only tested with ClockRecovery (Default: 0.005s).");
   args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
 
   if (!args.Parse())
@@ -79,6 +411,13 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
 
+  vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType timestampFilteringMethod;
+  if (vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodFromString(inputTimestampFilteringMethod.c_str(), timestampFilteringMethod) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid timestamp filtering method: " << inputTimestampFilteringMethod);
+    return EXIT_FAILURE;
+  }
+
   // Read buffer
   LOG_INFO("Reading meta file...");
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackerFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
@@ -90,6 +429,7 @@ int main(int argc, char** argv)
   LOG_INFO("Copy buffer to tracker buffer...");
   vtkSmartPointer<vtkPlusBuffer> trackerBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
   trackerBuffer->SetTimeStampReporting(true);
+  trackerBuffer->SetTimestampFilteringMethod(timestampFilteringMethod);
   // compute filtered timestamps now to test the filtering
   if (trackerBuffer->CopyTransformFromTrackedFrameList(trackerFrameList, vtkPlusBuffer::READ_UNFILTERED_COMPUTE_FILTERED_TIMESTAMPS, transformName) != PLUS_SUCCESS)
   {
@@ -179,6 +519,25 @@ int main(int argc, char** argv)
     numberOfErrors++;
   }
 
+  // 3. Filtering must remain accurate in long acquisitions with many averaged items
+  if (inputLongRunNumberOfItems > 0)
+  {
+    numberOfErrors += TestLongRunFiltering(timestampFilteringMethod, inputLongRunNumberOfItems, inputLongRunAveragedItemsForFiltering, inputLongRunMaxTimestampDifference);
+  }
+
+  // 4. Items with identical item indexes cannot be filtered, they must be kept with their unfiltered timestamps
+  numberOfErrors += TestIdenticalItemIndexes(timestampFilteringMethod, inputAveragedItemsForFiltering);
+
+  // 5. Items delivered in bursts must not be rejected and must not distort the filtered timestamps
+  if (timestampFilteringMethod == vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_CLOCK_RECOVERY)
+  {
+    numberOfErrors += TestBurstDelivery(timestampFilteringMethod, inputAveragedItemsForFiltering, inputBurstMaxTimestampDifference);
+    numberOfErrors += TestJitterIncrease(timestampFilteringMethod, inputAveragedItemsForFiltering);
+    numberOfErrors += TestLateItem(timestampFilteringMethod, inputAveragedItemsForFiltering, inputBurstMaxTimestampDifference);
+  }
+
+  // 6. The columns of the timestamp report must follow the filtering method
+  numberOfErrors += TestReportColumns(inputAveragedItemsForFiltering);
 
   vtkSmartPointer<vtkTable> timestampReportTable = vtkSmartPointer<vtkTable>::New();
   if (trackerBuffer->GetTimeStampReportTable(timestampReportTable) != PLUS_SUCCESS)
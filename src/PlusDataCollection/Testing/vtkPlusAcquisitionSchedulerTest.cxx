@@ -0,0 +1,159 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusAcquisitionSchedulerTest.cxx
+  \brief Test updating many rate-driven devices on the shared acquisition scheduler.
+
+  Several polling devices are recorded with the acquisition scheduler enabled. One of them is slower than its acquisition
+  period and one of them requests a dedicated update thread. The test fails if the devices are not updated at their
+  acquisition rate, if the updates of the slow device are not reported as overruns, or if the scheduler tasks are not
+  added and removed when the recording is started and stopped.
+*/
+
+// Local includes
+#include "PlusAcquisitionScheduler.h"
+#include "PlusConfigure.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfDevices(8);
+  int numberOfWorkerThreads(2);
+  double acquisitionRate(50.0);
+  double recordingTimeSec(1.0);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-devices", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfDevices, "Number of simulated polling devices (Default: 8).");
+  args.AddArgument("--number-of-worker-threads", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfWorkerThreads, "Number of acquisition scheduler worker threads (Default: 2).");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Acquisition rate of the devices in Hz (Default: 50).");
+  args.AddArgument("--recording-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &recordingTimeSec, "Duration of the recording (Default: 1.0).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfDevices < 3 || numberOfWorkerThreads < 1 || acquisitionRate <= 0 || recordingTimeSec <= 0)
+  {
+    LOG_ERROR("At least three devices, one worker thread, a positive acquisition rate and a positive recording time are needed");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+  const double periodSec = 1.0 / acquisitionRate;
+
+  std::shared_ptr<PlusAcquisitionScheduler> scheduler = std::make_shared<PlusAcquisitionScheduler>();
+  scheduler->SetNumberOfWorkerThreads(numberOfWorkerThreads);
+
+  // The first device is slower than its acquisition period, the second one uses a dedicated thread
+  std::vector<vtkSmartPointer<vtkPlusTestPollingDevice> > devices;
+  for (int deviceIndex = 0; deviceIndex < numberOfDevices; ++deviceIndex)
+  {
+    vtkSmartPointer<vtkPlusTestPollingDevice> device = vtkSmartPointer<vtkPlusTestPollingDevice>::New();
+    device->SetDeviceId("PollingDevice" + igsioCommon::ToString<int>(deviceIndex));
+    device->SetAcquisitionRate(acquisitionRate);
+    device->SetAcquisitionScheduler(scheduler);
+    devices.push_back(device);
+  }
+  devices[0]->UpdateDurationSec = 1.5 * periodSec;
+  devices[1]->SetDedicatedUpdateThread(true);
+
+  for (std::vector<vtkSmartPointer<vtkPlusTestPollingDevice> >::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    if ((*it)->GetAcquisitionMode() != vtkPlusDevice::ACQUISITION_MODE_RATE_DRIVEN)
+    {
+      LOG_ERROR((*it)->GetDeviceId() << " is expected to be rate-driven");
+      numberOfErrors++;
+    }
+    if ((*it)->StartRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start recording on " << (*it)->GetDeviceId());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (scheduler->GetNumberOfTasks() != numberOfDevices - 1)
+  {
+    LOG_ERROR(scheduler->GetNumberOfTasks() << " acquisition tasks are scheduled instead of " << numberOfDevices - 1);
+    numberOfErrors++;
+  }
+
+  vtkIGSIOAccurateTimer::Delay(recordingTimeSec);
+
+  for (std::vector<vtkSmartPointer<vtkPlusTestPollingDevice> >::iterator it = devices.begin(); it != devices.end(); ++it)
+  {
+    if ((*it)->StopRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to stop recording on " << (*it)->GetDeviceId());
+      numberOfErrors++;
+    }
+  }
+
+  if (scheduler->GetNumberOfTasks() != 0)
+  {
+    LOG_ERROR(scheduler->GetNumberOfTasks() << " acquisition tasks are left after recording is stopped");
+    numberOfErrors++;
+  }
+
+  // Allow for the startup of the threads and for the timer resolution
+  const double expectedNumberOfUpdates = recordingTimeSec * acquisitionRate;
+  for (int deviceIndex = 0; deviceIndex < numberOfDevices; ++deviceIndex)
+  {
+    vtkPlusTestPollingDevice* device = devices[deviceIndex];
+    LOG_INFO(device->GetDeviceId() << ": " << device->NumberOfUpdates << " updates, " << device->GetNumberOfUpdateOverruns() << " overruns");
+    if (deviceIndex == 0)
+    {
+      // Missed periods are skipped, so the slow device is updated at most once per update duration
+      if (device->NumberOfUpdates > recordingTimeSec / device->UpdateDurationSec + 2 || device->GetNumberOfUpdateOverruns() == 0)
+      {
+        LOG_ERROR(device->GetDeviceId() << " is slower than its acquisition period, but it is updated " << device->NumberOfUpdates
+                  << " times with " << device->GetNumberOfUpdateOverruns() << " overruns");
+        numberOfErrors++;
+      }
+      continue;
+    }
+    if (device->NumberOfUpdates < 0.5 * expectedNumberOfUpdates || device->NumberOfUpdates > 1.5 * expectedNumberOfUpdates + 2)
+    {
+      LOG_ERROR(device->GetDeviceId() << " is updated " << device->NumberOfUpdates << " times instead of about " << expectedNumberOfUpdates << " times");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferContentionTest.cxx
+  \brief Measure how much concurrent readers slow down the acquisition thread, with locked and lock-free buffer reads.
+
+  A writer thread adds tracker items to a buffer as fast as it can while several reader threads
+  continuously query timestamps, indices and item UIDs (the same queries that vtkPlusChannel performs).
+  The test fails if any reader receives data that does not belong to the requested item.
+  Lock-free reads are also tested while the writer repeatedly resizes the buffer.
+
+  The test also checks that a consumer blocked in WaitForItemNewerThan is woken up by each new item
+  and that the wait times out if no item is added. The wait of a channel must not return before the
+  most recent timestamp of the channel advances, even if each of its sources has a newer item.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double ITEM_PERIOD_SEC = 0.001;
+
+  struct ContentionResult
+  {
+    ContentionResult() : NumberOfWrites(0), MaxWriteTimeSec(0), NumberOfReads(0), NumberOfInconsistentReads(0) {}
+    unsigned long NumberOfWrites;
+    double MaxWriteTimeSec;
+    unsigned long NumberOfReads;
+    unsigned long NumberOfInconsistentReads;
+  };
+
+  //----------------------------------------------------------------------------
+  void ReadContinuously(vtkPlusBuffer* buffer, std::atomic<bool>* stopRequested, std::atomic<unsigned long>* numberOfReads, std::atomic<unsigned long>* numberOfInconsistentReads)
+  {
+    unsigned long reads(0);
+    unsigned long inconsistentReads(0);
+    while (!stopRequested->load())
+    {
+      BufferItemUidType latestUid = buffer->GetLatestItemUidInBuffer();
+      BufferItemUidType oldestUid = buffer->GetOldestItemUidInBuffer();
+      if (latestUid < 2 || oldestUid > latestUid)
+      {
+        continue;
+      }
+
+      // Look up an item in the middle of the buffer by time, then read its timestamp and index
+      double requestedTime = ((oldestUid + latestUid) / 2) * ITEM_PERIOD_SEC;
+      BufferItemUidType uid(0);
+      if (buffer->GetItemUidFromTime(requestedTime, uid) == ITEM_OK)
+      {
+        double timestamp(0);
+        if (buffer->GetTimeStamp(uid, timestamp) == ITEM_OK && fabs(timestamp - uid * ITEM_PERIOD_SEC) > 1e-9)
+        {
+          inconsistentReads++;
+        }
+        unsigned long index(0);
+        if (buffer->GetIndex(uid, index) == ITEM_OK && index != uid)
+        {
+          inconsistentReads++;
+        }
+        if (fabs(uid * ITEM_PERIOD_SEC - requestedTime) > ITEM_PERIOD_SEC * 0.5)
+        {
+          // not the closest item
+          inconsistentReads++;
+        }
+      }
+      reads++;
+    }
+    numberOfReads->fetch_add(reads);
+    numberOfInconsistentReads->fetch_add(inconsistentReads);
+  }
+
+  //----------------------------------------------------------------------------
+  /*! If resizePeriod is not 0 then the buffer size is switched between bufferSize and its half after every resizePeriod items */
+  ContentionResult RunContention(bool lockFreeReads, int numberOfReaders, int numberOfItemsToWrite, int bufferSize, int resizePeriod)
+  {
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetLockFreeReads(lockFreeReads);
+
+    std::atomic<bool> stopRequested(false);
+    std::atomic<unsigned long> numberOfReads(0);
+    std::atomic<unsigned long> numberOfInconsistentReads(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < numberOfReaders; ++i)
+    {
+      readers.push_back(std::thread(ReadContinuously, buffer.GetPointer(), &stopRequested, &numberOfReads, &numberOfInconsistentReads));
+    }
+
+    ContentionResult result;
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int frameNumber = 1; frameNumber <= numberOfItemsToWrite; ++frameNumber)
+    {
+      double timestamp = frameNumber * ITEM_PERIOD_SEC;
+      matrix->SetElement(0, 3, frameNumber);
+      double writeStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      if (buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp) == PLUS_SUCCESS)
+      {
+        result.NumberOfWrites++;
+      }
+      result.MaxWriteTimeSec = std::max(result.MaxWriteTimeSec, vtkIGSIOAccurateTimer::GetSystemTime() - writeStartTime);
+      if (resizePeriod > 0 && frameNumber % resizePeriod == 0)
+      {
+        buffer->SetBufferSize((frameNumber / resizePeriod) % 2 == 1 ? bufferSize / 2 : bufferSize);
+      }
+    }
+
+    stopRequested = true;
+    for (std::vector<std::thread>::iterator it = readers.begin(); it != readers.end(); ++it)
+    {
+      it->join();
+    }
+    result.NumberOfReads = numberOfReads;
+    result.NumberOfInconsistentReads = numberOfInconsistentReads;
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestWaitForNewItems(int numberOfItemsToWrite, int bufferSize)
+  {
+    const double WRITE_PERIOD_SEC = 0.002;
+    const double TIMEOUT_SEC = 0.05;
+    int numberOfErrors(0);
+
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+
+    double waitStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (buffer->WaitForItemNewerThan(0, TIMEOUT_SEC) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Waiting for an item in an empty buffer succeeded");
+      numberOfErrors++;
+    }
+    if (vtkIGSIOAccurateTimer::GetSystemTime() - waitStartTime < TIMEOUT_SEC * 0.9)
+    {
+      LOG_ERROR("Waiting for an item in an empty buffer returned before the timeout");
+      numberOfErrors++;
+    }
+
+    // The writer records when each item was added, the consumer measures how long it takes to notice it
+    std::vector<double> addTimes(numberOfItemsToWrite + 1, 0);
+    std::thread writer([&buffer, &addTimes, numberOfItemsToWrite, WRITE_PERIOD_SEC]()
+    {
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      for (int frameNumber = 1; frameNumber <= numberOfItemsToWrite; ++frameNumber)
+      {
+        vtkIGSIOAccurateTimer::Delay(WRITE_PERIOD_SEC);
+        double timestamp = frameNumber * ITEM_PERIOD_SEC;
+        addTimes[frameNumber] = vtkIGSIOAccurateTimer::GetSystemTime();
+        buffer->AddTimeStampedItem(matrix, TOOL_OK, frameNumber, timestamp, timestamp);
+      }
+    });
+
+    double lastTimestamp(0);
+    double totalLatencySec(0);
+    int numberOfReceivedItems(0);
+    while (lastTimestamp < numberOfItemsToWrite * ITEM_PERIOD_SEC - ITEM_PERIOD_SEC * 0.5)
+    {
+      if (buffer->WaitForItemNewerThan(lastTimestamp, 1.0) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Waiting for an item newer than " << lastTimestamp << " timed out");
+        numberOfErrors++;
+        break;
+      }
+      double latestTimestamp(0);
+      buffer->GetLatestTimeStamp(latestTimestamp);
+      int frameNumber = static_cast<int>(floor(latestTimestamp / ITEM_PERIOD_SEC + 0.5));
+      totalLatencySec += vtkIGSIOAccurateTimer::GetSystemTime() - addTimes[frameNumber];
+      numberOfReceivedItems++;
+      lastTimestamp = latestTimestamp;
+    }
+    writer.join();
+
+    LOG_INFO("Waiting consumer received " << numberOfReceivedItems << " of " << numberOfItemsToWrite << " items, average latency "
+             << std::fixed << (numberOfReceivedItems > 0 ? totalLatencySec / numberOfReceivedItems * 1000 : 0) << " ms");
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestChannelWait()
+  {
+    const double TIMEOUT_SEC = 0.05;
+    int numberOfErrors(0);
+
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("TrackerStream");
+    vtkSmartPointer<vtkPlusDataSource> masterTool = vtkSmartPointer<vtkPlusDataSource>::New();
+    masterTool->SetId("MasterToTracker");
+    vtkSmartPointer<vtkPlusDataSource> otherTool = vtkSmartPointer<vtkPlusDataSource>::New();
+    otherTool->SetId("OtherToTracker");
+    vtkPlusDataSource* tools[2] = { masterTool, otherTool };
+    for (int i = 0; i < 2; ++i)
+    {
+      tools[i]->SetType(DATA_SOURCE_TYPE_TOOL);
+      tools[i]->SetBufferSize(10);
+      channel->AddTool(tools[i]);
+    }
+
+    // Both tools have items newer than 1.0, but the master tool has no item between 1.0 and the latest item of the other tool,
+    // so the most recent timestamp of the channel is still 1.0
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    masterTool->AddTimeStampedItem(matrix, TOOL_OK, 1, 1.0, 1.0);
+    masterTool->AddTimeStampedItem(matrix, TOOL_OK, 2, 1.2, 1.2);
+    otherTool->AddTimeStampedItem(matrix, TOOL_OK, 1, 1.0, 1.0);
+    otherTool->AddTimeStampedItem(matrix, TOOL_OK, 2, 1.15, 1.15);
+
+    double waitStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (channel->WaitForItemNewerThan(1.0, TIMEOUT_SEC) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Waiting for a channel item returned before the most recent timestamp of the channel advanced");
+      numberOfErrors++;
+    }
+    else if (vtkIGSIOAccurateTimer::GetSystemTime() - waitStartTime < TIMEOUT_SEC * 0.9)
+    {
+      LOG_ERROR("Waiting for a channel item returned before the timeout");
+      numberOfErrors++;
+    }
+
+    // A new item of the other tool makes the latest item of the master tool available
+    std::thread writer([&otherTool, &matrix]()
+    {
+      vtkIGSIOAccurateTimer::Delay(0.02);
+      otherTool->AddTimeStampedItem(matrix, TOOL_OK, 3, 1.25, 1.25);
+    });
+    double mostRecentTimestamp(0);
+    if (channel->WaitForItemNewerThan(1.0, 1.0) != PLUS_SUCCESS || channel->GetMostRecentTimestamp(mostRecentTimestamp) != PLUS_SUCCESS || mostRecentTimestamp <= 1.0)
+    {
+      LOG_ERROR("Waiting for a channel item did not return when the most recent timestamp of the channel advanced");
+      numberOfErrors++;
+    }
+    writer.join();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfReaders(4);
+  int numberOfItems(200000);
+  int bufferSize(1000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-readers", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfReaders, "Number of concurrent reader threads (Default: 4).");
+  args.AddArgument("--number-of-items", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfItems, "Number of items added by the writer thread (Default: 200000).");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of items in the buffer (Default: 1000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+  for (int mode = 0; mode < 3; ++mode)
+  {
+    bool lockFreeReads = (mode >= 1);
+    // the last mode resizes the buffer while lock-free readers access it
+    int resizePeriod = (mode == 2 ? 1000 : 0);
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    ContentionResult result = RunContention(lockFreeReads, numberOfReaders, numberOfItems, bufferSize, resizePeriod);
+    double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    LOG_INFO((lockFreeReads ? "Lock-free" : "Locked") << (resizePeriod > 0 ? " resized" : "") << " reads with " << numberOfReaders << " readers: "
+             << std::fixed << result.NumberOfWrites / elapsedTimeSec << " writes/s, max write time " << result.MaxWriteTimeSec * 1000 << " ms, "
+             << result.NumberOfReads / elapsedTimeSec << " reads/s");
+
+    if (result.NumberOfWrites != static_cast<unsigned long>(numberOfItems))
+    {
+      LOG_ERROR("Writer added " << result.NumberOfWrites << " items instead of " << numberOfItems);
+      numberOfErrors++;
+    }
+    if (result.NumberOfInconsistentReads > 0)
+    {
+      LOG_ERROR((lockFreeReads ? "Lock-free" : "Locked") << " readers received " << result.NumberOfInconsistentReads << " inconsistent items");
+      numberOfErrors++;
+    }
+  }
+
+  numberOfErrors += TestWaitForNewItems(500, bufferSize);
+  numberOfErrors += TestChannelWait();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
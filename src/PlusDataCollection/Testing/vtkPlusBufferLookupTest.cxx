@@ -0,0 +1,227 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferLookupTest.cxx
+  \brief Measure the speed of finding buffer items by time, for buffer sizes from 100 to 100000 items.
+
+  Buffers are filled with items that have nearly uniform timestamps (constant frame rate with random jitter).
+  Items are looked up in increasing time order (as in vtkPlusChannel::GetTrackedFrameList) and in random order.
+  The test reports the lookup rate and the average number of timestamps that are inspected per lookup,
+  and fails if a lookup does not return the closest item or inspects more timestamps than a binary search.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
+#include "vtkPlusTransformBuffer.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+  const double FRAME_PERIOD_SEC = 0.01;
+  const double MAX_JITTER_SEC = 0.002;
+  const int NUMBER_OF_LOOKUPS = 200000;
+
+  //----------------------------------------------------------------------------
+  std::vector<double> GenerateTimestamps(int numberOfItems)
+  {
+    std::mt19937 randomGenerator(12345);
+    std::uniform_real_distribution<double> jitterDistribution(-MAX_JITTER_SEC, MAX_JITTER_SEC);
+    std::vector<double> timestamps(numberOfItems);
+    for (int i = 0; i < numberOfItems; ++i)
+    {
+      timestamps[i] = 100.0 + (i + 1) * FRAME_PERIOD_SEC + jitterDistribution(randomGenerator);
+    }
+    return timestamps;
+  }
+
+  //----------------------------------------------------------------------------
+  std::vector<double> GenerateLookupTimes(const std::vector<double>& timestamps, bool sequential)
+  {
+    std::mt19937 randomGenerator(54321);
+    std::uniform_real_distribution<double> timeDistribution(timestamps.front(), timestamps.back());
+    std::vector<double> lookupTimes(NUMBER_OF_LOOKUPS);
+    for (int i = 0; i < NUMBER_OF_LOOKUPS; ++i)
+    {
+      if (sequential)
+      {
+        // walk through the items, slightly off from the item timestamps
+        lookupTimes[i] = timestamps[i % timestamps.size()] + FRAME_PERIOD_SEC * 0.2;
+        lookupTimes[i] = std::min(lookupTimes[i], timestamps.back());
+      }
+      else
+      {
+        lookupTimes[i] = timeDistribution(randomGenerator);
+      }
+    }
+    return lookupTimes;
+  }
+
+  //----------------------------------------------------------------------------
+  BufferItemUidType GetClosestItemUid(const std::vector<double>& timestamps, double time)
+  {
+    // UID of the first item is 1
+    std::vector<double>::const_iterator next = std::lower_bound(timestamps.begin(), timestamps.end(), time);
+    if (next == timestamps.end())
+    {
+      return timestamps.size();
+    }
+    if (next != timestamps.begin() && time - *(next - 1) <= *next - time)
+    {
+      return next - timestamps.begin();
+    }
+    return next - timestamps.begin() + 1;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestLookupCount(const std::vector<double>& timestamps, const std::vector<double>& lookupTimes, const std::string& lookupName)
+  {
+    unsigned long numberOfProbes(0);
+    auto readTimestamp = [&timestamps, &numberOfProbes](BufferItemUidType uid, double & timestamp) -> bool
+    {
+      numberOfProbes++;
+      timestamp = timestamps[uid - 1];
+      return true;
+    };
+
+    BufferItemUidType hintUid(0);
+    for (std::vector<double>::const_iterator it = lookupTimes.begin(); it != lookupTimes.end(); ++it)
+    {
+      BufferItemUidType uid(0);
+      vtkPlusTimestampedCircularBuffer::FindItemUidFromTime(*it, 1, timestamps.size(), hintUid, 1e-5, readTimestamp, uid);
+      hintUid = uid;
+    }
+
+    // binary search reads the first and last timestamps, then halves the range until two items remain
+    double binarySearchProbes = 2 + ceil(log2(static_cast<double>(timestamps.size() - 1)));
+    double averageProbes = static_cast<double>(numberOfProbes) / lookupTimes.size();
+    LOG_INFO("  " << lookupName << " lookups: " << std::fixed << averageProbes << " timestamps inspected per lookup (binary search: " << binarySearchProbes << ")");
+    if (averageProbes > binarySearchProbes)
+    {
+      LOG_ERROR(lookupName << " lookups in a buffer of " << timestamps.size() << " items inspect more timestamps than a binary search");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestLookupSpeed(vtkPlusBuffer* buffer, const std::vector<double>& timestamps, const std::vector<double>& lookupTimes, const std::string& lookupName)
+  {
+    int numberOfErrors(0);
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (std::vector<double>::const_iterator it = lookupTimes.begin(); it != lookupTimes.end(); ++it)
+    {
+      BufferItemUidType uid(0);
+      if (buffer->GetItemUidFromTime(*it, uid) != ITEM_OK || uid != GetClosestItemUid(timestamps, *it))
+      {
+        numberOfErrors++;
+      }
+    }
+    double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+    LOG_INFO("  " << lookupName << " lookups in " << buffer->GetClassName() << ": " << std::fixed << (elapsedTimeSec > 0 ? lookupTimes.size() / elapsedTimeSec : 0) << " lookups/s");
+    if (numberOfErrors > 0)
+    {
+      LOG_ERROR(lookupName << " lookups in " << buffer->GetClassName() << " of " << timestamps.size() << " items did not return the closest item " << numberOfErrors << " times");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestBufferSize(int bufferSize)
+  {
+    LOG_INFO("Buffer size: " << bufferSize);
+    int numberOfErrors(0);
+    std::vector<double> timestamps = GenerateTimestamps(bufferSize);
+
+    vtkSmartPointer<vtkPlusBuffer> genericBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    vtkSmartPointer<vtkPlusTransformBuffer> transformBuffer = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+    vtkPlusBuffer* buffers[2] = { genericBuffer, transformBuffer };
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int b = 0; b < 2; ++b)
+    {
+      buffers[b]->SetBufferSize(bufferSize);
+      for (int i = 0; i < bufferSize; ++i)
+      {
+        if (buffers[b]->AddTimeStampedItem(matrix, TOOL_OK, i + 1, timestamps[i], timestamps[i]) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add item " << i + 1 << " to " << buffers[b]->GetClassName());
+          return 1;
+        }
+      }
+    }
+
+    const bool sequential[2] = { true, false };
+    for (int s = 0; s < 2; ++s)
+    {
+      std::string lookupName = sequential[s] ? "Sequential" : "Random";
+      std::vector<double> lookupTimes = GenerateLookupTimes(timestamps, sequential[s]);
+      numberOfErrors += TestLookupCount(timestamps, lookupTimes, lookupName);
+      for (int b = 0; b < 2; ++b)
+      {
+        numberOfErrors += TestLookupSpeed(buffers[b], timestamps, lookupTimes, lookupName);
+      }
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int maxBufferSize(100000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--max-buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maxBufferSize, "Largest tested buffer size, buffer sizes increase tenfold from 100 (Default: 100000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+  for (int bufferSize = 100; bufferSize <= maxBufferSize; bufferSize *= 10)
+  {
+    numberOfErrors += TestBufferSize(bufferSize);
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
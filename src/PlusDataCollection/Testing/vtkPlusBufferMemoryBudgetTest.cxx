@@ -0,0 +1,318 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferMemoryBudgetTest.cxx
+  \brief Test the buffer memory accounting of video buffers and the buffer memory budget of the data collector.
+
+  The allocated memory of a buffer has to include the pixel data of detached slots while a view references it
+  and the mapping of the spill file. The buffers of the data collector are shrunk in priority order to fit in the budget,
+  but not below the minimum buffer size, and enforcing the budget fails if the FAIL action is selected or the buffers
+  do not fit even at the minimum size. Connecting the data collector enforces the budget before the frame memory is mapped.
+  The test fails if the buffers exceed the budget after the budget is successfully enforced.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+namespace
+{
+  const unsigned int FRAME_WIDTH = 64;
+  const unsigned int FRAME_HEIGHT = 48;
+  const unsigned long long FRAME_SIZE_IN_BYTES = FRAME_WIDTH * FRAME_HEIGHT;
+  // must match the minimum buffer size of vtkPlusDataCollector::EnforceBufferMemoryBudget
+  const int MINIMUM_SHRUNK_BUFFER_SIZE = 10;
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrame(vtkPlusBuffer* buffer, long frameNumber)
+  {
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, static_cast<unsigned char>(frameNumber));
+    FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    return buffer->AddItem(&pixels[0], frameSize, pixels.size(), US_IMG_BRIGHTNESS, frameNumber, frameNumber * 0.1, frameNumber * 0.1);
+  }
+
+  //----------------------------------------------------------------------------
+  int TestBufferAllocatedMemory()
+  {
+    const int bufferSize = 5;
+    const int spillBufferSize = 10;
+
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(bufferSize);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    const unsigned long long slotsSizeInBytes = bufferSize * buffer->GetItemSizeInBytes();
+    if (buffer->GetAllocatedMemoryInBytes() != slotsSizeInBytes)
+    {
+      LOG_ERROR("Allocated memory of an empty buffer is " << buffer->GetAllocatedMemoryInBytes() << " bytes (expected: " << slotsSizeInBytes << ")");
+      numberOfErrors++;
+    }
+
+    long frameNumber(0);
+    for (; frameNumber < bufferSize; ++frameNumber)
+    {
+      AddFrame(buffer, frameNumber);
+    }
+
+    {
+      // The slot of the view is moved to new memory when it is reused, the previous pixel data is allocated while the view is held
+      StreamBufferItem view;
+      if (buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer(), &view) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get view of the oldest item");
+        return numberOfErrors + 1;
+      }
+      AddFrame(buffer, frameNumber++);
+      if (buffer->GetNumberOfDetachedFrames() != 1)
+      {
+        LOG_ERROR("Unexpected number of detached frames: " << buffer->GetNumberOfDetachedFrames() << " (expected: 1)");
+        numberOfErrors++;
+      }
+      if (buffer->GetAllocatedMemoryInBytes() != slotsSizeInBytes + FRAME_SIZE_IN_BYTES)
+      {
+        LOG_ERROR("Allocated memory with a detached frame is " << buffer->GetAllocatedMemoryInBytes() << " bytes (expected: " << slotsSizeInBytes + FRAME_SIZE_IN_BYTES << ")");
+        numberOfErrors++;
+      }
+    }
+    if (buffer->GetAllocatedMemoryInBytes() != slotsSizeInBytes)
+    {
+      LOG_ERROR("Allocated memory after the view is released is " << buffer->GetAllocatedMemoryInBytes() << " bytes (expected: " << slotsSizeInBytes << ")");
+      numberOfErrors++;
+    }
+
+    // The spill file holds the pixel data of the spilled items
+    if (buffer->SetSpillBufferSize(spillBufferSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set spill buffer size");
+      return numberOfErrors + 1;
+    }
+    for (int i = 0; i < bufferSize + spillBufferSize; ++i)
+    {
+      AddFrame(buffer, frameNumber++);
+    }
+    if (buffer->GetAllocatedMemoryInBytes() < slotsSizeInBytes + spillBufferSize * FRAME_SIZE_IN_BYTES)
+    {
+      LOG_ERROR("Allocated memory with a spill file is " << buffer->GetAllocatedMemoryInBytes() << " bytes, less than the size of the spilled frames ("
+                << slotsSizeInBytes + spillBufferSize * FRAME_SIZE_IN_BYTES << " bytes)");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Data collector with a device that has a low and a high priority video source of the same size */
+  vtkSmartPointer<vtkPlusDataCollector> CreateDataCollector(int bufferSize, vtkPlusDataSource*& lowPrioritySource, vtkPlusDataSource*& highPrioritySource)
+  {
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+    // The data collector deletes the device
+    vtkPlusDevice* device = vtkPlusDevice::New();
+    device->SetDeviceId("ImagingDevice");
+    dataCollector->AddDevice(device);
+
+    const char* sourceIds[2] = { "LowPriorityVideo", "HighPriorityVideo" };
+    vtkPlusDataSource* sources[2] = { NULL, NULL };
+    for (int priority = 0; priority < 2; ++priority)
+    {
+      vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+      source->SetId(sourceIds[priority]);
+      source->SetType(DATA_SOURCE_TYPE_VIDEO);
+      source->SetBufferSize(bufferSize);
+      source->SetInputFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+      source->SetPixelType(VTK_UNSIGNED_CHAR);
+      source->SetNumberOfScalarComponents(1);
+      source->SetBufferPriority(priority);
+      if (device->AddVideoSource(source) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add video source " << sourceIds[priority]);
+        exit(EXIT_FAILURE);
+      }
+      sources[priority] = source;
+    }
+    lowPrioritySource = sources[0];
+    highPrioritySource = sources[1];
+    return dataCollector;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestMemoryBudget()
+  {
+    const int bufferSize = 100;
+    int numberOfErrors(0);
+
+    vtkPlusDataSource* lowPrioritySource(NULL);
+    vtkPlusDataSource* highPrioritySource(NULL);
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = CreateDataCollector(bufferSize, lowPrioritySource, highPrioritySource);
+    const unsigned long long itemSizeInBytes = lowPrioritySource->GetBufferItemSizeInBytes();
+    if (dataCollector->GetAllocatedBufferMemoryInBytes() != 2 * bufferSize * itemSizeInBytes)
+    {
+      LOG_ERROR("Allocated buffer memory is " << dataCollector->GetAllocatedBufferMemoryInBytes() << " bytes (expected: " << 2 * bufferSize * itemSizeInBytes << ")");
+      numberOfErrors++;
+    }
+
+    // No limit
+    if (dataCollector->EnforceBufferMemoryBudget() != PLUS_SUCCESS || lowPrioritySource->GetBufferSize() != bufferSize || highPrioritySource->GetBufferSize() != bufferSize)
+    {
+      LOG_ERROR("Buffers are changed without a buffer memory budget");
+      numberOfErrors++;
+    }
+
+    // Buffers do not fit and the action is FAIL: the buffers are not changed
+    dataCollector->SetBufferMemoryBudgetAction(vtkPlusDataCollector::BUFFER_MEMORY_BUDGET_FAIL);
+    dataCollector->SetBufferMemoryBudgetBytes(3 * bufferSize / 2 * itemSizeInBytes);
+    if (dataCollector->EnforceBufferMemoryBudget() == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Buffer memory budget is exceeded but enforcing it with the FAIL action succeeded");
+      numberOfErrors++;
+    }
+    if (lowPrioritySource->GetBufferSize() != bufferSize || highPrioritySource->GetBufferSize() != bufferSize)
+    {
+      LOG_ERROR("Buffers are shrunk with the FAIL action");
+      numberOfErrors++;
+    }
+
+    // Only the low priority buffer is shrunk
+    dataCollector->SetBufferMemoryBudgetAction(vtkPlusDataCollector::BUFFER_MEMORY_BUDGET_SHRINK_BUFFERS);
+    if (dataCollector->EnforceBufferMemoryBudget() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to shrink the buffers to fit in the buffer memory budget");
+      numberOfErrors++;
+    }
+    if (dataCollector->GetAllocatedBufferMemoryInBytes() > dataCollector->GetBufferMemoryBudgetBytes())
+    {
+      LOG_ERROR("Allocated buffer memory (" << dataCollector->GetAllocatedBufferMemoryInBytes() << " bytes) exceeds the budget after shrinking");
+      numberOfErrors++;
+    }
+    if (lowPrioritySource->GetBufferSize() < bufferSize / 2 - 1 || lowPrioritySource->GetBufferSize() > bufferSize / 2 || highPrioritySource->GetBufferSize() != bufferSize)
+    {
+      LOG_ERROR("Unexpected buffer sizes after shrinking: " << lowPrioritySource->GetBufferSize() << " and " << highPrioritySource->GetBufferSize()
+                << " (expected: " << bufferSize / 2 << " and " << bufferSize << ")");
+      numberOfErrors++;
+    }
+
+    // The low priority buffer is shrunk to the minimum size, then the high priority buffer is shrunk
+    const int expectedHighPriorityBufferSize = 2 * MINIMUM_SHRUNK_BUFFER_SIZE;
+    dataCollector->SetBufferMemoryBudgetBytes((MINIMUM_SHRUNK_BUFFER_SIZE + expectedHighPriorityBufferSize) * itemSizeInBytes);
+    if (dataCollector->EnforceBufferMemoryBudget() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to shrink the buffers to fit in the buffer memory budget");
+      numberOfErrors++;
+    }
+    if (lowPrioritySource->GetBufferSize() != MINIMUM_SHRUNK_BUFFER_SIZE || highPrioritySource->GetBufferSize() < expectedHighPriorityBufferSize - 1
+        || highPrioritySource->GetBufferSize() > expectedHighPriorityBufferSize)
+    {
+      LOG_ERROR("Unexpected buffer sizes after shrinking: " << lowPrioritySource->GetBufferSize() << " and " << highPrioritySource->GetBufferSize()
+                << " (expected: " << MINIMUM_SHRUNK_BUFFER_SIZE << " and " << expectedHighPriorityBufferSize << ")");
+      numberOfErrors++;
+    }
+    if (dataCollector->GetAllocatedBufferMemoryInBytes() > dataCollector->GetBufferMemoryBudgetBytes())
+    {
+      LOG_ERROR("Allocated buffer memory (" << dataCollector->GetAllocatedBufferMemoryInBytes() << " bytes) exceeds the budget after shrinking");
+      numberOfErrors++;
+    }
+
+    // Buffers do not fit even at the minimum size
+    dataCollector->SetBufferMemoryBudgetBytes(MINIMUM_SHRUNK_BUFFER_SIZE * itemSizeInBytes);
+    if (dataCollector->EnforceBufferMemoryBudget() == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Buffers do not fit in the buffer memory budget at the minimum size but enforcing it succeeded");
+      numberOfErrors++;
+    }
+    if (lowPrioritySource->GetBufferSize() != MINIMUM_SHRUNK_BUFFER_SIZE || highPrioritySource->GetBufferSize() != MINIMUM_SHRUNK_BUFFER_SIZE)
+    {
+      LOG_ERROR("Buffers are not shrunk to the minimum size: " << lowPrioritySource->GetBufferSize() << " and " << highPrioritySource->GetBufferSize());
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestConnectWithMemoryBudget()
+  {
+    const int bufferSize = 100;
+    int numberOfErrors(0);
+
+    vtkPlusDataSource* lowPrioritySource(NULL);
+    vtkPlusDataSource* highPrioritySource(NULL);
+    vtkSmartPointer<vtkPlusDataCollector> dataCollector = CreateDataCollector(bufferSize, lowPrioritySource, highPrioritySource);
+    const unsigned long long itemSizeInBytes = lowPrioritySource->GetBufferItemSizeInBytes();
+    dataCollector->SetBufferMemoryBudgetAction(vtkPlusDataCollector::BUFFER_MEMORY_BUDGET_SHRINK_BUFFERS);
+    dataCollector->SetBufferMemoryBudgetBytes(bufferSize * itemSizeInBytes);
+
+    // The buffers are shrunk when the devices are connected, before their frame memory is mapped
+    if (dataCollector->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to connect the data collector with a buffer memory budget");
+      return numberOfErrors + 1;
+    }
+    if (dataCollector->GetAllocatedBufferMemoryInBytes() > dataCollector->GetBufferMemoryBudgetBytes())
+    {
+      LOG_ERROR("Allocated buffer memory (" << dataCollector->GetAllocatedBufferMemoryInBytes() << " bytes) exceeds the budget of "
+                << dataCollector->GetBufferMemoryBudgetBytes() << " bytes after connecting");
+      numberOfErrors++;
+    }
+    if (highPrioritySource->GetBufferSize() != bufferSize)
+    {
+      LOG_ERROR("High priority buffer is shrunk to " << highPrioritySource->GetBufferSize() << " items when connecting (expected: " << bufferSize << ")");
+      numberOfErrors++;
+    }
+    dataCollector->Disconnect();
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = TestBufferAllocatedMemory();
+  numberOfErrors += TestMemoryBudget();
+  numberOfErrors += TestConnectWithMemoryBudget();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,332 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferSpillTest.cxx
+  \brief Test that items which are overwritten in a small in-memory buffer remain accessible through the spill file.
+
+  A video buffer of a few frames is filled with many more frames than it can hold. The test checks
+  that the spilled frames can be retrieved by UID and by time with their timestamps, pixel data and
+  custom fields, that the history is limited to the buffer size plus the spill size, that a rejected
+  frame does not spill any frame, and that the complete history is written to a sequence file.
+  It also checks that a buffer without spill file keeps its pinned frames until it is unpinned.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  const double FRAME_PERIOD_SEC = 0.01;
+  const unsigned int FRAME_WIDTH = 32;
+  const unsigned int FRAME_HEIGHT = 24;
+  const char* FRAME_NUMBER_FIELD_NAME = "FrameNumberText";
+
+  //----------------------------------------------------------------------------
+  double GetFrameTimestamp(int frameNumber)
+  {
+    return 10.0 + frameNumber * FRAME_PERIOD_SEC;
+  }
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrames(vtkPlusBuffer* buffer, int firstFrameNumber, int numberOfFrames)
+  {
+    FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    std::array<int, 3> clipRectangleOrigin = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+    std::array<int, 3> clipRectangleSize = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT);
+    for (int frameNumber = firstFrameNumber; frameNumber < firstFrameNumber + numberOfFrames; ++frameNumber)
+    {
+      // each frame is filled with a value derived from its frame number
+      std::fill(pixels.begin(), pixels.end(), static_cast<unsigned char>(frameNumber % 256));
+      std::ostringstream frameNumberText;
+      frameNumberText << frameNumber;
+      igsioFieldMapType customFields;
+      customFields[FRAME_NUMBER_FIELD_NAME].first = FRAMEFIELD_NONE;
+      customFields[FRAME_NUMBER_FIELD_NAME].second = frameNumberText.str();
+      double timestamp = GetFrameTimestamp(frameNumber);
+      if (buffer->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber,
+                          clipRectangleOrigin, clipRectangleSize, timestamp, timestamp, &customFields) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        return PLUS_FAIL;
+      }
+    }
+    return PLUS_SUCCESS;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckFrame(vtkPlusBuffer* buffer, BufferItemUidType uid)
+  {
+    // frame numbers start at 1, same as the UIDs
+    const int frameNumber = static_cast<int>(uid);
+    StreamBufferItem item;
+    if (buffer->GetStreamBufferItem(uid, &item) != ITEM_OK)
+    {
+      LOG_ERROR("Frame " << uid << " is not available");
+      return 1;
+    }
+    int numberOfErrors(0);
+    if (item.GetIndex() != static_cast<unsigned long>(frameNumber))
+    {
+      LOG_ERROR("Frame " << uid << " has index " << item.GetIndex());
+      numberOfErrors++;
+    }
+    if (fabs(item.GetFilteredTimestamp(buffer->GetLocalTimeOffsetSec()) - GetFrameTimestamp(frameNumber)) > 1e-6)
+    {
+      LOG_ERROR("Frame " << uid << " has timestamp " << item.GetFilteredTimestamp(buffer->GetLocalTimeOffsetSec()));
+      numberOfErrors++;
+    }
+    double timestamp(0);
+    if (buffer->GetTimeStamp(uid, timestamp) != ITEM_OK || fabs(timestamp - GetFrameTimestamp(frameNumber)) > 1e-6)
+    {
+      LOG_ERROR("GetTimeStamp returned " << timestamp << " for frame " << uid);
+      numberOfErrors++;
+    }
+    std::ostringstream frameNumberText;
+    frameNumberText << frameNumber;
+    if (item.GetFrameField(FRAME_NUMBER_FIELD_NAME) != frameNumberText.str())
+    {
+      LOG_ERROR("Frame " << uid << " has custom field value '" << item.GetFrameField(FRAME_NUMBER_FIELD_NAME) << "'");
+      numberOfErrors++;
+    }
+    FrameSizeType frameSize = item.GetFrame().GetFrameSize();
+    if (frameSize[0] != FRAME_WIDTH || frameSize[1] != FRAME_HEIGHT)
+    {
+      LOG_ERROR("Frame " << uid << " has size " << frameSize[0] << "x" << frameSize[1]);
+      return numberOfErrors + 1;
+    }
+    const unsigned char* pixels = static_cast<const unsigned char*>(item.GetFrame().GetScalarPointer());
+    for (unsigned int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+      if (pixels[i] != static_cast<unsigned char>(frameNumber % 256))
+      {
+        LOG_ERROR("Frame " << uid << " has pixel value " << static_cast<int>(pixels[i]) << " at " << i);
+        numberOfErrors++;
+        break;
+      }
+    }
+    BufferItemUidType foundUid(0);
+    if (buffer->GetItemUidFromTime(GetFrameTimestamp(frameNumber) + FRAME_PERIOD_SEC * 0.2, foundUid) != ITEM_OK || foundUid != uid)
+    {
+      LOG_ERROR("Frame " << uid << " is not found by time (found: " << foundUid << ")");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckHistory(vtkPlusBuffer* buffer, BufferItemUidType expectedOldestUid, BufferItemUidType expectedLatestUid)
+  {
+    int numberOfErrors(0);
+    if (buffer->GetOldestItemUidInBuffer() != expectedOldestUid || buffer->GetLatestItemUidInBuffer() != expectedLatestUid)
+    {
+      LOG_ERROR("Buffer contains frames " << buffer->GetOldestItemUidInBuffer() << "-" << buffer->GetLatestItemUidInBuffer()
+                << " (expected: " << expectedOldestUid << "-" << expectedLatestUid << ")");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfItems() != static_cast<int>(expectedLatestUid - expectedOldestUid + 1))
+    {
+      LOG_ERROR("Buffer contains " << buffer->GetNumberOfItems() << " frames (expected: " << expectedLatestUid - expectedOldestUid + 1 << ")");
+      numberOfErrors++;
+    }
+    for (BufferItemUidType uid = expectedOldestUid; uid <= expectedLatestUid; ++uid)
+    {
+      numberOfErrors += CheckFrame(buffer, uid);
+    }
+    StreamBufferItem item;
+    if (expectedOldestUid > 1 && buffer->GetStreamBufferItem(expectedOldestUid - 1, &item) != ITEM_NOT_AVAILABLE_ANYMORE)
+    {
+      LOG_ERROR("Frame " << expectedOldestUid - 1 << " should not be available anymore");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int bufferSize(10);
+  int spillBufferSize(100);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of frames kept in memory (Default: 10).");
+  args.AddArgument("--spill-buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &spillBufferSize, "Number of frames kept in the spill file (Default: 100).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  buffer->SetBufferSize(bufferSize);
+  buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+  buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+  buffer->SetNumberOfScalarComponents(1);
+  buffer->SetImageType(US_IMG_BRIGHTNESS);
+  buffer->SetImageOrientation(US_IMG_ORIENT_MF);
+  if (buffer->SetSpillBufferSize(spillBufferSize) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set spill buffer size");
+    return EXIT_FAILURE;
+  }
+
+  int numberOfErrors(0);
+
+  // the history is not full yet: all frames are available
+  const int numberOfFramesPartial = bufferSize + spillBufferSize / 2;
+  if (AddFrames(buffer, 1, numberOfFramesPartial) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Check history after " << numberOfFramesPartial << " frames");
+  numberOfErrors += CheckHistory(buffer, 1, numberOfFramesPartial);
+
+  // the spill file is full: the oldest frames are removed
+  const int numberOfFramesTotal = bufferSize + spillBufferSize * 3;
+  if (AddFrames(buffer, numberOfFramesPartial + 1, numberOfFramesTotal - numberOfFramesPartial) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Check history after " << numberOfFramesTotal << " frames");
+  const BufferItemUidType oldestUid = numberOfFramesTotal - (bufferSize + spillBufferSize) + 1;
+  numberOfErrors += CheckHistory(buffer, oldestUid, numberOfFramesTotal);
+
+  // a frame that is rejected because its timestamp is not newer does not spill any frame
+  LOG_INFO("Check history after a rejected frame");
+  FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+  std::array<int, 3> noClip = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+  std::vector<unsigned char> rejectedPixels(FRAME_WIDTH * FRAME_HEIGHT, 0);
+  const double latestTimestamp = GetFrameTimestamp(numberOfFramesTotal);
+  if (buffer->AddItem(&rejectedPixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, numberOfFramesTotal + 1,
+                      noClip, noClip, latestTimestamp, latestTimestamp) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("Frame with the timestamp of the latest frame was added");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckHistory(buffer, oldestUid, numberOfFramesTotal);
+
+  // no frame has been acquired after the latest frame
+  BufferItemUidType firstUidAfterLatest = 0;
+  if (buffer->GetFirstItemUidAfterTime(latestTimestamp, firstUidAfterLatest) != ITEM_NOT_AVAILABLE_YET)
+  {
+    LOG_ERROR("A frame was found after the latest frame (UID: " << firstUidAfterLatest << ")");
+    numberOfErrors++;
+  }
+
+  // all frames of the history are written to file
+  std::string outputFilePath = vtkPlusConfig::GetInstance()->GetOutputPath("vtkPlusBufferSpillTest.igs.mha");
+  if (buffer->WriteToSequenceFile(outputFilePath.c_str()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to write buffer to " << outputFilePath);
+    numberOfErrors++;
+  }
+  else
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(outputFilePath, trackedFrameList) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read " << outputFilePath);
+      numberOfErrors++;
+    }
+    else if (trackedFrameList->GetNumberOfTrackedFrames() != static_cast<unsigned int>(bufferSize + spillBufferSize))
+    {
+      LOG_ERROR("Sequence file contains " << trackedFrameList->GetNumberOfTrackedFrames() << " frames (expected: " << bufferSize + spillBufferSize << ")");
+      numberOfErrors++;
+    }
+    vtksys::SystemTools::RemoveFile(outputFilePath);
+  }
+
+  // clearing the buffer removes the spilled frames, too
+  buffer->Clear();
+  if (buffer->GetNumberOfItems() != 0)
+  {
+    LOG_ERROR("Buffer contains " << buffer->GetNumberOfItems() << " frames after clear");
+    numberOfErrors++;
+  }
+
+  // a buffer without spill file keeps the pinned frames in memory while they are overwritten
+  vtkSmartPointer<vtkPlusBuffer> pinnedBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  pinnedBuffer->SetBufferSize(bufferSize);
+  pinnedBuffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+  pinnedBuffer->SetPixelType(VTK_UNSIGNED_CHAR);
+  pinnedBuffer->SetNumberOfScalarComponents(1);
+  pinnedBuffer->SetImageType(US_IMG_BRIGHTNESS);
+  pinnedBuffer->SetImageOrientation(US_IMG_ORIENT_MF);
+  if (AddFrames(pinnedBuffer, 1, bufferSize) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  BufferItemUidType pinnedUid = pinnedBuffer->PinItems();
+  if (AddFrames(pinnedBuffer, bufferSize + 1, bufferSize / 2) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  LOG_INFO("Check history of the pinned buffer");
+  numberOfErrors += CheckHistory(pinnedBuffer, 1, bufferSize + bufferSize / 2);
+  if (pinnedBuffer->UnpinItems(pinnedUid) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Pinned frames were discarded");
+    numberOfErrors++;
+  }
+  // the overwritten frames are not kept after the buffer is unpinned
+  numberOfErrors += CheckHistory(pinnedBuffer, bufferSize / 2 + 1, bufferSize + bufferSize / 2);
+
+  // the pin fails if more frames are overwritten than the buffer size
+  pinnedUid = pinnedBuffer->PinItems();
+  const int latestUid = bufferSize + bufferSize / 2;
+  if (AddFrames(pinnedBuffer, latestUid + 1, 2 * bufferSize + 1) != PLUS_SUCCESS)
+  {
+    return EXIT_FAILURE;
+  }
+  if (pinnedBuffer->UnpinItems(pinnedUid) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unpinning succeeded although pinned frames were discarded");
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,515 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusBufferViewTest.cxx
+  \brief Test that buffer item views reference the buffer pixel data and that the pixel data is not overwritten while a view is held.
+  The test is performed with separately allocated frames and with contiguous frame memory. The number of detached frames is
+  checked to be bounded. When the limit is reached the writer reuses the pixel data of slots that are not referenced and removes
+  the older items instead of the new frames, new frames are only skipped if all slots are referenced. Pixel data of views is
+  checked to be kept and accounted for when the buffer is resized. Tracked frames of a channel are checked to own their
+  pixel data, unless a view is requested explicitly.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusFrameSlab.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+  const unsigned int FRAME_WIDTH = 64;
+  const unsigned int FRAME_HEIGHT = 48;
+  const int BUFFER_SIZE = 5;
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrame(vtkPlusBuffer* buffer, long frameNumber)
+  {
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, static_cast<unsigned char>(frameNumber));
+    FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    return buffer->AddItem(&pixels[0], frameSize, pixels.size(), US_IMG_BRIGHTNESS, frameNumber, frameNumber * 0.1, frameNumber * 0.1);
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsFrameFilledWith(vtkImageData* image, unsigned char value)
+  {
+    unsigned char* pixels = static_cast<unsigned char*>(image->GetScalarPointer());
+    for (unsigned int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT; ++i)
+    {
+      if (pixels[i] != value)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestBufferViews(bool contiguousFrameMemory)
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    if (buffer->SetContiguousFrameMemory(contiguousFrameMemory) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set frame memory allocation mode");
+      return 1;
+    }
+    buffer->PrefaultFrameMemory();
+
+    for (long frameNumber = 1; frameNumber <= BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+
+    if (contiguousFrameMemory)
+    {
+      // Consecutive frames are stored next to each other in aligned memory
+      StreamBufferItem firstItem;
+      StreamBufferItem secondItem;
+      buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer(), &firstItem);
+      buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer() + 1, &secondItem);
+      unsigned char* firstPixels = static_cast<unsigned char*>(firstItem.GetFrame().GetImage()->GetScalarPointer());
+      unsigned char* secondPixels = static_cast<unsigned char*>(secondItem.GetFrame().GetImage()->GetScalarPointer());
+      if (reinterpret_cast<size_t>(firstPixels) % vtkPlusFrameSlab::FRAME_ALIGNMENT_BYTES != 0)
+      {
+        LOG_ERROR("Frame pixel data is not aligned to " << vtkPlusFrameSlab::FRAME_ALIGNMENT_BYTES << " bytes");
+        numberOfErrors++;
+      }
+      if (secondPixels - firstPixels != static_cast<ptrdiff_t>(FRAME_WIDTH * FRAME_HEIGHT))
+      {
+        LOG_ERROR("Frames are not stored in contiguous memory");
+        numberOfErrors++;
+      }
+    }
+
+    // A view must reference the pixel data of the buffer slot
+    BufferItemUidType oldestUid = buffer->GetOldestItemUidInBuffer();
+    StreamBufferItem view;
+    if (buffer->GetStreamBufferItemView(oldestUid, &view) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get view of item " << oldestUid);
+      return numberOfErrors + 1;
+    }
+    StreamBufferItem copy;
+    buffer->GetStreamBufferItem(oldestUid, &copy);
+    if (copy.GetFrame().GetImage()->GetScalarPointer() == view.GetFrame().GetImage()->GetScalarPointer())
+    {
+      LOG_ERROR("Deep copy of a buffer item shares pixel data with the buffer");
+      numberOfErrors++;
+    }
+    if (!view.IsFrameShared())
+    {
+      LOG_ERROR("View of a buffer item does not share pixel data with the buffer");
+      numberOfErrors++;
+    }
+
+    // Copying into a view must not write into the buffer slot that the view references
+    StreamBufferItem reusedView;
+    buffer->GetStreamBufferItemView(oldestUid + 1, &reusedView);
+    if (reusedView.DeepCopy(&copy) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to copy into a view");
+      numberOfErrors++;
+    }
+    StreamBufferItem slotContent;
+    buffer->GetStreamBufferItem(oldestUid + 1, &slotContent);
+    if (!IsFrameFilledWith(slotContent.GetFrame().GetImage(), static_cast<unsigned char>(oldestUid + 1)))
+    {
+      LOG_ERROR("Copying into a view has overwritten the pixel data of the buffer");
+      numberOfErrors++;
+    }
+
+    // Overwrite every slot of the buffer, the slot of the view must be moved to new memory
+    for (long frameNumber = BUFFER_SIZE + 1; frameNumber <= 3 * BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+    if (!IsFrameFilledWith(view.GetFrame().GetImage(), static_cast<unsigned char>(oldestUid)))
+    {
+      LOG_ERROR("Pixel data of a view has been overwritten by the buffer");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfDetachedFrames() != 1)
+    {
+      LOG_ERROR("Unexpected number of detached frames: " << buffer->GetNumberOfDetachedFrames() << " (expected: 1)");
+      numberOfErrors++;
+    }
+
+    // Slots that are not referenced anymore are reused in place
+    StreamBufferItem latestItem;
+    buffer->GetStreamBufferItem(buffer->GetLatestItemUidInBuffer(), &latestItem);
+    if (!IsFrameFilledWith(latestItem.GetFrame().GetImage(), static_cast<unsigned char>(3 * BUFFER_SIZE)))
+    {
+      LOG_ERROR("Latest frame in the buffer has unexpected content");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestDetachedFrameLimit()
+  {
+    int numberOfErrors(0);
+    const int maxNumberOfDetachedFrames = 2;
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    buffer->SetMaxNumberOfDetachedFrames(maxNumberOfDetachedFrames);
+
+    for (long frameNumber = 1; frameNumber <= BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+
+    // References that are not views (e.g., of a copied image) must not make the buffer detach slots
+    StreamBufferItem copy;
+    buffer->GetStreamBufferItem(buffer->GetOldestItemUidInBuffer(), &copy);
+    vtkSmartPointer<vtkImageData> copiedImage = copy.GetFrame().GetImage();
+
+    // A slow reader holds views of every slot
+    std::vector<StreamBufferItem> views(BUFFER_SIZE);
+    for (int i = 0; i < BUFFER_SIZE; ++i)
+    {
+      if (buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer() + i, &views[i]) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get view of item " << buffer->GetOldestItemUidInBuffer() + i);
+        numberOfErrors++;
+      }
+    }
+
+    // Only the allowed number of slots are detached, then the writer skips ahead to the slots of the detached frames,
+    // all the new frames are added and the older items are removed
+    for (long frameNumber = BUFFER_SIZE + 1; frameNumber <= 2 * BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Frame " << frameNumber << " is not added although there are slots that are not referenced by views");
+        numberOfErrors++;
+      }
+    }
+    if (buffer->GetNumberOfDetachedFrames() != static_cast<unsigned long>(maxNumberOfDetachedFrames))
+    {
+      LOG_ERROR("Unexpected number of detached frames: " << buffer->GetNumberOfDetachedFrames() << " (expected: " << maxNumberOfDetachedFrames << ")");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfSkippedFrames() != 0 || buffer->GetNumberOfDiscardedItems() == 0)
+    {
+      LOG_ERROR("Unexpected number of skipped frames and discarded items: " << buffer->GetNumberOfSkippedFrames() << " and " << buffer->GetNumberOfDiscardedItems()
+                << " (expected: 0 and more than 0)");
+      numberOfErrors++;
+    }
+    for (BufferItemUidType uid = buffer->GetOldestItemUidInBuffer(); uid <= buffer->GetLatestItemUidInBuffer(); ++uid)
+    {
+      StreamBufferItem item;
+      if (buffer->GetStreamBufferItem(uid, &item) != ITEM_OK || !IsFrameFilledWith(item.GetFrame().GetImage(), static_cast<unsigned char>(item.GetIndex())))
+      {
+        LOG_ERROR("Pixel data of item " << uid << " does not match its frame number");
+        numberOfErrors++;
+      }
+    }
+    if (buffer->GetLatestItemUidInBuffer() != static_cast<BufferItemUidType>(2 * BUFFER_SIZE))
+    {
+      LOG_ERROR("Latest item UID is " << buffer->GetLatestItemUidInBuffer() << " (expected: " << 2 * BUFFER_SIZE << ")");
+      numberOfErrors++;
+    }
+    for (int i = 0; i < BUFFER_SIZE; ++i)
+    {
+      if (!IsFrameFilledWith(views[i].GetFrame().GetImage(), static_cast<unsigned char>(i + 1)))
+      {
+        LOG_ERROR("Pixel data of view " << i << " has been overwritten by the buffer");
+        numberOfErrors++;
+      }
+    }
+
+    // Once the views are released the slots are reused in place
+    views.clear();
+    const unsigned long numberOfDetachedFrames = buffer->GetNumberOfDetachedFrames();
+    for (long frameNumber = 2 * BUFFER_SIZE + 1; frameNumber <= 4 * BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+    if (buffer->GetNumberOfDetachedFrames() != numberOfDetachedFrames)
+    {
+      LOG_ERROR("Slots are detached after the views have been released");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfSkippedFrames() != 0)
+    {
+      LOG_ERROR("Frames are skipped after the views have been released");
+      numberOfErrors++;
+    }
+    if (!IsFrameFilledWith(copiedImage, 1))
+    {
+      LOG_ERROR("Pixel data of a copied frame has been changed by the buffer");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestAllSlotsReferenced()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    buffer->SetMaxNumberOfDetachedFrames(0);
+    for (long frameNumber = 1; frameNumber <= BUFFER_SIZE; ++frameNumber)
+    {
+      AddFrame(buffer, frameNumber);
+    }
+
+    // If the pixel data of all slots is referenced then the new frame is skipped and reported as not added
+    std::vector<StreamBufferItem> views(BUFFER_SIZE);
+    for (int i = 0; i < BUFFER_SIZE; ++i)
+    {
+      buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer() + i, &views[i]);
+    }
+    if (AddFrame(buffer, BUFFER_SIZE + 1) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Frame is added although all slots are referenced by views");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfSkippedFrames() != 1 || buffer->GetNumberOfDetachedFrames() != 0 || buffer->GetNumberOfItems() != BUFFER_SIZE)
+    {
+      LOG_ERROR("Unexpected buffer state after skipping a frame: " << buffer->GetNumberOfSkippedFrames() << " skipped frames, "
+                << buffer->GetNumberOfDetachedFrames() << " detached frames, " << buffer->GetNumberOfItems() << " items");
+      numberOfErrors++;
+    }
+
+    // Once one view is released its slot is used
+    views.pop_back();
+    if (AddFrame(buffer, BUFFER_SIZE + 2) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Frame is not added although a slot is not referenced anymore");
+      numberOfErrors++;
+    }
+    for (int i = 0; i < BUFFER_SIZE - 1; ++i)
+    {
+      if (!IsFrameFilledWith(views[i].GetFrame().GetImage(), static_cast<unsigned char>(i + 1)))
+      {
+        LOG_ERROR("Pixel data of view " << i << " has been overwritten by the buffer");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestResizeWithViews()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusBuffer> buffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    buffer->SetPixelType(VTK_UNSIGNED_CHAR);
+    buffer->SetNumberOfScalarComponents(1);
+    buffer->SetFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    for (long frameNumber = 1; frameNumber <= BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+
+    StreamBufferItem view;
+    if (buffer->GetStreamBufferItemView(buffer->GetOldestItemUidInBuffer(), &view) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get view of the oldest item");
+      return numberOfErrors + 1;
+    }
+
+    // Resizing reallocates the slots, the pixel data of the view is kept and accounted for as detached
+    if (buffer->SetBufferSize(2 * BUFFER_SIZE) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to resize the buffer");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfDetachedFrames() != 1)
+    {
+      LOG_ERROR("Unexpected number of detached frames after resizing: " << buffer->GetNumberOfDetachedFrames() << " (expected: 1)");
+      numberOfErrors++;
+    }
+    if (!IsFrameFilledWith(view.GetFrame().GetImage(), 1))
+    {
+      LOG_ERROR("Pixel data of the view has been changed by resizing the buffer");
+      numberOfErrors++;
+    }
+    const unsigned long long frameSizeInBytes = FRAME_WIDTH * FRAME_HEIGHT;
+    if (buffer->GetAllocatedMemoryInBytes() < (2 * BUFFER_SIZE + 1) * frameSizeInBytes)
+    {
+      LOG_ERROR("Pixel data of the view is not counted in the allocated memory of the buffer");
+      numberOfErrors++;
+    }
+
+    // Once the view is released the new slots are written in place
+    view = StreamBufferItem();
+    for (long frameNumber = BUFFER_SIZE + 1; frameNumber <= 4 * BUFFER_SIZE; ++frameNumber)
+    {
+      if (AddFrame(buffer, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+    if (buffer->GetNumberOfDetachedFrames() != 1)
+    {
+      LOG_ERROR("Slots are detached after the view has been released");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestChannelFrames()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+    source->SetId("Video");
+    source->SetType(DATA_SOURCE_TYPE_VIDEO);
+    source->SetBufferSize(BUFFER_SIZE);
+    source->SetInputFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    source->SetPixelType(VTK_UNSIGNED_CHAR);
+    source->SetImageType(US_IMG_BRIGHTNESS);
+    source->SetInputImageOrientation(US_IMG_ORIENT_MF);
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("VideoStream");
+    channel->SetVideoSource(source);
+
+    const long frameNumber = 7;
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, static_cast<unsigned char>(frameNumber));
+    FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    if (source->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber, frameNumber * 0.1, frameNumber * 0.1) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add frame to the video source");
+      return 1;
+    }
+    const double timestamp = frameNumber * 0.1;
+    StreamBufferItem bufferView;
+    if (source->GetStreamBufferItemView(source->GetLatestItemUidInBuffer(), &bufferView) != ITEM_OK)
+    {
+      LOG_ERROR("Failed to get view of the latest frame");
+      return 1;
+    }
+    vtkImageData* bufferImage = bufferView.GetFrame().GetImage();
+
+    // A view shares the pixel data with the buffer
+    igsioTrackedFrame trackedFrame;
+    if (channel->GetTrackedFrameView(timestamp, trackedFrame) != PLUS_SUCCESS || trackedFrame.GetImageData()->GetImage() == NULL
+        || trackedFrame.GetImageData()->GetImage()->GetScalarPointer() != bufferImage->GetScalarPointer())
+    {
+      LOG_ERROR("Tracked frame view does not reference the pixel data of the buffer");
+      numberOfErrors++;
+    }
+
+    // A tracked frame owns its pixel data, even if the same object held a view before
+    if (channel->GetTrackedFrame(timestamp, trackedFrame) != PLUS_SUCCESS || trackedFrame.GetImageData()->GetImage() == NULL)
+    {
+      LOG_ERROR("Failed to get tracked frame");
+      return numberOfErrors + 1;
+    }
+    if (trackedFrame.GetImageData()->GetImage()->GetScalarPointer() == bufferImage->GetScalarPointer())
+    {
+      LOG_ERROR("Tracked frame shares pixel data with the buffer");
+      numberOfErrors++;
+    }
+    unsigned char* framePixels = static_cast<unsigned char*>(trackedFrame.GetImageData()->GetImage()->GetScalarPointer());
+    std::fill(framePixels, framePixels + FRAME_WIDTH * FRAME_HEIGHT, 0);
+
+    if (!IsFrameFilledWith(bufferImage, static_cast<unsigned char>(frameNumber)))
+    {
+      LOG_ERROR("Modifying a tracked frame has changed the pixel data of the buffer");
+      numberOfErrors++;
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+  numberOfErrors += TestBufferViews(false);
+  numberOfErrors += TestBufferViews(true);
+  numberOfErrors += TestDetachedFrameLimit();
+  numberOfErrors += TestAllSlotsReferenced();
+  numberOfErrors += TestResizeWithViews();
+  numberOfErrors += TestChannelFrames();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
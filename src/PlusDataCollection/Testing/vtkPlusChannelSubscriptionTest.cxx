@@ -0,0 +1,241 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusChannelSubscriptionTest.cxx
+  \brief Test delivering the tracked frames of a channel to subscribers.
+
+  A tracker with several tools is simulated. Three subscribers are registered to the channel before the samples are added:
+  one with a queue that is large enough for all the frames, and two with a small queue, dropping the oldest or the newest frames.
+  The test fails if the large queue misses a frame or the frames are not in order, if the small queues do not keep the expected frames,
+  if the drop counters are wrong, or if the subscribers do not receive the same shared frame objects.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusChannelSubscription.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+#include <vector>
+
+namespace
+{
+  const double SAMPLING_PERIOD_SEC = 0.01;
+
+  //----------------------------------------------------------------------------
+  int GetFrameNumber(const PlusChannelSubscription::FramePointer& frame)
+  {
+    return static_cast<int>(std::floor(frame->GetTimestamp() / SAMPLING_PERIOD_SEC + 0.5));
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Check that the queue of a small subscription contains the expected frames and that the counters are consistent */
+  void CheckSmallQueue(const std::string& name, PlusChannelSubscription* subscription, const std::vector<PlusChannelSubscription::FramePointer>& expectedFrames,
+                       unsigned long long numberOfDeliveredFrames, int& numberOfErrors)
+  {
+    LOG_INFO(name << ": pushed " << subscription->GetNumberOfPushedFrames() << ", dropped " << subscription->GetNumberOfDroppedFrames()
+             << ", queue depth " << subscription->GetQueueDepth());
+    if (subscription->GetNumberOfPushedFrames() != numberOfDeliveredFrames)
+    {
+      LOG_ERROR(name << ": " << subscription->GetNumberOfPushedFrames() << " frames were pushed instead of " << numberOfDeliveredFrames);
+      numberOfErrors++;
+    }
+    if (subscription->GetQueueDepth() != expectedFrames.size())
+    {
+      LOG_ERROR(name << ": queue depth is " << subscription->GetQueueDepth() << " instead of " << expectedFrames.size());
+      numberOfErrors++;
+    }
+    if (subscription->GetNumberOfDroppedFrames() != numberOfDeliveredFrames - expectedFrames.size())
+    {
+      LOG_ERROR(name << ": " << subscription->GetNumberOfDroppedFrames() << " frames were dropped instead of " << numberOfDeliveredFrames - expectedFrames.size());
+      numberOfErrors++;
+    }
+    for (std::vector<PlusChannelSubscription::FramePointer>::const_iterator it = expectedFrames.begin(); it != expectedFrames.end(); ++it)
+    {
+      PlusChannelSubscription::FramePointer frame;
+      if (subscription->PopFrame(frame) != PLUS_SUCCESS)
+      {
+        LOG_ERROR(name << ": frame " << GetFrameNumber(*it) << " is missing from the queue");
+        numberOfErrors++;
+        return;
+      }
+      if (frame != *it)
+      {
+        LOG_ERROR(name << ": frame " << GetFrameNumber(frame) << " is in the queue instead of frame " << GetFrameNumber(*it) << " or it is not the shared frame object");
+        numberOfErrors++;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfTools(5);
+  int numberOfSamples(300);
+  int smallQueueDepth(5);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tracked tools (Default: 5).");
+  args.AddArgument("--number-of-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSamples, "Number of tracker samples (Default: 300).");
+  args.AddArgument("--small-queue-depth", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &smallQueueDepth, "Queue depth of the subscribers that drop frames (Default: 5).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfTools < 1 || smallQueueDepth < 1 || numberOfSamples < 2 * smallQueueDepth)
+  {
+    LOG_ERROR("At least one tool and a queue depth of one are needed, and the number of samples must be at least twice the queue depth");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  vtkSmartPointer<vtkPlusTestTracker> tracker = vtkSmartPointer<vtkPlusTestTracker>::New();
+  tracker->SetDeviceId("Tracker");
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+  channel->SetChannelId("TrackerStream");
+  channel->SetOwnerDevice(tracker);
+
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > tools;
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > matrices;
+  std::vector<vtkPlusDevice::ToolTimeStampedUpdateItem> toolUpdates;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId("Probe" + igsioCommon::ToString<int>(toolIndex) + "ToTracker");
+    tool->SetType(DATA_SOURCE_TYPE_TOOL);
+    tool->SetBufferSize(numberOfSamples + 10);
+    if (tracker->AddTool(tool) != PLUS_SUCCESS || channel->AddTool(tool) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tool " << tool->GetId());
+      exit(EXIT_FAILURE);
+    }
+    tools.push_back(tool);
+    matrices.push_back(vtkSmartPointer<vtkMatrix4x4>::New());
+    toolUpdates.push_back(vtkPlusDevice::ToolTimeStampedUpdateItem(tool, matrices[toolIndex], TOOL_OK));
+  }
+
+  std::shared_ptr<PlusChannelSubscription> allFrames = channel->Subscribe(numberOfSamples + 10);
+  std::shared_ptr<PlusChannelSubscription> latestFrames = channel->Subscribe(smallQueueDepth, PlusChannelSubscription::DROP_OLDEST);
+  std::shared_ptr<PlusChannelSubscription> firstFrames = channel->Subscribe(smallQueueDepth, PlusChannelSubscription::DROP_NEWEST);
+  if (channel->GetNumberOfSubscriptions() != 3)
+  {
+    LOG_ERROR("Number of subscriptions is " << channel->GetNumberOfSubscriptions() << " instead of 3");
+    numberOfErrors++;
+  }
+
+  // Add the samples while the channel delivers the frames
+  for (int frameNumber = 1; frameNumber <= numberOfSamples; ++frameNumber)
+  {
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      matrices[toolIndex]->SetElement(0, 3, frameNumber);
+      matrices[toolIndex]->SetElement(1, 3, toolIndex);
+    }
+    const double timestamp = frameNumber * SAMPLING_PERIOD_SEC;
+    if (tracker->ToolTimeStampedUpdate(toolUpdates, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add sample " << frameNumber);
+      numberOfErrors++;
+    }
+    vtkIGSIOAccurateTimer::Delay(0.002);
+  }
+
+  // Read all the frames, until the last sample is delivered
+  std::vector<PlusChannelSubscription::FramePointer> receivedFrames;
+  PlusChannelSubscription::FramePointer frame;
+  while (receivedFrames.empty() || GetFrameNumber(receivedFrames.back()) < numberOfSamples)
+  {
+    if (allFrames->PopFrame(frame, 5.0) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("The last sample was not delivered, " << receivedFrames.size() << " frames were received");
+      numberOfErrors++;
+      break;
+    }
+    receivedFrames.push_back(frame);
+  }
+
+  // After unsubscribing, the dispatch thread does not deliver frames to any of the queues anymore
+  if (channel->Unsubscribe(allFrames) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to unsubscribe");
+    numberOfErrors++;
+  }
+
+  const unsigned long long numberOfDeliveredFrames = receivedFrames.size();
+  LOG_INFO("All frames: received " << numberOfDeliveredFrames << " frames, from sample " << (receivedFrames.empty() ? 0 : GetFrameNumber(receivedFrames.front())));
+  if (allFrames->GetNumberOfDroppedFrames() != 0 || allFrames->GetQueueDepth() != 0 || allFrames->GetNumberOfPushedFrames() != numberOfDeliveredFrames)
+  {
+    LOG_ERROR("All frames: pushed " << allFrames->GetNumberOfPushedFrames() << ", dropped " << allFrames->GetNumberOfDroppedFrames()
+              << ", queue depth " << allFrames->GetQueueDepth() << ", but " << numberOfDeliveredFrames << " frames were received");
+    numberOfErrors++;
+  }
+  for (unsigned int frameIndex = 1; frameIndex < receivedFrames.size(); ++frameIndex)
+  {
+    if (GetFrameNumber(receivedFrames[frameIndex]) != GetFrameNumber(receivedFrames[frameIndex - 1]) + 1)
+    {
+      LOG_ERROR("All frames: sample " << GetFrameNumber(receivedFrames[frameIndex]) << " was received after sample " << GetFrameNumber(receivedFrames[frameIndex - 1]));
+      numberOfErrors++;
+    }
+  }
+
+  if (receivedFrames.size() >= static_cast<size_t>(smallQueueDepth))
+  {
+    std::vector<PlusChannelSubscription::FramePointer> newestFrames(receivedFrames.end() - smallQueueDepth, receivedFrames.end());
+    CheckSmallQueue("Drop oldest", latestFrames.get(), newestFrames, numberOfDeliveredFrames, numberOfErrors);
+    std::vector<PlusChannelSubscription::FramePointer> oldestFrames(receivedFrames.begin(), receivedFrames.begin() + smallQueueDepth);
+    CheckSmallQueue("Drop newest", firstFrames.get(), oldestFrames, numberOfDeliveredFrames, numberOfErrors);
+  }
+  else
+  {
+    LOG_ERROR("Only " << receivedFrames.size() << " frames were received");
+    numberOfErrors++;
+  }
+
+  if (channel->Unsubscribe(latestFrames) != PLUS_SUCCESS || channel->Unsubscribe(firstFrames) != PLUS_SUCCESS || channel->GetNumberOfSubscriptions() != 0)
+  {
+    LOG_ERROR("Failed to remove all subscriptions");
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusChannelToolTransformNamesTest.cxx
+  \brief Test that the cached tool transform names of a channel follow the changes of its tools.
+
+  The transform names are parsed from the tool IDs only when the tools change. The test checks that the cached names
+  are reused while the tools do not change and that they are updated by AddTool, RemoveTool, RemoveTools and ReadConfiguration,
+  including a change that keeps the number of tools. It also checks that the timestamp master tool is replaced
+  when it is removed from the channel.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtkXMLUtilities.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------
+/*! Channel that exposes the cached tool transform names */
+class vtkPlusChannelToolTransformNamesTestChannel : public vtkPlusChannel
+{
+public:
+  static vtkPlusChannelToolTransformNamesTestChannel* New();
+  vtkTypeMacro(vtkPlusChannelToolTransformNamesTestChannel, vtkPlusChannel);
+
+  using vtkPlusChannel::GetToolTransformNames;
+
+protected:
+  vtkPlusChannelToolTransformNamesTestChannel() {}
+  ~vtkPlusChannelToolTransformNamesTestChannel() {}
+};
+
+vtkStandardNewMacro(vtkPlusChannelToolTransformNamesTestChannel);
+
+namespace
+{
+  typedef std::shared_ptr<const std::vector<igsioTransformName> > TransformNameListPtr;
+
+  //----------------------------------------------------------------------------
+  std::string GetNames(const TransformNameListPtr& transformNames)
+  {
+    std::string names;
+    for (std::vector<igsioTransformName>::const_iterator it = transformNames->begin(); it != transformNames->end(); ++it)
+    {
+      names += (names.empty() ? "" : ",") + it->GetTransformName();
+    }
+    return names;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckNames(vtkPlusChannelToolTransformNamesTestChannel* channel, const std::string& step, const std::string& expectedNames)
+  {
+    std::string names = GetNames(channel->GetToolTransformNames());
+    if (names != expectedNames)
+    {
+      LOG_ERROR("Tool transform names after " << step << ": \"" << names << "\" (expected: \"" << expectedNames << "\")");
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int CheckMasterTool(vtkPlusChannel* channel, const std::string& step, const std::string& expectedToolId)
+  {
+    vtkPlusDataSource* masterTool(NULL);
+    if (channel->GetTimestampMasterTool(masterTool) != PLUS_SUCCESS || masterTool->GetId() != expectedToolId)
+    {
+      LOG_ERROR("Timestamp master tool after " << step << " is " << (masterTool != NULL ? masterTool->GetId() : std::string("missing")) << " (expected: " << expectedToolId << ")");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+
+  vtkSmartPointer<vtkPlusDevice> tracker = vtkSmartPointer<vtkPlusDevice>::New();
+  tracker->SetDeviceId("Tracker");
+  vtkSmartPointer<vtkPlusChannelToolTransformNamesTestChannel> channel = vtkSmartPointer<vtkPlusChannelToolTransformNamesTestChannel>::New();
+  channel->SetChannelId("TrackerStream");
+  channel->SetOwnerDevice(tracker);
+
+  const char* toolIds[4] = { "ProbeToTracker", "StylusToTracker", "ReferenceToTracker", "NeedleToTracker" };
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > tools;
+  for (int toolIndex = 0; toolIndex < 4; ++toolIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId(toolIds[toolIndex]);
+    tool->SetType(DATA_SOURCE_TYPE_TOOL);
+    if (tracker->AddTool(tool) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tool " << toolIds[toolIndex]);
+      exit(EXIT_FAILURE);
+    }
+    tools.push_back(tool);
+  }
+
+  // Tools are listed in the order of their IDs
+  channel->AddTool(tools[0]);
+  channel->AddTool(tools[1]);
+  numberOfErrors += CheckNames(channel, "AddTool", "ProbeToTracker,StylusToTracker");
+  if (channel->GetToolTransformNames() != channel->GetToolTransformNames())
+  {
+    LOG_ERROR("Tool transform names are parsed again without a change of the tools");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckMasterTool(channel, "AddTool", "ProbeToTracker");
+
+  channel->AddTool(tools[2]);
+  numberOfErrors += CheckNames(channel, "AddTool", "ProbeToTracker,ReferenceToTracker,StylusToTracker");
+
+  // Removing the master tool must not access the removed tool
+  channel->RemoveTool("ProbeToTracker");
+  numberOfErrors += CheckNames(channel, "RemoveTool", "ReferenceToTracker,StylusToTracker");
+  numberOfErrors += CheckMasterTool(channel, "RemoveTool of the master tool", "ReferenceToTracker");
+
+  // The number of tools does not change
+  channel->RemoveTool("StylusToTracker");
+  channel->AddTool(tools[3]);
+  numberOfErrors += CheckNames(channel, "RemoveTool and AddTool", "NeedleToTracker,ReferenceToTracker");
+
+  channel->RemoveTools();
+  numberOfErrors += CheckNames(channel, "RemoveTools", "");
+  channel->AddTool(tools[1]);
+  numberOfErrors += CheckMasterTool(channel, "RemoveTools and AddTool", "StylusToTracker");
+  channel->RemoveTools();
+
+  vtkSmartPointer<vtkXMLDataElement> channelElement = vtkSmartPointer<vtkXMLDataElement>::Take(vtkXMLUtilities::ReadElementFromString(
+        "<OutputChannel Id=\"TrackerStream\"><DataSource Id=\"ProbeToTracker\" /><DataSource Id=\"NeedleToTracker\" /></OutputChannel>"));
+  if (channelElement == NULL || channel->ReadConfiguration(channelElement, false) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to read the channel configuration");
+    numberOfErrors++;
+  }
+  numberOfErrors += CheckNames(channel, "ReadConfiguration", "NeedleToTracker,ProbeToTracker");
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusDataCollectorDumpBuffersTest.cxx
+  \brief Test writing the buffers of the video sources to files in the background.
+
+  Several devices with a video source are simulated. The buffers are dumped while new frames are still added to one of them.
+  The test fails if the dump does not report its completion, if not exactly one file is written per video source,
+  or if the files do not contain the frames that were in the buffers when the dump was started.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusSequenceIO.h"
+
+// IGSIO includes
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  const double FRAME_PERIOD_SEC = 0.01;
+  const unsigned int FRAME_WIDTH = 64;
+  const unsigned int FRAME_HEIGHT = 48;
+
+  //----------------------------------------------------------------------------
+  PlusStatus AddFrame(vtkPlusDataSource* source, int frameNumber)
+  {
+    FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+    std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, static_cast<unsigned char>(frameNumber % 256));
+    double timestamp = frameNumber * FRAME_PERIOD_SEC;
+    return source->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber, timestamp, timestamp);
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfDevices(3);
+  int numberOfFrames(200);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-devices", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfDevices, "Number of simulated video devices (Default: 3).");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of frames in each buffer when the dump is started (Default: 200).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfDevices < 1 || numberOfFrames < 1)
+  {
+    LOG_ERROR("At least one device and one frame are needed");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  // The data collector deletes the devices
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > sources;
+  for (int deviceIndex = 0; deviceIndex < numberOfDevices; ++deviceIndex)
+  {
+    vtkPlusDevice* device = vtkPlusDevice::New();
+    device->SetDeviceId("VideoDevice" + igsioCommon::ToString<int>(deviceIndex));
+    vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+    source->SetId("Video");
+    source->SetType(DATA_SOURCE_TYPE_VIDEO);
+    // the buffer is large enough for the frames that are added during the dump
+    source->SetBufferSize(2 * numberOfFrames + 10);
+    source->SetInputFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    source->SetPixelType(VTK_UNSIGNED_CHAR);
+    source->SetImageType(US_IMG_BRIGHTNESS);
+    source->SetInputImageOrientation(US_IMG_ORIENT_MF);
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("VideoStream" + igsioCommon::ToString<int>(deviceIndex));
+    channel->SetVideoSource(source);
+    if (device->AddVideoSource(source) != PLUS_SUCCESS || device->AddOutputChannel(channel) != PLUS_SUCCESS || dataCollector->AddDevice(device) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to set up device " << device->GetDeviceId());
+      exit(EXIT_FAILURE);
+    }
+    for (int frameNumber = 1; frameNumber <= numberOfFrames; ++frameNumber)
+    {
+      if (AddFrame(source, frameNumber) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add frame " << frameNumber << " to " << device->GetDeviceId());
+        exit(EXIT_FAILURE);
+      }
+    }
+    sources.push_back(source);
+  }
+
+  std::string outputDirectory = vtkPlusConfig::GetInstance()->GetOutputDirectory() + "/vtkPlusDataCollectorDumpBuffersTest";
+  vtksys::SystemTools::RemoveADirectory(outputDirectory);
+  vtksys::SystemTools::MakeDirectory(outputDirectory);
+
+  if (dataCollector->StartDumpBuffersToDirectory(outputDirectory.c_str()) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start the buffer dump");
+    exit(EXIT_FAILURE);
+  }
+
+  // Acquisition continues while the buffers are written
+  for (int frameNumber = numberOfFrames + 1; frameNumber <= 2 * numberOfFrames && dataCollector->IsDumpBuffersInProgress(); ++frameNumber)
+  {
+    if (AddFrame(sources[0], frameNumber) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add frame " << frameNumber << " during the buffer dump");
+      numberOfErrors++;
+    }
+  }
+  LOG_INFO("Buffer dump progress while adding frames: " << dataCollector->GetDumpBuffersProgress());
+
+  if (dataCollector->WaitForDumpBuffers() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Buffer dump failed");
+    numberOfErrors++;
+  }
+  if (dataCollector->IsDumpBuffersInProgress() || dataCollector->GetDumpBuffersProgress() != 1.0)
+  {
+    LOG_ERROR("Buffer dump is finished, but it is reported to be in progress, or its progress is " << dataCollector->GetDumpBuffersProgress());
+    numberOfErrors++;
+  }
+
+  // Check the written files
+  vtksys::Directory directory;
+  directory.Load(outputDirectory.c_str());
+  std::vector<std::string> fileNames;
+  for (unsigned long fileIndex = 0; fileIndex < directory.GetNumberOfFiles(); ++fileIndex)
+  {
+    std::string fileName = directory.GetFile(fileIndex);
+    if (fileName.find("BufferDump_") == 0)
+    {
+      fileNames.push_back(fileName);
+    }
+  }
+  if (fileNames.size() != static_cast<size_t>(numberOfDevices))
+  {
+    LOG_ERROR(fileNames.size() << " buffer dump files are written instead of " << numberOfDevices);
+    numberOfErrors++;
+  }
+  for (std::vector<std::string>::iterator it = fileNames.begin(); it != fileNames.end(); ++it)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    if (vtkPlusSequenceIO::Read(outputDirectory + "/" + *it, trackedFrameList) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to read " << *it);
+      numberOfErrors++;
+      continue;
+    }
+    LOG_INFO(*it << ": " << trackedFrameList->GetNumberOfTrackedFrames() << " frames");
+    if (static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()) < numberOfFrames
+        || static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()) > 2 * numberOfFrames)
+    {
+      LOG_ERROR(*it << " contains " << trackedFrameList->GetNumberOfTrackedFrames() << " frames, at least " << numberOfFrames << " frames are expected");
+      numberOfErrors++;
+      continue;
+    }
+    for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      const unsigned char* pixels = static_cast<const unsigned char*>(trackedFrameList->GetTrackedFrame(frameIndex)->GetImageData()->GetScalarPointer());
+      if (pixels == NULL || pixels[0] != static_cast<unsigned char>((frameIndex + 1) % 256))
+      {
+        LOG_ERROR(*it << ": frame " << frameIndex << " does not contain the expected pixel data");
+        numberOfErrors++;
+        break;
+      }
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,316 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusDataCollectorGetDataTest.cxx
+  \brief Test getting the tracking data of a channel since a specified time.
+
+  A tracker with several tools is simulated, then vtkPlusDataCollector::GetTrackingData is called with
+  different start times (before the oldest item, exactly at an item, between two items, at the latest item).
+  The test fails if the returned frames are not exactly the items that were acquired after the start time,
+  or if their transforms differ from the ones returned by vtkPlusChannel::GetTrackedFrame.
+  It also checks that the frames of the list are reused, their previous fields are removed and the list is resized if frame reuse is requested.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// IGSIO includes
+#include <igsioTrackedFrame.h>
+#include <vtkIGSIOTrackedFrameList.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  /*! Get the tracking data since timestampFrom and compare it to the expected frame numbers */
+  void CheckTrackingData(vtkPlusDataCollector* dataCollector, vtkPlusChannel* channel, const std::vector<vtkPlusDataSource*>& tools,
+                         double timestampFrom, int expectedFirstFrameNumber, int expectedLastFrameNumber, int& numberOfErrors)
+  {
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    double timestamp = timestampFrom;
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (dataCollector->GetTrackingData(channel, timestamp, trackedFrameList) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracking data since " << std::fixed << timestampFrom);
+      numberOfErrors++;
+      return;
+    }
+    double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    const int expectedNumberOfFrames = std::max(0, expectedLastFrameNumber - expectedFirstFrameNumber + 1);
+    LOG_INFO("Tracking data since " << std::fixed << timestampFrom << ": " << trackedFrameList->GetNumberOfTrackedFrames()
+             << " frames in " << elapsedTimeSec * 1000 << " ms");
+    if (static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()) != expectedNumberOfFrames)
+    {
+      LOG_ERROR("Tracking data since " << std::fixed << timestampFrom << " contains " << trackedFrameList->GetNumberOfTrackedFrames()
+                << " frames instead of " << expectedNumberOfFrames);
+      numberOfErrors++;
+      return;
+    }
+    if (expectedNumberOfFrames == 0)
+    {
+      if (timestamp != timestampFrom)
+      {
+        LOG_ERROR("Timestamp was changed although no frames were returned");
+        numberOfErrors++;
+      }
+      return;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> referenceMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(frameIndex);
+      const int expectedFrameNumber = expectedFirstFrameNumber + frameIndex;
+      if (trackedFrame->GetTimestamp() <= timestampFrom)
+      {
+        LOG_ERROR("Frame " << frameIndex << " was acquired before the requested time: " << std::fixed << trackedFrame->GetTimestamp());
+        numberOfErrors++;
+      }
+
+      igsioTrackedFrame referenceFrame;
+      if (channel->GetTrackedFrame(trackedFrame->GetTimestamp(), referenceFrame, false) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get reference tracked frame at " << std::fixed << trackedFrame->GetTimestamp());
+        numberOfErrors++;
+        continue;
+      }
+
+      for (std::vector<vtkPlusDataSource*>::const_iterator toolIt = tools.begin(); toolIt != tools.end(); ++toolIt)
+      {
+        igsioTransformName transformName((*toolIt)->GetId());
+        if (trackedFrame->GetFrameTransform(transformName, matrix) != PLUS_SUCCESS
+            || referenceFrame.GetFrameTransform(transformName, referenceMatrix) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Transform " << (*toolIt)->GetId() << " is missing from frame " << frameIndex);
+          numberOfErrors++;
+          continue;
+        }
+        if (matrix->GetElement(0, 3) != expectedFrameNumber)
+        {
+          LOG_ERROR("Frame " << frameIndex << " of " << (*toolIt)->GetId() << " is sample " << matrix->GetElement(0, 3) << " instead of " << expectedFrameNumber);
+          numberOfErrors++;
+        }
+        for (int row = 0; row < 4; ++row)
+        {
+          for (int column = 0; column < 4; ++column)
+          {
+            if (matrix->GetElement(row, column) != referenceMatrix->GetElement(row, column))
+            {
+              LOG_ERROR("Frame " << frameIndex << " of " << (*toolIt)->GetId() << " differs from the tracked frame of the channel");
+              numberOfErrors++;
+              row = 4;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    if (timestamp != trackedFrameList->GetTrackedFrame(trackedFrameList->GetNumberOfTrackedFrames() - 1)->GetTimestamp())
+    {
+      LOG_ERROR("Timestamp is not set to the timestamp of the last returned frame");
+      numberOfErrors++;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Get the tracking data into a list that already contains frames and check that the frames are reused */
+  void CheckTrackingDataReuse(vtkPlusDataCollector* dataCollector, vtkPlusChannel* channel, const std::vector<vtkPlusDataSource*>& tools,
+                              double timestampFrom, int expectedFirstFrameNumber, int expectedLastFrameNumber, int& numberOfErrors)
+  {
+    // Fill the list with all the frames of the buffer first
+    vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
+    double timestamp = UNDEFINED_TIMESTAMP;
+    if (dataCollector->GetTrackingData(channel, timestamp, trackedFrameList) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracking data");
+      numberOfErrors++;
+      return;
+    }
+    std::vector<igsioTrackedFrame*> originalFrames;
+    for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      originalFrames.push_back(trackedFrameList->GetTrackedFrame(frameIndex));
+      // This field must not be kept when the frame is reused
+      trackedFrameList->GetTrackedFrame(frameIndex)->SetFrameField("StaleField", "1");
+    }
+
+    timestamp = timestampFrom;
+    if (dataCollector->GetTrackingData(channel, timestamp, trackedFrameList, true) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to get tracking data into reused frames since " << std::fixed << timestampFrom);
+      numberOfErrors++;
+      return;
+    }
+
+    const int expectedNumberOfFrames = std::max(0, expectedLastFrameNumber - expectedFirstFrameNumber + 1);
+    if (static_cast<int>(trackedFrameList->GetNumberOfTrackedFrames()) != expectedNumberOfFrames)
+    {
+      LOG_ERROR("Reused tracking data since " << std::fixed << timestampFrom << " contains " << trackedFrameList->GetNumberOfTrackedFrames()
+                << " frames instead of " << expectedNumberOfFrames);
+      numberOfErrors++;
+      return;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (unsigned int frameIndex = 0; frameIndex < trackedFrameList->GetNumberOfTrackedFrames(); ++frameIndex)
+    {
+      igsioTrackedFrame* trackedFrame = trackedFrameList->GetTrackedFrame(frameIndex);
+      if (frameIndex < originalFrames.size() && trackedFrame != originalFrames[frameIndex])
+      {
+        LOG_ERROR("Frame " << frameIndex << " was reallocated instead of reused");
+        numberOfErrors++;
+      }
+      igsioTransformName transformName(tools[0]->GetId());
+      if (trackedFrame->GetFrameTransform(transformName, matrix) != PLUS_SUCCESS
+          || matrix->GetElement(0, 3) != expectedFirstFrameNumber + static_cast<int>(frameIndex))
+      {
+        LOG_ERROR("Reused frame " << frameIndex << " does not contain sample " << expectedFirstFrameNumber + frameIndex);
+        numberOfErrors++;
+      }
+      if (trackedFrame->IsFrameFieldDefined("StaleField"))
+      {
+        LOG_ERROR("Reused frame " << frameIndex << " kept a field of the previous frame");
+        numberOfErrors++;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfTools(5);
+  int numberOfSamples(3000);
+  int bufferSize(1000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tracked tools (Default: 5).");
+  args.AddArgument("--number-of-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSamples, "Number of tracker samples (Default: 3000).");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of items in the buffer of each tool (Default: 1000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfTools < 1 || bufferSize < 10 || numberOfSamples < bufferSize)
+  {
+    LOG_ERROR("At least one tool and 10 buffer items are needed, and the number of samples must not be less than the buffer size");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  vtkSmartPointer<vtkPlusTestTracker> tracker = vtkSmartPointer<vtkPlusTestTracker>::New();
+  tracker->SetDeviceId("Tracker");
+  vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+  channel->SetChannelId("TrackerStream");
+  channel->SetOwnerDevice(tracker);
+
+  std::vector<vtkSmartPointer<vtkPlusDataSource> > toolSources;
+  std::vector<vtkPlusDataSource*> tools;
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > matrices;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId("Probe" + igsioCommon::ToString<int>(toolIndex) + "ToTracker");
+    tool->SetType(DATA_SOURCE_TYPE_TOOL);
+    tool->SetBufferSize(bufferSize);
+    if (tracker->AddTool(tool) != PLUS_SUCCESS || channel->AddTool(tool) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tool " << tool->GetId());
+      exit(EXIT_FAILURE);
+    }
+    toolSources.push_back(tool);
+    tools.push_back(tool);
+    matrices.push_back(vtkSmartPointer<vtkMatrix4x4>::New());
+  }
+
+  std::vector<vtkPlusDevice::ToolTimeStampedUpdateItem> toolUpdates;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    toolUpdates.push_back(vtkPlusDevice::ToolTimeStampedUpdateItem(tools[toolIndex], matrices[toolIndex], TOOL_OK));
+  }
+
+  // Samples are acquired at 100 Hz, sample N at N * 0.01 sec
+  const double samplingPeriodSec = 0.01;
+  for (int frameNumber = 1; frameNumber <= numberOfSamples; ++frameNumber)
+  {
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      matrices[toolIndex]->SetElement(0, 3, frameNumber);
+      matrices[toolIndex]->SetElement(1, 3, toolIndex);
+    }
+    const double timestamp = frameNumber * samplingPeriodSec;
+    if (tracker->ToolTimeStampedUpdate(toolUpdates, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add sample " << frameNumber);
+      numberOfErrors++;
+    }
+  }
+
+  const int oldestFrameNumber = numberOfSamples - bufferSize + 1;
+  const int middleFrameNumber = numberOfSamples - bufferSize / 2;
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+
+  // Before the oldest item: all items are returned
+  CheckTrackingData(dataCollector, channel, tools, UNDEFINED_TIMESTAMP, oldestFrameNumber, numberOfSamples, numberOfErrors);
+  CheckTrackingData(dataCollector, channel, tools, (oldestFrameNumber - 10) * samplingPeriodSec, oldestFrameNumber, numberOfSamples, numberOfErrors);
+  // Exactly at an item: the items after it are returned
+  CheckTrackingData(dataCollector, channel, tools, middleFrameNumber * samplingPeriodSec, middleFrameNumber + 1, numberOfSamples, numberOfErrors);
+  // Between two items, closer to the older or to the newer one
+  CheckTrackingData(dataCollector, channel, tools, (middleFrameNumber + 0.2) * samplingPeriodSec, middleFrameNumber + 1, numberOfSamples, numberOfErrors);
+  CheckTrackingData(dataCollector, channel, tools, (middleFrameNumber + 0.8) * samplingPeriodSec, middleFrameNumber + 1, numberOfSamples, numberOfErrors);
+  // At or after the latest item: nothing is returned
+  CheckTrackingData(dataCollector, channel, tools, numberOfSamples * samplingPeriodSec, numberOfSamples + 1, numberOfSamples, numberOfErrors);
+  CheckTrackingData(dataCollector, channel, tools, (numberOfSamples + 10) * samplingPeriodSec, numberOfSamples + 1, numberOfSamples, numberOfErrors);
+
+  // Reused frames: the list shrinks to the new frames, or it is emptied if there are none
+  CheckTrackingDataReuse(dataCollector, channel, tools, middleFrameNumber * samplingPeriodSec, middleFrameNumber + 1, numberOfSamples, numberOfErrors);
+  CheckTrackingDataReuse(dataCollector, channel, tools, numberOfSamples * samplingPeriodSec, numberOfSamples + 1, numberOfSamples, numberOfErrors);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
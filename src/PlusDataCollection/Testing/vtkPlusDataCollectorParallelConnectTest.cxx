@@ -0,0 +1,201 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusDataCollectorParallelConnectTest.cxx
+  \brief Test connecting and disconnecting the devices of the data collector concurrently.
+
+  Several slow physical devices and a virtual device that uses two of them as input are simulated.
+  The test fails if connecting the devices in parallel takes as long as connecting them one by one,
+  if the virtual device is connected before its input devices, or if it is disconnected after them.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+//----------------------------------------------------------------------------
+/*! Device that takes a specified time to connect and records when it was connected and disconnected */
+class vtkPlusDataCollectorParallelConnectTestDevice : public vtkPlusDevice
+{
+public:
+  static vtkPlusDataCollectorParallelConnectTestDevice* New();
+  vtkTypeMacro(vtkPlusDataCollectorParallelConnectTestDevice, vtkPlusDevice);
+
+  virtual bool IsVirtual() const { return this->Virtual; }
+
+  bool Virtual;
+  double ConnectDelaySec;
+  double ConnectStartTime;
+  double ConnectEndTime;
+  double DisconnectTime;
+
+protected:
+  vtkPlusDataCollectorParallelConnectTestDevice()
+    : Virtual(false)
+    , ConnectDelaySec(0.0)
+    , ConnectStartTime(0.0)
+    , ConnectEndTime(0.0)
+    , DisconnectTime(0.0)
+  {
+  }
+  ~vtkPlusDataCollectorParallelConnectTestDevice() {}
+
+  virtual PlusStatus InternalConnect()
+  {
+    this->ConnectStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    vtkIGSIOAccurateTimer::Delay(this->ConnectDelaySec);
+    this->ConnectEndTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    return PLUS_SUCCESS;
+  }
+
+  virtual PlusStatus InternalDisconnect()
+  {
+    this->DisconnectTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    // make sure that the devices that are disconnected later get a later timestamp
+    vtkIGSIOAccurateTimer::Delay(0.01);
+    return PLUS_SUCCESS;
+  }
+};
+
+vtkStandardNewMacro(vtkPlusDataCollectorParallelConnectTestDevice);
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfPhysicalDevices(4);
+  double connectDelaySec(0.5);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-physical-devices", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfPhysicalDevices, "Number of simulated physical devices (Default: 4).");
+  args.AddArgument("--connect-delay-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &connectDelaySec, "Time that each physical device takes to connect (Default: 0.5).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfPhysicalDevices < 2 || connectDelaySec <= 0)
+  {
+    LOG_ERROR("At least two physical devices and a positive connect delay are needed");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  // The data collector deletes the devices
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  std::vector<vtkPlusDataCollectorParallelConnectTestDevice*> physicalDevices;
+  std::vector<vtkSmartPointer<vtkPlusChannel> > channels;
+  for (int deviceIndex = 0; deviceIndex < numberOfPhysicalDevices; ++deviceIndex)
+  {
+    vtkPlusDataCollectorParallelConnectTestDevice* device = vtkPlusDataCollectorParallelConnectTestDevice::New();
+    device->SetDeviceId("Device" + igsioCommon::ToString<int>(deviceIndex));
+    device->ConnectDelaySec = connectDelaySec;
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("Device" + igsioCommon::ToString<int>(deviceIndex) + "Stream");
+    channel->SetOwnerDevice(device);
+    device->AddOutputChannel(channel);
+    channels.push_back(channel);
+    physicalDevices.push_back(device);
+  }
+
+  // The virtual device is added first, so that the device order alone does not connect it after its inputs
+  vtkPlusDataCollectorParallelConnectTestDevice* virtualDevice = vtkPlusDataCollectorParallelConnectTestDevice::New();
+  virtualDevice->SetDeviceId("Mixer");
+  virtualDevice->Virtual = true;
+  virtualDevice->AddInputChannel(channels[0]);
+  virtualDevice->AddInputChannel(channels[1]);
+  dataCollector->AddDevice(virtualDevice);
+  for (std::vector<vtkPlusDataCollectorParallelConnectTestDevice*>::iterator it = physicalDevices.begin(); it != physicalDevices.end(); ++it)
+  {
+    dataCollector->AddDevice(*it);
+  }
+
+  for (int parallel = 1; parallel >= 0; --parallel)
+  {
+    dataCollector->SetParallelDeviceStartup(parallel != 0);
+
+    double connectStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    if (dataCollector->Connect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to connect the devices");
+      numberOfErrors++;
+    }
+    double connectTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - connectStartTime;
+    LOG_INFO((parallel ? "Parallel" : "Sequential") << " connect took " << connectTimeSec << " sec");
+
+    double sequentialConnectTimeSec = numberOfPhysicalDevices * connectDelaySec;
+    if (parallel && connectTimeSec > 0.5 * sequentialConnectTimeSec + connectDelaySec)
+    {
+      LOG_ERROR("Parallel connect took " << connectTimeSec << " sec, which is too close to the sequential connect time of " << sequentialConnectTimeSec << " sec");
+      numberOfErrors++;
+    }
+    if (!parallel && connectTimeSec < sequentialConnectTimeSec)
+    {
+      LOG_ERROR("Sequential connect took " << connectTimeSec << " sec, which is less than the sum of the connect times of the devices (" << sequentialConnectTimeSec << " sec)");
+      numberOfErrors++;
+    }
+
+    for (int inputIndex = 0; inputIndex < 2; ++inputIndex)
+    {
+      if (virtualDevice->ConnectStartTime < physicalDevices[inputIndex]->ConnectEndTime)
+      {
+        LOG_ERROR("Virtual device was connected before its input device " << physicalDevices[inputIndex]->GetDeviceId());
+        numberOfErrors++;
+      }
+    }
+
+    if (dataCollector->Disconnect() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to disconnect the devices");
+      numberOfErrors++;
+    }
+    for (int inputIndex = 0; inputIndex < 2; ++inputIndex)
+    {
+      if (virtualDevice->DisconnectTime >= physicalDevices[inputIndex]->DisconnectTime)
+      {
+        LOG_ERROR("Virtual device was disconnected after its input device " << physicalDevices[inputIndex]->GetDeviceId());
+        numberOfErrors++;
+      }
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusDevicePacingTest.cxx
+  \brief Test that the internal updates of a rate-driven device keep the acquisition rate.
+
+  A polling device is recorded at a high acquisition rate. The test fails if the rate of the served updates
+  (number of updates / elapsed time) deviates from the acquisition rate by more than the tolerance,
+  or if more deadlines are missed than the allowed fraction of the elapsed periods.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cmath>
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  double acquisitionRate(1000.0);
+  double recordingTimeSec(2.0);
+  double wakeupSpinTimeSec(0.0);
+  double maximumRateErrorPercent(1.0);
+  double maximumMissedDeadlinesPercent(1.0);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Acquisition rate of the device in Hz (Default: 1000).");
+  args.AddArgument("--recording-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &recordingTimeSec, "Duration of the recording (Default: 2.0).");
+  args.AddArgument("--wakeup-spin-time-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &wakeupSpinTimeSec, "Time spent polling the clock before each deadline (Default: 0).");
+  args.AddArgument("--maximum-rate-error-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maximumRateErrorPercent, "Allowed deviation of the served update rate from the acquisition rate (Default: 1.0).");
+  args.AddArgument("--maximum-missed-deadlines-percent", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &maximumMissedDeadlinesPercent, "Allowed number of missed deadlines, in percent of the elapsed periods (Default: 1.0).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (acquisitionRate <= 0 || recordingTimeSec <= 0)
+  {
+    LOG_ERROR("A positive acquisition rate and a positive recording time are needed");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  vtkSmartPointer<vtkPlusTestPollingDevice> device = vtkSmartPointer<vtkPlusTestPollingDevice>::New();
+  device->SetDeviceId("PacedDevice");
+  device->SetAcquisitionRate(acquisitionRate);
+  device->SetWakeupSpinTimeSec(wakeupSpinTimeSec);
+
+  double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  if (device->StartRecording() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start recording");
+    exit(EXIT_FAILURE);
+  }
+  vtkIGSIOAccurateTimer::Delay(recordingTimeSec);
+  double elapsedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+  unsigned long numberOfUpdates = device->NumberOfUpdates;
+  unsigned long numberOfMissedDeadlines = device->GetNumberOfMissedDeadlines();
+  if (device->StopRecording() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to stop recording");
+    numberOfErrors++;
+  }
+
+  const double expectedNumberOfDeadlines = elapsedTimeSec * acquisitionRate;
+  const double servedRate = numberOfUpdates / elapsedTimeSec;
+  LOG_INFO("Elapsed time: " << elapsedTimeSec << " sec, updates: " << numberOfUpdates << " (" << servedRate << " Hz), missed deadlines: " << numberOfMissedDeadlines
+           << ", overruns: " << device->GetNumberOfUpdateOverruns() << ", expected deadlines: " << expectedNumberOfDeadlines);
+
+  if (numberOfUpdates == 0)
+  {
+    LOG_ERROR("The device is not updated");
+    numberOfErrors++;
+  }
+
+  // A few periods are allowed for starting the update thread
+  const double allowedRateDeviation = acquisitionRate * maximumRateErrorPercent / 100.0 + 3 / elapsedTimeSec;
+  if (std::fabs(servedRate - acquisitionRate) > allowedRateDeviation)
+  {
+    LOG_ERROR("Updates are served at " << servedRate << " Hz instead of " << acquisitionRate << " Hz (allowed deviation: " << allowedRateDeviation << " Hz)");
+    numberOfErrors++;
+  }
+
+  const double allowedNumberOfMissedDeadlines = expectedNumberOfDeadlines * maximumMissedDeadlinesPercent / 100.0;
+  if (numberOfMissedDeadlines > allowedNumberOfMissedDeadlines)
+  {
+    LOG_ERROR(numberOfMissedDeadlines << " deadlines are missed in " << elapsedTimeSec << " sec, more than the allowed " << allowedNumberOfMissedDeadlines);
+    numberOfErrors++;
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusFrameFieldNameTableTest.cxx
+  \brief Test interning, lookup and transform field classification of PlusFrameFieldNameTable.
+
+  Names are interned and looked up from a single thread, then a writer thread interns new names while
+  reader threads look up the names that are already in the table. The test fails if a name gets a different key
+  than before, a lookup of a published name fails, or a transform field is classified incorrectly.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusFrameFieldNameTable.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  std::string GetFieldName(int nameIndex)
+  {
+    // Every third name is a transform or transform status field
+    return (nameIndex % 3 == 0 ? std::string("Tool") + igsioCommon::ToString<int>(nameIndex) + "ToTrackerTransform" : std::string("Field") + igsioCommon::ToString<int>(nameIndex));
+  }
+
+  //----------------------------------------------------------------------------
+  int TestSingleThread()
+  {
+    int numberOfErrors(0);
+    PlusFrameFieldNameTable table;
+
+    PlusFrameFieldNameTable::KeyType key(0);
+    if (table.GetNumberOfNames() != 0 || table.Find("Field0", key))
+    {
+      LOG_ERROR("New table is not empty");
+      numberOfErrors++;
+    }
+
+    const PlusFrameFieldNameTable::KeyType probeKey = table.Intern("ProbeToTrackerTransform");
+    const PlusFrameFieldNameTable::KeyType statusKey = table.Intern("ProbeToTrackerTransformStatus");
+    const PlusFrameFieldNameTable::KeyType frameNumberKey = table.Intern("FrameNumber");
+    if (probeKey != 0 || statusKey != 1 || frameNumberKey != 2 || table.GetNumberOfNames() != 3)
+    {
+      LOG_ERROR("Keys are not assigned in increasing order: " << probeKey << ", " << statusKey << ", " << frameNumberKey);
+      numberOfErrors++;
+    }
+    if (table.Intern("ProbeToTrackerTransform") != probeKey || table.GetNumberOfNames() != 3)
+    {
+      LOG_ERROR("Interning an existing name added a new key");
+      numberOfErrors++;
+    }
+    if (!table.Find("FrameNumber", key) || key != frameNumberKey)
+    {
+      LOG_ERROR("Failed to find FrameNumber");
+      numberOfErrors++;
+    }
+    if (table.Find("frameNumber", key))
+    {
+      LOG_ERROR("Lookup is not case sensitive");
+      numberOfErrors++;
+    }
+    if (table.GetName(statusKey) != "ProbeToTrackerTransformStatus")
+    {
+      LOG_ERROR("Name of key " << statusKey << " mismatch: " << table.GetName(statusKey));
+      numberOfErrors++;
+    }
+    if (!table.IsTransformField(probeKey) || !table.IsTransformField(statusKey) || table.IsTransformField(frameNumberKey))
+    {
+      LOG_ERROR("Transform fields are classified incorrectly");
+      numberOfErrors++;
+    }
+
+    // References returned by GetName remain valid when names are added
+    const std::string& probeName = table.GetName(probeKey);
+    for (int nameIndex = 0; nameIndex < 1000; ++nameIndex)
+    {
+      table.Intern(GetFieldName(nameIndex));
+    }
+    if (probeName != "ProbeToTrackerTransform" || table.GetNumberOfNames() != 1003)
+    {
+      LOG_ERROR("Table is corrupted after adding names");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  void LookUpNames(const PlusFrameFieldNameTable* table, std::atomic<bool>* stopRequested, std::atomic<int>* numberOfErrors)
+  {
+    int errors(0);
+    while (!stopRequested->load())
+    {
+      const unsigned int numberOfNames = table->GetNumberOfNames();
+      for (unsigned int nameIndex = 0; nameIndex < numberOfNames; ++nameIndex)
+      {
+        // Names are interned in order by the writer, so the key of a name is its index
+        const std::string expectedName = GetFieldName(nameIndex);
+        PlusFrameFieldNameTable::KeyType key(0);
+        if (!table->Find(expectedName, key) || key != nameIndex || table->GetName(key) != expectedName
+            || table->IsTransformField(key) != (nameIndex % 3 == 0))
+        {
+          errors++;
+        }
+      }
+    }
+    numberOfErrors->fetch_add(errors);
+  }
+
+  //----------------------------------------------------------------------------
+  int TestConcurrentAccess(int numberOfNames, int numberOfReaders)
+  {
+    PlusFrameFieldNameTable table;
+    std::atomic<bool> stopRequested(false);
+    std::atomic<int> numberOfReadErrors(0);
+    std::vector<std::thread> readers;
+    for (int readerIndex = 0; readerIndex < numberOfReaders; ++readerIndex)
+    {
+      readers.push_back(std::thread(LookUpNames, &table, &stopRequested, &numberOfReadErrors));
+    }
+
+    int numberOfErrors(0);
+    for (int nameIndex = 0; nameIndex < numberOfNames; ++nameIndex)
+    {
+      if (table.Intern(GetFieldName(nameIndex)) != static_cast<PlusFrameFieldNameTable::KeyType>(nameIndex))
+      {
+        LOG_ERROR("Unexpected key for " << GetFieldName(nameIndex));
+        numberOfErrors++;
+      }
+    }
+
+    stopRequested = true;
+    for (std::vector<std::thread>::iterator it = readers.begin(); it != readers.end(); ++it)
+    {
+      it->join();
+    }
+    if (numberOfReadErrors > 0)
+    {
+      LOG_ERROR(numberOfReadErrors << " lookups failed while names were added");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfNames(500);
+  int numberOfReaders(4);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-names", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfNames, "Number of names that are added while the readers look up the names (Default: 500).");
+  args.AddArgument("--number-of-readers", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfReaders, "Number of reader threads (Default: 4).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = TestSingleThread();
+  numberOfErrors += TestConcurrentAccess(numberOfNames, numberOfReaders);
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusFrameFlipClipTest.cxx
+  \brief Compare the specialized flip and clip kernels with igsioVideoFrame::GetOrientedClippedImage.
+
+  Random frames of several pixel formats and sizes (including widths that are not a multiple of the SIMD block size)
+  are flipped and clipped with both implementations and the results are compared. The test fails if any output differs.
+
+  The throughput of both implementations is measured for full HD (1920x1080) frames.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusFrameFlipClipKernel.h"
+
+// IGSIO includes
+#include <igsioVideoFrame.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  struct PixelFormat
+  {
+    const char* Name;
+    igsioCommon::VTKScalarPixelType PixelType;
+    unsigned int NumberOfScalarComponents;
+    US_IMAGE_TYPE ImageType;
+  };
+
+  const PixelFormat PIXEL_FORMATS[] =
+  {
+    { "8-bit gray", VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS },
+    { "16-bit gray", VTK_SHORT, 1, US_IMG_BRIGHTNESS },
+    { "24-bit color", VTK_UNSIGNED_CHAR, 3, US_IMG_RGB_COLOR },
+    { "32-bit color", VTK_UNSIGNED_CHAR, 4, US_IMG_RGB_COLOR }
+  };
+  const int NUMBER_OF_PIXEL_FORMATS = sizeof(PIXEL_FORMATS) / sizeof(PIXEL_FORMATS[0]);
+
+  //----------------------------------------------------------------------------
+  std::string GetFlipAsString(const igsioVideoFrame::FlipInfoType& flipInfo)
+  {
+    std::string flip;
+    flip += flipInfo.hFlip ? "H" : "";
+    flip += flipInfo.vFlip ? "V" : "";
+    flip += flipInfo.eFlip ? "E" : "";
+    return flip.empty() ? "none" : flip;
+  }
+
+  //----------------------------------------------------------------------------
+  void FillRandom(std::vector<unsigned char>& data, unsigned int seed)
+  {
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      data[i] = static_cast<unsigned char>(seed >> 16);
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned int GetFrameSizeInBytes(const FrameSizeType& frameSize, const PixelFormat& format)
+  {
+    return frameSize[0] * frameSize[1] * frameSize[2] * igsioVideoFrame::GetNumberOfBytesPerScalar(format.PixelType) * format.NumberOfScalarComponents;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareWithGeneric(const PixelFormat& format, const FrameSizeType& inputFrameSize, const igsioVideoFrame::FlipInfoType& flipInfo,
+                         const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+  {
+    PlusFrameFlipClipKernel kernel;
+    if (kernel.Configure(flipInfo, format.ImageType, format.PixelType, format.NumberOfScalarComponents, inputFrameSize, clipRectangleOrigin, clipRectangleSize) == PlusFrameFlipClipKernel::KERNEL_GENERIC)
+    {
+      LOG_ERROR("No specialized kernel for " << format.Name << ", flip " << GetFlipAsString(flipInfo));
+      return 1;
+    }
+    const FrameSizeType& outputFrameSize = kernel.GetOutputFrameSizeInPx();
+
+    std::vector<unsigned char> input(GetFrameSizeInBytes(inputFrameSize, format));
+    FillRandom(input, inputFrameSize[0] * 31 + inputFrameSize[1]);
+
+    igsioVideoFrame genericOutput;
+    igsioVideoFrame kernelOutput;
+    if (genericOutput.AllocateFrame(outputFrameSize, format.PixelType, format.NumberOfScalarComponents) != PLUS_SUCCESS
+        || kernelOutput.AllocateFrame(outputFrameSize, format.PixelType, format.NumberOfScalarComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate output frames");
+      return 1;
+    }
+
+    if (igsioVideoFrame::GetOrientedClippedImage(&input[0], flipInfo, format.ImageType, format.PixelType, format.NumberOfScalarComponents, inputFrameSize,
+        genericOutput, clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Generic flip and clip failed for " << format.Name << ", flip " << GetFlipAsString(flipInfo));
+      return 1;
+    }
+    unsigned char* kernelOutputPixels = static_cast<unsigned char*>(kernelOutput.GetImage()->GetScalarPointer());
+    if (kernel.Apply(&input[0], kernelOutputPixels) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Kernel flip and clip failed for " << format.Name << ", flip " << GetFlipAsString(flipInfo));
+      return 1;
+    }
+
+    FrameSizeType genericOutputFrameSize = { 0, 0, 0 };
+    genericOutput.GetFrameSize(genericOutputFrameSize);
+    if (genericOutputFrameSize != outputFrameSize
+        || memcmp(genericOutput.GetImage()->GetScalarPointer(), kernelOutputPixels, GetFrameSizeInBytes(outputFrameSize, format)) != 0)
+    {
+      LOG_ERROR(PlusFrameFlipClipKernel::GetKernelTypeAsString(kernel.GetType()) << " kernel output differs from the generic output for " << format.Name
+                << ", input " << inputFrameSize[0] << "x" << inputFrameSize[1] << "x" << inputFrameSize[2] << ", flip " << GetFlipAsString(flipInfo)
+                << ", clip origin " << clipRectangleOrigin[0] << "," << clipRectangleOrigin[1] << "," << clipRectangleOrigin[2]
+                << " size " << clipRectangleSize[0] << "," << clipRectangleSize[1] << "," << clipRectangleSize[2]);
+      return 1;
+    }
+    return 0;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestCorrectness()
+  {
+    int numberOfErrors(0);
+    int numberOfCases(0);
+    const unsigned int widths[] = { 1, 7, 16, 17, 33, 64, 101 };
+    const unsigned int heights[] = { 1, 5 };
+    const unsigned int depths[] = { 1, 3 };
+    for (int formatIndex = 0; formatIndex < NUMBER_OF_PIXEL_FORMATS; ++formatIndex)
+    {
+      for (unsigned int w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w)
+      {
+        for (unsigned int h = 0; h < sizeof(heights) / sizeof(heights[0]); ++h)
+        {
+          for (unsigned int d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d)
+          {
+            FrameSizeType inputFrameSize = { widths[w], heights[h], depths[d] };
+            for (int flip = 0; flip < 8; ++flip)
+            {
+              igsioVideoFrame::FlipInfoType flipInfo;
+              flipInfo.hFlip = (flip & 1) != 0;
+              flipInfo.vFlip = (flip & 2) != 0;
+              flipInfo.eFlip = (flip & 4) != 0;
+
+              std::array<int, 3> noClipOrigin = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+              std::array<int, 3> noClipSize = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+              numberOfErrors += CompareWithGeneric(PIXEL_FORMATS[formatIndex], inputFrameSize, flipInfo, noClipOrigin, noClipSize);
+              numberOfCases++;
+
+              if (inputFrameSize[0] > 2)
+              {
+                // Clip a rectangle that is not aligned to the frame
+                std::array<int, 3> clipOrigin = { 1, 0, 0 };
+                std::array<int, 3> clipSize = { static_cast<int>(inputFrameSize[0]) - 2, static_cast<int>(inputFrameSize[1]), static_cast<int>(inputFrameSize[2]) };
+                if (inputFrameSize[1] > 2)
+                {
+                  clipOrigin[1] = 1;
+                  clipSize[1] = static_cast<int>(inputFrameSize[1]) - 2;
+                }
+                numberOfErrors += CompareWithGeneric(PIXEL_FORMATS[formatIndex], inputFrameSize, flipInfo, clipOrigin, clipSize);
+                numberOfCases++;
+              }
+            }
+          }
+        }
+      }
+    }
+    LOG_INFO("Compared " << numberOfCases << " flip and clip cases with the generic implementation, " << numberOfErrors << " differences");
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  void MeasureThroughput(int numberOfFrames)
+  {
+    const FrameSizeType inputFrameSize = { 1920, 1080, 1 };
+    std::array<int, 3> noClipOrigin = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+    std::array<int, 3> noClipSize = { igsioCommon::NO_CLIP, igsioCommon::NO_CLIP, igsioCommon::NO_CLIP };
+
+    for (int formatIndex = 0; formatIndex < NUMBER_OF_PIXEL_FORMATS; ++formatIndex)
+    {
+      const PixelFormat& format = PIXEL_FORMATS[formatIndex];
+      std::vector<unsigned char> input(GetFrameSizeInBytes(inputFrameSize, format));
+      FillRandom(input, formatIndex);
+      igsioVideoFrame output;
+      output.AllocateFrame(inputFrameSize, format.PixelType, format.NumberOfScalarComponents);
+      unsigned char* outputPixels = static_cast<unsigned char*>(output.GetImage()->GetScalarPointer());
+
+      for (int flip = 0; flip < 4; ++flip)
+      {
+        igsioVideoFrame::FlipInfoType flipInfo;
+        flipInfo.hFlip = (flip & 1) != 0;
+        flipInfo.vFlip = (flip & 2) != 0;
+
+        PlusFrameFlipClipKernel kernel;
+        kernel.Configure(flipInfo, format.ImageType, format.PixelType, format.NumberOfScalarComponents, inputFrameSize, noClipOrigin, noClipSize);
+
+        double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+        for (int i = 0; i < numberOfFrames; ++i)
+        {
+          igsioVideoFrame::GetOrientedClippedImage(&input[0], flipInfo, format.ImageType, format.PixelType, format.NumberOfScalarComponents, inputFrameSize, output, noClipOrigin, noClipSize);
+        }
+        double genericTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+        startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+        for (int i = 0; i < numberOfFrames; ++i)
+        {
+          kernel.Apply(&input[0], outputPixels);
+        }
+        double kernelTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+        std::string instructionSet = flipInfo.hFlip ? PlusFrameFlipClipKernel::GetMirrorInstructionSet(input.size() / (inputFrameSize[0] * inputFrameSize[1])) : "memcpy";
+        LOG_INFO("1920x1080 " << format.Name << ", flip " << GetFlipAsString(flipInfo) << ": generic " << std::fixed << numberOfFrames / genericTimeSec << " fps, "
+                 << PlusFrameFlipClipKernel::GetKernelTypeAsString(kernel.GetType()) << " (" << instructionSet << ") " << numberOfFrames / kernelTimeSec << " fps, "
+                 << genericTimeSec / kernelTimeSec << "x");
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfFrames(100);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-frames", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfFrames, "Number of full HD frames copied for measuring the throughput (Default: 100).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors = TestCorrectness();
+  if (numberOfFrames > 0)
+  {
+    MeasureThroughput(numberOfFrames);
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
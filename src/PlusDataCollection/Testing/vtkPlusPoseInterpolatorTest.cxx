@@ -0,0 +1,267 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusPoseInterpolatorTest.cxx
+  \brief Compare the batched pose interpolation of PlusPoseInterpolator with the interpolation of the buffers.
+
+  Transform buffers of multiple tools are filled with poses that rotate at different speeds (including large rotations
+  between items and matrices that are not exactly orthonormal). For many requested times the interpolated items are
+  computed both by vtkPlusBuffer::GetStreamBufferItemFromTime (INTERPOLATED) for each tool and by
+  GetInterpolationSamplesFromTime followed by a single PlusPoseInterpolator::Interpolate call for all tools.
+  The test fails if the results differ.
+
+  The time spent on interpolating the poses of all tools is measured for both methods.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusPoseInterpolator.h"
+#include "vtkPlusTransformBuffer.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+  const int NUMBER_OF_ITEMS = 200;
+  const double FRAME_PERIOD_SEC = 0.01;
+  const double LOCAL_TIME_OFFSET_SEC = 0.25;
+  const double MAX_DIFFERENCE = 1e-9;
+
+  //----------------------------------------------------------------------------
+  void GetPose(int toolIndex, int frameNumber, vtkMatrix4x4* matrix)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(frameNumber * 0.5 + toolIndex, 10.0 - frameNumber * 0.2, 3.0 * toolIndex);
+    // Rotation speed is between 0.1 and 45 degrees per item, some tools rotate by large angles
+    double degreesPerItem = (toolIndex % 5 == 4 ? 45.0 : 0.1 + toolIndex * 1.3);
+    transform->RotateWXYZ(frameNumber * degreesPerItem + toolIndex * 40.0, 0.2 + toolIndex, 1.0, 0.3 - toolIndex * 0.1);
+    matrix->DeepCopy(transform->GetMatrix());
+    if (toolIndex % 3 == 2)
+    {
+      // Slightly scaled rotation, as reported by some trackers, which is not converted in closed form
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < 3; j++)
+        {
+          matrix->SetElement(i, j, matrix->GetElement(i, j) * (1.0 + 1e-6));
+        }
+      }
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  int FillBuffers(std::vector<vtkSmartPointer<vtkPlusTransformBuffer> >& buffers)
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int toolIndex = 0; toolIndex < static_cast<int>(buffers.size()); ++toolIndex)
+    {
+      vtkPlusTransformBuffer* buffer = buffers[toolIndex];
+      buffer->SetBufferSize(NUMBER_OF_ITEMS);
+      buffer->SetLocalTimeOffsetSec(LOCAL_TIME_OFFSET_SEC);
+      for (int frameNumber = 0; frameNumber < NUMBER_OF_ITEMS; ++frameNumber)
+      {
+        GetPose(toolIndex, frameNumber, matrix);
+        // Some items are missing, to test interpolation next to invalid items
+        ToolStatus status = ((frameNumber + toolIndex) % 10 == 0 ? TOOL_MISSING : TOOL_OK);
+        // Tools are sampled at slightly different times
+        double timestamp = frameNumber * FRAME_PERIOD_SEC + toolIndex * 0.0003;
+        if (buffer->AddTimeStampedItem(matrix, status, frameNumber, timestamp, timestamp + 0.0001) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to add item " << frameNumber << " of tool " << toolIndex);
+          numberOfErrors++;
+        }
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareItems(StreamBufferItem& expectedItem, StreamBufferItem& item, int toolIndex, double time)
+  {
+    int numberOfErrors(0);
+    if (expectedItem.GetStatus() != item.GetStatus())
+    {
+      LOG_ERROR("Tool " << toolIndex << " at time " << std::fixed << time << ": status mismatch");
+      numberOfErrors++;
+    }
+    if (fabs(expectedItem.GetFilteredTimestamp(0) - item.GetFilteredTimestamp(0)) > MAX_DIFFERENCE
+        || fabs(expectedItem.GetUnfilteredTimestamp(0) - item.GetUnfilteredTimestamp(0)) > MAX_DIFFERENCE)
+    {
+      LOG_ERROR("Tool " << toolIndex << " at time " << std::fixed << time << ": timestamp mismatch");
+      numberOfErrors++;
+    }
+    vtkSmartPointer<vtkMatrix4x4> expectedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    expectedItem.GetMatrix(expectedMatrix);
+    item.GetMatrix(matrix);
+    for (int i = 0; i < 4; i++)
+    {
+      for (int j = 0; j < 4; j++)
+      {
+        if (fabs(expectedMatrix->GetElement(i, j) - matrix->GetElement(i, j)) > MAX_DIFFERENCE)
+        {
+          LOG_ERROR("Tool " << toolIndex << " at time " << std::fixed << time << ": matrix element (" << i << "," << j << ") mismatch: "
+                    << std::setprecision(12) << expectedMatrix->GetElement(i, j) << " != " << matrix->GetElement(i, j));
+          numberOfErrors++;
+        }
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestCorrectness(std::vector<vtkSmartPointer<vtkPlusTransformBuffer> >& buffers)
+  {
+    int numberOfErrors(0);
+    PlusPoseInterpolator interpolator;
+    std::vector<PlusPoseInterpolationSample> samples(buffers.size());
+    std::vector<ItemStatus> sampleStatuses(buffers.size());
+    int numberOfInterpolatedPoses(0);
+
+    // Requested times are between the items, at the items and close to the items
+    const int stepsPerItem = 7;
+    for (int step = 2 * stepsPerItem; step < (NUMBER_OF_ITEMS - 2) * stepsPerItem; ++step)
+    {
+      double time = LOCAL_TIME_OFFSET_SEC + step * FRAME_PERIOD_SEC / stepsPerItem;
+
+      for (unsigned int toolIndex = 0; toolIndex < buffers.size(); ++toolIndex)
+      {
+        sampleStatuses[toolIndex] = buffers[toolIndex]->GetInterpolationSamplesFromTime(time, samples[toolIndex]);
+        if (samples[toolIndex].InterpolationRequired)
+        {
+          numberOfInterpolatedPoses++;
+        }
+      }
+      interpolator.Interpolate(samples, static_cast<unsigned int>(samples.size()));
+
+      for (unsigned int toolIndex = 0; toolIndex < buffers.size(); ++toolIndex)
+      {
+        StreamBufferItem expectedItem;
+        ItemStatus expectedStatus = buffers[toolIndex]->GetStreamBufferItemFromTime(time, &expectedItem, vtkPlusBuffer::INTERPOLATED);
+        if (expectedStatus != sampleStatuses[toolIndex])
+        {
+          LOG_ERROR("Tool " << toolIndex << " at time " << std::fixed << time << ": item status mismatch");
+          numberOfErrors++;
+          continue;
+        }
+        if (expectedStatus != ITEM_OK)
+        {
+          continue;
+        }
+        numberOfErrors += CompareItems(expectedItem, samples[toolIndex].Item, toolIndex, time);
+      }
+    }
+
+    if (numberOfInterpolatedPoses == 0)
+    {
+      LOG_ERROR("No poses were interpolated");
+      numberOfErrors++;
+    }
+    LOG_INFO("Compared " << numberOfInterpolatedPoses << " interpolated poses with the buffer interpolation, " << numberOfErrors << " differences");
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  void MeasurePerformance(std::vector<vtkSmartPointer<vtkPlusTransformBuffer> >& buffers, int numberOfRepetitions)
+  {
+    PlusPoseInterpolator interpolator;
+    std::vector<PlusPoseInterpolationSample> samples(buffers.size());
+    StreamBufferItem item;
+
+    const double firstTime = LOCAL_TIME_OFFSET_SEC + 2 * FRAME_PERIOD_SEC;
+    const double timeRange = (NUMBER_OF_ITEMS - 4) * FRAME_PERIOD_SEC;
+
+    double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+    {
+      double time = firstTime + timeRange * (repetition % 1000) / 1000.0;
+      for (unsigned int toolIndex = 0; toolIndex < buffers.size(); ++toolIndex)
+      {
+        buffers[toolIndex]->GetStreamBufferItemFromTime(time, &item, vtkPlusBuffer::INTERPOLATED);
+      }
+    }
+    double perToolTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    startTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+    {
+      double time = firstTime + timeRange * (repetition % 1000) / 1000.0;
+      for (unsigned int toolIndex = 0; toolIndex < buffers.size(); ++toolIndex)
+      {
+        buffers[toolIndex]->GetInterpolationSamplesFromTime(time, samples[toolIndex]);
+      }
+      interpolator.Interpolate(samples, static_cast<unsigned int>(samples.size()));
+    }
+    double batchedTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - startTime;
+
+    LOG_INFO("Interpolating " << buffers.size() << " tools: per tool " << std::fixed << std::setprecision(2) << perToolTimeSec * 1e6 / numberOfRepetitions << " us, "
+             << "batched " << batchedTimeSec * 1e6 / numberOfRepetitions << " us");
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfTools(20);
+  int numberOfRepetitions(10000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tools (Default: 20).");
+  args.AddArgument("--number-of-repetitions", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfRepetitions, "Number of interpolations of all tools for measuring the performance (Default: 10000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  std::vector<vtkSmartPointer<vtkPlusTransformBuffer> > buffers;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+  {
+    buffers.push_back(vtkSmartPointer<vtkPlusTransformBuffer>::New());
+  }
+
+  int numberOfErrors = FillBuffers(buffers);
+  numberOfErrors += TestCorrectness(buffers);
+  if (numberOfRepetitions > 0)
+  {
+    MeasurePerformance(buffers, numberOfRepetitions);
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,36 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusTestTracker);
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkPlusTestPollingDevice);
+
+//----------------------------------------------------------------------------
+vtkPlusTestPollingDevice::vtkPlusTestPollingDevice()
+  : NumberOfUpdates(0)
+  , UpdateDurationSec(0.0)
+{
+  this->StartThreadForInternalUpdates = true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTestPollingDevice::InternalUpdate()
+{
+  if (this->UpdateDurationSec > 0)
+  {
+    vtkIGSIOAccurateTimer::Delay(this->UpdateDurationSec);
+  }
+  this->NumberOfUpdates++;
+  return PLUS_SUCCESS;
+}
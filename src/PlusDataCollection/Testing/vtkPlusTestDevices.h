@@ -0,0 +1,64 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusTestDevices_h
+#define __vtkPlusTestDevices_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusDevice.h"
+
+// STL includes
+#include <atomic>
+
+/*!
+  \class vtkPlusTestTracker
+  \brief Tracker that exposes the tool update methods, so that the tests can push samples directly
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusTestTracker : public vtkPlusDevice
+{
+public:
+  static vtkPlusTestTracker* New();
+  vtkTypeMacro(vtkPlusTestTracker, vtkPlusDevice);
+
+  virtual bool IsTracker() const { return true; }
+
+  using vtkPlusDevice::ToolTimeStampedUpdate;
+
+protected:
+  vtkPlusTestTracker() {}
+  ~vtkPlusTestTracker() {}
+};
+
+/*!
+  \class vtkPlusTestPollingDevice
+  \brief Polling device that counts its internal updates
+
+  Each update takes UpdateDurationSec, so that the tests can simulate a device that is slower than its acquisition rate.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusTestPollingDevice : public vtkPlusDevice
+{
+public:
+  static vtkPlusTestPollingDevice* New();
+  vtkTypeMacro(vtkPlusTestPollingDevice, vtkPlusDevice);
+
+  /*! Incremented by the update thread, can be read from any thread */
+  std::atomic<unsigned long> NumberOfUpdates;
+  /*! Duration of each internal update (0 means no delay). Set it before the recording is started. */
+  double UpdateDurationSec;
+
+protected:
+  vtkPlusTestPollingDevice();
+  ~vtkPlusTestPollingDevice() {}
+
+  virtual PlusStatus InternalUpdate();
+};
+
+#endif
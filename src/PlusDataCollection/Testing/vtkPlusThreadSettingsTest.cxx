@@ -0,0 +1,267 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusThreadSettingsTest.cxx
+  \brief Test applying CPU affinity, real-time scheduling and thread name to the internal update thread of a device.
+
+  The thread settings are read from XML attributes and checked in the /proc file system (Linux only).
+  The test fails if the CPU affinity or the thread name is not applied. Real-time scheduling is only checked
+  if the process is allowed to use it, otherwise a warning is logged.
+*/
+
+// Local includes
+#include "PlusAcquisitionScheduler.h"
+#include "PlusConfigure.h"
+#include "PlusThreadSettings.h"
+#include "vtkPlusDevice.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLDataElement.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// OS includes
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+  const int REAL_TIME_PRIORITY = 10;
+
+  //----------------------------------------------------------------------------
+  long GetCurrentThreadId()
+  {
+    return syscall(SYS_gettid);
+  }
+
+  //----------------------------------------------------------------------------
+  std::string ReadThreadFile(long threadId, const std::string& fileName)
+  {
+    std::ifstream file("/proc/self/task/" + igsioCommon::ToString<long>(threadId) + "/" + fileName);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+
+  //----------------------------------------------------------------------------
+  /*! Check the settings of a thread in /proc. Returns the number of differences. */
+  int CheckThread(long threadId, const std::string& expectedName, int expectedCpu, bool checkRealTime)
+  {
+    int numberOfErrors(0);
+
+    std::string name = ReadThreadFile(threadId, "comm");
+    name = name.substr(0, name.find('\n'));
+    if (name != expectedName)
+    {
+      LOG_ERROR("Thread " << threadId << " is named " << name << " instead of " << expectedName);
+      numberOfErrors++;
+    }
+
+    std::istringstream status(ReadThreadFile(threadId, "status"));
+    std::string line;
+    std::string cpusAllowed;
+    while (std::getline(status, line))
+    {
+      if (line.find("Cpus_allowed_list:") == 0)
+      {
+        std::istringstream(line.substr(line.find(':') + 1)) >> cpusAllowed;
+      }
+    }
+    if (cpusAllowed != igsioCommon::ToString<int>(expectedCpu))
+    {
+      LOG_ERROR("Thread " << threadId << " may run on CPUs " << cpusAllowed << " instead of CPU " << expectedCpu);
+      numberOfErrors++;
+    }
+
+    if (checkRealTime)
+    {
+      // The fields of stat follow the name of the thread, which is in parentheses. rt_priority and policy are the 40th and 41st fields.
+      std::string stat = ReadThreadFile(threadId, "stat");
+      std::istringstream fields(stat.substr(stat.rfind(')') + 1));
+      std::vector<std::string> values;
+      std::string value;
+      while (fields >> value)
+      {
+        values.push_back(value);
+      }
+      const size_t firstFieldNumber = 3;
+      if (values.size() < 41 - firstFieldNumber + 1
+          || values[40 - firstFieldNumber] != igsioCommon::ToString<int>(REAL_TIME_PRIORITY)
+          || values[41 - firstFieldNumber] != igsioCommon::ToString<int>(SCHED_FIFO))
+      {
+        LOG_ERROR("Thread " << threadId << " does not use FIFO scheduling with priority " << REAL_TIME_PRIORITY << ": " << stat);
+        numberOfErrors++;
+      }
+    }
+
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+/*! Polling device that records the id of the thread that runs its internal updates */
+class vtkPlusThreadSettingsTestDevice : public vtkPlusDevice
+{
+public:
+  static vtkPlusThreadSettingsTestDevice* New();
+  vtkTypeMacro(vtkPlusThreadSettingsTestDevice, vtkPlusDevice);
+
+  std::atomic<long> UpdateThreadId;
+
+protected:
+  vtkPlusThreadSettingsTestDevice()
+    : UpdateThreadId(0)
+  {
+    this->StartThreadForInternalUpdates = true;
+  }
+  ~vtkPlusThreadSettingsTestDevice() {}
+
+  virtual PlusStatus InternalUpdate()
+  {
+    this->UpdateThreadId = GetCurrentThreadId();
+    return PLUS_SUCCESS;
+  }
+};
+
+vtkStandardNewMacro(vtkPlusThreadSettingsTestDevice);
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+
+  // Pin the thread to the last CPU that the process may use, so that the test works with any CPU set
+  cpu_set_t processCpuSet;
+  CPU_ZERO(&processCpuSet);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &processCpuSet) != 0)
+  {
+    LOG_ERROR("Failed to get the CPU affinity of the process");
+    exit(EXIT_FAILURE);
+  }
+  int cpu(0);
+  for (int cpuIndex = 0; cpuIndex < CPU_SETSIZE; ++cpuIndex)
+  {
+    if (CPU_ISSET(cpuIndex, &processCpuSet))
+    {
+      cpu = cpuIndex;
+    }
+  }
+
+  std::vector<int> cpuIndices;
+  if (PlusThreadSettings::ParseCpuList("0-2, 5", cpuIndices) != PLUS_SUCCESS || cpuIndices.size() != 4 || cpuIndices[3] != 5
+      || PlusThreadSettings::ParseCpuList("3-1", cpuIndices) == PLUS_SUCCESS || PlusThreadSettings::ParseCpuList("first", cpuIndices) == PLUS_SUCCESS)
+  {
+    LOG_ERROR("CPU lists are not parsed correctly");
+    numberOfErrors++;
+  }
+
+  vtkSmartPointer<vtkXMLDataElement> deviceElement = vtkSmartPointer<vtkXMLDataElement>::New();
+  deviceElement->SetName("Device");
+  deviceElement->SetIntAttribute("CpuAffinity", cpu);
+  deviceElement->SetAttribute("ThreadSchedulingPolicy", "FIFO");
+  deviceElement->SetIntAttribute("ThreadPriority", REAL_TIME_PRIORITY);
+  deviceElement->SetAttribute("ThreadName", "PlusTestDeviceUpdate");
+  PlusThreadSettings settings;
+  if (settings.ReadConfiguration(deviceElement) != PLUS_SUCCESS || settings.IsDefault())
+  {
+    LOG_ERROR("Failed to read the thread settings");
+    exit(EXIT_FAILURE);
+  }
+  // Thread names are truncated to 15 characters
+  const std::string expectedName = "PlusTestDeviceU";
+
+  // Find out whether the process is allowed to use real-time scheduling
+  PlusStatus applyStatus(PLUS_FAIL);
+  long threadId(0);
+  std::thread probeThread([&]()
+  {
+    applyStatus = settings.ApplyToCurrentThread();
+    threadId = GetCurrentThreadId();
+    numberOfErrors += CheckThread(threadId, expectedName, cpu, false);
+  });
+  probeThread.join();
+  bool realTimeAllowed = (applyStatus == PLUS_SUCCESS);
+  if (!realTimeAllowed)
+  {
+    LOG_WARNING("The process is not allowed to use real-time scheduling, only CPU affinity and thread name are checked");
+  }
+
+  // The settings require a dedicated thread, even if the device is configured to use the acquisition scheduler
+  vtkSmartPointer<vtkPlusThreadSettingsTestDevice> device = vtkSmartPointer<vtkPlusThreadSettingsTestDevice>::New();
+  device->SetDeviceId("ThreadSettingsDevice");
+  device->SetAcquisitionRate(100);
+  std::shared_ptr<PlusAcquisitionScheduler> scheduler = std::make_shared<PlusAcquisitionScheduler>();
+  device->SetAcquisitionScheduler(scheduler);
+  device->SetUpdateThreadSettings(settings);
+  if (device->StartRecording() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start recording");
+    exit(EXIT_FAILURE);
+  }
+  if (scheduler->GetNumberOfTasks() != 0)
+  {
+    LOG_ERROR("Device with thread settings is updated by the acquisition scheduler");
+    numberOfErrors++;
+  }
+  for (int i = 0; i < 100 && device->UpdateThreadId == 0; ++i)
+  {
+    vtkIGSIOAccurateTimer::Delay(0.01);
+  }
+  if (device->UpdateThreadId == 0 || device->UpdateThreadId == GetCurrentThreadId())
+  {
+    LOG_ERROR("Internal updates are not run in a separate thread");
+    numberOfErrors++;
+  }
+  else
+  {
+    // The thread is checked while it is running
+    numberOfErrors += CheckThread(device->UpdateThreadId, expectedName, cpu, realTimeAllowed);
+  }
+  device->StopRecording();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusToolBatchUpdateTest.cxx
+  \brief Compare adding tracker samples tool by tool and in one batch.
+
+  A tracker with many tools is simulated at a fixed sampling rate. Each sample is added once with one
+  ToolTimeStampedUpdate call per tool and once with a single batched ToolTimeStampedUpdate call.
+  The time spent in the update calls is reported for both methods.
+
+  A reader thread gets the most recent tracked frame of a channel that contains all the tools, the same way as
+  the data consumers do (vtkPlusChannel::GetMostRecentTimestamp and GetTrackedFrame), and checks that the
+  transforms of all the tools are valid and belong to the same sample.
+  The test fails if the reader gets a tracked frame with a mix of samples when the batched update is used,
+  or if any sample is not recorded in all the tool buffers or is not reported exactly once in the timestamp report of each tool.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  struct UpdateResult
+  {
+    UpdateResult() : UpdateTimeSec(0), MaxSampleUpdateTimeSec(0), NumberOfConsistentReads(0), NumberOfInconsistentReads(0) {}
+    double UpdateTimeSec;
+    double MaxSampleUpdateTimeSec;
+    unsigned long NumberOfConsistentReads;
+    unsigned long NumberOfInconsistentReads;
+  };
+
+  //----------------------------------------------------------------------------
+  void ReadTrackedFrames(vtkPlusChannel* channel, const std::vector<vtkPlusDataSource*>* tools, std::atomic<bool>* stopRequested, std::atomic<unsigned long>* numberOfConsistentReads, std::atomic<unsigned long>* numberOfInconsistentReads)
+  {
+    // The channel reports an error if a tool has no data yet, so wait until the first sample is added to all the tools
+    while (!stopRequested->load() && tools->back()->GetNumberOfItems() == 0)
+    {
+      std::this_thread::yield();
+    }
+
+    unsigned long consistentReads(0);
+    unsigned long inconsistentReads(0);
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    while (!stopRequested->load())
+    {
+      double timestamp(0);
+      igsioTrackedFrame trackedFrame;
+      if (channel->GetMostRecentTimestamp(timestamp) != PLUS_SUCCESS || channel->GetTrackedFrame(timestamp, trackedFrame, false) != PLUS_SUCCESS)
+      {
+        inconsistentReads++;
+        continue;
+      }
+      bool consistent(true);
+      double firstSample(0);
+      for (size_t toolIndex = 0; toolIndex < tools->size(); ++toolIndex)
+      {
+        igsioTransformName transformName((*tools)[toolIndex]->GetId());
+        ToolStatus status(TOOL_INVALID);
+        if (trackedFrame.GetFrameTransform(transformName, matrix) != PLUS_SUCCESS
+            || trackedFrame.GetFrameTransformStatus(transformName, status) != PLUS_SUCCESS || status != TOOL_OK
+            || matrix->GetElement(1, 3) != toolIndex)
+        {
+          consistent = false;
+          break;
+        }
+        if (toolIndex == 0)
+        {
+          firstSample = matrix->GetElement(0, 3);
+        }
+        else if (fabs(matrix->GetElement(0, 3) - firstSample) > 1e-3)
+        {
+          consistent = false;
+          break;
+        }
+      }
+      if (consistent)
+      {
+        consistentReads++;
+      }
+      else
+      {
+        inconsistentReads++;
+      }
+    }
+    numberOfConsistentReads->fetch_add(consistentReads);
+    numberOfInconsistentReads->fetch_add(inconsistentReads);
+  }
+
+  //----------------------------------------------------------------------------
+  UpdateResult RunUpdates(bool batched, int numberOfTools, int numberOfSamples, double samplingRateHz, int bufferSize, int& numberOfErrors)
+  {
+    vtkSmartPointer<vtkPlusTestTracker> tracker = vtkSmartPointer<vtkPlusTestTracker>::New();
+    tracker->SetDeviceId("Tracker");
+    vtkSmartPointer<vtkPlusChannel> channel = vtkSmartPointer<vtkPlusChannel>::New();
+    channel->SetChannelId("TrackerStream");
+    channel->SetOwnerDevice(tracker);
+    std::vector<vtkSmartPointer<vtkPlusDataSource> > toolSources;
+    std::vector<vtkPlusDataSource*> tools;
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+      tool->SetId("Tool" + igsioCommon::ToString<int>(toolIndex) + "ToTracker");
+      tool->SetType(DATA_SOURCE_TYPE_TOOL);
+      tool->SetBufferSize(bufferSize);
+      tool->SetTimeStampReporting(true);
+      if (tracker->AddTool(tool) != PLUS_SUCCESS || channel->AddTool(tool) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add tool " << tool->GetId());
+        numberOfErrors++;
+      }
+      toolSources.push_back(tool);
+      tools.push_back(tool);
+    }
+
+    std::vector<vtkSmartPointer<vtkMatrix4x4> > matrices;
+    std::vector<vtkPlusDevice::ToolTimeStampedUpdateItem> toolUpdates;
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      matrices.push_back(vtkSmartPointer<vtkMatrix4x4>::New());
+      toolUpdates.push_back(vtkPlusDevice::ToolTimeStampedUpdateItem(tools[toolIndex], matrices[toolIndex], TOOL_OK));
+    }
+
+    std::atomic<bool> stopRequested(false);
+    std::atomic<unsigned long> numberOfConsistentReads(0);
+    std::atomic<unsigned long> numberOfInconsistentReads(0);
+    std::thread reader(ReadTrackedFrames, channel.GetPointer(), &tools, &stopRequested, &numberOfConsistentReads, &numberOfInconsistentReads);
+
+    UpdateResult result;
+    const double samplingPeriodSec = 1.0 / samplingRateHz;
+    for (int frameNumber = 1; frameNumber <= numberOfSamples; ++frameNumber)
+    {
+      const double unfilteredTimestamp = frameNumber * samplingPeriodSec;
+      for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+      {
+        matrices[toolIndex]->SetElement(0, 3, frameNumber);
+        matrices[toolIndex]->SetElement(1, 3, toolIndex);
+      }
+
+      double updateStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+      if (batched)
+      {
+        tracker->ToolTimeStampedUpdate(toolUpdates, frameNumber, unfilteredTimestamp);
+      }
+      else
+      {
+        for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+        {
+          tracker->ToolTimeStampedUpdate(tools[toolIndex]->GetId(), matrices[toolIndex], TOOL_OK, frameNumber, unfilteredTimestamp);
+        }
+      }
+      double sampleUpdateTimeSec = vtkIGSIOAccurateTimer::GetSystemTime() - updateStartTime;
+      result.UpdateTimeSec += sampleUpdateTimeSec;
+      result.MaxSampleUpdateTimeSec = std::max(result.MaxSampleUpdateTimeSec, sampleUpdateTimeSec);
+    }
+
+    stopRequested = true;
+    reader.join();
+    result.NumberOfConsistentReads = numberOfConsistentReads;
+    result.NumberOfInconsistentReads = numberOfInconsistentReads;
+
+    // Check that every tool recorded the latest sample with its own transform
+    const int expectedNumberOfItems = std::min(numberOfSamples, bufferSize);
+    for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+      if (tools[toolIndex]->GetNumberOfItems() != expectedNumberOfItems)
+      {
+        LOG_ERROR(tools[toolIndex]->GetId() << " has " << tools[toolIndex]->GetNumberOfItems() << " items instead of " << expectedNumberOfItems);
+        numberOfErrors++;
+        continue;
+      }
+      StreamBufferItem item;
+      vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+      if (tools[toolIndex]->GetLatestStreamBufferItem(&item) != ITEM_OK || item.GetMatrix(matrix) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to get the latest item of " << tools[toolIndex]->GetId());
+        numberOfErrors++;
+        continue;
+      }
+      if (item.GetIndex() != static_cast<unsigned long>(numberOfSamples) || matrix->GetElement(0, 3) != numberOfSamples || matrix->GetElement(1, 3) != toolIndex)
+      {
+        LOG_ERROR("Latest item of " << tools[toolIndex]->GetId() << " does not match the latest sample");
+        numberOfErrors++;
+      }
+      vtkSmartPointer<vtkTable> timeStampReportTable = vtkSmartPointer<vtkTable>::New();
+      if (tools[toolIndex]->GetTimeStampReportTable(timeStampReportTable) != PLUS_SUCCESS
+          || timeStampReportTable->GetNumberOfRows() != numberOfSamples)
+      {
+        LOG_ERROR("Timestamp report of " << tools[toolIndex]->GetId() << " has " << timeStampReportTable->GetNumberOfRows() << " rows instead of " << numberOfSamples);
+        numberOfErrors++;
+      }
+    }
+
+    return result;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int numberOfTools(50);
+  int numberOfSamples(5000);
+  double samplingRateHz(1000.0);
+  int bufferSize(1000);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--number-of-tools", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfTools, "Number of tracked tools (Default: 50).");
+  args.AddArgument("--number-of-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSamples, "Number of tracker samples (Default: 5000).");
+  args.AddArgument("--sampling-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &samplingRateHz, "Tracker sampling rate in Hz (Default: 1000).");
+  args.AddArgument("--buffer-size", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &bufferSize, "Number of items in the buffer of each tool (Default: 1000).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  if (numberOfTools < 1 || numberOfSamples < 1 || samplingRateHz <= 0)
+  {
+    LOG_ERROR("Number of tools, number of samples and sampling rate must be positive");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+  const double samplingPeriodSec = 1.0 / samplingRateHz;
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    bool batched = (mode == 1);
+    UpdateResult result = RunUpdates(batched, numberOfTools, numberOfSamples, samplingRateHz, bufferSize, numberOfErrors);
+
+    double averageSampleUpdateTimeSec = result.UpdateTimeSec / numberOfSamples;
+    LOG_INFO((batched ? "Batched" : "Per-tool") << " update of " << numberOfTools << " tools at " << samplingRateHz << " Hz: "
+             << std::fixed << averageSampleUpdateTimeSec * 1e6 << " us per sample (" << averageSampleUpdateTimeSec / samplingPeriodSec * 100 << "% of the sampling period), "
+             << "max " << result.MaxSampleUpdateTimeSec * 1e6 << " us; reader got " << result.NumberOfInconsistentReads << " inconsistent tracked frames in "
+             << result.NumberOfConsistentReads + result.NumberOfInconsistentReads << " reads");
+
+    if (batched && result.NumberOfInconsistentReads > 0)
+    {
+      LOG_ERROR("Reader got " << result.NumberOfInconsistentReads << " inconsistent tracked frames with batched updates");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,466 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusTransformBufferTest.cxx
+  \brief Test that the compact transform buffer returns the same items and interpolated transforms as the generic buffer.
+  Pinned items are checked to be kept while the buffer is pinned, up to the limit of the pinned buffer size.
+  Lock-free timestamp, index and UID queries are checked to return the same results as the locked ones.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusTransformBuffer.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+namespace
+{
+  const int BUFFER_SIZE = 50;
+  const int NUMBER_OF_ITEMS = 120;
+  const double FRAME_PERIOD_SEC = 0.02;
+  const double MAX_MATRIX_ELEMENT_DIFFERENCE = 1e-6;
+
+  //----------------------------------------------------------------------------
+  void GetPose(int frameNumber, vtkMatrix4x4* matrix)
+  {
+    vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(frameNumber * 0.5, 10.0 - frameNumber * 0.2, 3.0);
+    transform->RotateWXYZ(frameNumber * 1.5, 0.2, 1.0, 0.3);
+    matrix->DeepCopy(transform->GetMatrix());
+  }
+
+  //----------------------------------------------------------------------------
+  int AddItems(vtkPlusBuffer* buffer, int firstFrameNumber, int lastFrameNumber)
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    for (int frameNumber = firstFrameNumber; frameNumber <= lastFrameNumber; ++frameNumber)
+    {
+      GetPose(frameNumber, matrix);
+      // Every 10th item is missing, to test interpolation next to invalid items
+      ToolStatus status = (frameNumber % 10 == 0 ? TOOL_MISSING : TOOL_OK);
+      double timestamp = frameNumber * FRAME_PERIOD_SEC;
+      igsioFieldMapType customFields;
+      if (frameNumber % 7 == 0)
+      {
+        customFields["FrameNumber"] = std::make_pair(FRAMEFIELD_NONE, igsioCommon::ToString<int>(frameNumber));
+      }
+      if (buffer->AddTimeStampedItem(matrix, status, frameNumber, timestamp, timestamp, &customFields) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add item " << frameNumber);
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsMatrixEqual(vtkMatrix4x4* matrixA, vtkMatrix4x4* matrixB)
+  {
+    for (int i = 0; i < 4; i++)
+    {
+      for (int j = 0; j < 4; j++)
+      {
+        if (fabs(matrixA->GetElement(i, j) - matrixB->GetElement(i, j)) > MAX_MATRIX_ELEMENT_DIFFERENCE)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareBuffers(vtkPlusBuffer* expectedBuffer, vtkPlusBuffer* actualBuffer)
+  {
+    int numberOfErrors(0);
+    if (expectedBuffer->GetNumberOfItems() != actualBuffer->GetNumberOfItems())
+    {
+      LOG_ERROR("Number of items mismatch: " << actualBuffer->GetNumberOfItems() << " (expected: " << expectedBuffer->GetNumberOfItems() << ")");
+      return 1;
+    }
+
+    double oldestTimestamp(0);
+    double latestTimestamp(0);
+    expectedBuffer->GetOldestTimeStamp(oldestTimestamp);
+    expectedBuffer->GetLatestTimeStamp(latestTimestamp);
+    vtkSmartPointer<vtkMatrix4x4> expectedMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    vtkSmartPointer<vtkMatrix4x4> actualMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    StreamBufferItem expectedItem;
+    StreamBufferItem actualItem;
+    for (double time = oldestTimestamp; time <= latestTimestamp; time += FRAME_PERIOD_SEC * 0.3)
+    {
+      const vtkPlusBuffer::DataItemTemporalInterpolationType interpolationTypes[2] = { vtkPlusBuffer::INTERPOLATED, vtkPlusBuffer::CLOSEST_TIME };
+      for (int i = 0; i < 2; i++)
+      {
+        ItemStatus expectedStatus = expectedBuffer->GetStreamBufferItemFromTime(time, &expectedItem, interpolationTypes[i]);
+        ItemStatus actualStatus = actualBuffer->GetStreamBufferItemFromTime(time, &actualItem, interpolationTypes[i]);
+        if (expectedStatus != actualStatus)
+        {
+          LOG_ERROR("Item status mismatch at time " << time << ": " << actualStatus << " (expected: " << expectedStatus << ")");
+          numberOfErrors++;
+          continue;
+        }
+        if (expectedStatus != ITEM_OK)
+        {
+          continue;
+        }
+        expectedItem.GetMatrix(expectedMatrix);
+        actualItem.GetMatrix(actualMatrix);
+        if (!IsMatrixEqual(expectedMatrix, actualMatrix))
+        {
+          LOG_ERROR("Transform mismatch at time " << time);
+          numberOfErrors++;
+        }
+        if (expectedItem.GetStatus() != actualItem.GetStatus()
+            || fabs(expectedItem.GetFilteredTimestamp(0) - actualItem.GetFilteredTimestamp(0)) > MAX_MATRIX_ELEMENT_DIFFERENCE
+            || expectedItem.GetIndex() != actualItem.GetIndex()
+            || expectedItem.GetFrameField("FrameNumber") != actualItem.GetFrameField("FrameNumber"))
+        {
+          LOG_ERROR("Item properties mismatch at time " << time);
+          numberOfErrors++;
+        }
+      }
+    }
+
+    for (int ideal = 0; ideal < 2; ideal++)
+    {
+      double expectedFramePeriodStdev(0);
+      double actualFramePeriodStdev(0);
+      double expectedFrameRate = expectedBuffer->GetFrameRate(ideal != 0, &expectedFramePeriodStdev);
+      double actualFrameRate = actualBuffer->GetFrameRate(ideal != 0, &actualFramePeriodStdev);
+      if (fabs(expectedFrameRate - actualFrameRate) > MAX_MATRIX_ELEMENT_DIFFERENCE
+          || fabs(expectedFramePeriodStdev - actualFramePeriodStdev) > MAX_MATRIX_ELEMENT_DIFFERENCE)
+      {
+        LOG_ERROR((ideal ? "Ideal frame rate" : "Frame rate") << " mismatch: " << actualFrameRate << " stdev " << actualFramePeriodStdev
+                  << " (expected: " << expectedFrameRate << " stdev " << expectedFramePeriodStdev << ")");
+        numberOfErrors++;
+      }
+      // All items are FRAME_PERIOD_SEC apart
+      if (fabs(actualFrameRate - 1.0 / FRAME_PERIOD_SEC) > MAX_MATRIX_ELEMENT_DIFFERENCE)
+      {
+        LOG_ERROR((ideal ? "Ideal frame rate" : "Frame rate") << " is incorrect: " << actualFrameRate << " (expected: " << 1.0 / FRAME_PERIOD_SEC << ")");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestPinnedItems()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusTransformBuffer> buffer = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    numberOfErrors += AddItems(buffer, 1, BUFFER_SIZE + 5);
+
+    BufferItemUidType oldestUid = buffer->GetOldestItemUidInBuffer();
+    StreamBufferItem expectedOldestItem;
+    buffer->GetStreamBufferItem(oldestUid, &expectedOldestItem);
+
+    // Two readers pin the buffer, then it wraps around twice
+    BufferItemUidType firstPinnedUid = buffer->PinItems();
+    BufferItemUidType secondPinnedUid = buffer->PinItems();
+    if (firstPinnedUid != oldestUid || secondPinnedUid != oldestUid)
+    {
+      LOG_ERROR("Pinned UID mismatch: " << firstPinnedUid << ", " << secondPinnedUid << " (expected: " << oldestUid << ")");
+      numberOfErrors++;
+    }
+    numberOfErrors += AddItems(buffer, BUFFER_SIZE + 6, 3 * BUFFER_SIZE);
+
+    StreamBufferItem oldestItem;
+    if (buffer->GetOldestItemUidInBuffer() != oldestUid || buffer->GetStreamBufferItem(oldestUid, &oldestItem) != ITEM_OK
+        || oldestItem.GetIndex() != expectedOldestItem.GetIndex())
+    {
+      LOG_ERROR("Pinned item is not available anymore");
+      numberOfErrors++;
+    }
+    if (buffer->GetNumberOfItems() != 3 * BUFFER_SIZE - 5)
+    {
+      LOG_ERROR("Number of items of the pinned buffer mismatch: " << buffer->GetNumberOfItems() << " (expected: " << 3 * BUFFER_SIZE - 5 << ")");
+      numberOfErrors++;
+    }
+
+    // Items are kept until all the readers unpin the buffer
+    if (buffer->UnpinItems(firstPinnedUid) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unpinning failed, although the pinned items were kept");
+      numberOfErrors++;
+    }
+    numberOfErrors += AddItems(buffer, 3 * BUFFER_SIZE + 1, 3 * BUFFER_SIZE + 1);
+    if (buffer->GetOldestItemUidInBuffer() != oldestUid)
+    {
+      LOG_ERROR("Item is discarded while the buffer is still pinned");
+      numberOfErrors++;
+    }
+    if (buffer->UnpinItems(secondPinnedUid) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unpinning failed, although the pinned items were kept");
+      numberOfErrors++;
+    }
+    if (buffer->GetAllocatedMemoryInBytes() != BUFFER_SIZE * buffer->GetItemSizeInBytes())
+    {
+      LOG_ERROR("Buffer did not shrink after unpinning: " << buffer->GetAllocatedMemoryInBytes() << " bytes (expected: " << BUFFER_SIZE * buffer->GetItemSizeInBytes() << ")");
+      numberOfErrors++;
+    }
+    numberOfErrors += AddItems(buffer, 3 * BUFFER_SIZE + 2, 3 * BUFFER_SIZE + 2);
+    if (buffer->GetNumberOfItems() != BUFFER_SIZE || buffer->GetBufferSize() != BUFFER_SIZE)
+    {
+      LOG_ERROR("Number of items after unpinning mismatch: " << buffer->GetNumberOfItems() << " (expected: " << BUFFER_SIZE << ")");
+      numberOfErrors++;
+    }
+
+    // The buffer works the same way as a generic buffer with the grown arrays
+    vtkSmartPointer<vtkPlusBuffer> genericBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
+    genericBuffer->SetBufferSize(BUFFER_SIZE);
+    numberOfErrors += AddItems(genericBuffer, 3 * BUFFER_SIZE + 3 - BUFFER_SIZE, 3 * BUFFER_SIZE + 2);
+    numberOfErrors += CompareBuffers(genericBuffer, buffer);
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestPinnedItemsLimit()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusTransformBuffer> buffer = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+    buffer->SetBufferSize(BUFFER_SIZE);
+    buffer->SetMaxNumberOfPinnedItems(2 * BUFFER_SIZE);
+    numberOfErrors += AddItems(buffer, 1, BUFFER_SIZE);
+
+    // A slow reader holds its pin while the buffer wraps around several times
+    BufferItemUidType pinnedUid = buffer->PinItems();
+    numberOfErrors += AddItems(buffer, BUFFER_SIZE + 1, 4 * BUFFER_SIZE);
+    if (buffer->GetAllocatedMemoryInBytes() > 2 * BUFFER_SIZE * buffer->GetItemSizeInBytes())
+    {
+      LOG_ERROR("Pinned buffer has grown beyond its limit: " << buffer->GetAllocatedMemoryInBytes() << " bytes (limit: " << 2 * BUFFER_SIZE * buffer->GetItemSizeInBytes() << ")");
+      numberOfErrors++;
+    }
+    // Once the pin has failed the buffer does not keep more items than its size
+    if (buffer->GetNumberOfItems() != BUFFER_SIZE)
+    {
+      LOG_ERROR("Number of items of the buffer with a failed pin mismatch: " << buffer->GetNumberOfItems() << " (expected: " << BUFFER_SIZE << ")");
+      numberOfErrors++;
+    }
+
+    // The pinned items were overwritten, so the pin fails
+    if (buffer->UnpinItems(pinnedUid) == PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unpinning succeeded, although pinned items were overwritten");
+      numberOfErrors++;
+    }
+    if (buffer->GetAllocatedMemoryInBytes() != BUFFER_SIZE * buffer->GetItemSizeInBytes() || buffer->GetNumberOfItems() != BUFFER_SIZE)
+    {
+      LOG_ERROR("Buffer did not shrink after unpinning: " << buffer->GetNumberOfItems() << " items (expected: " << BUFFER_SIZE << ")");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int CompareItemQueries(vtkPlusBuffer* expectedBuffer, vtkPlusBuffer* actualBuffer)
+  {
+    int numberOfErrors(0);
+    BufferItemUidType oldestUid = expectedBuffer->GetOldestItemUidInBuffer();
+    BufferItemUidType latestUid = expectedBuffer->GetLatestItemUidInBuffer();
+    if (actualBuffer->GetOldestItemUidInBuffer() != oldestUid || actualBuffer->GetLatestItemUidInBuffer() != latestUid)
+    {
+      LOG_ERROR("UID range mismatch: " << actualBuffer->GetOldestItemUidInBuffer() << "-" << actualBuffer->GetLatestItemUidInBuffer()
+                << " (expected: " << oldestUid << "-" << latestUid << ")");
+      return 1;
+    }
+
+    double expectedTimestamp(0);
+    double actualTimestamp(0);
+    if (expectedBuffer->GetOldestTimeStamp(expectedTimestamp) != actualBuffer->GetOldestTimeStamp(actualTimestamp) || expectedTimestamp != actualTimestamp)
+    {
+      LOG_ERROR("Oldest timestamp mismatch: " << actualTimestamp << " (expected: " << expectedTimestamp << ")");
+      numberOfErrors++;
+    }
+    if (expectedBuffer->GetLatestTimeStamp(expectedTimestamp) != actualBuffer->GetLatestTimeStamp(actualTimestamp) || expectedTimestamp != actualTimestamp)
+    {
+      LOG_ERROR("Latest timestamp mismatch: " << actualTimestamp << " (expected: " << expectedTimestamp << ")");
+      numberOfErrors++;
+    }
+
+    // Include the items just outside the buffer, their status must match as well
+    for (BufferItemUidType uid = (oldestUid > 1 ? oldestUid - 1 : 1); uid <= latestUid + 1; ++uid)
+    {
+      ItemStatus expectedStatus = expectedBuffer->GetTimeStamp(uid, expectedTimestamp);
+      ItemStatus actualStatus = actualBuffer->GetTimeStamp(uid, actualTimestamp);
+      unsigned long expectedIndex(0);
+      unsigned long actualIndex(0);
+      expectedBuffer->GetIndex(uid, expectedIndex);
+      actualBuffer->GetIndex(uid, actualIndex);
+      if (expectedStatus != actualStatus || expectedTimestamp != actualTimestamp || expectedIndex != actualIndex)
+      {
+        LOG_ERROR("Item " << uid << " mismatch: status " << actualStatus << ", timestamp " << actualTimestamp << ", index " << actualIndex
+                  << " (expected: status " << expectedStatus << ", timestamp " << expectedTimestamp << ", index " << expectedIndex << ")");
+        numberOfErrors++;
+      }
+    }
+
+    BufferItemUidType actualSearchHintUid(0);
+    for (double time = (static_cast<double>(oldestUid) - 2) * FRAME_PERIOD_SEC; time <= (latestUid + 2) * FRAME_PERIOD_SEC; time += FRAME_PERIOD_SEC * 0.3)
+    {
+      BufferItemUidType expectedUid(0);
+      BufferItemUidType actualUid(0);
+      ItemStatus expectedStatus = expectedBuffer->GetItemUidFromTime(time + expectedBuffer->GetLocalTimeOffsetSec(), expectedUid);
+      ItemStatus actualStatus = actualBuffer->GetItemUidFromTime(time + actualBuffer->GetLocalTimeOffsetSec(), actualUid, &actualSearchHintUid);
+      if (expectedStatus != actualStatus || (expectedStatus == ITEM_OK && expectedUid != actualUid))
+      {
+        LOG_ERROR("Item at time " << time << " mismatch: status " << actualStatus << ", UID " << actualUid
+                  << " (expected: status " << expectedStatus << ", UID " << expectedUid << ")");
+        numberOfErrors++;
+      }
+    }
+    return numberOfErrors;
+  }
+
+  //----------------------------------------------------------------------------
+  int TestLockFreeReadsForTools()
+  {
+    int numberOfErrors(0);
+    vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+    source->SetId("Probe");
+    source->SetType(DATA_SOURCE_TYPE_VIDEO);
+    source->GetBuffer()->SetLockFreeReads(true);
+
+    // The setting is carried over to the transform buffer of the tool
+    source->SetType(DATA_SOURCE_TYPE_TOOL);
+    vtkPlusTransformBuffer* lockFreeBuffer = vtkPlusTransformBuffer::SafeDownCast(source->GetBuffer());
+    if (lockFreeBuffer == NULL)
+    {
+      LOG_ERROR("Tool source does not use a transform buffer");
+      return 1;
+    }
+    if (!lockFreeBuffer->GetLockFreeReads())
+    {
+      LOG_ERROR("Lock-free reads are disabled for a tool source");
+      numberOfErrors++;
+    }
+
+    // Lock-free queries return the same results as the locked ones
+    vtkSmartPointer<vtkPlusTransformBuffer> lockedBuffer = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+    lockedBuffer->SetBufferSize(BUFFER_SIZE);
+    lockFreeBuffer->SetBufferSize(BUFFER_SIZE);
+    lockedBuffer->SetLocalTimeOffsetSec(0.5);
+    lockFreeBuffer->SetLocalTimeOffsetSec(0.5);
+    numberOfErrors += AddItems(lockedBuffer, 1, NUMBER_OF_ITEMS);
+    numberOfErrors += AddItems(lockFreeBuffer, 1, NUMBER_OF_ITEMS);
+    LOG_INFO("Compare lock-free item queries");
+    numberOfErrors += CompareItemQueries(lockedBuffer, lockFreeBuffer);
+
+    // The slots follow the arrays when they are resized or grow while pinned
+    lockedBuffer->SetBufferSize(BUFFER_SIZE / 2);
+    lockFreeBuffer->SetBufferSize(BUFFER_SIZE / 2);
+    LOG_INFO("Compare lock-free item queries after shrinking");
+    numberOfErrors += CompareItemQueries(lockedBuffer, lockFreeBuffer);
+    BufferItemUidType lockedPinnedUid = lockedBuffer->PinItems();
+    BufferItemUidType lockFreePinnedUid = lockFreeBuffer->PinItems();
+    numberOfErrors += AddItems(lockedBuffer, NUMBER_OF_ITEMS + 1, NUMBER_OF_ITEMS + BUFFER_SIZE);
+    numberOfErrors += AddItems(lockFreeBuffer, NUMBER_OF_ITEMS + 1, NUMBER_OF_ITEMS + BUFFER_SIZE);
+    LOG_INFO("Compare lock-free item queries of a pinned buffer");
+    numberOfErrors += CompareItemQueries(lockedBuffer, lockFreeBuffer);
+    lockedBuffer->UnpinItems(lockedPinnedUid);
+    lockFreeBuffer->UnpinItems(lockFreePinnedUid);
+    LOG_INFO("Compare lock-free item queries after unpinning");
+    numberOfErrors += CompareItemQueries(lockedBuffer, lockFreeBuffer);
+
+    lockFreeBuffer->Clear();
+    double latestTimestamp(0);
+    BufferItemUidType uid(0);
+    if (lockFreeBuffer->GetLatestTimeStamp(latestTimestamp) == ITEM_OK || lockFreeBuffer->GetItemUidFromTime(FRAME_PERIOD_SEC, uid) != ITEM_NOT_AVAILABLE_YET)
+    {
+      LOG_ERROR("Lock-free queries return items after the buffer is cleared");
+      numberOfErrors++;
+    }
+    return numberOfErrors;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+
+  // Fill both buffers with the same items, the buffers wrap around multiple times
+  vtkSmartPointer<vtkPlusBuffer> genericBuffer = vtkSmartPointer<vtkPlusBuffer>::New();
+  vtkSmartPointer<vtkPlusTransformBuffer> transformBuffer = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+  genericBuffer->SetBufferSize(BUFFER_SIZE);
+  transformBuffer->SetBufferSize(BUFFER_SIZE);
+  numberOfErrors += AddItems(genericBuffer, 1, NUMBER_OF_ITEMS);
+  numberOfErrors += AddItems(transformBuffer, 1, NUMBER_OF_ITEMS);
+  LOG_INFO("Compare generic and transform buffers");
+  numberOfErrors += CompareBuffers(genericBuffer, transformBuffer);
+
+  // Resizing keeps the latest items
+  genericBuffer->SetBufferSize(BUFFER_SIZE / 2);
+  transformBuffer->SetBufferSize(BUFFER_SIZE / 2);
+  LOG_INFO("Compare buffers after shrinking");
+  numberOfErrors += CompareBuffers(genericBuffer, transformBuffer);
+  genericBuffer->SetBufferSize(BUFFER_SIZE);
+  transformBuffer->SetBufferSize(BUFFER_SIZE);
+  numberOfErrors += AddItems(genericBuffer, NUMBER_OF_ITEMS + 1, NUMBER_OF_ITEMS + BUFFER_SIZE / 2);
+  numberOfErrors += AddItems(transformBuffer, NUMBER_OF_ITEMS + 1, NUMBER_OF_ITEMS + BUFFER_SIZE / 2);
+  LOG_INFO("Compare buffers after growing");
+  numberOfErrors += CompareBuffers(genericBuffer, transformBuffer);
+
+  // Copy between the buffer types
+  vtkSmartPointer<vtkPlusBuffer> genericBufferCopy = vtkSmartPointer<vtkPlusBuffer>::New();
+  genericBufferCopy->DeepCopy(transformBuffer);
+  vtkSmartPointer<vtkPlusTransformBuffer> transformBufferCopy = vtkSmartPointer<vtkPlusTransformBuffer>::New();
+  transformBufferCopy->DeepCopy(genericBuffer);
+  LOG_INFO("Compare buffer copies");
+  numberOfErrors += CompareBuffers(genericBuffer, genericBufferCopy);
+  numberOfErrors += CompareBuffers(genericBuffer, transformBufferCopy);
+
+  LOG_INFO("Test pinned items");
+  numberOfErrors += TestPinnedItems();
+  numberOfErrors += TestPinnedItemsLimit();
+
+  LOG_INFO("Test lock-free reads of tool sources");
+  numberOfErrors += TestLockFreeReadsForTools();
+
+  if (numberOfErrors > 0)
+  {
+    LOG_INFO("Test failed");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusVirtualDeviceEventDrivenTest.cxx
+  \brief Test that event-driven virtual devices process new input data without waiting for their polling period.
+
+  A tracker feeds a chain of two virtual devices: the first one copies the latest tracker sample to its own output channel,
+  the second one reads the output of the first one. The virtual devices poll at a low acquisition rate. In event-driven mode
+  each sample has to reach the end of the chain well within one polling period, and almost all samples have to be processed.
+  In rate-driven mode only the samples that are the latest at the polling times are processed.
+  The event-driven devices are updated by a PlusEventDrivenUpdateDispatcher, which is started after the devices.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusEventDrivenUpdateDispatcher.h"
+#include "vtkPlusChannel.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusTestDevices.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <memory>
+#include <vector>
+
+//----------------------------------------------------------------------------
+/*! Virtual device that processes the latest sample of its input channel and optionally forwards it to its output tool */
+class vtkPlusVirtualDeviceEventDrivenTestDevice : public vtkPlusDevice
+{
+public:
+  static vtkPlusVirtualDeviceEventDrivenTestDevice* New();
+  vtkTypeMacro(vtkPlusVirtualDeviceEventDrivenTestDevice, vtkPlusDevice);
+
+  virtual bool IsVirtual() const { return true; }
+
+  /*! Tool that the processed samples are forwarded to, may be NULL */
+  vtkPlusDataSource* OutputTool;
+  /*! Written by the update thread, read by the test after recording is stopped */
+  unsigned long NumberOfProcessedSamples;
+  double MaximumLatencySec;
+
+protected:
+  vtkPlusVirtualDeviceEventDrivenTestDevice()
+    : OutputTool(NULL)
+    , NumberOfProcessedSamples(0)
+    , MaximumLatencySec(0.0)
+    , LastProcessedTimestamp(0.0)
+    , Matrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  {
+    this->StartThreadForInternalUpdates = true;
+  }
+  ~vtkPlusVirtualDeviceEventDrivenTestDevice() {}
+
+  virtual PlusStatus InternalUpdate()
+  {
+    double timestamp(0.0);
+    if (this->InputChannels.empty() || this->InputChannels[0]->GetLatestTimestamp(timestamp) != PLUS_SUCCESS || timestamp <= this->LastProcessedTimestamp)
+    {
+      // no new data
+      return PLUS_SUCCESS;
+    }
+    this->LastProcessedTimestamp = timestamp;
+    this->NumberOfProcessedSamples++;
+    double latencySec = vtkIGSIOAccurateTimer::GetSystemTime() - timestamp;
+    if (latencySec > this->MaximumLatencySec)
+    {
+      this->MaximumLatencySec = latencySec;
+    }
+    if (this->OutputTool != NULL)
+    {
+      return this->OutputTool->AddTimeStampedItem(this->Matrix, TOOL_OK, this->NumberOfProcessedSamples, timestamp, timestamp);
+    }
+    return PLUS_SUCCESS;
+  }
+
+  double LastProcessedTimestamp;
+  vtkSmartPointer<vtkMatrix4x4> Matrix;
+};
+
+vtkStandardNewMacro(vtkPlusVirtualDeviceEventDrivenTestDevice);
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  vtkSmartPointer<vtkPlusDataSource> CreateTool(const std::string& toolId, vtkPlusDevice* device, vtkPlusChannel* channel, int bufferSize)
+  {
+    vtkSmartPointer<vtkPlusDataSource> tool = vtkSmartPointer<vtkPlusDataSource>::New();
+    tool->SetId(toolId);
+    tool->SetType(DATA_SOURCE_TYPE_TOOL);
+    tool->SetBufferSize(bufferSize);
+    if (device->AddTool(tool) != PLUS_SUCCESS || channel->AddTool(tool) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add tool " << toolId);
+      exit(EXIT_FAILURE);
+    }
+    return tool;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  double acquisitionRate(5.0);
+  int numberOfSamples(20);
+  double samplingPeriodSec(0.02);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--acquisition-rate", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &acquisitionRate, "Acquisition rate of the virtual devices in Hz (Default: 5).");
+  args.AddArgument("--number-of-samples", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &numberOfSamples, "Number of tracker samples (Default: 20).");
+  args.AddArgument("--sampling-period-sec", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &samplingPeriodSec, "Time between the tracker samples (Default: 0.02).");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  const double pollingPeriodSec = 1.0 / acquisitionRate;
+  if (acquisitionRate <= 0 || numberOfSamples < 10 || samplingPeriodSec <= 0 || samplingPeriodSec * 5 > pollingPeriodSec)
+  {
+    LOG_ERROR("At least 10 samples are needed and the polling period must be much longer than the sampling period");
+    exit(EXIT_FAILURE);
+  }
+
+  int numberOfErrors(0);
+
+  for (int eventDriven = 1; eventDriven >= 0; --eventDriven)
+  {
+    const vtkPlusDevice::AcquisitionModeType mode = (eventDriven ? vtkPlusDevice::ACQUISITION_MODE_EVENT_DRIVEN : vtkPlusDevice::ACQUISITION_MODE_RATE_DRIVEN);
+    const std::string modeName = vtkPlusDevice::GetAcquisitionModeAsString(mode);
+
+    // Tracker -> First virtual device -> Second virtual device
+    vtkSmartPointer<vtkPlusTestTracker> tracker = vtkSmartPointer<vtkPlusTestTracker>::New();
+    tracker->SetDeviceId("Tracker");
+    vtkSmartPointer<vtkPlusChannel> trackerChannel = vtkSmartPointer<vtkPlusChannel>::New();
+    trackerChannel->SetChannelId("TrackerStream");
+    trackerChannel->SetOwnerDevice(tracker);
+    tracker->AddOutputChannel(trackerChannel);
+    vtkSmartPointer<vtkPlusDataSource> trackerTool = CreateTool("ProbeToTracker", tracker, trackerChannel, numberOfSamples + 10);
+
+    vtkSmartPointer<vtkPlusVirtualDeviceEventDrivenTestDevice> firstDevice = vtkSmartPointer<vtkPlusVirtualDeviceEventDrivenTestDevice>::New();
+    firstDevice->SetDeviceId("FirstVirtualDevice");
+    vtkSmartPointer<vtkPlusChannel> firstChannel = vtkSmartPointer<vtkPlusChannel>::New();
+    firstChannel->SetChannelId("FirstVirtualStream");
+    firstChannel->SetOwnerDevice(firstDevice);
+    firstDevice->AddOutputChannel(firstChannel);
+    vtkSmartPointer<vtkPlusDataSource> firstTool = CreateTool("ProbeToReference", firstDevice, firstChannel, numberOfSamples + 10);
+    firstDevice->OutputTool = firstTool;
+    firstDevice->AddInputChannel(trackerChannel);
+
+    vtkSmartPointer<vtkPlusVirtualDeviceEventDrivenTestDevice> secondDevice = vtkSmartPointer<vtkPlusVirtualDeviceEventDrivenTestDevice>::New();
+    secondDevice->SetDeviceId("SecondVirtualDevice");
+    secondDevice->AddInputChannel(firstChannel);
+
+    std::shared_ptr<PlusEventDrivenUpdateDispatcher> dispatcher = std::make_shared<PlusEventDrivenUpdateDispatcher>();
+    vtkPlusVirtualDeviceEventDrivenTestDevice* virtualDevices[2] = { firstDevice, secondDevice };
+    for (int i = 0; i < 2; ++i)
+    {
+      virtualDevices[i]->SetEventDrivenUpdateDispatcher(dispatcher);
+      virtualDevices[i]->SetAcquisitionRate(acquisitionRate);
+      virtualDevices[i]->SetRequestedAcquisitionMode(mode);
+      if (virtualDevices[i]->GetAcquisitionMode() != mode)
+      {
+        LOG_ERROR(virtualDevices[i]->GetDeviceId() << " is not " << modeName);
+        numberOfErrors++;
+      }
+    }
+    // Start the end of the chain first, so that no sample is missed
+    if (secondDevice->StartRecording() != PLUS_SUCCESS || firstDevice->StartRecording() != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start recording in " << modeName << " mode");
+      exit(EXIT_FAILURE);
+    }
+    // The second device is passed first, the dispatcher has to find the dependency order
+    std::vector<vtkPlusDevice*> devices;
+    devices.push_back(secondDevice);
+    devices.push_back(firstDevice);
+    devices.push_back(tracker);
+    if (dispatcher->Start(devices) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to start the event-driven update dispatcher in " << modeName << " mode");
+      exit(EXIT_FAILURE);
+    }
+    const int expectedNumberOfDispatchedDevices = (eventDriven ? 2 : 0);
+    if (dispatcher->GetNumberOfDevices() != expectedNumberOfDispatchedDevices)
+    {
+      LOG_ERROR(dispatcher->GetNumberOfDevices() << " devices are updated by the dispatcher in " << modeName << " mode, expected " << expectedNumberOfDispatchedDevices);
+      numberOfErrors++;
+    }
+
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    std::vector<vtkPlusDevice::ToolTimeStampedUpdateItem> toolUpdates;
+    toolUpdates.push_back(vtkPlusDevice::ToolTimeStampedUpdateItem(trackerTool, matrix, TOOL_OK));
+    for (int frameNumber = 1; frameNumber <= numberOfSamples; ++frameNumber)
+    {
+      matrix->SetElement(0, 3, frameNumber);
+      const double timestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+      if (tracker->ToolTimeStampedUpdate(toolUpdates, frameNumber, timestamp, timestamp) != PLUS_SUCCESS)
+      {
+        LOG_ERROR("Failed to add sample " << frameNumber);
+        numberOfErrors++;
+      }
+      vtkIGSIOAccurateTimer::Delay(samplingPeriodSec);
+    }
+    // Let the last sample propagate
+    vtkIGSIOAccurateTimer::Delay(pollingPeriodSec / 2);
+
+    dispatcher->Stop();
+    firstDevice->StopRecording();
+    secondDevice->StopRecording();
+
+    LOG_INFO(modeName << ": " << firstDevice->NumberOfProcessedSamples << " and " << secondDevice->NumberOfProcessedSamples << " of " << numberOfSamples
+             << " samples are processed, maximum latency at the end of the chain: " << secondDevice->MaximumLatencySec << " sec");
+
+    const double recordingTimeSec = numberOfSamples * samplingPeriodSec + pollingPeriodSec / 2;
+    if (eventDriven)
+    {
+      // A few samples may be merged if the system is busy, but none of them may wait for the polling period
+      if (secondDevice->NumberOfProcessedSamples < static_cast<unsigned long>(numberOfSamples * 8 / 10))
+      {
+        LOG_ERROR("Only " << secondDevice->NumberOfProcessedSamples << " of " << numberOfSamples << " samples are processed in " << modeName << " mode");
+        numberOfErrors++;
+      }
+      if (secondDevice->MaximumLatencySec >= pollingPeriodSec / 2)
+      {
+        LOG_ERROR("Maximum latency is " << secondDevice->MaximumLatencySec << " sec in " << modeName << " mode, it should be much less than the polling period (" << pollingPeriodSec << " sec)");
+        numberOfErrors++;
+      }
+    }
+    else if (secondDevice->NumberOfProcessedSamples > static_cast<unsigned long>(recordingTimeSec / pollingPeriodSec) + 2)
+    {
+      LOG_ERROR(secondDevice->NumberOfProcessedSamples << " samples are processed in " << modeName << " mode, more than the number of polling periods");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -667,7 +667,9 @@ PlusStatus vtkPlusVirtualCapture::GetInputTrackedFrameListSampled(double& lastAl
     return PLUS_FAIL;
   }
 
-  return this->OutputChannels[0]->GetTrackedFrameListSampled(lastAlreadyRecordedFrameTimestamp, nextFrameToBeRecordedTimestamp, recordedFrames, requestedFramePeriodSec, maxProcessingTimeSec);
+  // Unbuffered frames are written to file before the next update, so they can reference the pixel data in the video buffer.
+  // Buffered frames are kept for several updates, they are copied so that they do not make the video buffer skip frames.
+  return this->OutputChannels[0]->GetTrackedFrameListSampled(lastAlreadyRecordedFrameTimestamp, nextFrameToBeRecordedTimestamp, recordedFrames, requestedFramePeriodSec, maxProcessingTimeSec, !this->IsFrameBuffered());
 }
 
 //-----------------------------------------------------------------------------
@@ -179,8 +179,9 @@ PlusStatus vtkPlusVirtualVolumeReconstructor::InternalUpdate()
   }
   vtkPlusChannel* outputChannel = this->OutputChannels[0];
 
+  // The frames are inserted into the volume and released in this update, so they can reference the pixel data in the video buffer
   vtkSmartPointer<vtkIGSIOTrackedFrameList> recordedFrames = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
-  if (outputChannel->GetTrackedFrameListSampled(m_LastAlreadyRecordedFrameTimestamp, m_NextFrameToBeRecordedTimestamp, recordedFrames, requestedFramePeriodSec, maxProcessingTimeSec) != PLUS_SUCCESS)
+  if (outputChannel->GetTrackedFrameListSampled(m_LastAlreadyRecordedFrameTimestamp, m_NextFrameToBeRecordedTimestamp, recordedFrames, requestedFramePeriodSec, maxProcessingTimeSec, true) != PLUS_SUCCESS)
   {
     LOG_ERROR("Error while getting tracked frame list from data collector during volume reconstruction. Last recorded timestamp: " << std::fixed << m_NextFrameToBeRecordedTimestamp);
   }
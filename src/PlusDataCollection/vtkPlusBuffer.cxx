@@ -8,9 +8,16 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "igsioMath.h"
 #include "igsioTrackedFrame.h"
+#include "PlusPoseInterpolator.h"
 #include "vtkPlusBuffer.h"
+#include "vtkPlusBufferLogMacros.h"
+#include "vtkPlusBufferSpillFile.h"
 #include "vtkPlusDevice.h"
+#include "vtkPlusFrameSlab.h"
 #include "vtkPlusSequenceIO.h"
+#include "vtkPlusTransformBuffer.h"
+#include "vtkIGSIOSequenceIO.h"
+#include "vtkIGSIOSequenceIOBase.h"
 #include "vtkIGSIOTrackedFrameList.h"
 
 // VTK includes
@@ -20,59 +27,19 @@ See License.txt for details.
 #include <vtkMath.h>
 #include <vtkMatrix4x4.h>
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
 #include <vtkUnsignedLongLongArray.h>
+#include <vtksys/SystemTools.hxx>
 
 // vtkAddon includes
 #include <vtkStreamingVolumeCodec.h>
 
 static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001; // in seconds, used for comparing between exact timestamps
+static const int WRITE_CHUNK_SIZE = 100; // number of frames that are written to the sequence file at once
 static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
 
 vtkStandardNewMacro(vtkPlusBuffer);
 
-#define LOCAL_LOG_ERROR(msg) \
-{ \
-  std::ostringstream msgStream; \
-  if( this->DescriptiveName == NULL ) \
-  { \
-    msgStream << " " << msg << std::ends; \
-  } \
-  else \
-  { \
-    msgStream << this->DescriptiveName << ": " << msg << std::ends; \
-  } \
-  std::string finalStr(msgStream.str()); \
-  LOG_ERROR(finalStr); \
-}
-#define LOCAL_LOG_WARNING(msg) \
-{ \
-  std::ostringstream msgStream; \
-  if( this->DescriptiveName == NULL ) \
-{ \
-  msgStream << " " << msg << std::ends; \
-} \
-  else \
-{ \
-  msgStream << this->DescriptiveName << ": " << msg << std::ends; \
-} \
-  std::string finalStr(msgStream.str()); \
-  LOG_WARNING(finalStr); \
-}
-#define LOCAL_LOG_DEBUG(msg) \
-{ \
-  std::ostringstream msgStream; \
-  if( this->DescriptiveName == NULL ) \
-{ \
-  msgStream << " " << msg << std::ends; \
-} \
-  else \
-{ \
-  msgStream << this->DescriptiveName << ": " << msg << std::ends; \
-} \
-  std::string finalStr(msgStream.str()); \
-  LOG_DEBUG(finalStr); \
-}
-
 //----------------------------------------------------------------------------
 // vtkPlusBuffer
 //----------------------------------------------------------------------------
@@ -84,6 +51,16 @@ vtkPlusBuffer::vtkPlusBuffer()
   , StreamBuffer(vtkPlusTimestampedCircularBuffer::New())
   , MaxAllowedTimeDifference(0.5)
   , DescriptiveName(NULL)
+  , NumberOfDetachedFrames(0)
+  , NumberOfSkippedFrames(0)
+  , NumberOfDiscardedItems(0)
+  , MaxNumberOfDetachedFrames(-1)
+  , ContiguousFrameMemory(false)
+  , HugePageFrameMemory(false)
+  , FrameSlab(NULL)
+  , SpillBufferSize(0)
+  , SpillFile(NULL)
+  , FrameFieldNames(std::make_shared<PlusFrameFieldNameTable>())
 {
   this->FrameSize[0] = 0;
   this->FrameSize[1] = 0;
@@ -103,6 +80,16 @@ vtkPlusBuffer::~vtkPlusBuffer()
     this->StreamBuffer->Delete();
     this->StreamBuffer = NULL;
   }
+  if (this->FrameSlab != NULL)
+  {
+    this->FrameSlab->Delete();
+    this->FrameSlab = NULL;
+  }
+  if (this->SpillFile != NULL)
+  {
+    this->SpillFile->Delete();
+    this->SpillFile = NULL;
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -119,6 +106,22 @@ void vtkPlusBuffer::PrintSelf(ostream& os, vtkIndent indent)
   {
     this->StreamBuffer->PrintSelf(os, indent.GetNextIndent());
   }
+  os << indent << "MaxNumberOfDetachedFrames: " << this->MaxNumberOfDetachedFrames << std::endl;
+  os << indent << "NumberOfDetachedFrames: " << this->NumberOfDetachedFrames << std::endl;
+  os << indent << "NumberOfSkippedFrames: " << this->NumberOfSkippedFrames << std::endl;
+  os << indent << "NumberOfDiscardedItems: " << this->NumberOfDiscardedItems << std::endl;
+  os << indent << "ContiguousFrameMemory: " << (this->ContiguousFrameMemory ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "HugePageFrameMemory: " << (this->HugePageFrameMemory ? "TRUE" : "FALSE") << std::endl;
+  if (this->FrameSlab != NULL)
+  {
+    this->FrameSlab->PrintSelf(os, indent.GetNextIndent());
+  }
+  os << indent << "SpillBufferSize: " << this->SpillBufferSize << std::endl;
+  os << indent << "NumberOfPins: " << this->Pins.size() << std::endl;
+  if (this->SpillFile != NULL)
+  {
+    this->SpillFile->PrintSelf(os, indent.GetNextIndent());
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -127,10 +130,62 @@ PlusStatus vtkPlusBuffer::AllocateMemoryForFrames()
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   PlusStatus result = PLUS_SUCCESS;
 
+  // Views of the frames keep the old format
+  this->ReleaseSharedSlotFrames();
+
+  unsigned long frameSizeInBytes = static_cast<unsigned long>(this->FrameSize[0]) * this->FrameSize[1] * this->FrameSize[2] * this->GetNumberOfBytesPerPixel();
+  if (this->ContiguousFrameMemory && frameSizeInBytes > 0)
+  {
+    // Frames of the previous slab (and views of them) keep the previous slab alive until they are released
+    vtkPlusFrameSlab* frameSlab = vtkPlusFrameSlab::New();
+    if (frameSlab->Allocate(this->StreamBuffer->GetBufferSize(), frameSizeInBytes, this->HugePageFrameMemory) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("Failed to allocate contiguous memory for frames");
+      frameSlab->Delete();
+      return PLUS_FAIL;
+    }
+    if (this->FrameSlab != NULL)
+    {
+      this->FrameSlab->Delete();
+    }
+    this->FrameSlab = frameSlab;
+
+    for (int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i)
+    {
+      if (this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().IsFrameEncoded())
+      {
+        continue;
+      }
+      vtkImageData* frameImage = this->FrameSlab->CreateFrameImage(i, this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents());
+      if (frameImage == NULL)
+      {
+        LOCAL_LOG_ERROR("Failed to allocate memory for frame " << i);
+        result = PLUS_FAIL;
+        continue;
+      }
+      this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().SetImageData(frameImage);
+      frameImage->Delete();
+    }
+    return result;
+  }
+
+  // Frames that were allocated in a slab are moved to separately allocated memory
+  bool frameSlabReleased = (this->FrameSlab != NULL);
+  if (this->FrameSlab != NULL)
+  {
+    this->FrameSlab->Delete();
+    this->FrameSlab = NULL;
+  }
+
   for (int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i)
   {
     if (!this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().IsFrameEncoded())
     {
+      if (frameSlabReleased)
+      {
+        vtkSmartPointer<vtkImageData> frameImage = vtkSmartPointer<vtkImageData>::New();
+        this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().SetImageData(frameImage);
+      }
       if (this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i)->GetFrame().AllocateFrame(this->GetFrameSize(), this->GetPixelType(), this->GetNumberOfScalarComponents()) != PLUS_SUCCESS)
       {
         LOCAL_LOG_ERROR("Failed to allocate memory for frame " << i);
@@ -141,6 +196,45 @@ PlusStatus vtkPlusBuffer::AllocateMemoryForFrames()
   return result;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::SetContiguousFrameMemory(bool enable)
+{
+  if (this->ContiguousFrameMemory == enable)
+  {
+    // no change
+    return PLUS_SUCCESS;
+  }
+  this->ContiguousFrameMemory = enable;
+  return AllocateMemoryForFrames();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::SetHugePageFrameMemory(bool enable)
+{
+  if (this->HugePageFrameMemory == enable)
+  {
+    // no change
+    return PLUS_SUCCESS;
+  }
+  this->HugePageFrameMemory = enable;
+  if (!this->ContiguousFrameMemory)
+  {
+    // huge pages are only used for contiguous frame memory
+    return PLUS_SUCCESS;
+  }
+  return AllocateMemoryForFrames();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::PrefaultFrameMemory()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->FrameSlab != NULL)
+  {
+    this->FrameSlab->Prefault();
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusBuffer::SetLocalTimeOffsetSec(double offsetSec)
 {
@@ -174,10 +268,21 @@ PlusStatus vtkPlusBuffer::SetBufferSize(int bufsize)
   }
 
   PlusStatus result = PLUS_SUCCESS;
+  {
+    // Resizing moves the slots by assignment
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    this->ReleaseSharedSlotFrames();
+  }
   if (this->StreamBuffer->SetBufferSize(bufsize) != PLUS_SUCCESS)
   {
     result = PLUS_FAIL;
   }
+  if (this->SpillFile != NULL)
+  {
+    // Items that did not fit in the resized buffer were not spilled, the history is not contiguous anymore
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    this->SpillFile->Clear();
+  }
   if (this->AllocateMemoryForFrames() != PLUS_SUCCESS)
   {
     return PLUS_FAIL;
@@ -186,6 +291,62 @@ PlusStatus vtkPlusBuffer::SetBufferSize(int bufsize)
   return result;
 }
 
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::SetItemCustomFields(StreamBufferItem* item, const igsioFieldMapType* customFields)
+{
+  // Fields of the item that was previously stored in this slot are removed
+  item->SetFrameFieldNameTable(this->FrameFieldNames);
+  item->ClearFrameFields();
+  if (customFields == NULL)
+  {
+    return false;
+  }
+  bool transformFieldFound(false);
+  for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
+  {
+    PlusFrameFieldNameTable::KeyType key = this->FrameFieldNames->Intern(it->first);
+    item->SetFrameFieldByKey(key, it->second.second, it->second.first);
+    if (this->FrameFieldNames->IsTransformField(key))
+    {
+      transformFieldFound = true;
+    }
+  }
+  return transformFieldFound;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusBuffer::GetItemSizeInBytes()
+{
+  unsigned long long frameSizeInBytes = static_cast<unsigned long long>(this->FrameSize[0]) * this->FrameSize[1] * this->FrameSize[2] * this->GetNumberOfBytesPerPixel();
+  return sizeof(StreamBufferItem) + frameSizeInBytes;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusBuffer::GetAllocatedMemoryInBytes()
+{
+  // frames are allocated for all items when the buffer is resized
+  unsigned long long allocatedBytes = static_cast<unsigned long long>(this->GetBufferSize()) * this->GetItemSizeInBytes();
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->ReleaseUnreferencedDetachedFrames();
+  for (std::vector<DetachedFrame>::iterator it = this->DetachedFrames.begin(); it != this->DetachedFrames.end(); ++it)
+  {
+    allocatedBytes += it->SizeInBytes;
+  }
+  if (this->SpillFile != NULL && !this->SpillFile->GetInMemory())
+  {
+    // The memory that keeps the pinned items is only used while the buffer is pinned
+    allocatedBytes += this->SpillFile->GetFileSizeInBytes();
+  }
+  return allocatedBytes;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusBuffer::GetUsedMemoryInBytes()
+{
+  return static_cast<unsigned long long>(this->StreamBuffer->GetNumberOfItems()) * this->GetItemSizeInBytes();
+}
+
 //----------------------------------------------------------------------------
 bool vtkPlusBuffer::CheckFrameFormat(const FrameSizeType& frameSizeInPx, igsioCommon::VTKScalarPixelType pixelType, US_IMAGE_TYPE imgType, int numberOfScalarComponents)
 {
@@ -353,18 +514,24 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
   BufferItemUidType itemUid;
 
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  const bool overwritesOldestItem = this->IsBufferFull();
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
     return PLUS_FAIL;
   }
+  if (overwritesOldestItem)
+  {
+    this->SpillOverwrittenItem(bufferIndex);
+  }
 
   // get the pointer to the correct location in the tracker buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to data buffer object from the tracker buffer for the new frame!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
@@ -374,11 +541,7 @@ PlusStatus vtkPlusBuffer::AddItem(const igsioFieldMapType& fields,
   newObjectInBuffer->SetUid(itemUid);
 
   // Add custom fields
-  for (igsioFieldMapType::const_iterator it = fields.begin(); it != fields.end(); ++it)
-  {
-    newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
-    std::string name(it->first);
-  }
+  this->SetItemCustomFields(newObjectInBuffer, &fields);
 
   return PLUS_SUCCESS;
 }
@@ -464,18 +627,37 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   int bufferIndex(0);
   BufferItemUidType itemUid;
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int unreferencedSlotOffset(0);
+  if (imageDataPtr != NULL && this->IsNextSlotLockedByViews())
+  {
+    // The writer skips ahead to a slot that is not referenced instead of allocating more memory for slow readers
+    unreferencedSlotOffset = this->GetUnreferencedSlotOffset();
+    if (unreferencedSlotOffset < 0)
+    {
+      // the caller is notified that the frame is lost
+      LOCAL_LOG_DEBUG("vtkPlusBuffer: Skip frame " << frameNumber << ", all slots are still referenced by views");
+      this->NumberOfSkippedFrames++;
+      return PLUS_FAIL;
+    }
+  }
+  const bool overwritesOldestItem = this->IsBufferFull();
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
     return PLUS_FAIL;
   }
+  if (overwritesOldestItem)
+  {
+    this->SpillOverwrittenItem(bufferIndex);
+  }
 
   // get the pointer to the correct location in the frame buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
@@ -491,18 +673,48 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
                     outputFrameSizeInPx[0] << "x" << outputFrameSizeInPx[1] << "x" << outputFrameSizeInPx[2] <<
                     ",   buffer: " <<
                     receivedFrameSize[0] << "x" << receivedFrameSize[1] << "x" << receivedFrameSize[2] << ")!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
+  // Do not overwrite pixel data that is still referenced by a view, use the pixel data of a slot that is not referenced
+  // or move the slot to new memory instead
+  if (unreferencedSlotOffset > 0)
+  {
+    this->TakeUnreferencedSlotFrame(bufferIndex, unreferencedSlotOffset);
+  }
+  else if (imageDataPtr != NULL && newObjectInBuffer->IsFrameShared())
+  {
+    if (this->DetachSharedSlotFrame(newObjectInBuffer) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("Failed to allocate new memory for a video buffer slot that is still in use!");
+      this->StreamBuffer->CancelPendingItem();
+      return PLUS_FAIL;
+    }
+    this->NumberOfDetachedFrames++;
+  }
+
   // Skip the numberOfBytesToSkip bytes, e.g. header size
   if (imageDataPtr != NULL)
   {
     unsigned char* byteImageDataPtr = reinterpret_cast<unsigned char*>(imageDataPtr);
     byteImageDataPtr += numberOfBytesToSkip;
 
-    if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
+    // The kernel is normally selected already, this only compares the settings
+    PlusFrameFlipClipKernel::KernelType kernelType = this->SelectFlipClipKernel(flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, clipRectangleOrigin, clipRectangleSize);
+    if (kernelType != PlusFrameFlipClipKernel::KERNEL_GENERIC)
+    {
+      if (this->FlipClipKernel.Apply(byteImageDataPtr, reinterpret_cast<unsigned char*>(newObjectInBuffer->GetFrame().GetImage()->GetScalarPointer())) != PLUS_SUCCESS)
+      {
+        LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
+        this->StreamBuffer->CancelPendingItem();
+        return PLUS_FAIL;
+      }
+    }
+    else if (igsioVideoFrame::GetOrientedClippedImage(byteImageDataPtr, flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, newObjectInBuffer->GetFrame(), clipRectangleOrigin, clipRectangleSize) != PLUS_SUCCESS)
     {
       LOCAL_LOG_ERROR("Failed to convert input US image to the requested orientation!");
+      this->StreamBuffer->CancelPendingItem();
       return PLUS_FAIL;
     }
   }
@@ -518,17 +730,9 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr,
   newObjectInBuffer->GetFrame().SetImageType(imageType);
 
   // Add custom fields
-  if (customFields != NULL)
+  if (this->SetItemCustomFields(newObjectInBuffer, customFields))
   {
-    for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
-    {
-      newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
-      std::string name(it->first);
-      if (name.find("Transform") != std::string::npos)
-      {
-        newObjectInBuffer->SetValidTransformData(true);
-      }
-    }
+    newObjectInBuffer->SetValidTransformData(true);
   }
 
   return PLUS_SUCCESS;
@@ -577,18 +781,37 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   int bufferIndex(0);
   BufferItemUidType itemUid;
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int unreferencedSlotOffset(0);
+  if (this->IsNextSlotLockedByViews())
+  {
+    // The writer skips ahead to a slot that is not referenced instead of allocating more memory for slow readers
+    unreferencedSlotOffset = this->GetUnreferencedSlotOffset();
+    if (unreferencedSlotOffset < 0)
+    {
+      // the caller is notified that the frame is lost
+      LOCAL_LOG_DEBUG("vtkPlusBuffer: Skip frame " << frameNumber << ", all slots are still referenced by views");
+      this->NumberOfSkippedFrames++;
+      return PLUS_FAIL;
+    }
+  }
+  const bool overwritesOldestItem = this->IsBufferFull();
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to video buffer!");
     return PLUS_FAIL;
   }
+  if (overwritesOldestItem)
+  {
+    this->SpillOverwrittenItem(bufferIndex);
+  }
 
   // get the pointer to the correct location in the frame buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to video buffer object from the video buffer for the new frame!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
@@ -596,9 +819,27 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   if (bufferFrameSizeBytes < inputFrameSizeInBytes)
   {
     LOCAL_LOG_ERROR("Input frame size is larger than buffer frame size (input: " << inputFrameSizeInBytes << ",   buffer: " << bufferFrameSizeBytes << ")!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
+  // Do not overwrite pixel data that is still referenced by a view, use the pixel data of a slot that is not referenced
+  // or move the slot to new memory instead
+  if (unreferencedSlotOffset > 0)
+  {
+    this->TakeUnreferencedSlotFrame(bufferIndex, unreferencedSlotOffset);
+  }
+  else if (newObjectInBuffer->IsFrameShared())
+  {
+    if (this->DetachSharedSlotFrame(newObjectInBuffer) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("Failed to allocate new memory for a video buffer slot that is still in use!");
+      this->StreamBuffer->CancelPendingItem();
+      return PLUS_FAIL;
+    }
+    this->NumberOfDetachedFrames++;
+  }
+
   newObjectInBuffer->SetFilteredTimestamp(filteredTimestamp);
   newObjectInBuffer->SetUnfilteredTimestamp(unfilteredTimestamp);
   newObjectInBuffer->SetIndex(frameNumber);
@@ -607,17 +848,9 @@ PlusStatus vtkPlusBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frame
   memcpy(newObjectInBuffer->GetFrame().GetImage()->GetScalarPointer(), imageDataPtr, inputFrameSizeInBytes);
 
   // Add custom fields
-  if (customFields != NULL)
+  if (this->SetItemCustomFields(newObjectInBuffer, customFields))
   {
-    for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
-    {
-      newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
-      std::string name(it->first);
-      if (name.find("Transform") != std::string::npos)
-      {
-        newObjectInBuffer->SetValidTransformData(true);
-      }
-    }
+    newObjectInBuffer->SetValidTransformData(true);
   }
 
   newObjectInBuffer->SetFrameField("FrameSizeInBytes", igsioCommon::ToString<unsigned int>(inputFrameSizeInBytes));
@@ -656,22 +889,40 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
     this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
   }
 
+  return this->AddFilteredTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  if (matrix == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Unable to add NULL matrix to tracker buffer!");
+    return PLUS_FAIL;
+  }
+
   int bufferIndex(0);
   BufferItemUidType itemUid;
 
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  const bool overwritesOldestItem = this->IsBufferFull();
   if (this->StreamBuffer->PrepareForNewItem(filteredTimestamp, itemUid, bufferIndex) != PLUS_SUCCESS)
   {
     // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
     LOCAL_LOG_DEBUG("vtkPlusBuffer: Failed to prepare for adding new frame to tracker buffer!");
     return PLUS_FAIL;
   }
+  if (overwritesOldestItem)
+  {
+    this->SpillOverwrittenItem(bufferIndex);
+  }
 
   // get the pointer to the correct location in the tracker buffer, where this data needs to be copied
   StreamBufferItem* newObjectInBuffer = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
   if (newObjectInBuffer == NULL)
   {
     LOCAL_LOG_ERROR("vtkPlusBuffer: Failed to get pointer to data buffer object from the tracker buffer for the new frame!");
+    this->StreamBuffer->CancelPendingItem();
     return PLUS_FAIL;
   }
 
@@ -683,17 +934,9 @@ PlusStatus vtkPlusBuffer::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus st
   newObjectInBuffer->SetUid(itemUid);
 
   // Add custom fields
-  if (customFields != NULL)
+  if (this->SetItemCustomFields(newObjectInBuffer, customFields))
   {
-    for (igsioFieldMapType::const_iterator it = customFields->begin(); it != customFields->end(); ++it)
-    {
-      newObjectInBuffer->SetFrameField(it->first, it->second.second, it->second.first);
-      std::string name(it->first);
-      if (name.find("Transform") != std::string::npos)
-      {
-        newObjectInBuffer->SetValidTransformData(true);
-      }
-    }
+    newObjectInBuffer->SetValidTransformData(true);
   }
 
   return itemStatus;
@@ -706,109 +949,769 @@ ItemStatus vtkPlusBuffer::GetLatestTimeStamp(double& latestTimestamp)
 }
 
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetOldestTimeStamp(double& oldestTimestamp)
+PlusStatus vtkPlusBuffer::WaitForItemNewerThan(double timestamp, double timeoutSec)
 {
-  return this->StreamBuffer->GetOldestTimeStamp(oldestTimestamp);
+  const double deadline = vtkIGSIOAccurateTimer::GetSystemTime() + timeoutSec;
+  for (;;)
+  {
+    // Get the signal count before checking the latest item, so that an item that is added right after the check is not missed
+    unsigned long signalCount = this->StreamBuffer->GetNewItemSignalCount();
+    double latestTimestamp(0);
+    if (this->GetNumberOfItems() > 0 && this->GetLatestTimeStamp(latestTimestamp) == ITEM_OK && latestTimestamp > timestamp)
+    {
+      return PLUS_SUCCESS;
+    }
+    double remainingTimeSec = deadline - vtkIGSIOAccurateTimer::GetSystemTime();
+    if (remainingTimeSec <= 0 || !this->StreamBuffer->WaitForNewItemSignal(signalCount, remainingTimeSec))
+    {
+      return PLUS_FAIL;
+    }
+  }
 }
 
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetTimeStamp(BufferItemUidType uid, double& timestamp)
+unsigned long vtkPlusBuffer::AddNewItemCallback(const vtkPlusTimestampedCircularBuffer::NewItemCallbackType& callback)
 {
-  return this->StreamBuffer->GetTimeStamp(uid, timestamp);
+  return this->StreamBuffer->AddNewItemCallback(callback);
 }
 
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetIndex(BufferItemUidType uid, unsigned long& index)
+void vtkPlusBuffer::RemoveNewItemCallback(unsigned long callbackId)
 {
-  return this->StreamBuffer->GetIndex(uid, index);
+  this->StreamBuffer->RemoveNewItemCallback(callbackId);
 }
 
-
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetBufferIndexFromTime(const double time, int& bufferIndex)
+ItemStatus vtkPlusBuffer::GetOldestTimeStamp(double& oldestTimestamp)
 {
-  return this->StreamBuffer->GetBufferIndexFromTime(time, bufferIndex);
+  if (this->SpillFile != NULL)
+  {
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    if (this->HasSpilledItems())
+    {
+      return this->GetTimeStamp(this->SpillFile->GetOldestItemUid(), oldestTimestamp);
+    }
+  }
+  return this->StreamBuffer->GetOldestTimeStamp(oldestTimestamp);
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBuffer::SetAveragedItemsForFiltering(int averagedItemsForFiltering)
+ItemStatus vtkPlusBuffer::GetTimeStamp(BufferItemUidType uid, double& timestamp)
 {
-  this->StreamBuffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+  ItemStatus status = this->StreamBuffer->GetTimeStamp(uid, timestamp);
+  if (status != ITEM_NOT_AVAILABLE_ANYMORE || this->SpillFile == NULL)
+  {
+    return status;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (!this->HasSpilledItems())
+  {
+    return status;
+  }
+  status = this->SpillFile->GetFilteredTimeStamp(uid, timestamp);
+  if (status == ITEM_OK)
+  {
+    timestamp += this->StreamBuffer->GetLocalTimeOffsetSec();
+  }
+  return status;
 }
 
 //----------------------------------------------------------------------------
-int vtkPlusBuffer::GetAveragedItemsForFiltering()
+ItemStatus vtkPlusBuffer::GetIndex(BufferItemUidType uid, unsigned long& index)
 {
-  return this->StreamBuffer->GetAveragedItemsForFiltering();
+  ItemStatus status = this->StreamBuffer->GetIndex(uid, index);
+  if (status != ITEM_NOT_AVAILABLE_ANYMORE || this->SpillFile == NULL)
+  {
+    return status;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->HasSpilledItems() ? this->SpillFile->GetIndex(uid, index) : status;
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBuffer::SetStartTime(double startTime)
+BufferItemUidType vtkPlusBuffer::PinItems()
 {
-  this->StreamBuffer->SetStartTime(startTime);
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  // The items in memory are kept, the items that are already spilled are kept only as long as the spill file holds them
+  BufferItemUidType oldestUid = this->StreamBuffer->GetOldestItemUidInBuffer();
+  this->AddPin(oldestUid);
+  return oldestUid;
 }
 
 //----------------------------------------------------------------------------
-double vtkPlusBuffer::GetStartTime()
+PlusStatus vtkPlusBuffer::UnpinItems(BufferItemUidType pinnedItemUid)
 {
-  return this->StreamBuffer->GetStartTime();
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  bool expired(false);
+  if (!this->RemovePin(pinnedItemUid, expired))
+  {
+    LOCAL_LOG_ERROR("vtkPlusBuffer: Items are not pinned from UID " << pinnedItemUid);
+    return PLUS_FAIL;
+  }
+
+  BufferItemUidType oldestPinnedUid(0);
+  if (!this->GetOldestPinnedItemUid(oldestPinnedUid) && this->SpillFile != NULL && this->SpillFile->GetInMemory())
+  {
+    // The in-memory spill file only holds items while they are pinned
+    this->SpillFile->Clear();
+  }
+
+  if (expired)
+  {
+    LOCAL_LOG_DEBUG("vtkPlusBuffer: Pinned items from UID " << pinnedItemUid << " were discarded while the pin was held");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable)
+void vtkPlusBuffer::AddPin(BufferItemUidType pinnedItemUid)
 {
-  return this->StreamBuffer->GetTimeStampReportTable(timeStampReportTable);
+  // the caller must have locked the buffer
+  Pin pin;
+  pin.ItemUid = pinnedItemUid;
+  pin.Expired = false;
+  this->Pins.push_back(pin);
 }
 
 //----------------------------------------------------------------------------
-ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
+bool vtkPlusBuffer::RemovePin(BufferItemUidType pinnedItemUid, bool& expired)
 {
-  if (bufferItem == NULL)
+  // the caller must have locked the buffer
+  // Pins of the same UID expire together, so any of them can be removed
+  std::vector<Pin>::iterator pinIt = this->Pins.begin();
+  while (pinIt != this->Pins.end() && pinIt->ItemUid != pinnedItemUid)
   {
-    LOCAL_LOG_ERROR("Unable to copy data buffer item into a NULL data buffer item!");
-    return ITEM_UNKNOWN_ERROR;
+    ++pinIt;
   }
-
-  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
-
-  StreamBufferItem* dataItem = NULL;
-  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
-  if (itemStatus != ITEM_OK)
+  if (pinIt == this->Pins.end())
   {
-    LOCAL_LOG_WARNING("Failed to retrieve data item");
-    return itemStatus;
+    return false;
   }
+  expired = pinIt->Expired;
+  // Order of the pins does not matter
+  *pinIt = this->Pins.back();
+  this->Pins.pop_back();
+  return true;
+}
 
-  if (bufferItem->DeepCopy(dataItem) != PLUS_SUCCESS)
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetOldestPinnedItemUid(BufferItemUidType& uid) const
+{
+  // the caller must have locked the buffer
+  bool pinned(false);
+  for (std::vector<Pin>::const_iterator pinIt = this->Pins.begin(); pinIt != this->Pins.end(); ++pinIt)
   {
-    LOCAL_LOG_WARNING("Failed to copy data item");
-    return ITEM_UNKNOWN_ERROR;
+    if (!pinIt->Expired && (!pinned || pinIt->ItemUid < uid))
+    {
+      uid = pinIt->ItemUid;
+      pinned = true;
+    }
   }
-
-  return ITEM_OK;
+  return pinned;
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
+void vtkPlusBuffer::ExpirePins(BufferItemUidType discardedItemUid)
 {
-  LOG_TRACE("vtkPlusBuffer::DeepCopy");
-
-  this->StreamBuffer->DeepCopy(buffer->StreamBuffer);
-  if (buffer->GetFrameSize()[0] != -1 && buffer->GetFrameSize()[1] != -1 && buffer->GetFrameSize()[2] != -1)
+  // the caller must have locked the buffer
+  for (std::vector<Pin>::iterator pinIt = this->Pins.begin(); pinIt != this->Pins.end(); ++pinIt)
   {
-    this->SetFrameSize(buffer->GetFrameSize());
+    if (pinIt->ItemUid <= discardedItemUid)
+    {
+      pinIt->Expired = true;
+    }
   }
-  this->SetPixelType(buffer->GetPixelType());
-  this->SetImageType(buffer->GetImageType());
-  this->SetNumberOfScalarComponents(buffer->GetNumberOfScalarComponents());
-  this->SetImageOrientation(buffer->GetImageOrientation());
-  this->SetBufferSize(buffer->GetBufferSize());
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusBuffer::Clear()
+BufferItemUidType vtkPlusBuffer::GetOldestItemUidInBuffer()
 {
+  if (this->SpillFile != NULL)
+  {
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    if (this->HasSpilledItems())
+    {
+      return this->SpillFile->GetOldestItemUid();
+    }
+  }
+  return this->StreamBuffer->GetOldestItemUidInBuffer();
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusBuffer::GetNumberOfItems()
+{
+  if (this->SpillFile != NULL)
+  {
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    if (this->HasSpilledItems())
+    {
+      return static_cast<int>(this->StreamBuffer->GetLatestItemUidInBuffer() - this->SpillFile->GetOldestItemUid() + 1);
+    }
+  }
+  return this->StreamBuffer->GetNumberOfItems();
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/)
+{
+  ItemStatus status = this->StreamBuffer->GetItemUidFromTime(time, uid, searchHintUid);
+  if (status != ITEM_NOT_AVAILABLE_ANYMORE || this->SpillFile == NULL)
+  {
+    return status;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (!this->HasSpilledItems())
+  {
+    return status;
+  }
+  // The requested time is older than the items in memory: search the spilled items and the oldest item in memory
+  auto readTimestamp = [this](BufferItemUidType itemUid, double & timestamp) -> bool
+  {
+    return this->GetTimeStamp(itemUid, timestamp) == ITEM_OK;
+  };
+  return vtkPlusTimestampedCircularBuffer::FindItemUidFromTime(time, this->SpillFile->GetOldestItemUid(), this->StreamBuffer->GetOldestItemUidInBuffer(),
+         0, NEGLIGIBLE_TIME_DIFFERENCE, readTimestamp, uid);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetFirstItemUidAfterTime(double time, BufferItemUidType& uid)
+{
+  BufferItemUidType oldestItemUid = this->GetOldestItemUidInBuffer();
+  BufferItemUidType itemUid = 0;
+  ItemStatus status = this->GetItemUidFromTime(time, itemUid);
+  if (status == ITEM_NOT_AVAILABLE_YET)
+  {
+    // all the items have been acquired before the requested time
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  if (status != ITEM_OK)
+  {
+    // the requested time is older than the items in the buffer
+    uid = oldestItemUid;
+    return ITEM_OK;
+  }
+
+  // The closest item may be just before or just after the requested time
+  double itemTimestamp = 0;
+  if (this->GetTimeStamp(itemUid, itemTimestamp) == ITEM_OK && itemTimestamp <= time)
+  {
+    ++itemUid;
+    if (itemUid > this->GetLatestItemUidInBuffer())
+    {
+      // the closest item is the latest one, no item has been acquired after the requested time yet
+      return ITEM_NOT_AVAILABLE_YET;
+    }
+  }
+  else
+  {
+    while (itemUid > oldestItemUid && this->GetTimeStamp(itemUid - 1, itemTimestamp) == ITEM_OK && itemTimestamp > time)
+    {
+      --itemUid;
+    }
+  }
+  uid = itemUid;
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::SetSpillBufferSize(int n)
+{
+  if (n < 0)
+  {
+    LOCAL_LOG_ERROR("Invalid spill buffer size requested: " << n);
+    return PLUS_FAIL;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->SpillBufferSize = n;
+  if (this->SpillFile != NULL && (n == 0 || this->SpillFile->GetInMemory()))
+  {
+    if (this->HasSpilledItems())
+    {
+      // The pinned items in the removed file are not available anymore
+      this->ExpirePins(this->SpillFile->GetLatestItemUid());
+    }
+    this->SpillFile->Delete();
+    this->SpillFile = NULL;
+  }
+  if (n == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+  if (this->SpillFile == NULL)
+  {
+    this->SpillFile = vtkPlusBufferSpillFile::New();
+    this->SpillFile->SetDirectory(this->SpillDirectory);
+  }
+  if (this->SpillFile->GetNumberOfRecords() != static_cast<unsigned int>(n))
+  {
+    // The file is created when the first item is spilled, when the frame size is known
+    this->SpillFile->SetNumberOfRecords(n);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetSpillDirectory(const std::string& directory)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->SpillDirectory = directory;
+  if (this->SpillFile != NULL && !this->SpillFile->GetInMemory())
+  {
+    this->SpillFile->SetDirectory(directory);
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::HasSpilledItems()
+{
+  if (this->SpillFile == NULL || this->SpillFile->GetNumberOfItems() == 0 || this->StreamBuffer->GetNumberOfItems() == 0)
+  {
+    return false;
+  }
+  // The latest spilled item is the item just before the oldest item in memory (or the same item,
+  // if it was spilled but the new item could not be added)
+  BufferItemUidType latestSpilledUid = this->SpillFile->GetLatestItemUid();
+  BufferItemUidType oldestUidInMemory = this->StreamBuffer->GetOldestItemUidInBuffer();
+  return latestSpilledUid + 1 >= oldestUidInMemory && latestSpilledUid <= this->StreamBuffer->GetLatestItemUidInBuffer();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::ConfigureFlipClipKernel(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+    unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->SelectFlipClipKernel(flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, clipRectangleOrigin, clipRectangleSize);
+}
+
+//----------------------------------------------------------------------------
+PlusFrameFlipClipKernel::KernelType vtkPlusBuffer::SelectFlipClipKernel(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+    unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+    const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize)
+{
+  PlusFrameFlipClipKernel::KernelType previousKernelType = this->FlipClipKernel.GetType();
+  PlusFrameFlipClipKernel::KernelType kernelType = this->FlipClipKernel.Configure(flipInfo, imageType, pixelType, numberOfScalarComponents, inputFrameSizeInPx, clipRectangleOrigin, clipRectangleSize);
+  if (kernelType != previousKernelType)
+  {
+    LOCAL_LOG_DEBUG("vtkPlusBuffer: using " << PlusFrameFlipClipKernel::GetKernelTypeAsString(kernelType) << " kernel for adding frames");
+  }
+  return kernelType;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::DetachSharedSlotFrame(StreamBufferItem* slot)
+{
+  if (!slot->IsFrameShared())
+  {
+    return PLUS_SUCCESS;
+  }
+  DetachedFrame detachedFrame;
+  detachedFrame.FrameViewCount = slot->GetFrameViewCounter();
+  detachedFrame.SizeInBytes = slot->GetFrame().GetFrameSizeInBytes();
+  if (slot->DetachSharedFrame() != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  if (detachedFrame.FrameViewCount != NULL)
+  {
+    this->DetachedFrames.push_back(detachedFrame);
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::ReleaseSharedSlotFrames()
+{
+  for (int i = 0; i < this->StreamBuffer->GetBufferSize(); ++i)
+  {
+    StreamBufferItem* slot = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(i);
+    if (slot == NULL || !slot->IsFrameShared())
+    {
+      continue;
+    }
+    DetachedFrame detachedFrame;
+    detachedFrame.FrameViewCount = slot->GetFrameViewCounter();
+    detachedFrame.SizeInBytes = slot->GetFrame().GetFrameSizeInBytes();
+    slot->ReleaseSharedFrame();
+    if (detachedFrame.FrameViewCount != NULL)
+    {
+      this->DetachedFrames.push_back(detachedFrame);
+    }
+    this->NumberOfDetachedFrames++;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::ReleaseUnreferencedDetachedFrames()
+{
+  // New views cannot be created of detached pixel data, so once its views are deleted it is not referenced anymore
+  for (std::vector<DetachedFrame>::iterator it = this->DetachedFrames.begin(); it != this->DetachedFrames.end();)
+  {
+    if (it->FrameViewCount->load() <= 0)
+    {
+      it = this->DetachedFrames.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::IsNextSlotLockedByViews()
+{
+  StreamBufferItem* nextSlot = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(this->StreamBuffer->GetNextWritableBufferIndex());
+  if (nextSlot == NULL || !nextSlot->IsFrameShared())
+  {
+    return false;
+  }
+  this->ReleaseUnreferencedDetachedFrames();
+  const int maxNumberOfDetachedFrames = (this->MaxNumberOfDetachedFrames < 0 ? this->StreamBuffer->GetBufferSize() : this->MaxNumberOfDetachedFrames);
+  return static_cast<int>(this->DetachedFrames.size()) >= maxNumberOfDetachedFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusBuffer::GetUnreferencedSlotOffset()
+{
+  const int bufferSize = this->StreamBuffer->GetBufferSize();
+  const int nextBufferIndex = this->StreamBuffer->GetNextWritableBufferIndex();
+  for (int offset = 1; offset < bufferSize; ++offset)
+  {
+    StreamBufferItem* slot = this->StreamBuffer->GetBufferItemPointerFromBufferIndex((nextBufferIndex + offset) % bufferSize);
+    if (slot != NULL && !slot->IsFrameShared())
+    {
+      return offset;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::TakeUnreferencedSlotFrame(int bufferIndex, int unreferencedSlotOffset)
+{
+  const int bufferSize = this->StreamBuffer->GetBufferSize();
+  // The items that precede the pending item are in the slots before it, so the slots right after it contain the oldest items
+  const int firstItemOffset = bufferSize - (this->StreamBuffer->GetNumberOfItems() - 1);
+  for (int offset = firstItemOffset; offset <= unreferencedSlotOffset; ++offset)
+  {
+    this->SpillOverwrittenItem((bufferIndex + offset) % bufferSize);
+  }
+  if (unreferencedSlotOffset >= firstItemOffset)
+  {
+    this->NumberOfDiscardedItems += this->StreamBuffer->DiscardOldestItems(unreferencedSlotOffset - firstItemOffset + 1);
+  }
+
+  StreamBufferItem* pendingItem = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
+  StreamBufferItem* unreferencedSlot = this->StreamBuffer->GetBufferItemPointerFromBufferIndex((bufferIndex + unreferencedSlotOffset) % bufferSize);
+  pendingItem->SwapFramePixelData(unreferencedSlot);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetMaxNumberOfDetachedFrames(int maxNumberOfDetachedFrames)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->MaxNumberOfDetachedFrames = maxNumberOfDetachedFrames;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusBuffer::GetMaxNumberOfDetachedFrames()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->MaxNumberOfDetachedFrames;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusBuffer::IsBufferFull()
+{
+  return this->StreamBuffer->GetBufferSize() > 0 && this->StreamBuffer->GetNumberOfItems() >= this->StreamBuffer->GetBufferSize();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SpillOverwrittenItem(int bufferIndex)
+{
+  // The slot still contains the overwritten item, the new item is only copied into it after this call
+  StreamBufferItem* overwrittenItem = this->StreamBuffer->GetBufferItemPointerFromBufferIndex(bufferIndex);
+  if (overwrittenItem == NULL)
+  {
+    return;
+  }
+  BufferItemUidType oldestPinnedUid(0);
+  const bool pinned = this->GetOldestPinnedItemUid(oldestPinnedUid) && oldestPinnedUid <= overwrittenItem->GetUid();
+  if (this->SpillBufferSize == 0)
+  {
+    if (!pinned)
+    {
+      return;
+    }
+    if (this->SpillFile == NULL)
+    {
+      this->SpillFile = vtkPlusBufferSpillFile::New();
+      this->SpillFile->SetInMemory(true);
+    }
+    if (this->SpillFile->GetNumberOfRecords() != static_cast<unsigned int>(this->GetBufferSize()))
+    {
+      this->SpillFile->SetNumberOfRecords(this->GetBufferSize());
+    }
+  }
+
+  if (pinned && this->SpillFile->GetNumberOfItems() > 0 && this->SpillFile->GetNumberOfItems() >= this->SpillFile->GetNumberOfRecords()
+      && this->SpillFile->GetOldestItemUid() >= oldestPinnedUid)
+  {
+    // The spill file is full of pinned items, the oldest one is overwritten
+    this->ExpirePins(this->SpillFile->GetOldestItemUid());
+  }
+  // Errors are reported by the spill file, the item is still added to the buffer
+  if (this->SpillFile->AppendItem(overwrittenItem) != PLUS_SUCCESS && pinned)
+  {
+    this->ExpirePins(overwrittenItem->GetUid());
+  }
+}
+
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetBufferIndexFromTime(const double time, int& bufferIndex)
+{
+  return this->StreamBuffer->GetBufferIndexFromTime(time, bufferIndex);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetAveragedItemsForFiltering(int averagedItemsForFiltering)
+{
+  this->StreamBuffer->SetAveragedItemsForFiltering(averagedItemsForFiltering);
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusBuffer::GetAveragedItemsForFiltering()
+{
+  return this->StreamBuffer->GetAveragedItemsForFiltering();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetTimestampFilteringMethod(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method)
+{
+  this->StreamBuffer->SetTimestampFilteringMethod(method);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType vtkPlusBuffer::GetTimestampFilteringMethod()
+{
+  return this->StreamBuffer->GetTimestampFilteringMethod();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::SetStartTime(double startTime)
+{
+  this->StreamBuffer->SetStartTime(startTime);
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusBuffer::GetStartTime()
+{
+  return this->StreamBuffer->GetStartTime();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable)
+{
+  return this->StreamBuffer->GetTimeStampReportTable(timeStampReportTable);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy data buffer item into a NULL data buffer item!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE && this->HasSpilledItems())
+  {
+    // Items in the spill file are always copied
+    itemStatus = this->SpillFile->GetItem(uid, bufferItem);
+    if (itemStatus != ITEM_OK)
+    {
+      LOCAL_LOG_WARNING("Failed to retrieve data item from the spill file");
+    }
+    return itemStatus;
+  }
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  if (bufferItem->DeepCopy(dataItem) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to copy data item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy data buffer item into a NULL data buffer item!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE && this->HasSpilledItems())
+  {
+    // Items in the spill file are always copied
+    itemStatus = this->SpillFile->GetItem(uid, bufferItem);
+    if (itemStatus != ITEM_OK)
+    {
+      LOCAL_LOG_WARNING("Failed to retrieve data item from the spill file");
+    }
+    return itemStatus;
+  }
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  if (bufferItem->ShallowCopy(dataItem) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to copy data item");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::CopyItemToTrackedFrame(BufferItemUidType uid, igsioTrackedFrame& trackedFrame)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  StreamBufferItem* dataItem = NULL;
+  StreamBufferItem spilledItem;
+  ItemStatus itemStatus = this->StreamBuffer->GetBufferItemPointerFromUid(uid, dataItem);
+  if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE && this->HasSpilledItems())
+  {
+    itemStatus = this->SpillFile->GetItem(uid, &spilledItem);
+    if (itemStatus != ITEM_OK)
+    {
+      LOCAL_LOG_WARNING("Failed to retrieve data item from the spill file");
+      return itemStatus;
+    }
+    dataItem = &spilledItem;
+  }
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+
+  // The copy reuses the image of the tracked frame if it has the same size, therefore the image must not be referenced
+  // by others and must not share the pixel data of a buffer (e.g., if the tracked frame was previously filled by a view)
+  vtkImageData* targetImage = trackedFrame.GetImageData()->GetImage();
+  if (targetImage != NULL && (targetImage->GetReferenceCount() > 1 || StreamBufferItem::IsFrameViewImage(targetImage)))
+  {
+    trackedFrame.GetImageData()->SetImageData(vtkSmartPointer<vtkImageData>::New());
+  }
+  trackedFrame.SetImageData(dataItem->GetFrame());
+
+  // Remove the fields of the frame that the tracked frame was previously filled with
+  std::vector<std::string> previousFieldNames;
+  trackedFrame.GetFrameFieldNameList(previousFieldNames);
+  for (std::vector<std::string>::const_iterator fieldNameIt = previousFieldNames.begin(); fieldNameIt != previousFieldNames.end(); ++fieldNameIt)
+  {
+    trackedFrame.DeleteFrameField(*fieldNameIt);
+  }
+  for (unsigned int fieldIndex = 0; fieldIndex < dataItem->GetNumberOfFrameFields(); ++fieldIndex)
+  {
+    trackedFrame.SetFrameField(dataItem->GetFrameFieldNameAt(fieldIndex), dataItem->GetFrameFieldValueAt(fieldIndex), dataItem->GetFrameFieldFlagsAt(fieldIndex));
+  }
+  trackedFrame.SetTimestamp(dataItem->GetTimestamp(this->StreamBuffer->GetLocalTimeOffsetSec()));
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::DeepCopy(vtkPlusBuffer* buffer)
+{
+  LOG_TRACE("vtkPlusBuffer::DeepCopy");
+
+  if (vtkPlusTransformBuffer::SafeDownCast(buffer) != NULL)
+  {
+    // The items are not stored in the circular buffer of the source
+    this->DeepCopyItems(buffer);
+    return;
+  }
+
+  {
+    // The slots are overwritten by assignment
+    igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+    this->ReleaseSharedSlotFrames();
+  }
+  this->StreamBuffer->DeepCopy(buffer->StreamBuffer);
+  if (buffer->GetFrameSize()[0] != -1 && buffer->GetFrameSize()[1] != -1 && buffer->GetFrameSize()[2] != -1)
+  {
+    this->SetFrameSize(buffer->GetFrameSize());
+  }
+  this->SetPixelType(buffer->GetPixelType());
+  this->SetImageType(buffer->GetImageType());
+  this->SetNumberOfScalarComponents(buffer->GetNumberOfScalarComponents());
+  this->SetImageOrientation(buffer->GetImageOrientation());
+  this->SetBufferSize(buffer->GetBufferSize());
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::DeepCopyItems(vtkPlusBuffer* buffer)
+{
+  this->Clear();
+  this->SetBufferSize(buffer->GetBufferSize());
+  this->SetLocalTimeOffsetSec(buffer->GetLocalTimeOffsetSec());
+  this->SetStartTime(buffer->GetStartTime());
+  this->SetAveragedItemsForFiltering(buffer->GetAveragedItemsForFiltering());
+  this->SetTimestampFilteringMethod(buffer->GetTimestampFilteringMethod());
+  this->SetMaxAllowedTimeDifference(buffer->GetMaxAllowedTimeDifference());
+  if (buffer->GetNumberOfItems() < 1)
+  {
+    return;
+  }
+
+  StreamBufferItem bufferItem;
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  const BufferItemUidType latestUid = buffer->GetLatestItemUidInBuffer();
+  for (BufferItemUidType uid = buffer->GetOldestItemUidInBuffer(); uid <= latestUid; ++uid)
+  {
+    if (buffer->GetStreamBufferItem(uid, &bufferItem) != ITEM_OK || !bufferItem.HasValidTransformData())
+    {
+      continue;
+    }
+    bufferItem.GetMatrix(matrix);
+    igsioFieldMapType customFields = bufferItem.GetFrameFieldMap();
+    // Timestamps are copied in local time, as they are stored in the buffer
+    this->AddTimeStampedItem(matrix, bufferItem.GetStatus(), bufferItem.GetIndex(), bufferItem.GetUnfilteredTimestamp(0), bufferItem.GetFilteredTimestamp(0), &customFields);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::Clear()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
   this->StreamBuffer->Clear();
+  if (this->SpillFile != NULL)
+  {
+    this->SpillFile->Clear();
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -1072,18 +1975,96 @@ PlusStatus vtkPlusBuffer::CopyImagesFromTrackedFrameList(vtkIGSIOTrackedFrameLis
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useCompression /*=false*/)
+PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useCompression /*=false*/, const WriteProgressCallbackType& progressCallback /*=WriteProgressCallbackType()*/)
 {
   LOG_TRACE("vtkPlusBuffer::WriteToSequenceFile");
 
+  // Frames are read from the buffer in chunks, the lock is only held while a frame is read, so acquisition may continue while the file is written.
+  // Only one chunk is kept in memory, so the buffer can be written even if its history is kept in the spill file.
   vtkSmartPointer<vtkIGSIOTrackedFrameList> trackedFrameList = vtkSmartPointer<vtkIGSIOTrackedFrameList>::New();
 
+  const std::string filePath = (vtksys::SystemTools::FileIsFullPath(filename) ? std::string(filename) : vtkPlusConfig::GetInstance()->GetOutputPath(filename));
+  vtkSmartPointer<vtkIGSIOSequenceIOBase> writer;
+  writer.TakeReference(vtkIGSIOSequenceIO::CreateSequenceHandlerForFile(filePath));
+  if (writer.GetPointer() == NULL)
+  {
+    LOCAL_LOG_ERROR("Could not create writer for file: " << filePath);
+    return PLUS_FAIL;
+  }
+  writer->SetUseCompression(useCompression);
+  writer->SetTrackedFrameList(trackedFrameList);
+  writer->SetFileName(filePath);
+
+  // The incomplete file is removed if the writing fails or is cancelled
+  auto discardFile = [&]()
+  {
+    writer->Close();
+    if (vtksys::SystemTools::FileExists(filePath.c_str(), true))
+    {
+      vtksys::SystemTools::RemoveFile(filePath);
+    }
+  };
+
   PlusStatus status = PLUS_SUCCESS;
+  bool headerPrepared(false);
+  bool isData3D(false);
+  int numberOfWrittenFrames(0);
+  auto writeFrames = [&]() -> PlusStatus
+  {
+    if (trackedFrameList->GetNumberOfTrackedFrames() == 0)
+    {
+      return PLUS_SUCCESS;
+    }
+    if (!headerPrepared)
+    {
+      // The frames are written in the orientation of the buffer, without reordering the pixels
+      writer->SetImageOrientationInFile(trackedFrameList->GetImageOrientation());
+      if (writer->PrepareHeader() != PLUS_SUCCESS)
+      {
+        return PLUS_FAIL;
+      }
+      headerPrepared = true;
+    }
+    isData3D = trackedFrameList->GetTrackedFrame(0)->GetFrameSize()[2] > 1;
+    if (writer->AppendImagesToHeader() != PLUS_SUCCESS || writer->WriteImages() != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+    numberOfWrittenFrames += trackedFrameList->GetNumberOfTrackedFrames();
+    trackedFrameList->Clear();
+    return PLUS_SUCCESS;
+  };
 
-  for (BufferItemUidType frameUid = this->GetOldestItemUidInBuffer(); frameUid <= this->GetLatestItemUidInBuffer(); ++frameUid)
+  // Only the items that are in the buffer when the writing starts are written
+  const BufferItemUidType firstUid = this->GetOldestItemUidInBuffer();
+  const BufferItemUidType lastUid = this->GetLatestItemUidInBuffer();
+  unsigned int numberOfOverwrittenItems(0);
+  for (BufferItemUidType frameUid = firstUid; frameUid <= lastUid; ++frameUid)
   {
+    if (progressCallback && !progressCallback(static_cast<double>(frameUid - firstUid) / (lastUid - firstUid + 1)))
+    {
+      LOG_INFO("Writing of sequence file " << filePath << " is cancelled");
+      discardFile();
+      return PLUS_FAIL;
+    }
+
+    if (frameUid < this->GetOldestItemUidInBuffer())
+    {
+      // the item was overwritten by the acquisition since the writing started
+      numberOfOverwrittenItems++;
+      continue;
+    }
+
+    // The pixel data is copied into the tracked frame, so there is no need to copy it from the buffer first
     StreamBufferItem bufferItem;
-    if (this->GetStreamBufferItem(frameUid, &bufferItem) != ITEM_OK)
+    ItemStatus itemStatus = this->GetStreamBufferItemView(frameUid, &bufferItem);
+    if (itemStatus == ITEM_NOT_AVAILABLE_ANYMORE)
+    {
+      // the item was overwritten between the oldest uid check and getting the item
+      numberOfOverwrittenItems++;
+      continue;
+    }
+    if (itemStatus != ITEM_OK)
     {
       LOCAL_LOG_ERROR("Unable to get frame from buffer with UID: " << frameUid);
       status = PLUS_FAIL;
@@ -1120,23 +2101,47 @@ PlusStatus vtkPlusBuffer::WriteToSequenceFile(const char* filename, bool useComp
     trackedFrame->SetFrameField("FrameNumber", frameNumberFieldValue.str());
 
     // Add custom fields
-    const igsioFieldMapType& customFields = bufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator cf = customFields.begin(); cf != customFields.end(); ++cf)
+    for (unsigned int fieldIndex = 0; fieldIndex < bufferItem.GetNumberOfFrameFields(); ++fieldIndex)
     {
-      trackedFrame->SetFrameField(cf->first, cf->second.second, cf->second.first);
+      trackedFrame->SetFrameField(bufferItem.GetFrameFieldNameAt(fieldIndex), bufferItem.GetFrameFieldValueAt(fieldIndex), bufferItem.GetFrameFieldFlagsAt(fieldIndex));
     }
 
     // Add tracked frame to the list
     trackedFrameList->TakeTrackedFrame(trackedFrame);
+
+    if (trackedFrameList->GetNumberOfTrackedFrames() >= WRITE_CHUNK_SIZE && writeFrames() != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_ERROR("Failed to write tracked frames to sequence file: " << filePath);
+      discardFile();
+      return PLUS_FAIL;
+    }
   }
 
-  // Save tracked frames to metafile
-  if (vtkPlusSequenceIO::Write(filename, trackedFrameList, trackedFrameList->GetImageOrientation(), useCompression) != PLUS_SUCCESS)
+  if (writeFrames() != PLUS_SUCCESS || !headerPrepared)
+  {
+    LOCAL_LOG_ERROR("Failed to write tracked frames to sequence file: " << filePath);
+    discardFile();
+    return PLUS_FAIL;
+  }
+  writer->UpdateDimensionsCustomStrings(numberOfWrittenFrames, isData3D);
+  writer->UpdateFieldInImageHeader(writer->GetDimensionSizeString());
+  writer->UpdateFieldInImageHeader(writer->GetDimensionKindsString());
+  if (writer->FinalizeHeader() != PLUS_SUCCESS || writer->Close() != PLUS_SUCCESS)
   {
-    LOCAL_LOG_ERROR("Failed to save tracked frames to sequence metafile!");
+    LOCAL_LOG_ERROR("Failed to finalize sequence file: " << filePath);
+    discardFile();
     return PLUS_FAIL;
   }
 
+  if (numberOfOverwrittenItems > 0)
+  {
+    LOCAL_LOG_WARNING(numberOfOverwrittenItems << " items were overwritten by the acquisition before they could be written to the sequence file: " << filename);
+  }
+  if (progressCallback)
+  {
+    progressCallback(1.0);
+  }
+
   return status;
 }
 
@@ -1152,6 +2157,42 @@ bool vtkPlusBuffer::GetTimeStampReporting()
   return this->StreamBuffer->GetTimeStampReporting();
 }
 
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::SetLockFreeReads(bool enable)
+{
+  this->StreamBuffer->SetLockFreeReads(enable);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkPlusBuffer::GetLockFreeReads()
+{
+  return this->StreamBuffer->GetLockFreeReads();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::Lock()
+{
+  this->StreamBuffer->Lock();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusBuffer::Unlock()
+{
+  this->StreamBuffer->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusBuffer::CreateFilteredTimeStampForItem(unsigned long frameNumber, double unfilteredTimestamp, double& filteredTimestamp, bool& filteredTimestampProbablyValid)
+{
+  return this->StreamBuffer->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBuffer::AddToTimeStampReport(unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp)
+{
+  this->StreamBuffer->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+}
+
 //----------------------------------------------------------------------------
 // Returns the two buffer items that are closest previous and next buffer items relative to the specified time.
 // itemA is the closest item
@@ -1288,6 +2329,13 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromTime(double time, StreamBufferI
   }
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBuffer::GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample)
+{
+  sample.InterpolationRequired = false;
+  return this->GetInterpolatedStreamBufferItemFromTime(time, &sample.Item);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusBuffer::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
@@ -1327,7 +2375,7 @@ ItemStatus vtkPlusBuffer::GetStreamBufferItemFromClosestTime(double time, Stream
   igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
 
   BufferItemUidType itemUid(0);
-  ItemStatus status = this->StreamBuffer->GetItemUidFromTime(time, itemUid);
+  ItemStatus status = this->GetItemUidFromTime(time, itemUid);
   if (status != ITEM_OK)
   {
     switch (status)
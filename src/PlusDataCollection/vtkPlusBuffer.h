@@ -18,6 +18,7 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 #include "igsioCommon.h"
 #include "PlusConfigure.h"
 #include "vtkPlusDataCollectionExport.h"
+#include "PlusFrameFlipClipKernel.h"
 #include "PlusStreamBufferItem.h"
 #include "vtkPlusTimestampedCircularBuffer.h"
 
@@ -26,7 +27,16 @@ See Copyright.txt or http://www.kitware.com/Copyright.htm for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <functional>
+#include <vector>
+
+class igsioTrackedFrame;
+class vtkImageData;
+class vtkPlusBufferSpillFile;
 class vtkPlusDevice;
+class vtkPlusFrameSlab;
+struct PlusPoseInterpolationSample;
 enum ToolStatus;
 
 //class vtkIGSIOTrackedFrameList;
@@ -61,6 +71,33 @@ public:
   /*! Get the size of the buffer */
   virtual int GetBufferSize();
 
+  /*! Get the number of bytes of memory that one item of the buffer occupies (pixel data and item bookkeeping) */
+  virtual unsigned long long GetItemSizeInBytes();
+  /*!
+    Get the number of bytes of memory that is allocated for the items of the buffer. It includes the pixel data of
+    detached slots that is still referenced by views and the mapping of the spill file.
+  */
+  virtual unsigned long long GetAllocatedMemoryInBytes();
+  /*! Get the number of bytes of memory that is occupied by the items that are currently stored in the buffer (spill file is not included) */
+  virtual unsigned long long GetUsedMemoryInBytes();
+
+  /*!
+    Set the number of items that are kept in a memory-mapped spill file on local disk after they are
+    overwritten in the buffer (0 disables spilling, this is the default). Spilled items remain accessible by UID and
+    time (GetStreamBufferItem, GetItemUidFromTime, GetTimeStamp, ...) and they are included in
+    GetOldestItemUidInBuffer and GetNumberOfItems, so a long history can be exported without keeping it in memory.
+    Interpolation and lookup of the previous/next item only use the items in memory.
+    Spilled items are removed when the buffer is cleared or resized.
+  */
+  virtual PlusStatus SetSpillBufferSize(int n);
+  /*! Get the number of items that are kept in the spill file */
+  virtual int GetSpillBufferSize() { return this->SpillBufferSize; }
+
+  /*! Set the directory of the spill file (the output directory is used by default). The spilled items are removed. */
+  void SetSpillDirectory(const std::string& directory);
+  /*! Get the directory of the spill file */
+  std::string GetSpillDirectory() const { return this->SpillDirectory; }
+
   /*!
     Add a frame plus a timestamp to the buffer with frame index.
     If the timestamp is  less than or equal to the previous timestamp,
@@ -149,10 +186,35 @@ public:
     If the timestamp is less than or equal to the previous timestamp, then nothing  will be done.
     If filteredTimestamp argument is undefined then the filtered timestamp will be computed from the input unfiltered timestamp.
   */
-  PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
+  virtual PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
+
+  /*!
+    Add a matrix plus status to the list with the specified filtered timestamp. Unlike AddTimeStampedItem, the timestamp filter
+    is not used and the item is not added to the timestamp report. For callers that compute the filtered timestamp and report
+    the item themselves (see vtkPlusDevice::ToolTimeStampedUpdate).
+  */
+  virtual PlusStatus AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields = NULL);
 
   /*! Get a frame with the specified frame uid from the buffer */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*!
+    Get a frame with the specified frame uid from the buffer without copying the pixel data.
+    The returned item references the pixel data of the buffer slot, which must be treated as read-only.
+    The view is counted until its image is deleted (see StreamBufferItem::ShallowCopy): while it exists the buffer
+    does not write into that pixel data, but moves the slot to newly allocated memory when the slot is reused
+    (see GetNumberOfDetachedFrames). If MaxNumberOfDetachedFrames slots are detached already then the writer skips ahead
+    to the next slot whose pixel data is not referenced and removes the older items up to that slot (see GetNumberOfDiscardedItems).
+    New frames are skipped (AddItem returns PLUS_FAIL) only if the pixel data of all slots is referenced (see GetNumberOfSkippedFrames).
+    Readers that keep frames for longer than a short processing step should use GetStreamBufferItem instead.
+  */
+  virtual ItemStatus GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*!
+    Copy the frame, the custom fields and the timestamp of the item with the specified uid into a tracked frame.
+    The pixel data is copied once, directly from the buffer slot. The image of the tracked frame is reused
+    if it has the same size and it is not referenced by others, so a tracked frame can be refilled without reallocating the image.
+    The fields of the tracked frame are replaced by the fields of the item.
+  */
+  virtual ItemStatus CopyItemToTrackedFrame(BufferItemUidType uid, igsioTrackedFrame& trackedFrame);
   /*! Get the most recent frame from the buffer */
   virtual ItemStatus GetLatestStreamBufferItem(StreamBufferItem* bufferItem)
   {
@@ -165,6 +227,13 @@ public:
   };
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, DataItemTemporalInterpolationType interpolation);
+  /*!
+    Get the data that is needed for computing the interpolated item at the specified time. The result is the same as
+    GetStreamBufferItemFromTime with INTERPOLATED mode after the sample is processed by PlusPoseInterpolator.
+    This allows interpolating the poses of multiple tools at once. The default implementation returns the final
+    interpolated item, without requiring further interpolation.
+  */
+  virtual ItemStatus GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample);
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
   /*! Get latest timestamp in the buffer */
@@ -173,6 +242,22 @@ public:
   /*! Get oldest timestamp in the buffer */
   virtual ItemStatus GetOldestTimeStamp(double& oldestTimestamp);
 
+  /*!
+    Block the calling thread until the buffer contains an item with a timestamp newer than the specified timestamp
+    (in global time) or the timeout expires. Returns immediately if there is already a newer item.
+    Returns PLUS_FAIL if no newer item was added within the timeout.
+  */
+  virtual PlusStatus WaitForItemNewerThan(double timestamp, double timeoutSec);
+
+  /*!
+    Register a function that is called in the thread that adds an item, after the item is available for reading
+    and the buffer lock is released. The function must return quickly, it may read this buffer but it must not
+    add or remove callbacks. Returns an id for RemoveNewItemCallback.
+  */
+  unsigned long AddNewItemCallback(const vtkPlusTimestampedCircularBuffer::NewItemCallbackType& callback);
+  /*! Unregister a function that was registered by AddNewItemCallback */
+  void RemoveNewItemCallback(unsigned long callbackId);
+
   /*! Get buffer item timestamp */
   virtual ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp);
 
@@ -192,32 +277,48 @@ public:
     Given a timestamp, compute the nearest buffer index
     This assumes that the times monotonically increase
   */
-  ItemStatus GetBufferIndexFromTime(const double time, int& bufferIndex);
+  virtual ItemStatus GetBufferIndexFromTime(const double time, int& bufferIndex);
 
   /*! Get buffer item unique ID */
-  virtual BufferItemUidType GetOldestItemUidInBuffer()
-  {
-    return this->StreamBuffer->GetOldestItemUidInBuffer();
-  }
+  virtual BufferItemUidType GetOldestItemUidInBuffer();
   virtual BufferItemUidType GetLatestItemUidInBuffer()
   {
     return this->StreamBuffer->GetLatestItemUidInBuffer();
   }
-  virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid)
-  {
-    return this->StreamBuffer->GetItemUidFromTime(time, uid);
-  }
+  /*!
+    Get the UID of the item that is the closest to the specified time. If searchHintUid is specified then the search
+    starts from that item and it is updated to the found item (see vtkPlusTimestampedCircularBuffer::GetItemUidFromTime).
+  */
+  virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL);
+  /*!
+    Get the UID of the oldest item that was acquired after the specified time, found by time lookup
+    (the oldest item if all items are newer). Returns ITEM_NOT_AVAILABLE_YET if there is no such item.
+  */
+  virtual ItemStatus GetFirstItemUidAfterTime(double time, BufferItemUidType& uid);
+
+  /*!
+    Keep all the items that are currently in the buffer available until UnpinItems is called with the returned UID,
+    even if new items are added in the meantime. This allows reading several buffers as a consistent snapshot.
+    Multiple readers may pin the buffer at the same time. The pinned items that are overwritten in the circular buffer
+    remain accessible from the spill file, like the spilled items (see SetSpillBufferSize). If spilling is disabled then
+    they are kept in memory, up to the buffer size, until the buffer is unpinned. vtkPlusTransformBuffer keeps the pinned
+    items by growing temporarily up to a limit.
+  */
+  virtual BufferItemUidType PinItems();
+  /*!
+    Allow discarding the items that were kept by the PinItems call that returned the specified UID.
+    Returns PLUS_FAIL if pinned items had to be discarded while the pin was held, in this case the reads
+    of the pinned items may have failed or may have found newer items.
+  */
+  virtual PlusStatus UnpinItems(BufferItemUidType pinnedItemUid);
 
   /*! Set the local time offset in seconds (global = local + offset) */
   virtual void SetLocalTimeOffsetSec(double offsetSec);
   /*! Get the local time offset in seconds (global = local + offset) */
   virtual double GetLocalTimeOffsetSec();
 
-  /*! Get the number of items in the buffer */
-  virtual int GetNumberOfItems()
-  {
-    return this->StreamBuffer->GetNumberOfItems();
-  }
+  /*! Get the number of items in the buffer (including the items in the spill file) */
+  virtual int GetNumberOfItems();
 
   /*!
     Get the frame rate from the buffer based on the number of frames in the buffer and the elapsed time.
@@ -258,6 +359,10 @@ public:
 
   virtual int GetAveragedItemsForFiltering();
 
+  /*! Set the method that is used for computing filtered timestamps from the unfiltered timestamps */
+  virtual void SetTimestampFilteringMethod(vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method);
+  virtual vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType GetTimestampFilteringMethod();
+
   /*! Set recording start time */
   virtual void SetStartTime(double startTime);
   /*! Get recording start time */
@@ -271,6 +376,50 @@ public:
   /*! If TimeStampReporting is enabled then all filtered and unfiltered timestamp values will be saved in a table for diagnostic purposes. */
   bool GetTimeStampReporting();
 
+  /*!
+    If LockFreeReads is enabled then timestamp and UID queries do not acquire the buffer lock and never block the acquisition thread.
+    See vtkPlusTimestampedCircularBuffer::SetLockFreeReads.
+  */
+  void SetLockFreeReads(bool enable);
+  /*! Get if timestamp and UID queries are performed without acquiring the buffer lock */
+  bool GetLockFreeReads();
+
+  /*!
+    Acquire the buffer lock. Other threads cannot add or read items until Unlock is called
+    (except lock-free reads, see SetLockFreeReads). The lock is recursive.
+  */
+  void Lock();
+  /*! Release the buffer lock */
+  void Unlock();
+
+  /*!
+    Compute the filtered timestamp of an item that is about to be added, from its frame number and unfiltered timestamp,
+    using the timestamp filter of this buffer. See vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem.
+  */
+  PlusStatus CreateFilteredTimeStampForItem(unsigned long frameNumber, double unfilteredTimestamp, double& filteredTimestamp, bool& filteredTimestampProbablyValid);
+
+  /*! Add an item whose filtered timestamp was not computed by the timestamp filter of this buffer to the timestamp report */
+  void AddToTimeStampReport(unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp);
+
+  /*!
+    If ContiguousFrameMemory is enabled then the pixel data of all frames is allocated in one 64-byte aligned memory block
+    (see vtkPlusFrameSlab) instead of allocating each frame separately. Changing the buffer size or frame format reallocates the whole block at once.
+  */
+  PlusStatus SetContiguousFrameMemory(bool enable);
+  /*! Get if the pixel data of all frames is allocated in one memory block */
+  vtkGetMacro(ContiguousFrameMemory, bool);
+
+  /*! If HugePageFrameMemory is enabled then contiguous frame memory is backed by huge pages (if supported by the system) */
+  PlusStatus SetHugePageFrameMemory(bool enable);
+  /*! Get if contiguous frame memory is backed by huge pages */
+  vtkGetMacro(HugePageFrameMemory, bool);
+
+  /*!
+    Touch all memory pages of the contiguous frame memory, so that adding the first frames does not cause page faults.
+    Does nothing if ContiguousFrameMemory is disabled. Called by vtkPlusDataCollector::Connect after the buffer memory budget is enforced.
+  */
+  void PrefaultFrameMemory();
+
   /*! Set the frame size in pixel  */
   PlusStatus SetFrameSize(unsigned int x, unsigned int y, unsigned int z, bool allocateFrames = true);
   /*! Set the frame size in pixel  */
@@ -299,6 +448,15 @@ public:
   /*! Get the image orientation (MF, MN, ...) */
   vtkGetMacro(ImageOrientation, US_IMAGE_ORIENTATION);
 
+  /*!
+    Select the flip and clip kernel for raw input frames of the specified format, so that it is ready before the first frame
+    is added. Called when the input frame size of the data source is set. Adding a frame of a different format (the orientation
+    and pixel format are specified for each frame) selects the kernel again.
+  */
+  void ConfigureFlipClipKernel(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+                               unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+                               const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize);
+
   /*! Get the number of bytes per scalar component */
   int GetNumberOfBytesPerScalar();
 
@@ -311,12 +469,42 @@ public:
   /*! Copy images from a tracked frame buffer. It is useful when data is stored in a metafile and the data is needed as a vtkPlusDataBuffer. */
   PlusStatus CopyImagesFromTrackedFrameList(vtkIGSIOTrackedFrameList* sourceTrackedFrameList, TIMESTAMP_FILTERING_OPTION timestampFiltering, bool copyFrameFields);
 
-  /*! Dump the current state of the video buffer to metafile */
-  virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
+  /*!
+    Called while the buffer is written to file with the fraction of the items that are already written (between 0 and 1).
+    If it returns false then the writing is cancelled.
+  */
+  typedef std::function<bool(double)> WriteProgressCallbackType;
+
+  /*!
+    Dump the current state of the video buffer to metafile. The items are read and written to the file in chunks, while the
+    acquisition continues, so only one chunk is kept in memory (including the items that are spilled to disk). A relative filename
+    is relative to the output directory. If the writing fails or is cancelled by the progress callback then the incomplete file
+    is removed and PLUS_FAIL is returned.
+  */
+  virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false, const WriteProgressCallbackType& progressCallback = WriteProgressCallbackType());
 
   vtkGetStringMacro(DescriptiveName);
   vtkSetStringMacro(DescriptiveName);
 
+  /*! Number of times a buffer slot had to be moved to new memory because its pixel data was still referenced by a view */
+  vtkGetMacro(NumberOfDetachedFrames, unsigned long);
+
+  /*! Number of frames that were not added because the pixel data of all slots was referenced by views and no more slots could be detached */
+  vtkGetMacro(NumberOfSkippedFrames, unsigned long);
+
+  /*! Number of items that were removed before they would have been overwritten, because the writer skipped ahead to a slot that was not referenced by views */
+  vtkGetMacro(NumberOfDiscardedItems, unsigned long);
+
+  /*!
+    Set the maximum number of detached pixel data that views may reference at the same time (see GetStreamBufferItemView).
+    Limits the memory that slow readers can make the buffer allocate: if the limit is reached then the writer skips ahead
+    to the next slot that is not referenced, until the views are released (see GetStreamBufferItemView). 0 means that slots are never detached.
+    Negative value means that the limit is the buffer size (default).
+  */
+  void SetMaxNumberOfDetachedFrames(int maxNumberOfDetachedFrames);
+  /*! Get the maximum number of detached pixel data that views may reference at the same time (negative: the buffer size) */
+  int GetMaxNumberOfDetachedFrames();
+
 protected:
   vtkPlusBuffer();
   ~vtkPlusBuffer();
@@ -346,6 +534,92 @@ protected:
   /*! Get tracker buffer item from the closest timestamp */
   virtual ItemStatus GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem);
 
+  /*!
+    Make this buffer into a copy of a buffer that stores its items differently (e.g., vtkPlusTransformBuffer).
+    Only the items that contain a transform are copied, item UIDs are not preserved.
+  */
+  void DeepCopyItems(vtkPlusBuffer* buffer);
+
+  /*! Returns true if the spill file contains items that directly precede the items in memory. The caller must hold the lock. */
+  bool HasSpilledItems();
+
+  /*! Register a pin of the items from the specified UID, see PinItems. The caller must hold the lock. */
+  void AddPin(BufferItemUidType pinnedItemUid);
+
+  /*!
+    Remove a pin that was registered by AddPin. Returns false if the items are not pinned from the specified UID,
+    expired is set to true if items that the pin needed had to be discarded. The caller must hold the lock.
+  */
+  bool RemovePin(BufferItemUidType pinnedItemUid, bool& expired);
+
+  /*!
+    Get the oldest UID that is pinned by any reader whose pin has not failed. Returns false if the buffer is not pinned.
+    The caller must hold the lock.
+  */
+  bool GetOldestPinnedItemUid(BufferItemUidType& uid) const;
+
+  /*! Mark the pins that need the specified item or older items as failed, before the item is discarded. The caller must hold the lock. */
+  void ExpirePins(BufferItemUidType discardedItemUid);
+
+  /*!
+    Move a slot whose pixel data is referenced by a view to newly allocated memory. The previous pixel data
+    is accounted for in DetachedFrames until its views are deleted. The caller must hold the lock.
+  */
+  PlusStatus DetachSharedSlotFrame(StreamBufferItem* slot);
+
+  /*! Same as ConfigureFlipClipKernel, returns the selected kernel. The caller must hold the lock. */
+  PlusFrameFlipClipKernel::KernelType SelectFlipClipKernel(const igsioVideoFrame::FlipInfoType& flipInfo, US_IMAGE_TYPE imageType, igsioCommon::VTKScalarPixelType pixelType,
+      unsigned int numberOfScalarComponents, const FrameSizeType& inputFrameSizeInPx,
+      const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize);
+
+  /*!
+    Replace the pixel data of all slots that are referenced by views by empty images, before the slots are reallocated
+    or overwritten by a copy. The previous pixel data is accounted for in DetachedFrames until its views are deleted.
+    These configuration changes cannot skip slots, therefore MaxNumberOfDetachedFrames does not apply.
+    The caller must hold the lock.
+  */
+  void ReleaseSharedSlotFrames();
+
+  /*! Forget the detached pixel data that is not referenced by any view anymore. The caller must hold the lock. */
+  void ReleaseUnreferencedDetachedFrames();
+
+  /*!
+    Returns true if the new frame cannot be written to the next slot, because its slot is referenced by a view and
+    MaxNumberOfDetachedFrames pixel data are detached already. The caller must hold the lock.
+  */
+  bool IsNextSlotLockedByViews();
+
+  /*!
+    Returns the number of slots from the next writable slot to the first following slot whose pixel data is not referenced
+    by views, or -1 if the pixel data of all slots is referenced. The caller must hold the lock.
+  */
+  int GetUnreferencedSlotOffset();
+
+  /*!
+    Give the pixel data of the slot that is unreferencedSlotOffset slots after the slot of the pending item (bufferIndex)
+    to the pending item, and the pixel data that is referenced by views to that slot, without allocating memory.
+    The items in the slots up to that slot are the oldest items, they are spilled and removed from the buffer.
+    The caller must hold the lock since the item was prepared.
+  */
+  void TakeUnreferencedSlotFrame(int bufferIndex, int unreferencedSlotOffset);
+
+  /*! Returns true if the next item overwrites the oldest item. The caller must hold the lock. */
+  bool IsBufferFull();
+
+  /*!
+    Store the item that is overwritten by the new item in the spill file. If spilling is disabled then only pinned items
+    are stored, in a spill file that is kept in memory (see PinItems). Called after the new item was prepared in the slot (so items that are rejected, e.g., because of their timestamp,
+    do not spill anything), before the new item is copied into the slot. The caller must hold the lock.
+  */
+  void SpillOverwrittenItem(int bufferIndex);
+
+  /*!
+    Replace the frame fields of a new item by the custom fields. The field names are interned in the field name table of the buffer,
+    the memory of the previous field values of the item is reused. Returns true if the name of any field contains "Transform".
+    The caller must hold the lock.
+  */
+  bool SetItemCustomFields(StreamBufferItem* item, const igsioFieldMapType* customFields);
+
 protected:
   /*! Image frame size in pixel */
   FrameSizeType FrameSize;
@@ -371,6 +645,65 @@ protected:
 
   char* DescriptiveName;
 
+  /*! Number of times a buffer slot had to be moved to new memory because its pixel data was still referenced by a view */
+  unsigned long NumberOfDetachedFrames;
+
+  /*! Number of frames that were skipped because the pixel data of all slots was referenced by views and no more slots could be detached */
+  unsigned long NumberOfSkippedFrames;
+
+  /*! Number of items that were removed early, because the writer skipped ahead to a slot that was not referenced by views */
+  unsigned long NumberOfDiscardedItems;
+
+  /*! Maximum number of detached pixel data that views may reference at the same time (negative: the buffer size) */
+  int MaxNumberOfDetachedFrames;
+
+  /*! Previous pixel data of a detached slot, accounted for until its views are deleted */
+  struct DetachedFrame
+  {
+    std::shared_ptr<const std::atomic<int> > FrameViewCount;
+    unsigned long long SizeInBytes;
+  };
+  /*! Previous pixel data of detached slots that are still referenced by views. Access requires the lock. */
+  std::vector<DetachedFrame> DetachedFrames;
+
+  /*!
+    Copies raw input frames into the buffer for the common flip and clip settings. It is selected when the input frame size
+    is set (see ConfigureFlipClipKernel) and only selected again if the input format or the flip and clip settings change.
+    Access requires the lock.
+  */
+  PlusFrameFlipClipKernel FlipClipKernel;
+
+  /*! If enabled then the pixel data of all frames is allocated in FrameSlab */
+  bool ContiguousFrameMemory;
+
+  /*! If enabled then FrameSlab is backed by huge pages */
+  bool HugePageFrameMemory;
+
+  /*! Memory block that holds the pixel data of all frames (NULL if ContiguousFrameMemory is disabled) */
+  vtkPlusFrameSlab* FrameSlab;
+
+  /*! Number of items kept in the spill file */
+  int SpillBufferSize;
+  /*! Directory of the spill file, the output directory is used if empty */
+  std::string SpillDirectory;
+  /*!
+    Items that have been overwritten in the circular buffer (NULL if spilling is disabled and no pinned item
+    has been overwritten yet). If spilling is disabled then it is kept in memory and only holds pinned items.
+  */
+  vtkPlusBufferSpillFile* SpillFile;
+
+  /*! Oldest UID kept by an active pin, and whether items that it needs had to be discarded */
+  struct Pin
+  {
+    BufferItemUidType ItemUid;
+    bool Expired;
+  };
+  /*! Active pins (the capacity of the vector is reused) */
+  std::vector<Pin> Pins;
+
+  /*! Assigns keys to the custom frame field names, shared by all items of the buffer */
+  std::shared_ptr<PlusFrameFieldNameTable> FrameFieldNames;
+
 private:
   vtkPlusBuffer(const vtkPlusBuffer&);
   void operator=(const vtkPlusBuffer&);
@@ -0,0 +1,62 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusBufferLogMacros_h
+#define __vtkPlusBufferLogMacros_h
+
+/*!
+  \file vtkPlusBufferLogMacros.h
+  \brief Logging macros of the buffer implementations that prefix the message with the descriptive name of the buffer
+
+  The macros can be used in the member functions of vtkPlusBuffer and its subclasses. Only to be included in .cxx files.
+
+  \ingroup PlusLibDataCollection
+*/
+
+#define LOCAL_LOG_ERROR(msg) \
+{ \
+  std::ostringstream msgStream; \
+  if( this->DescriptiveName == NULL ) \
+  { \
+    msgStream << " " << msg << std::ends; \
+  } \
+  else \
+  { \
+    msgStream << this->DescriptiveName << ": " << msg << std::ends; \
+  } \
+  std::string finalStr(msgStream.str()); \
+  LOG_ERROR(finalStr); \
+}
+#define LOCAL_LOG_WARNING(msg) \
+{ \
+  std::ostringstream msgStream; \
+  if( this->DescriptiveName == NULL ) \
+  { \
+    msgStream << " " << msg << std::ends; \
+  } \
+  else \
+  { \
+    msgStream << this->DescriptiveName << ": " << msg << std::ends; \
+  } \
+  std::string finalStr(msgStream.str()); \
+  LOG_WARNING(finalStr); \
+}
+#define LOCAL_LOG_DEBUG(msg) \
+{ \
+  std::ostringstream msgStream; \
+  if( this->DescriptiveName == NULL ) \
+  { \
+    msgStream << " " << msg << std::ends; \
+  } \
+  else \
+  { \
+    msgStream << this->DescriptiveName << ": " << msg << std::ends; \
+  } \
+  std::string finalStr(msgStream.str()); \
+  LOG_DEBUG(finalStr); \
+}
+
+#endif
@@ -0,0 +1,559 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBufferSpillFile.h"
+
+// IGSIO includes
+#include <igsioVideoFrame.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+  const unsigned long RECORD_ALIGNMENT_BYTES = 64;
+  const unsigned int DEFAULT_FIELD_CAPACITY_BYTES = 4096;
+
+  /*! Fixed part of a record, followed by the serialized frame fields and the pixel data */
+  struct SpillRecordHeader
+  {
+    BufferItemUidType Uid;
+    unsigned long long Index;
+    double FilteredTimestamp;
+    double UnfilteredTimestamp;
+    double Matrix[16];
+    int Status;
+    int ValidTransformData;
+    unsigned int FrameSize[3];
+    int PixelType;
+    unsigned int NumberOfScalarComponents;
+    int ImageType;
+    int ImageOrientation;
+    unsigned int FrameSizeInBytes;
+    unsigned int FieldsSizeInBytes;
+  };
+
+  //----------------------------------------------------------------------------
+  unsigned long RoundUp(unsigned long value, unsigned long alignment)
+  {
+    return ((value + alignment - 1) / alignment) * alignment;
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned int GetFieldHeaderOffset()
+  {
+    return RoundUp(sizeof(SpillRecordHeader), RECORD_ALIGNMENT_BYTES);
+  }
+
+  //----------------------------------------------------------------------------
+  void WriteUnsigned(unsigned char*& destination, unsigned int value)
+  {
+    memcpy(destination, &value, sizeof(value));
+    destination += sizeof(value);
+  }
+
+  //----------------------------------------------------------------------------
+  unsigned int ReadUnsigned(const unsigned char*& source)
+  {
+    unsigned int value(0);
+    memcpy(&value, source, sizeof(value));
+    source += sizeof(value);
+    return value;
+  }
+
+  //----------------------------------------------------------------------------
+  // Serialized fields: (flags, name length, value length, name, value) for each field
+  // Returns false if some fields did not fit in the available space
+  bool SerializeFields(const StreamBufferItem& item, unsigned char* destination, unsigned int capacityInBytes, unsigned int& sizeInBytes)
+  {
+    bool allFieldsStored = true;
+    unsigned char* position = destination;
+    for (unsigned int fieldIndex = 0; fieldIndex < item.GetNumberOfFrameFields(); ++fieldIndex)
+    {
+      const std::string& name = item.GetFrameFieldNameAt(fieldIndex);
+      const std::string& value = item.GetFrameFieldValueAt(fieldIndex);
+      unsigned long fieldSizeInBytes = 3 * sizeof(unsigned int) + name.size() + value.size();
+      if ((position - destination) + fieldSizeInBytes > capacityInBytes)
+      {
+        allFieldsStored = false;
+        continue;
+      }
+      WriteUnsigned(position, static_cast<unsigned int>(item.GetFrameFieldFlagsAt(fieldIndex)));
+      WriteUnsigned(position, static_cast<unsigned int>(name.size()));
+      WriteUnsigned(position, static_cast<unsigned int>(value.size()));
+      memcpy(position, name.data(), name.size());
+      position += name.size();
+      memcpy(position, value.data(), value.size());
+      position += value.size();
+    }
+    sizeInBytes = static_cast<unsigned int>(position - destination);
+    return allFieldsStored;
+  }
+
+  //----------------------------------------------------------------------------
+  void DeserializeFields(const unsigned char* source, unsigned int sizeInBytes, StreamBufferItem& item)
+  {
+    item.ClearFrameFields();
+    const unsigned char* end = source + sizeInBytes;
+    while (source < end)
+    {
+      unsigned int flags = ReadUnsigned(source);
+      unsigned int nameSize = ReadUnsigned(source);
+      unsigned int valueSize = ReadUnsigned(source);
+      std::string name(reinterpret_cast<const char*>(source), nameSize);
+      source += nameSize;
+      std::string value(reinterpret_cast<const char*>(source), valueSize);
+      source += valueSize;
+      item.SetFrameField(name, value, static_cast<igsioFrameFieldFlags>(flags));
+    }
+  }
+
+#ifndef _WIN32
+  //----------------------------------------------------------------------------
+  // Allocate the disk blocks of the whole file. Writing to an unallocated page of a shared mapping raises SIGBUS
+  // when the disk is full, while a failed allocation here can be reported as an error.
+  // Returns 0 on success, the error number otherwise.
+  int ReserveFileSpace(int fileDescriptor, unsigned long long sizeInBytes)
+  {
+#ifdef __APPLE__
+    fstore_t store;
+    memset(&store, 0, sizeof(store));
+    store.fst_flags = F_ALLOCATEALL;
+    store.fst_posmode = F_PEOFPOSMODE;
+    store.fst_length = static_cast<off_t>(sizeInBytes);
+    if (fcntl(fileDescriptor, F_PREALLOCATE, &store) == -1)
+    {
+      return errno;
+    }
+    return (ftruncate(fileDescriptor, static_cast<off_t>(sizeInBytes)) == 0 ? 0 : errno);
+#else
+    int result(0);
+    do
+    {
+      result = posix_fallocate(fileDescriptor, 0, static_cast<off_t>(sizeInBytes));
+    }
+    while (result == EINTR);
+    return result;
+#endif
+  }
+#endif
+}
+
+vtkStandardNewMacro(vtkPlusBufferSpillFile);
+
+//----------------------------------------------------------------------------
+vtkPlusBufferSpillFile::vtkPlusBufferSpillFile()
+  : NumberOfRecords(0)
+  , InMemory(false)
+  , FieldCapacityInBytes(DEFAULT_FIELD_CAPACITY_BYTES)
+  , NumberOfItems(0)
+  , LatestItemUid(0)
+  , FrameCapacityInBytes(0)
+  , RecordSizeInBytes(0)
+  , FileSizeInBytes(0)
+  , Memory(NULL)
+#ifdef _WIN32
+  , FileHandle(INVALID_HANDLE_VALUE)
+  , MappingHandle(NULL)
+#else
+  , FileDescriptor(-1)
+#endif
+  , FieldsTruncatedWarningLogged(false)
+  , EncodedFrameWarningLogged(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusBufferSpillFile::~vtkPlusBufferSpillFile()
+{
+  this->Close();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfRecords: " << this->NumberOfRecords << std::endl;
+  os << indent << "Directory: " << this->Directory << std::endl;
+  os << indent << "InMemory: " << (this->InMemory ? "TRUE" : "FALSE") << std::endl;
+  os << indent << "FileName: " << this->FileName << std::endl;
+  os << indent << "RecordSizeInBytes: " << this->RecordSizeInBytes << std::endl;
+  os << indent << "FileSizeInBytes: " << this->FileSizeInBytes << std::endl;
+  os << indent << "NumberOfItems: " << this->NumberOfItems << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::SetNumberOfRecords(unsigned int numberOfRecords)
+{
+  this->Close();
+  this->NumberOfRecords = numberOfRecords;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::SetDirectory(const std::string& directory)
+{
+  this->Close();
+  this->Directory = directory;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::SetInMemory(bool inMemory)
+{
+  this->Close();
+  this->InMemory = inMemory;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBufferSpillFile::Open(unsigned long frameSizeInBytes)
+{
+  this->Close();
+  if (this->NumberOfRecords == 0)
+  {
+    return PLUS_FAIL;
+  }
+
+  this->FrameCapacityInBytes = RoundUp(frameSizeInBytes, RECORD_ALIGNMENT_BYTES);
+  this->RecordSizeInBytes = GetFieldHeaderOffset() + RoundUp(this->FieldCapacityInBytes, RECORD_ALIGNMENT_BYTES) + this->FrameCapacityInBytes;
+  unsigned long long fileSizeInBytes = static_cast<unsigned long long>(this->RecordSizeInBytes) * this->NumberOfRecords;
+
+  if (this->InMemory)
+  {
+    // Physical memory is only used for the pages that are written
+    void* memory(NULL);
+#ifdef _WIN32
+    memory = VirtualAlloc(NULL, static_cast<SIZE_T>(fileSizeInBytes), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* mapped = mmap(NULL, static_cast<size_t>(fileSizeInBytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped != MAP_FAILED)
+    {
+      memory = mapped;
+    }
+#endif
+    if (memory == NULL)
+    {
+      LOG_ERROR("Failed to reserve " << fileSizeInBytes << " bytes of memory for buffer items");
+      return PLUS_FAIL;
+    }
+    this->Memory = static_cast<unsigned char*>(memory);
+    this->FileSizeInBytes = fileSizeInBytes;
+    return PLUS_SUCCESS;
+  }
+
+  // The file name only has to be unique while the file is open
+  static std::atomic<unsigned int> fileCounter(0);
+  std::ostringstream fileName;
+#ifdef _WIN32
+  fileName << "PlusBufferSpill_" << GetCurrentProcessId() << "_" << fileCounter++ << ".bin";
+#else
+  fileName << "PlusBufferSpill_" << getpid() << "_" << fileCounter++ << ".bin";
+#endif
+  if (this->Directory.empty())
+  {
+    this->FileName = vtkPlusConfig::GetInstance()->GetOutputPath(fileName.str());
+  }
+  else
+  {
+    this->FileName = this->Directory + "/" + fileName.str();
+  }
+
+  void* memory(NULL);
+#ifdef _WIN32
+  // The file is deleted when the last handle is closed, even if the process is terminated
+  this->FileHandle = CreateFileA(this->FileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                 FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+  if (this->FileHandle != INVALID_HANDLE_VALUE)
+  {
+    // Extend the file before mapping it, so that a full disk is reported here instead of failing on a write to the mapping
+    LARGE_INTEGER requestedSize;
+    requestedSize.QuadPart = static_cast<LONGLONG>(fileSizeInBytes);
+    LARGE_INTEGER actualSize;
+    actualSize.QuadPart = 0;
+    if (SetFilePointerEx(this->FileHandle, requestedSize, NULL, FILE_BEGIN) && SetEndOfFile(this->FileHandle)
+        && GetFileSizeEx(this->FileHandle, &actualSize) && actualSize.QuadPart == requestedSize.QuadPart)
+    {
+      this->MappingHandle = CreateFileMappingA(this->FileHandle, NULL, PAGE_READWRITE, 0, 0, NULL);
+    }
+    else
+    {
+      LOG_ERROR("Failed to reserve " << fileSizeInBytes << " bytes for the buffer spill file " << this->FileName << " (error " << GetLastError() << ")");
+    }
+    if (this->MappingHandle != NULL)
+    {
+      memory = MapViewOfFile(this->MappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(fileSizeInBytes));
+    }
+  }
+#else
+  this->FileDescriptor = open(this->FileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (this->FileDescriptor >= 0)
+  {
+    // Remove the directory entry right away, the file is deleted when it is unmapped or the process exits
+    unlink(this->FileName.c_str());
+    int reserveError = ReserveFileSpace(this->FileDescriptor, fileSizeInBytes);
+    if (reserveError != 0)
+    {
+      LOG_ERROR("Failed to reserve " << fileSizeInBytes << " bytes for the buffer spill file " << this->FileName << ": " << strerror(reserveError));
+    }
+    else
+    {
+      void* mapped = mmap(NULL, static_cast<size_t>(fileSizeInBytes), PROT_READ | PROT_WRITE, MAP_SHARED, this->FileDescriptor, 0);
+      if (mapped != MAP_FAILED)
+      {
+        memory = mapped;
+      }
+    }
+  }
+#endif
+
+  if (memory == NULL)
+  {
+    LOG_ERROR("Failed to create a " << fileSizeInBytes << " byte buffer spill file: " << this->FileName);
+    this->Close();
+    return PLUS_FAIL;
+  }
+
+  this->Memory = static_cast<unsigned char*>(memory);
+  this->FileSizeInBytes = fileSizeInBytes;
+  LOG_DEBUG("Buffer spill file created: " << this->FileName << " (" << this->NumberOfRecords << " items, " << fileSizeInBytes << " bytes)");
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::Close()
+{
+#ifdef _WIN32
+  if (this->Memory != NULL && this->InMemory)
+  {
+    VirtualFree(this->Memory, 0, MEM_RELEASE);
+  }
+  else if (this->Memory != NULL)
+  {
+    UnmapViewOfFile(this->Memory);
+  }
+  if (this->MappingHandle != NULL)
+  {
+    CloseHandle(this->MappingHandle);
+    this->MappingHandle = NULL;
+  }
+  if (this->FileHandle != INVALID_HANDLE_VALUE)
+  {
+    CloseHandle(this->FileHandle);
+    this->FileHandle = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (this->Memory != NULL)
+  {
+    munmap(this->Memory, static_cast<size_t>(this->FileSizeInBytes));
+  }
+  if (this->FileDescriptor >= 0)
+  {
+    close(this->FileDescriptor);
+    this->FileDescriptor = -1;
+  }
+#endif
+  this->Memory = NULL;
+  this->FileSizeInBytes = 0;
+  this->FrameCapacityInBytes = 0;
+  this->RecordSizeInBytes = 0;
+  this->FileName.clear();
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusBufferSpillFile::Clear()
+{
+  this->NumberOfItems = 0;
+  this->LatestItemUid = 0;
+}
+
+//----------------------------------------------------------------------------
+unsigned char* vtkPlusBufferSpillFile::GetRecord(BufferItemUidType uid, ItemStatus& status)
+{
+  if (this->NumberOfItems == 0 || uid > this->LatestItemUid)
+  {
+    status = ITEM_NOT_AVAILABLE_YET;
+    return NULL;
+  }
+  if (uid < this->GetOldestItemUid())
+  {
+    status = ITEM_NOT_AVAILABLE_ANYMORE;
+    return NULL;
+  }
+  status = ITEM_OK;
+  return this->Memory + static_cast<unsigned long long>(uid % this->NumberOfRecords) * this->RecordSizeInBytes;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusBufferSpillFile::AppendItem(StreamBufferItem* item)
+{
+  if (item == NULL || this->NumberOfRecords == 0)
+  {
+    return PLUS_FAIL;
+  }
+  const BufferItemUidType uid = item->GetUid();
+  if (this->NumberOfItems > 0 && uid <= this->LatestItemUid && uid >= this->GetOldestItemUid())
+  {
+    // already stored
+    return PLUS_SUCCESS;
+  }
+
+  igsioVideoFrame& frame = item->GetFrame();
+  if (frame.IsFrameEncoded())
+  {
+    if (!this->EncodedFrameWarningLogged)
+    {
+      LOG_WARNING("Encoded frames cannot be stored in the buffer spill file, older frames are not kept");
+      this->EncodedFrameWarningLogged = true;
+    }
+    this->Clear();
+    return PLUS_FAIL;
+  }
+  unsigned long frameSizeInBytes = (frame.IsImageValid() ? frame.GetFrameSizeInBytes() : 0);
+  if (this->Memory == NULL || frameSizeInBytes > this->FrameCapacityInBytes)
+  {
+    // Frame size is known from the first item (or it has changed), items in a file with the old record size are discarded
+    if (this->Open(frameSizeInBytes) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+  if (this->NumberOfItems > 0 && uid != this->LatestItemUid + 1)
+  {
+    // Items must be contiguous, the older items do not belong to the same sequence anymore
+    this->Clear();
+  }
+
+  unsigned char* record = this->Memory + static_cast<unsigned long long>(uid % this->NumberOfRecords) * this->RecordSizeInBytes;
+  SpillRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.Uid = uid;
+  header.Index = item->GetIndex();
+  header.FilteredTimestamp = item->GetFilteredTimestamp(0);
+  header.UnfilteredTimestamp = item->GetUnfilteredTimestamp(0);
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  item->GetMatrix(matrix);
+  for (int i = 0; i < 16; ++i)
+  {
+    header.Matrix[i] = matrix->GetElement(i / 4, i % 4);
+  }
+  header.Status = static_cast<int>(item->GetStatus());
+  header.ValidTransformData = item->HasValidTransformData() ? 1 : 0;
+  if (frameSizeInBytes > 0)
+  {
+    FrameSizeType frameSize = { 0, 0, 0 };
+    frame.GetFrameSize(frameSize);
+    unsigned int numberOfScalarComponents(1);
+    frame.GetNumberOfScalarComponents(numberOfScalarComponents);
+    header.FrameSize[0] = frameSize[0];
+    header.FrameSize[1] = frameSize[1];
+    header.FrameSize[2] = frameSize[2];
+    header.PixelType = frame.GetVTKScalarPixelType();
+    header.NumberOfScalarComponents = numberOfScalarComponents;
+    header.FrameSizeInBytes = frameSizeInBytes;
+    memcpy(record + GetFieldHeaderOffset() + RoundUp(this->FieldCapacityInBytes, RECORD_ALIGNMENT_BYTES), frame.GetScalarPointer(), frameSizeInBytes);
+  }
+  header.ImageType = static_cast<int>(frame.GetImageType());
+  header.ImageOrientation = static_cast<int>(frame.GetImageOrientation());
+
+  if (!SerializeFields(*item, record + GetFieldHeaderOffset(), this->FieldCapacityInBytes, header.FieldsSizeInBytes)
+      && !this->FieldsTruncatedWarningLogged)
+  {
+    LOG_WARNING("Frame fields of a buffer item do not fit in " << this->FieldCapacityInBytes << " bytes, some fields are not stored in the buffer spill file");
+    this->FieldsTruncatedWarningLogged = true;
+  }
+  memcpy(record, &header, sizeof(header));
+
+  this->LatestItemUid = uid;
+  if (this->NumberOfItems < this->NumberOfRecords)
+  {
+    this->NumberOfItems++;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBufferSpillFile::GetItem(BufferItemUidType uid, StreamBufferItem* item)
+{
+  ItemStatus status(ITEM_OK);
+  const unsigned char* record = this->GetRecord(uid, status);
+  if (record == NULL)
+  {
+    return status;
+  }
+  SpillRecordHeader header;
+  memcpy(&header, record, sizeof(header));
+
+  item->SetUid(header.Uid);
+  item->SetIndex(static_cast<unsigned long>(header.Index));
+  item->SetFilteredTimestamp(header.FilteredTimestamp);
+  item->SetUnfilteredTimestamp(header.UnfilteredTimestamp);
+  item->SetMatrix(header.Matrix);
+  item->SetStatus(static_cast<ToolStatus>(header.Status));
+  item->SetValidTransformData(header.ValidTransformData != 0);
+
+  DeserializeFields(record + GetFieldHeaderOffset(), header.FieldsSizeInBytes, *item);
+
+  igsioVideoFrame& frame = item->GetFrame();
+  if (header.FrameSizeInBytes > 0)
+  {
+    // The item may be a view of a buffer slot, its pixel data must not be overwritten
+    item->ReleaseSharedFrame();
+    FrameSizeType frameSize = { header.FrameSize[0], header.FrameSize[1], header.FrameSize[2] };
+    if (frame.AllocateFrame(frameSize, header.PixelType, header.NumberOfScalarComponents) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to allocate frame for buffer item " << uid << " read from the buffer spill file");
+      return ITEM_UNKNOWN_ERROR;
+    }
+    memcpy(frame.GetScalarPointer(), record + GetFieldHeaderOffset() + RoundUp(this->FieldCapacityInBytes, RECORD_ALIGNMENT_BYTES), header.FrameSizeInBytes);
+  }
+  frame.SetImageType(static_cast<US_IMAGE_TYPE>(header.ImageType));
+  frame.SetImageOrientation(static_cast<US_IMAGE_ORIENTATION>(header.ImageOrientation));
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBufferSpillFile::GetFilteredTimeStamp(BufferItemUidType uid, double& timestamp)
+{
+  ItemStatus status(ITEM_OK);
+  const unsigned char* record = this->GetRecord(uid, status);
+  if (record == NULL)
+  {
+    return status;
+  }
+  memcpy(&timestamp, record + offsetof(SpillRecordHeader, FilteredTimestamp), sizeof(timestamp));
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusBufferSpillFile::GetIndex(BufferItemUidType uid, unsigned long& index)
+{
+  ItemStatus status(ITEM_OK);
+  const unsigned char* record = this->GetRecord(uid, status);
+  if (record == NULL)
+  {
+    return status;
+  }
+  unsigned long long storedIndex(0);
+  memcpy(&storedIndex, record + offsetof(SpillRecordHeader, Index), sizeof(storedIndex));
+  index = static_cast<unsigned long>(storedIndex);
+  return ITEM_OK;
+}
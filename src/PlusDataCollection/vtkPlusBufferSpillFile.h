@@ -0,0 +1,129 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusBufferSpillFile_h
+#define __vtkPlusBufferSpillFile_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusStreamBufferItem.h"
+#include "vtkPlusDataCollectionExport.h"
+#include "vtkPlusTimestampedCircularBuffer.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+/*!
+  \class vtkPlusBufferSpillFile
+  \brief Ring of buffer items stored in a memory-mapped file on local disk
+
+  vtkPlusBuffer appends each item to the spill file just before the item is overwritten in the
+  in-memory circular buffer, so the spill file holds the items that are older than the items in memory.
+  Items are stored in fixed-size records (item header, serialized frame fields, pixel data), the record
+  of the item with a given UID is found without any search. When the ring is full the oldest record is overwritten.
+
+  The file is created when the first item is appended (the record size depends on the frame size)
+  and it is removed when the spill file is closed or the process exits. Writing an item is a memory copy
+  into the page cache, the operating system writes the pages to disk in the background.
+
+  If InMemory is enabled then the records are kept in anonymous memory instead of a file, the pages are only backed
+  by physical memory when they are written. vtkPlusBuffer uses this to keep the pinned items (see vtkPlusBuffer::PinItems).
+
+  Items must be appended in UID order; if an item does not follow the latest item then the previous items are discarded.
+  Encoded (compressed) frames cannot be stored. The class is not thread-safe, the owner buffer must be locked.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusBufferSpillFile : public vtkObject
+{
+public:
+  static vtkPlusBufferSpillFile* New();
+  vtkTypeMacro(vtkPlusBufferSpillFile, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Set the maximum number of items in the file. The file is closed and all items are removed. */
+  void SetNumberOfRecords(unsigned int numberOfRecords);
+  vtkGetMacro(NumberOfRecords, unsigned int);
+
+  /*! Set the directory where the file is created. If empty then the output directory is used. */
+  void SetDirectory(const std::string& directory);
+  std::string GetDirectory() const { return this->Directory; }
+
+  /*! Keep the records in anonymous memory instead of a file. The file is closed and all items are removed. */
+  void SetInMemory(bool inMemory);
+  vtkGetMacro(InMemory, bool);
+
+  /*! Maximum size of the serialized frame fields of an item. Fields that do not fit are not stored. */
+  vtkSetMacro(FieldCapacityInBytes, unsigned int);
+  vtkGetMacro(FieldCapacityInBytes, unsigned int);
+
+  /*! Store an item, which must be the next item after the latest stored item (older items are discarded otherwise) */
+  PlusStatus AppendItem(StreamBufferItem* item);
+
+  /*! Copy a stored item. The copy owns its pixel data. */
+  ItemStatus GetItem(BufferItemUidType uid, StreamBufferItem* item);
+
+  /*! Get the filtered timestamp (in local time) of a stored item */
+  ItemStatus GetFilteredTimeStamp(BufferItemUidType uid, double& timestamp);
+
+  /*! Get the index assigned by the data acquisition system of a stored item */
+  ItemStatus GetIndex(BufferItemUidType uid, unsigned long& index);
+
+  /*! Remove all items. The file is kept open. */
+  void Clear();
+
+  /*! Unmap and remove the file. */
+  void Close();
+
+  vtkGetMacro(NumberOfItems, unsigned int);
+  /*! UID of the oldest stored item (only valid if NumberOfItems > 0) */
+  BufferItemUidType GetOldestItemUid() const { return this->LatestItemUid - (this->NumberOfItems - 1); }
+  /*! UID of the latest stored item (only valid if NumberOfItems > 0) */
+  vtkGetMacro(LatestItemUid, BufferItemUidType);
+
+  /*! Size of the mapped file in bytes (0 if the file is not created yet) */
+  vtkGetMacro(FileSizeInBytes, unsigned long long);
+
+protected:
+  vtkPlusBufferSpillFile();
+  ~vtkPlusBufferSpillFile();
+
+  /*! Create and map the file, records are sized for frames of the specified size */
+  PlusStatus Open(unsigned long frameSizeInBytes);
+
+  /*! Get the record of the item with the specified UID, NULL if the item is not stored */
+  unsigned char* GetRecord(BufferItemUidType uid, ItemStatus& status);
+
+  unsigned int NumberOfRecords;
+  std::string Directory;
+  bool InMemory;
+  unsigned int FieldCapacityInBytes;
+
+  unsigned int NumberOfItems;
+  BufferItemUidType LatestItemUid;
+
+  unsigned long FrameCapacityInBytes;
+  unsigned long RecordSizeInBytes;
+  unsigned long long FileSizeInBytes;
+  unsigned char* Memory;
+  std::string FileName;
+#ifdef _WIN32
+  void* FileHandle;
+  void* MappingHandle;
+#else
+  int FileDescriptor;
+#endif
+
+  /*! Warnings about items that cannot be stored completely are logged only once */
+  bool FieldsTruncatedWarningLogged;
+  bool EncodedFrameWarningLogged;
+
+private:
+  vtkPlusBufferSpillFile(const vtkPlusBufferSpillFile&);
+  void operator=(const vtkPlusBufferSpillFile&);
+};
+
+#endif
@@ -21,6 +21,10 @@ See License.txt for details.
 #include <vtkObjectFactory.h>
 #include <vtkTable.h>
 
+// STL includes
+#include <algorithm>
+#include <limits>
+
 //----------------------------------------------------------------------------
 
 vtkStandardNewMacro(vtkPlusChannel);
@@ -31,6 +35,15 @@ vtkStandardNewMacro(vtkPlusChannel);
 // This time should be long enough to comfortably retrieve a frame from the buffer.
 static const double SAMPLING_SKIPPING_MARGIN_SEC = 0.1;
 
+// The subscription dispatch thread checks whether it has to stop at least this often while it waits for new data
+static const double SUBSCRIPTION_WAIT_TIMEOUT_SEC = 0.1;
+// Delay of the subscription dispatch thread if new data is not available in all sources of the channel yet
+static const double SUBSCRIPTION_RETRY_DELAY_SEC = 0.002;
+
+// Number of times the tools are read again because a batched tool update was added meanwhile,
+// before they are read with all the tool buffers locked
+static const int MAX_TOOL_BATCH_READ_ATTEMPTS = 10;
+
 //----------------------------------------------------------------------------
 vtkPlusChannel::vtkPlusChannel(void)
   : VideoSource(NULL)
@@ -39,6 +52,8 @@ vtkPlusChannel::vtkPlusChannel(void)
   , RfProcessor(NULL)
   , BlankImage(vtkImageData::New())
   , SaveRfProcessingParameters(false)
+  , ToolTransformNamesUpToDate(false)
+  , SubscriptionDispatchStopRequested(false)
 {
   // Default size for brightness frame
   this->BrightnessFrameSize[0] = 640;
@@ -58,6 +73,11 @@ vtkPlusChannel::vtkPlusChannel(void)
 //----------------------------------------------------------------------------
 vtkPlusChannel::~vtkPlusChannel(void)
 {
+  {
+    std::lock_guard<std::mutex> subscriptionControlLock(this->SubscriptionControlMutex);
+    this->StopSubscriptionDispatchThread();
+  }
+
   this->VideoSource = NULL;
   this->Tools.clear();
   this->FieldDataSources.clear();
@@ -89,6 +109,7 @@ PlusStatus vtkPlusChannel::ReadConfiguration(vtkXMLDataElement* aChannelElement,
   }
 
   vtkPlusDataSource* aSource = NULL;
+  this->ToolTransformNamesUpToDate = false;
   for (int i = 0; i < aChannelElement->GetNumberOfNestedElements(); i++)
   {
     vtkXMLDataElement* aSourceElement = aChannelElement->GetNestedElement(i);
@@ -294,6 +315,7 @@ PlusStatus vtkPlusChannel::AddTool(vtkPlusDataSource* aTool)
 
   this->Tools[aTool->GetId()] = aTool;
   this->Tools[aTool->GetId()]->Register(this);
+  this->ToolTransformNamesUpToDate = false;
 
   if (this->TimestampMasterTool == NULL)
   {
@@ -318,12 +340,13 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
   {
     if (it->second->GetId() == toolSourceId)
     {
-      this->Tools.erase(it);
+      this->ToolTransformNamesUpToDate = false;
       if (this->TimestampMasterTool == it->second)
       {
         // the master tool has been deleted
         this->TimestampMasterTool = NULL;
       }
+      this->Tools.erase(it);
       return PLUS_SUCCESS;
     }
   }
@@ -335,6 +358,8 @@ PlusStatus vtkPlusChannel::RemoveTool(const std::string& toolSourceId)
 PlusStatus vtkPlusChannel::RemoveTools()
 {
   this->Tools.clear();
+  this->TimestampMasterTool = NULL;
+  this->ToolTransformNamesUpToDate = false;
 
   return PLUS_SUCCESS;
 }
@@ -526,8 +551,186 @@ void vtkPlusChannel::SetVideoSource(vtkPlusDataSource* aSource)
   this->VideoSource = aSource;
 }
 
+//----------------------------------------------------------------------------
+vtkPlusChannel::TrackedFrameReadContext::TrackedFrameReadContext()
+  : ToolTransformMatrix(vtkSmartPointer<vtkMatrix4x4>::New())
+  , VideoSearchHintUid(0)
+  , VideoItemImage(vtkSmartPointer<vtkImageData>::New())
+{
+  this->VideoItem.GetFrame().SetImageData(this->VideoItemImage);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::TrackedFrameReadContext::Reset()
+{
+  this->PinnedItems.clear();
+  // The tools of the channel may change until the next call, the names are requested again then
+  this->ToolTransformNames.reset();
+  this->ToolInterpolationSampleValid.clear();
+  this->ToolDevices.clear();
+  this->ToolBatchSequences.clear();
+  this->LockedTools.clear();
+  // Release the view, so that the video buffer can overwrite the slot
+  this->VideoItem.GetFrame().SetImageData(this->VideoItemImage);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusChannel::TrackedFrameReadContext* vtkPlusChannel::AcquireReadContext()
+{
+  std::lock_guard<std::mutex> freeReadContextsLock(this->FreeReadContextsMutex);
+  if (this->FreeReadContexts.empty())
+  {
+    return new TrackedFrameReadContext;
+  }
+  TrackedFrameReadContext* context = this->FreeReadContexts.back().release();
+  this->FreeReadContexts.pop_back();
+  return context;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::ReleaseReadContext(TrackedFrameReadContext* context)
+{
+  context->Reset();
+  std::lock_guard<std::mutex> freeReadContextsLock(this->FreeReadContextsMutex);
+  this->FreeReadContexts.push_back(std::unique_ptr<TrackedFrameReadContext>(context));
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData/*=true*/)
+{
+  return this->InternalGetTrackedFrame(timestamp, aTrackedFrame, enableImageData, false);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameView(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData/*=true*/)
+{
+  return this->InternalGetTrackedFrame(timestamp, aTrackedFrame, enableImageData, true);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::InternalGetTrackedFrame(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData, bool referenceImageData)
+{
+  TrackedFrameReadContext* context = this->AcquireReadContext();
+  this->PinSourceItems(*context, this->HasVideoSource() && enableImageData, true);
+  PlusStatus status = this->GetTrackedFrameFromPinnedSources(timestamp, aTrackedFrame, enableImageData, referenceImageData, *context);
+  if (this->UnpinSourceItems(*context) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Buffer items were discarded while the tracked frame was read at time: " << std::fixed << timestamp);
+    status = PLUS_FAIL;
+  }
+  this->ReleaseReadContext(context);
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetToolTrackedFrames(const std::vector<double>& timestamps, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames)
+{
+  if (aTrackedFrameList == NULL)
+  {
+    LOG_ERROR("Unable to get tool tracked frames - output tracked frame list is NULL");
+    return PLUS_FAIL;
+  }
+
+  // The scratch data is reused for all the timestamps
+  TrackedFrameReadContext* context = this->AcquireReadContext();
+  PlusStatus status = PLUS_SUCCESS;
+  // Index of the next frame to fill, the frames before it are kept
+  unsigned int frameIndex = (reuseFrames ? 0 : aTrackedFrameList->GetNumberOfTrackedFrames());
+  this->PinSourceItems(*context, false, false);
+  for (std::vector<double>::const_iterator timestampIt = timestamps.begin(); timestampIt != timestamps.end(); ++timestampIt)
+  {
+    double synchronizedTimestamp = *timestampIt;
+    // A new frame is allocated only if there is no frame to reuse
+    bool newFrame = (frameIndex >= aTrackedFrameList->GetNumberOfTrackedFrames());
+    igsioTrackedFrame* trackedFrame = (newFrame ? new igsioTrackedFrame : aTrackedFrameList->GetTrackedFrame(frameIndex));
+    if (!newFrame)
+    {
+      // Remove the fields that the reused frame was previously filled with
+      std::vector<std::string> previousFieldNames;
+      trackedFrame->GetFrameFieldNameList(previousFieldNames);
+      for (std::vector<std::string>::const_iterator fieldNameIt = previousFieldNames.begin(); fieldNameIt != previousFieldNames.end(); ++fieldNameIt)
+      {
+        trackedFrame->DeleteFrameField(*fieldNameIt);
+      }
+    }
+    if (this->GetToolTransformsFromPinnedSources(synchronizedTimestamp, *trackedFrame, *context) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to get tracking data by time: " << std::fixed << *timestampIt);
+      status = PLUS_FAIL;
+    }
+    trackedFrame->SetTimestamp(synchronizedTimestamp);
+
+    if (!newFrame)
+    {
+      ++frameIndex;
+      continue;
+    }
+    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Unable to add tracking data to the list!");
+      status = PLUS_FAIL;
+    }
+    frameIndex = aTrackedFrameList->GetNumberOfTrackedFrames();
+  }
+  if (this->UnpinSourceItems(*context) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Tool items were discarded while the tool tracked frames were read");
+    status = PLUS_FAIL;
+  }
+  this->ReleaseReadContext(context);
+
+  // Remove the reused frames that were not filled
+  if (frameIndex < aTrackedFrameList->GetNumberOfTrackedFrames())
+  {
+    aTrackedFrameList->RemoveTrackedFrameRange(frameIndex, aTrackedFrameList->GetNumberOfTrackedFrames() - 1);
+  }
+
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::PinSourceItems(TrackedFrameReadContext& context, bool pinVideoSource, bool pinFieldDataSources)
+{
+  // Pin the items of all buffers before any lookup. The buffers cannot discard these items while the frame is read,
+  // so the lookups for all the sources see the items that were available at the same time and succeed or fail together
+  // (if a buffer cannot keep its items then unpinning fails).
+  context.PinnedItems.clear();
+  if (pinVideoSource)
+  {
+    context.PinnedItems.push_back(std::make_pair(this->VideoSource, this->VideoSource->PinItems()));
+  }
+  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
+  {
+    context.PinnedItems.push_back(std::make_pair(it->second, it->second->PinItems()));
+  }
+  if (pinFieldDataSources)
+  {
+    for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
+    {
+      context.PinnedItems.push_back(std::make_pair(it->second, it->second->PinItems()));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::UnpinSourceItems(TrackedFrameReadContext& context)
+{
+  // The pinned sources are stored, so that the pins are released even if the sources of the channel have changed in the meantime
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<std::pair<vtkPlusDataSource*, BufferItemUidType> >::iterator it = context.PinnedItems.begin(); it != context.PinnedItems.end(); ++it)
+  {
+    if (it->first->UnpinItems(it->second) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+  context.PinnedItems.clear();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameFromPinnedSources(double timestamp, igsioTrackedFrame& aTrackedFrame, bool enableImageData, bool referenceImageData, TrackedFrameReadContext& context)
 {
   int numberOfErrors(0);
   double synchronizedTimestamp(0);
@@ -535,15 +738,19 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
   // Get frame UID
   if (this->HasVideoSource() && enableImageData)
   {
+    // The frame is found and referenced while the video buffer is locked, so that it cannot be overwritten in between
+    this->VideoSource->LockBuffer();
     if (this->VideoSource->GetNumberOfItems() < 1)
     {
+      this->VideoSource->UnlockBuffer();
       LOG_ERROR("Couldn't get tracked frame from video source, frames are not available yet");
       return PLUS_FAIL;
     }
     BufferItemUidType frameUID = 0;
-    ItemStatus status = this->VideoSource->GetItemUidFromTime(timestamp, frameUID);
+    ItemStatus status = this->VideoSource->GetItemUidFromTime(timestamp, frameUID, &context.VideoSearchHintUid);
     if (status != ITEM_OK)
     {
+      this->VideoSource->UnlockBuffer();
       if (status == ITEM_NOT_AVAILABLE_ANYMORE)
       {
         LOG_ERROR("Couldn't get frame UID from time (" << std::fixed << timestamp <<
@@ -562,22 +769,39 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
       return PLUS_FAIL;
     }
 
-    StreamBufferItem CurrentStreamBufferItem;
-    if (this->VideoSource->GetStreamBufferItem(frameUID, &CurrentStreamBufferItem) != ITEM_OK)
+    StreamBufferItem& CurrentStreamBufferItem = context.VideoItem;
+    status = this->VideoSource->GetStreamBufferItemView(frameUID, &CurrentStreamBufferItem);
+    this->VideoSource->UnlockBuffer();
+    if (status != ITEM_OK)
     {
       LOG_ERROR("Couldn't get video buffer item by frame UID: " << frameUID);
       return PLUS_FAIL;
     }
 
-    // Copy frame
-    igsioVideoFrame frame = CurrentStreamBufferItem.GetFrame();
-    aTrackedFrame.SetImageData(frame);
+    igsioVideoFrame& frame = CurrentStreamBufferItem.GetFrame();
+    if (!referenceImageData || frame.IsFrameEncoded() || frame.GetImage() == NULL)
+    {
+      // The copy reuses the image of the tracked frame if it has the same size, therefore the image must not be referenced
+      // by others and must not share the pixel data of the buffer (e.g., if the tracked frame was previously filled by GetTrackedFrameView)
+      vtkImageData* targetImage = aTrackedFrame.GetImageData()->GetImage();
+      if (targetImage != NULL && (targetImage->GetReferenceCount() > 1 || StreamBufferItem::IsFrameViewImage(targetImage)))
+      {
+        aTrackedFrame.GetImageData()->SetImageData(vtkSmartPointer<vtkImageData>::New());
+      }
+      aTrackedFrame.SetImageData(frame);
+    }
+    else
+    {
+      // Reference the pixel data of the buffer instead of copying it, the view image keeps the slot from being overwritten while it exists
+      aTrackedFrame.GetImageData()->SetImageData(frame.GetImage());
+      aTrackedFrame.GetImageData()->SetImageType(frame.GetImageType());
+      aTrackedFrame.GetImageData()->SetImageOrientation(frame.GetImageOrientation());
+    }
 
     // Copy all custom fields
-    igsioFieldMapType fieldMap = CurrentStreamBufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    for (unsigned int fieldIndex = 0; fieldIndex < CurrentStreamBufferItem.GetNumberOfFrameFields(); ++fieldIndex)
     {
-      aTrackedFrame.SetFrameField((*fieldIterator).first, (*fieldIterator).second.second, fieldIterator->second.first);
+      aTrackedFrame.SetFrameField(CurrentStreamBufferItem.GetFrameFieldNameAt(fieldIndex), CurrentStreamBufferItem.GetFrameFieldValueAt(fieldIndex), CurrentStreamBufferItem.GetFrameFieldFlagsAt(fieldIndex));
     }
 
     synchronizedTimestamp = CurrentStreamBufferItem.GetTimestamp(this->VideoSource->GetLocalTimeOffsetSec());
@@ -591,20 +815,90 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
   // Add main tool timestamp
   aTrackedFrame.SetTimestamp(synchronizedTimestamp);
 
-  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
+  if (this->GetToolTransformsFromPinnedSources(synchronizedTimestamp, aTrackedFrame, context) != PLUS_SUCCESS)
+  {
+    numberOfErrors++;
+  }
+
+  for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
+  {
+    vtkPlusDataSource* aSource = it->second;
+
+    StreamBufferItem& bufferItem = context.FieldDataItem;
+    ItemStatus result = aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
+    if (result != ITEM_OK)
+    {
+      double latestTimestamp(0);
+      if (aSource->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get latest timestamp!");
+        numberOfErrors++;
+      }
+
+      double oldestTimestamp(0);
+      if (aSource->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
+      {
+        LOG_ERROR("Failed to get oldest timestamp!");
+        numberOfErrors++;
+      }
+
+      LOG_ERROR(aSource->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
+      numberOfErrors++;
+      continue;
+    }
+
+    // Copy all custom fields
+    for (unsigned int fieldIndex = 0; fieldIndex < bufferItem.GetNumberOfFrameFields(); ++fieldIndex)
+    {
+      aTrackedFrame.SetFrameField(bufferItem.GetFrameFieldNameAt(fieldIndex), bufferItem.GetFrameFieldValueAt(fieldIndex), bufferItem.GetFrameFieldFlagsAt(fieldIndex));
+    }
+
+    synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
+  }
+
+  // Copy frame timestamp
+  aTrackedFrame.SetTimestamp(synchronizedTimestamp);
+
+  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetToolTransformsFromPinnedSources(double& synchronizedTimestamp, igsioTrackedFrame& aTrackedFrame, TrackedFrameReadContext& context)
+{
+  int numberOfErrors(0);
+
+  const unsigned int numberOfTools = static_cast<unsigned int>(this->Tools.size());
+  if (context.ToolInterpolationSamples.size() < numberOfTools)
+  {
+    context.ToolInterpolationSamples.resize(numberOfTools);
+  }
+  if (context.ToolTransformNames == NULL || context.ToolTransformNames->size() != numberOfTools)
+  {
+    context.ToolTransformNames = this->GetToolTransformNames();
+  }
+  if (context.ToolTransformNames->size() != numberOfTools)
+  {
+    LOG_ERROR("The tools of the channel have changed while the tracked frame was read");
+    return PLUS_FAIL;
+  }
+  const std::vector<igsioTransformName>& toolTransformNames = *context.ToolTransformNames;
+
+  // Get the two bracketing poses of all tools first
+  this->ReadToolInterpolationSamples(synchronizedTimestamp, context);
+
+  unsigned int toolIndex = 0;
+  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it, ++toolIndex)
   {
     vtkPlusDataSource* aTool = it->second;
-    igsioTransformName toolTransformName(aTool->GetId());
-    if (!toolTransformName.IsValid())
+    if (!toolTransformNames[toolIndex].IsValid())
     {
       LOG_ERROR("Tool transform name is invalid!");
       numberOfErrors++;
+      context.ToolInterpolationSampleValid[toolIndex] = false;
       continue;
     }
 
-    StreamBufferItem bufferItem;
-    ItemStatus result = aTool->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::INTERPOLATED);
-    if (result != ITEM_OK)
+    if (!context.ToolInterpolationSampleValid[toolIndex])
     {
       double latestTimestamp(0);
       if (aTool->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
@@ -622,18 +916,32 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
 
       LOG_ERROR(aTool->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
       numberOfErrors++;
+    }
+  }
+
+  // Interpolate all the poses at once
+  context.ToolPoseInterpolator.Interpolate(context.ToolInterpolationSamples, numberOfTools);
+
+  // Write the results into the tracked frame
+  toolIndex = 0;
+  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it, ++toolIndex)
+  {
+    if (!context.ToolInterpolationSampleValid[toolIndex])
+    {
       continue;
     }
+    vtkPlusDataSource* aTool = it->second;
+    const igsioTransformName& toolTransformName = toolTransformNames[toolIndex];
+    StreamBufferItem& bufferItem = context.ToolInterpolationSamples[toolIndex].Item;
 
-    vtkSmartPointer<vtkMatrix4x4> dMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-    if (bufferItem.GetMatrix(dMatrix) != PLUS_SUCCESS)
+    if (bufferItem.GetMatrix(context.ToolTransformMatrix) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to get matrix from buffer item for tool " << aTool->GetId());
       numberOfErrors++;
       continue;
     }
 
-    if (aTrackedFrame.SetFrameTransform(toolTransformName, dMatrix) != PLUS_SUCCESS)
+    if (aTrackedFrame.SetFrameTransform(toolTransformName, context.ToolTransformMatrix) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to set transform for tool " << aTool->GetId());
       numberOfErrors++;
@@ -648,57 +956,125 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(double timestamp, igsioTrackedFrame&
     }
 
     // Copy all custom fields
-    igsioFieldMapType fieldMap = bufferItem.GetFrameFieldMap();
-    igsioFieldMapType::iterator fieldIterator;
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    for (unsigned int fieldIndex = 0; fieldIndex < bufferItem.GetNumberOfFrameFields(); ++fieldIndex)
     {
-      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      aTrackedFrame.SetFrameField(bufferItem.GetFrameFieldNameAt(fieldIndex), bufferItem.GetFrameFieldValueAt(fieldIndex), bufferItem.GetFrameFieldFlagsAt(fieldIndex));
     }
-
-    synchronizedTimestamp = bufferItem.GetTimestamp(aTool->GetLocalTimeOffsetSec());
   }
 
-  for (DataSourceContainerConstIterator it = this->GetFieldDataSourcesStartIterator(); it != this->GetFieldDataSourcesEndIterator(); ++it)
+  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::ReadToolInterpolationSamples(double& synchronizedTimestamp, TrackedFrameReadContext& context)
+{
+  // A batched update of the tools (see vtkPlusDevice::ToolTimeStampedUpdate) may add items to some of the tools
+  // while they are read one after the other. The tools are read again then, so that all of them are read either
+  // before or after the batch.
+  context.ToolDevices.clear();
+  for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
   {
-    vtkPlusDataSource* aSource = it->second;
+    vtkPlusDevice* device = it->second->GetDevice();
+    if (device != NULL && std::find(context.ToolDevices.begin(), context.ToolDevices.end(), device) == context.ToolDevices.end())
+    {
+      context.ToolDevices.push_back(device);
+    }
+  }
+  context.ToolBatchSequences.resize(context.ToolDevices.size());
 
-    StreamBufferItem bufferItem;
-    ItemStatus result = aSource->GetStreamBufferItemFromTime(synchronizedTimestamp, &bufferItem, vtkPlusBuffer::CLOSEST_TIME);
-    if (result != ITEM_OK)
+  const double requestedTimestamp = synchronizedTimestamp;
+  bool toolBuffersLocked(false);
+  for (int attempt = 0; ; ++attempt)
+  {
+    if (attempt == MAX_TOOL_BATCH_READ_ATTEMPTS)
     {
-      double latestTimestamp(0);
-      if (aSource->GetLatestTimeStamp(latestTimestamp) != ITEM_OK)
+      // Batches keep being added while the tools are read. A batch holds the locks of all its tools while it adds
+      // the items, so the tools are read with all their buffers locked (in the same order as the batch locks them).
+      context.LockedTools.clear();
+      for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it)
       {
-        LOG_ERROR("Failed to get latest timestamp!");
-        numberOfErrors++;
+        context.LockedTools.push_back(it->second);
       }
-
-      double oldestTimestamp(0);
-      if (aSource->GetOldestTimeStamp(oldestTimestamp) != ITEM_OK)
+      std::sort(context.LockedTools.begin(), context.LockedTools.end());
+      for (std::vector<vtkPlusDataSource*>::iterator it = context.LockedTools.begin(); it != context.LockedTools.end(); ++it)
       {
-        LOG_ERROR("Failed to get oldest timestamp!");
-        numberOfErrors++;
+        (*it)->LockBuffer();
       }
+      toolBuffersLocked = true;
+    }
 
-      LOG_ERROR(aSource->GetId() << ": Failed to get tracker item from buffer by time: " << std::fixed << synchronizedTimestamp << " (Latest timestamp: " << latestTimestamp << "   Oldest timestamp: " << oldestTimestamp << ").");
-      numberOfErrors++;
+    bool batchInProgress(false);
+    for (size_t deviceIndex = 0; deviceIndex < context.ToolDevices.size(); ++deviceIndex)
+    {
+      context.ToolBatchSequences[deviceIndex] = context.ToolDevices[deviceIndex]->GetToolBatchSequence();
+      batchInProgress = batchInProgress || (context.ToolBatchSequences[deviceIndex] & 1) != 0;
+    }
+    if (batchInProgress && !toolBuffersLocked)
+    {
+      // the batch is being added, it takes a few buffer writes
+      std::this_thread::yield();
       continue;
     }
 
-    // Copy all custom fields
-    igsioFieldMapType fieldMap = bufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    synchronizedTimestamp = requestedTimestamp;
+    context.ToolInterpolationSampleValid.assign(this->Tools.size(), false);
+    unsigned int toolIndex = 0;
+    for (DataSourceContainerConstIterator it = this->GetToolsStartIterator(); it != this->GetToolsEndIterator(); ++it, ++toolIndex)
     {
-      aTrackedFrame.SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      vtkPlusDataSource* aTool = it->second;
+      PlusPoseInterpolationSample& sample = context.ToolInterpolationSamples[toolIndex];
+      sample.InterpolationRequired = false;
+      if (aTool->GetInterpolationSamplesFromTime(synchronizedTimestamp, sample) != ITEM_OK)
+      {
+        continue;
+      }
+      context.ToolInterpolationSampleValid[toolIndex] = true;
+      // The filtered timestamp of the item is already final, even if the pose still has to be interpolated
+      synchronizedTimestamp = sample.Item.GetTimestamp(aTool->GetLocalTimeOffsetSec());
     }
 
-    synchronizedTimestamp = bufferItem.GetTimestamp(aSource->GetLocalTimeOffsetSec());
+    if (toolBuffersLocked)
+    {
+      break;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool batchAdded(false);
+    for (size_t deviceIndex = 0; deviceIndex < context.ToolDevices.size() && !batchAdded; ++deviceIndex)
+    {
+      batchAdded = (context.ToolDevices[deviceIndex]->GetToolBatchSequence() != context.ToolBatchSequences[deviceIndex]);
+    }
+    if (!batchAdded)
+    {
+      break;
+    }
   }
 
-  // Copy frame timestamp
-  aTrackedFrame.SetTimestamp(synchronizedTimestamp);
+  if (toolBuffersLocked)
+  {
+    for (std::vector<vtkPlusDataSource*>::reverse_iterator it = context.LockedTools.rbegin(); it != context.LockedTools.rend(); ++it)
+    {
+      (*it)->UnlockBuffer();
+    }
+  }
+}
 
-  return (numberOfErrors == 0 ? PLUS_SUCCESS : PLUS_FAIL);
+//----------------------------------------------------------------------------
+std::shared_ptr<const std::vector<igsioTransformName> > vtkPlusChannel::GetToolTransformNames()
+{
+  std::lock_guard<std::mutex> toolTransformNamesLock(this->ToolTransformNamesMutex);
+  // The flag is set before the tools are read, so a tool change during the update clears it again
+  if (this->ToolTransformNamesUpToDate.exchange(true) && this->ToolTransformNames != NULL && this->ToolTransformNames->size() == this->Tools.size())
+  {
+    return this->ToolTransformNames;
+  }
+  std::shared_ptr<std::vector<igsioTransformName> > toolTransformNames = std::make_shared<std::vector<igsioTransformName> >();
+  toolTransformNames->reserve(this->Tools.size());
+  for (DataSourceContainerConstIterator it = this->GetToolsStartConstIterator(); it != this->GetToolsEndConstIterator(); ++it)
+  {
+    toolTransformNames->push_back(igsioTransformName(it->second->GetId()));
+  }
+  this->ToolTransformNames = toolTransformNames;
+  return this->ToolTransformNames;
 }
 
 //----------------------------------------------------------------------------
@@ -712,7 +1088,17 @@ PlusStatus vtkPlusChannel::GetTrackedFrame(igsioTrackedFrame& trackedFrame)
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd)
+PlusStatus vtkPlusChannel::GetTrackedFrameView(igsioTrackedFrame& trackedFrame)
+{
+  double mostRecentFrameTimestamp(0);
+  RETURN_WITH_FAIL_IF(this->GetMostRecentTimestamp(mostRecentFrameTimestamp) != PLUS_SUCCESS,
+                      "Failed to get most recent timestamp from the buffer!");
+
+  return this->GetTrackedFrameView(mostRecentFrameTimestamp, trackedFrame);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd, bool referenceImageData/*=false*/)
 {
   LOG_TRACE("vtkPlusDevice::GetTrackedFrameList(" << aTimestampOfLastFrameAlreadyGot << ", " << aMaxNumberOfFramesToAdd << ")");
 
@@ -949,7 +1335,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlre
       // Get tracked frame from buffer
       igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
 
-      if (this->GetTrackedFrame(timestampFrom, *trackedFrame) != PLUS_SUCCESS)
+      if (this->InternalGetTrackedFrame(timestampFrom, *trackedFrame, true, referenceImageData) != PLUS_SUCCESS)
       {
         delete trackedFrame;
         LOG_ERROR("Unable to get tracked frame by time: " << std::fixed << timestampFrom);
@@ -1047,7 +1433,7 @@ PlusStatus vtkPlusChannel::GetTrackedFrameList(double& aTimestampOfLastFrameAlre
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkIGSIOTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec/*=-1*/)
+PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkIGSIOTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec/*=-1*/, bool referenceImageData/*=false*/)
 {
   LOG_TRACE("vtkPlusDataCollector::GetTrackedFrameListSampled: aTimestampOfLastFrameAlreadyGot=" << aTimestampOfLastFrameAlreadyGot << ", aTimestampOfNextFrameToBeAdded=" << aTimestampOfNextFrameToBeAdded << ", aSamplingPeriodSec=" << aSamplingPeriodSec);
 
@@ -1103,9 +1489,9 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFr
       // This frame has been already added. Don't spend time with retrieving this frame, just jump to the next
       continue;
     }
-    // Get tracked frame from buffer (actually copies pixel and field data)
+    // Get tracked frame from buffer
     igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-    if (GetTrackedFrame(closestTimestamp, *trackedFrame) != PLUS_SUCCESS)
+    if (this->InternalGetTrackedFrame(closestTimestamp, *trackedFrame, true, referenceImageData) != PLUS_SUCCESS)
     {
       LOG_WARNING("vtkPlusChannel::GetTrackedFrameListSampled: Unable retrieve frame from the devices for time: " << std::fixed << aTimestampOfNextFrameToBeAdded << ", probably the item is not available in the buffers anymore. Frames may be lost.");
       delete trackedFrame;
@@ -1124,6 +1510,244 @@ PlusStatus vtkPlusChannel::GetTrackedFrameListSampled(double& aTimestampOfLastFr
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::WaitForItemNewerThan(double timestamp, double timeoutSec)
+{
+  std::vector<vtkPlusDataSource*> sources;
+  if (this->HasVideoSource())
+  {
+    sources.push_back(this->VideoSource);
+  }
+  for (DataSourceContainerConstIterator it = this->Tools.begin(); it != this->Tools.end(); ++it)
+  {
+    sources.push_back(it->second);
+  }
+  for (DataSourceContainerConstIterator it = this->FieldDataSources.begin(); it != this->FieldDataSources.end(); ++it)
+  {
+    sources.push_back(it->second);
+  }
+  if (sources.empty())
+  {
+    // no data will ever arrive, do not let the caller spin
+    vtkIGSIOAccurateTimer::Delay(timeoutSec);
+    return PLUS_FAIL;
+  }
+
+  // The most recent timestamp of the channel is at most the minimum of the latest timestamps of the sources,
+  // so first wait until each of them has a newer item, sharing the same deadline
+  const double deadline = vtkIGSIOAccurateTimer::GetSystemTime() + timeoutSec;
+  for (std::vector<vtkPlusDataSource*>::iterator it = sources.begin(); it != sources.end(); ++it)
+  {
+    double remainingTimeSec = std::max(0.0, deadline - vtkIGSIOAccurateTimer::GetSystemTime());
+    if ((*it)->WaitForItemNewerThan(timestamp, remainingTimeSec) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+
+  // GetTrackedFrameList only returns frames up to the most recent timestamp of the channel, which also depends on
+  // the sampling times of the master source. Returning before it advances would make the caller poll without delay.
+  for (;;)
+  {
+    double mostRecentTimestamp(0);
+    if (this->GetMostRecentTimestamp(mostRecentTimestamp) == PLUS_SUCCESS && mostRecentTimestamp > timestamp)
+    {
+      return PLUS_SUCCESS;
+    }
+
+    // Wait for the source that is the furthest behind
+    vtkPlusDataSource* oldestSource(NULL);
+    double oldestLatestTimestamp(0);
+    for (std::vector<vtkPlusDataSource*>::iterator it = sources.begin(); it != sources.end(); ++it)
+    {
+      double latestTimestamp(0);
+      if ((*it)->GetLatestTimeStamp(latestTimestamp) == ITEM_OK && (oldestSource == NULL || latestTimestamp < oldestLatestTimestamp))
+      {
+        oldestSource = *it;
+        oldestLatestTimestamp = latestTimestamp;
+      }
+    }
+    double remainingTimeSec = deadline - vtkIGSIOAccurateTimer::GetSystemTime();
+    if (oldestSource == NULL || remainingTimeSec <= 0)
+    {
+      return PLUS_FAIL;
+    }
+    if (oldestSource->WaitForItemNewerThan(oldestLatestTimestamp, remainingTimeSec) != PLUS_SUCCESS)
+    {
+      return PLUS_FAIL;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<PlusChannelSubscription> vtkPlusChannel::Subscribe(unsigned int maximumQueueDepth, PlusChannelSubscription::OverflowPolicyType overflowPolicy/*=DROP_OLDEST*/)
+{
+  std::lock_guard<std::mutex> subscriptionControlLock(this->SubscriptionControlMutex);
+
+  std::shared_ptr<PlusChannelSubscription> subscription = std::make_shared<PlusChannelSubscription>(maximumQueueDepth, overflowPolicy);
+  {
+    std::lock_guard<std::mutex> subscriptionsLock(this->SubscriptionsMutex);
+    this->Subscriptions.push_back(subscription);
+  }
+
+  if (!this->SubscriptionDispatchThread.joinable())
+  {
+    LOG_DEBUG("Start subscription dispatch thread of channel " << (this->ChannelId ? this->ChannelId : "(unknown)"));
+    this->SubscriptionDispatchStopRequested = false;
+    this->SubscriptionDispatchThread = std::thread(&vtkPlusChannel::DispatchSubscriptionFrames, this);
+  }
+
+  return subscription;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusChannel::Unsubscribe(const std::shared_ptr<PlusChannelSubscription>& subscription)
+{
+  std::lock_guard<std::mutex> subscriptionControlLock(this->SubscriptionControlMutex);
+
+  bool noSubscriptionsLeft(false);
+  {
+    std::lock_guard<std::mutex> subscriptionsLock(this->SubscriptionsMutex);
+    std::vector<std::shared_ptr<PlusChannelSubscription> >::iterator it = std::find(this->Subscriptions.begin(), this->Subscriptions.end(), subscription);
+    if (it == this->Subscriptions.end())
+    {
+      LOG_ERROR("Unable to unsubscribe from channel " << (this->ChannelId ? this->ChannelId : "(unknown)") << " - the subscription is not registered");
+      return PLUS_FAIL;
+    }
+    this->Subscriptions.erase(it);
+    noSubscriptionsLeft = this->Subscriptions.empty();
+  }
+
+  if (noSubscriptionsLeft)
+  {
+    this->StopSubscriptionDispatchThread();
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusChannel::GetNumberOfSubscriptions()
+{
+  std::lock_guard<std::mutex> subscriptionsLock(this->SubscriptionsMutex);
+  return static_cast<int>(this->Subscriptions.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::StopSubscriptionDispatchThread()
+{
+  if (!this->SubscriptionDispatchThread.joinable())
+  {
+    return;
+  }
+  LOG_DEBUG("Stop subscription dispatch thread of channel " << (this->ChannelId ? this->ChannelId : "(unknown)"));
+  this->SubscriptionDispatchStopRequested = true;
+  this->SubscriptionDispatchThread.join();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusChannel::DispatchSubscriptionFrames()
+{
+  // The first frame is assembled at the most recent timestamp of the channel, then every new item is delivered
+  bool firstFrame(true);
+  double lastDispatchedTimestamp = -std::numeric_limits<double>::max();
+  while (!this->SubscriptionDispatchStopRequested)
+  {
+    // Wait until all the sources of the channel have new data
+    if (this->WaitForItemNewerThan(lastDispatchedTimestamp, SUBSCRIPTION_WAIT_TIMEOUT_SEC) != PLUS_SUCCESS)
+    {
+      continue;
+    }
+
+    // The frames are assembled at the timestamps of this source
+    vtkPlusDataSource* masterSource = NULL;
+    if (this->HasVideoSource())
+    {
+      masterSource = this->VideoSource;
+    }
+    else if (this->GetTrackingEnabled())
+    {
+      if (this->GetTimestampMasterTool(masterSource) != PLUS_SUCCESS)
+      {
+        vtkIGSIOAccurateTimer::Delay(SUBSCRIPTION_WAIT_TIMEOUT_SEC);
+        continue;
+      }
+    }
+    else if (this->GetFieldDataEnabled())
+    {
+      masterSource = this->FieldDataSources.begin()->second;
+    }
+    else
+    {
+      // the sources of the channel have been removed
+      vtkIGSIOAccurateTimer::Delay(SUBSCRIPTION_WAIT_TIMEOUT_SEC);
+      continue;
+    }
+
+    // Frames are only assembled up to the time where all the sources have data
+    double mostRecentTimestamp(0);
+    if (this->GetMostRecentTimestamp(mostRecentTimestamp) != PLUS_SUCCESS)
+    {
+      vtkIGSIOAccurateTimer::Delay(SUBSCRIPTION_WAIT_TIMEOUT_SEC);
+      continue;
+    }
+
+    BufferItemUidType itemUid = 0;
+    ItemStatus itemStatus = (firstFrame
+                             ? masterSource->GetItemUidFromTime(mostRecentTimestamp, itemUid)
+                             : masterSource->GetFirstItemUidAfterTime(lastDispatchedTimestamp, itemUid));
+    if (itemStatus != ITEM_OK)
+    {
+      vtkIGSIOAccurateTimer::Delay(SUBSCRIPTION_RETRY_DELAY_SEC);
+      continue;
+    }
+
+    bool frameDispatched(false);
+    BufferItemUidType latestItemUid = masterSource->GetLatestItemUidInBuffer();
+    for (; itemUid <= latestItemUid && !this->SubscriptionDispatchStopRequested; ++itemUid)
+    {
+      double itemTimestamp(0);
+      if (masterSource->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
+      {
+        // probably the buffer item is not available anymore
+        continue;
+      }
+      if (itemTimestamp > mostRecentTimestamp)
+      {
+        // the other sources do not have data for this item yet
+        break;
+      }
+      if (itemTimestamp <= lastDispatchedTimestamp)
+      {
+        continue;
+      }
+      lastDispatchedTimestamp = itemTimestamp;
+      firstFrame = false;
+      frameDispatched = true;
+
+      std::shared_ptr<igsioTrackedFrame> trackedFrame = std::make_shared<igsioTrackedFrame>();
+      if (this->GetTrackedFrame(itemTimestamp, *trackedFrame) != PLUS_SUCCESS)
+      {
+        LOG_WARNING("Unable to get the tracked frame of channel " << (this->ChannelId ? this->ChannelId : "(unknown)") << " for the subscribers at time: " << std::fixed << itemTimestamp);
+        continue;
+      }
+
+      PlusChannelSubscription::FramePointer frame(trackedFrame);
+      std::lock_guard<std::mutex> subscriptionsLock(this->SubscriptionsMutex);
+      for (std::vector<std::shared_ptr<PlusChannelSubscription> >::iterator it = this->Subscriptions.begin(); it != this->Subscriptions.end(); ++it)
+      {
+        (*it)->PushFrame(frame);
+      }
+    }
+
+    if (!frameDispatched)
+    {
+      // The new items of the master source are not available in the other sources yet
+      vtkIGSIOAccurateTimer::Delay(SUBSCRIPTION_RETRY_DELAY_SEC);
+    }
+  }
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusChannel::GetOldestTimestamp(double& ts)
 {
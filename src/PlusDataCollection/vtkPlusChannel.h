@@ -10,14 +10,27 @@
 #include "PlusConfigure.h"
 #include "vtkPlusDataCollectionExport.h"
 
+#include "PlusChannelSubscription.h"
+#include "PlusPoseInterpolator.h"
 #include "PlusStreamBufferItem.h"
 #include "vtkDataObject.h"
 #include "vtkPlusRfProcessor.h"
 
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STL includes
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 //class igsioTrackedFrame; 
 class vtkPlusHTMLGenerator;
 class vtkPlusDataSource;
 class vtkPlusDevice;
+class vtkMatrix4x4;
 //class vtkIGSIOTrackedFrameList;
 
 typedef std::map<std::string, vtkPlusDataSource*> DataSourceContainer;
@@ -108,10 +121,35 @@ public:
     \param timestamp Timestamp of the requested tracked frame
     \param trackedFrame Target tracked frame
     \param enableImageData Enable returning of image data. Tracking data will be interpolated at the timestamp of the image data.
+    The pixel data is copied, the tracked frame may be modified by the caller (see GetTrackedFrameView for read-only access without copying).
+    The tool buffers are pinned while the frame is read (see vtkPlusBuffer::PinItems), so the tool lookups
+    are not affected by items that are added in the meantime, and the call fails if a tool buffer could not keep
+    its pinned items. The video frame is found and referenced while the video buffer is locked. Field data sources
+    are not pinned (their circular buffers overwrite items in place), each of them is read under its own buffer lock.
   */
   virtual PlusStatus GetTrackedFrame(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData = true);
   virtual PlusStatus GetTrackedFrame(igsioTrackedFrame& trackedFrame);
 
+  /*!
+    Same as GetTrackedFrame, but the image data of the tracked frame references the pixel data in the video buffer
+    instead of copying it. The pixel data must not be modified through the tracked frame. The buffer does not overwrite
+    pixel data that is still referenced, and copies of the tracked frame own their pixel data.
+  */
+  virtual PlusStatus GetTrackedFrameView(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData = true);
+  /*! Get the most recent tracked frame as a view, see GetTrackedFrameView */
+  virtual PlusStatus GetTrackedFrameView(igsioTrackedFrame& trackedFrame);
+
+  /*!
+    Append a tracked frame to the list for each of the specified timestamps, containing only the transforms of the tools.
+    The video source and the field data sources are not read. The tool buffers are pinned once for all the frames.
+    \param timestamps Timestamps of the requested frames, in ascending order
+    \param aTrackedFrameList Tracked frame list that the frames are appended to
+    \param reuseFrames If true then the frames that are already in the list are overwritten instead of appending new frames,
+    and the list is resized to the number of timestamps. New frames are allocated only if the list has fewer frames.
+    The fields of the reused frames are replaced by the tool transforms.
+  */
+  virtual PlusStatus GetToolTrackedFrames(const std::vector<double>& timestamps, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames = false);
+
   /*!
     Get the tracked frame list from devices since time specified
     \param aTimestampOfLastFrameAlreadyGot Used for preventing returning the same frame multiple times. In: the timestamp of the timestamp that has been already returned in previous GetTrackedFrameListSampled calls. If no frames have got yet then set it to UNDEFINED_TIMESTAMP. Out: the timestamp of the most recent frame that is returned.
@@ -119,8 +157,9 @@ public:
     \param aTrackedFrameList Tracked frame list used to get the newly acquired frames into. The new frames are appended to the tracked frame.
     \param aSamplingPeriodSec Sampling period time for getting the frames in seconds (timestamps are in seconds too)
     \param maxTimeLimitSec Maximum time spent in the function (in sec)
+    \param referenceImageData If true then the frames reference the pixel data in the video buffer and must not be modified (see GetTrackedFrameView)
   */
-  virtual PlusStatus GetTrackedFrameListSampled(double& aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkIGSIOTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec = -1);
+  virtual PlusStatus GetTrackedFrameListSampled(double& aTimestampOfLastFrameAlreadyGot, double& aTimestampOfNextFrameToBeAdded, vtkIGSIOTrackedFrameList* aTrackedFrameList, double aSamplingPeriodSec, double maxTimeLimitSec = -1, bool referenceImageData = false);
 
   /*!
     Get all the tracked frame list from devices since time specified
@@ -130,8 +169,9 @@ public:
       Out: the timestamp of the most recent frame that is returned.
     \param aTrackedFrameList Tracked frame list used to get the newly acquired frames into. The new frames are appended to the tracked frame.
     \param aMaxNumberOfFramesToAdd Maximum this number of frames will be added (can be used for limiting the time spent in this method)
+    \param referenceImageData If true then the frames reference the pixel data in the video buffer and must not be modified (see GetTrackedFrameView)
   */
-  PlusStatus GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd);
+  PlusStatus GetTrackedFrameList(double& aTimestampOfLastFrameAlreadyGot, vtkIGSIOTrackedFrameList* aTrackedFrameList, int aMaxNumberOfFramesToAdd, bool referenceImageData = false);
 
   /*! Get the closest tracked frame timestamp to the specified time */
   virtual double GetClosestTrackedFrameTimestampByTime(double time);
@@ -142,6 +182,28 @@ public:
   /*! Return the oldest synchronized timestamp in the buffers */
   virtual PlusStatus GetOldestTimestamp(double& ts);
 
+  /*!
+    Block the calling thread until the most recent timestamp of the channel (see GetMostRecentTimestamp) is newer
+    than the specified timestamp, i.e., GetTrackedFrameList can return a new frame, or the timeout expires.
+    Data consumers can call this instead of polling GetTrackedFrameList periodically. Returns PLUS_FAIL on timeout.
+  */
+  virtual PlusStatus WaitForItemNewerThan(double timestamp, double timeoutSec);
+
+  /*!
+    Register a subscriber that receives the new tracked frames of the channel, as they are acquired.
+    A frame is delivered at the timestamp of each new item of the video source (or of the timestamp master tool,
+    if there is no video source), once the data of all the sources of the channel is available for that time.
+    Each frame is assembled only once, by a dispatch thread of the channel, and the same shared frame is delivered
+    to all the subscribers. The dispatch thread is started by the first subscription and stopped when the last one is removed.
+    \param maximumQueueDepth Maximum number of frames that are kept for the subscriber
+    \param overflowPolicy Frame that is dropped if the queue of the subscriber is full
+  */
+  std::shared_ptr<PlusChannelSubscription> Subscribe(unsigned int maximumQueueDepth, PlusChannelSubscription::OverflowPolicyType overflowPolicy = PlusChannelSubscription::DROP_OLDEST);
+  /*! Stop delivering frames to the subscriber. Frames that are already in its queue remain available. */
+  PlusStatus Unsubscribe(const std::shared_ptr<PlusChannelSubscription>& subscription);
+  /*! Number of registered subscribers */
+  int GetNumberOfSubscriptions();
+
   virtual PlusStatus Clear();
 
   virtual void ShallowCopy(vtkDataObject*);
@@ -174,6 +236,78 @@ protected:
   /*! Get number of tracked frames between two given timestamps (inclusive) */
   virtual int GetNumberOfFramesBetweenTimestamps(double aTimestampFrom, double aTimestampTo);
 
+  /*!
+    State of one GetTrackedFrame or GetToolTrackedFrames call: the pinned tool items, the tool transform names
+    and the scratch data for reading the items and interpolating the poses of all tools at once.
+    Each call uses its own instance, so concurrent readers of the channel do not block each other. The instances
+    are reused by the later calls (see AcquireReadContext), so the scratch data is not allocated for every frame.
+  */
+  struct TrackedFrameReadContext
+  {
+    TrackedFrameReadContext();
+    /*! Clear the state of the previous call, the allocated scratch data is kept */
+    void Reset();
+    std::vector<std::pair<vtkPlusDataSource*, BufferItemUidType> > PinnedItems;
+    std::shared_ptr<const std::vector<igsioTransformName> > ToolTransformNames;
+    PlusPoseInterpolator ToolPoseInterpolator;
+    std::vector<PlusPoseInterpolationSample> ToolInterpolationSamples;
+    std::vector<bool> ToolInterpolationSampleValid;
+    vtkSmartPointer<vtkMatrix4x4> ToolTransformMatrix;
+    /*! UID of the video item found by the previous lookup, the next lookup of this reader starts from here */
+    BufferItemUidType VideoSearchHintUid;
+    /*! Devices of the tools and their tool batch sequence numbers at the start of the read, see ReadToolInterpolationSamples */
+    std::vector<vtkPlusDevice*> ToolDevices;
+    std::vector<unsigned long> ToolBatchSequences;
+    /*! Tools whose buffers are locked if batches keep being added while the tools are read */
+    std::vector<vtkPlusDataSource*> LockedTools;
+    /*! Item of the video source, it references the pixel data of the buffer until the context is reset */
+    StreamBufferItem VideoItem;
+    /*! Image of VideoItem while it does not reference the buffer, items read from the spill file are copied into it */
+    vtkSmartPointer<vtkImageData> VideoItemImage;
+    /*! Item of the field data source that is being read */
+    StreamBufferItem FieldDataItem;
+  };
+
+  /*! Get a read context that is not used by other calls, it must be returned by ReleaseReadContext */
+  TrackedFrameReadContext* AcquireReadContext();
+  /*! Reset the read context and make it available for the next call */
+  void ReleaseReadContext(TrackedFrameReadContext* context);
+
+  /*! Read the tracked frame, the buffers of the sources must be pinned by PinSourceItems */
+  PlusStatus GetTrackedFrameFromPinnedSources(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData, bool referenceImageData, TrackedFrameReadContext& context);
+
+  /*! Get a tracked frame with copied or referenced pixel data */
+  PlusStatus InternalGetTrackedFrame(double timestamp, igsioTrackedFrame& trackedFrame, bool enableImageData, bool referenceImageData);
+
+  /*!
+    Set the transforms of all tools in the tracked frame, interpolated at synchronizedTimestamp.
+    synchronizedTimestamp is updated to the timestamp of the tool items. The tool buffers must be pinned by PinSourceItems.
+  */
+  PlusStatus GetToolTransformsFromPinnedSources(double& synchronizedTimestamp, igsioTrackedFrame& trackedFrame, TrackedFrameReadContext& context);
+
+  /*!
+    Get the interpolation samples of all tools at synchronizedTimestamp into the read context, ToolInterpolationSampleValid is false
+    for the tools that have no item at that time. All the tools are read either before or after any batched tool update
+    (see vtkPlusDevice::GetToolBatchSequence). synchronizedTimestamp is updated to the timestamp of the tool items.
+  */
+  void ReadToolInterpolationSamples(double& synchronizedTimestamp, TrackedFrameReadContext& context);
+
+  /*!
+    Pin and unpin the items of the buffers of the sources that are read (see vtkPlusBuffer::PinItems): all the tools,
+    and the video source and the field data sources if requested. The pins are stored in the read context.
+    UnpinSourceItems returns PLUS_FAIL if pinned items had to be discarded while the pins were held.
+  */
+  void PinSourceItems(TrackedFrameReadContext& context, bool pinVideoSource, bool pinFieldDataSources);
+  PlusStatus UnpinSourceItems(TrackedFrameReadContext& context);
+
+  /*! Get the transform names of the tools, they are parsed from the source IDs only if the tools have changed */
+  std::shared_ptr<const std::vector<igsioTransformName> > GetToolTransformNames();
+
+  /*! Body of the subscription dispatch thread: assemble the new tracked frames and deliver them to the subscribers */
+  void DispatchSubscriptionFrames();
+  /*! Stop the subscription dispatch thread and wait for it, SubscriptionControlMutex must be locked by the caller */
+  void StopSubscriptionDispatchThread();
+
 protected:
   DataSourceContainer       FieldDataSources;
   DataSourceContainer       Tools;
@@ -199,6 +333,30 @@ protected:
 
   CustomAttributeMap CustomAttributes;
 
+  /*!
+    Transform names of the tools, in the order of Tools. Parsed only when the tools of the channel change
+    (ToolTransformNamesUpToDate is cleared by ReadConfiguration, AddTool, RemoveTool and RemoveTools).
+    The readers get the current list under ToolTransformNamesMutex and keep using it without the lock.
+  */
+  std::mutex ToolTransformNamesMutex;
+  std::shared_ptr<const std::vector<igsioTransformName> > ToolTransformNames;
+  std::atomic<bool> ToolTransformNamesUpToDate;
+
+  /*! Read contexts that are not used by any call at the moment, guarded by FreeReadContextsMutex */
+  std::mutex FreeReadContextsMutex;
+  std::vector<std::unique_ptr<TrackedFrameReadContext> > FreeReadContexts;
+
+  /*!
+    Subscribers of the channel and the thread that delivers the new frames to them.
+    SubscriptionControlMutex serializes Subscribe and Unsubscribe (starting and stopping the thread),
+    SubscriptionsMutex guards the list of subscribers, which is also read by the dispatch thread.
+  */
+  std::mutex SubscriptionControlMutex;
+  std::mutex SubscriptionsMutex;
+  std::vector<std::shared_ptr<PlusChannelSubscription> > Subscriptions;
+  std::thread SubscriptionDispatchThread;
+  std::atomic<bool> SubscriptionDispatchStopRequested;
+
   vtkPlusChannel(void);
   virtual ~vtkPlusChannel(void);
 
@@ -5,7 +5,9 @@ See License.txt for details.
 =========================================================Plus=header=end*/
 
 // Local includes
+#include "PlusAcquisitionScheduler.h"
 #include "PlusConfigure.h"
+#include "PlusEventDrivenUpdateDispatcher.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataCollector.h"
@@ -25,7 +27,17 @@ See License.txt for details.
 #endif
 
 // STD includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <set>
+#include <thread>
 
 // VTK includes
 #include <vtkObjectFactory.h>
@@ -36,13 +48,36 @@ See License.txt for details.
 
 vtkStandardNewMacro(vtkPlusDataCollector);
 
+namespace
+{
+  const double BYTES_PER_MB = 1024.0 * 1024.0;
+  // buffers are not shrunk below this number of items to fit in the buffer memory budget
+  const int MINIMUM_SHRUNK_BUFFER_SIZE = 10;
+  // maximum number of devices that are connected, started or disconnected at the same time
+  const unsigned int MAXIMUM_NUMBER_OF_DEVICE_WORKER_THREADS = 16;
+  // maximum number of sequence files that are written at the same time when the buffers are dumped
+  const unsigned int MAXIMUM_NUMBER_OF_DUMP_BUFFERS_THREADS = 4;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusDataCollector::vtkPlusDataCollector()
   : vtkObject()
   , StartupDelaySec(0.0)
+  , ParallelDeviceStartup(false)
+  , StartupTimeoutSec(0.0)
+  , UseAcquisitionScheduler(false)
+  , AcquisitionScheduler(std::make_shared<PlusAcquisitionScheduler>())
+  , VirtualDeviceAcquisitionMode(vtkPlusDevice::ACQUISITION_MODE_RATE_DRIVEN)
+  , EventDrivenUpdateDispatcher(std::make_shared<PlusEventDrivenUpdateDispatcher>())
+  , BufferMemoryBudgetBytes(0)
+  , BufferMemoryBudgetAction(BUFFER_MEMORY_BUDGET_SHRINK_BUFFERS)
   , DeviceFactory(vtkSmartPointer<vtkPlusDeviceFactory>::New())
   , Connected(false)
   , Started(false)
+  , NextDumpBuffersJobIndex(0)
+  , DumpBuffersStatus(PLUS_SUCCESS)
+  , NumberOfRunningDumpBuffersThreads(0)
+  , DumpBuffersCancelRequested(false)
 {
   vtkStreamingVolumeCodecFactory* factory = vtkStreamingVolumeCodecFactory::GetInstance();
 #if defined PLUS_USE_VP9
@@ -55,6 +90,10 @@ vtkPlusDataCollector::vtkPlusDataCollector()
 vtkPlusDataCollector::~vtkPlusDataCollector()
 {
   LOG_TRACE("vtkPlusDataCollector::~vtkPlusDataCollector()");
+  // the buffer dump reads the buffers of the devices
+  this->CancelDumpBuffers();
+  this->WaitForDumpBuffers();
+
   if (this->Started)
   {
     this->Stop();
@@ -63,6 +102,8 @@ vtkPlusDataCollector::~vtkPlusDataCollector()
   {
     this->Disconnect();
   }
+  // the dispatcher updates the devices even if they were started without connecting the data collector
+  this->EventDrivenUpdateDispatcher->Stop();
 
   for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
   {
@@ -105,6 +146,101 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
     LOG_DEBUG("StartupDelaySec: " << std::fixed << startupDelaySec);
   }
 
+  const char* parallelDeviceStartup = dataCollectionElement->GetAttribute("ParallelDeviceStartup");
+  if (parallelDeviceStartup != NULL)
+  {
+    if (STRCASECMP(parallelDeviceStartup, "TRUE") == 0)
+    {
+      this->SetParallelDeviceStartup(true);
+    }
+    else if (STRCASECMP(parallelDeviceStartup, "FALSE") == 0)
+    {
+      this->SetParallelDeviceStartup(false);
+    }
+    else
+    {
+      LOG_ERROR("Invalid ParallelDeviceStartup \"" << parallelDeviceStartup << "\". Valid values: TRUE, FALSE");
+      return PLUS_FAIL;
+    }
+  }
+
+  double startupTimeoutSec(0.0);
+  if (dataCollectionElement->GetScalarAttribute("StartupTimeoutSec", startupTimeoutSec))
+  {
+    if (startupTimeoutSec < 0)
+    {
+      LOG_ERROR("Invalid StartupTimeoutSec: " << startupTimeoutSec);
+      return PLUS_FAIL;
+    }
+    this->SetStartupTimeoutSec(startupTimeoutSec);
+  }
+
+  const char* useAcquisitionScheduler = dataCollectionElement->GetAttribute("UseAcquisitionScheduler");
+  if (useAcquisitionScheduler != NULL)
+  {
+    if (STRCASECMP(useAcquisitionScheduler, "TRUE") == 0)
+    {
+      this->SetUseAcquisitionScheduler(true);
+    }
+    else if (STRCASECMP(useAcquisitionScheduler, "FALSE") == 0)
+    {
+      this->SetUseAcquisitionScheduler(false);
+    }
+    else
+    {
+      LOG_ERROR("Invalid UseAcquisitionScheduler \"" << useAcquisitionScheduler << "\". Valid values: TRUE, FALSE");
+      return PLUS_FAIL;
+    }
+  }
+
+  int acquisitionSchedulerThreads(0);
+  if (dataCollectionElement->GetScalarAttribute("AcquisitionSchedulerThreads", acquisitionSchedulerThreads))
+  {
+    if (acquisitionSchedulerThreads < 1)
+    {
+      LOG_ERROR("Invalid AcquisitionSchedulerThreads: " << acquisitionSchedulerThreads);
+      return PLUS_FAIL;
+    }
+    this->AcquisitionScheduler->SetNumberOfWorkerThreads(acquisitionSchedulerThreads);
+  }
+
+  const char* virtualDeviceAcquisitionMode = dataCollectionElement->GetAttribute("VirtualDeviceAcquisitionMode");
+  if (virtualDeviceAcquisitionMode != NULL
+      && vtkPlusDevice::GetAcquisitionModeFromString(virtualDeviceAcquisitionMode, this->VirtualDeviceAcquisitionMode) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid VirtualDeviceAcquisitionMode \"" << virtualDeviceAcquisitionMode << "\". Valid values: RATE_DRIVEN, EVENT_DRIVEN");
+    return PLUS_FAIL;
+  }
+
+  double bufferMemoryBudgetMB(0.0);
+  if (dataCollectionElement->GetScalarAttribute("BufferMemoryBudgetMB", bufferMemoryBudgetMB))
+  {
+    if (bufferMemoryBudgetMB < 0)
+    {
+      LOG_ERROR("Invalid BufferMemoryBudgetMB: " << bufferMemoryBudgetMB);
+      return PLUS_FAIL;
+    }
+    this->SetBufferMemoryBudgetBytes(static_cast<unsigned long long>(bufferMemoryBudgetMB * BYTES_PER_MB));
+  }
+
+  const char* bufferMemoryBudgetAction = dataCollectionElement->GetAttribute("BufferMemoryBudgetAction");
+  if (bufferMemoryBudgetAction != NULL)
+  {
+    if (STRCASECMP(bufferMemoryBudgetAction, "SHRINK_BUFFERS") == 0)
+    {
+      this->SetBufferMemoryBudgetAction(BUFFER_MEMORY_BUDGET_SHRINK_BUFFERS);
+    }
+    else if (STRCASECMP(bufferMemoryBudgetAction, "FAIL") == 0)
+    {
+      this->SetBufferMemoryBudgetAction(BUFFER_MEMORY_BUDGET_FAIL);
+    }
+    else
+    {
+      LOG_ERROR("Invalid BufferMemoryBudgetAction \"" << bufferMemoryBudgetAction << "\". Valid values: SHRINK_BUFFERS, FAIL");
+      return PLUS_FAIL;
+    }
+  }
+
   std::set<std::string> existingDeviceIds;
 
   for (int i = 0; i < dataCollectionElement->GetNumberOfNestedElements(); ++i)
@@ -137,6 +273,15 @@ PlusStatus vtkPlusDataCollector::ReadConfiguration(vtkXMLDataElement* aConfig)
       continue;
     }
     device->SetDataCollector(this);
+    if (this->UseAcquisitionScheduler)
+    {
+      device->SetAcquisitionScheduler(this->AcquisitionScheduler);
+    }
+    device->SetEventDrivenUpdateDispatcher(this->EventDrivenUpdateDispatcher);
+    if (device->IsVirtual())
+    {
+      device->SetRequestedAcquisitionMode(this->VirtualDeviceAcquisitionMode);
+    }
     if (device->ReadConfiguration(aConfig) != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to read parameters of device: " << deviceElement->GetAttribute("Id") << " (type: " << deviceElement->GetAttribute("Type") << ")");
@@ -282,6 +427,36 @@ PlusStatus vtkPlusDataCollector::WriteConfiguration(vtkXMLDataElement* aConfig)
 
   dataCollectionConfig->SetDoubleAttribute("StartupDelaySec", GetStartupDelaySec());
 
+  if (this->ParallelDeviceStartup || dataCollectionConfig->GetAttribute("ParallelDeviceStartup") != NULL)
+  {
+    dataCollectionConfig->SetAttribute("ParallelDeviceStartup", this->ParallelDeviceStartup ? "TRUE" : "FALSE");
+  }
+  if (this->StartupTimeoutSec > 0 || dataCollectionConfig->GetAttribute("StartupTimeoutSec") != NULL)
+  {
+    dataCollectionConfig->SetDoubleAttribute("StartupTimeoutSec", this->StartupTimeoutSec);
+  }
+  if (this->UseAcquisitionScheduler || dataCollectionConfig->GetAttribute("UseAcquisitionScheduler") != NULL)
+  {
+    dataCollectionConfig->SetAttribute("UseAcquisitionScheduler", this->UseAcquisitionScheduler ? "TRUE" : "FALSE");
+  }
+  if (dataCollectionConfig->GetAttribute("AcquisitionSchedulerThreads") != NULL)
+  {
+    dataCollectionConfig->SetIntAttribute("AcquisitionSchedulerThreads", this->AcquisitionScheduler->GetNumberOfWorkerThreads());
+  }
+  if (this->VirtualDeviceAcquisitionMode != vtkPlusDevice::ACQUISITION_MODE_RATE_DRIVEN || dataCollectionConfig->GetAttribute("VirtualDeviceAcquisitionMode") != NULL)
+  {
+    dataCollectionConfig->SetAttribute("VirtualDeviceAcquisitionMode", vtkPlusDevice::GetAcquisitionModeAsString(this->VirtualDeviceAcquisitionMode).c_str());
+  }
+
+  if (this->BufferMemoryBudgetBytes > 0 || dataCollectionConfig->GetAttribute("BufferMemoryBudgetMB") != NULL)
+  {
+    dataCollectionConfig->SetDoubleAttribute("BufferMemoryBudgetMB", this->BufferMemoryBudgetBytes / BYTES_PER_MB);
+  }
+  if (dataCollectionConfig->GetAttribute("BufferMemoryBudgetAction") != NULL)
+  {
+    dataCollectionConfig->SetAttribute("BufferMemoryBudgetAction", this->BufferMemoryBudgetAction == BUFFER_MEMORY_BUDGET_FAIL ? "FAIL" : "SHRINK_BUFFERS");
+  }
+
   PlusStatus status = PLUS_SUCCESS;
 
   for (DeviceCollectionConstIterator it = Devices.begin(); it != Devices.end(); ++it)
@@ -318,20 +493,24 @@ PlusStatus vtkPlusDataCollector::Start()
 {
   LOG_TRACE("vtkPlusDataCollector::Start()");
 
-  PlusStatus status = PLUS_SUCCESS;
-
   const double startTime = vtkIGSIOAccurateTimer::GetSystemTime();
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  PlusStatus status = this->ProcessDevices("Start", [startTime](vtkPlusDevice * device) -> PlusStatus
   {
-    vtkPlusDevice* device = *it;
-
-    if (device->StartRecording() != PLUS_SUCCESS)
+    PlusStatus deviceStatus = device->StartRecording();
+    if (deviceStatus != PLUS_SUCCESS)
     {
       LOG_ERROR("Failed to start data acquisition for device " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
     }
     device->SetStartTime(startTime);
+    return deviceStatus;
+  }, false, this->StartupTimeoutSec);
+
+  // The dependency order of the event-driven devices is computed once, after all of them are recording
+  if (this->EventDrivenUpdateDispatcher->Start(this->Devices) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to start the updates of the event-driven devices");
+    status = PLUS_FAIL;
   }
 
   LOG_DEBUG("vtkPlusDataCollector::Start -- wait " << std::fixed << this->StartupDelaySec << " sec for buffer init...");
@@ -358,24 +537,39 @@ PlusStatus vtkPlusDataCollector::Connect()
 {
   LOG_TRACE("vtkPlusDataCollector::Connect()");
 
-  PlusStatus status = PLUS_SUCCESS;
-
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  PlusStatus status = this->ProcessDevices("Connect", [](vtkPlusDevice * device) -> PlusStatus
   {
-    vtkPlusDevice* device = *it;
-
-    if (device->Connect() != PLUS_SUCCESS)
+    PlusStatus deviceStatus = device->Connect();
+    if (deviceStatus != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to connect device: " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
     }
-  }
+    return deviceStatus;
+  }, false, this->StartupTimeoutSec);
 
   if (status != PLUS_SUCCESS)
   {
     this->Disconnect();
     status = PLUS_FAIL;
   }
+  else if (this->EnforceBufferMemoryBudget() != PLUS_SUCCESS)
+  {
+    // the frame sizes are known only after the devices are connected
+    LOG_ERROR("Buffers of the devices do not fit in the buffer memory budget. Devices are disconnected.");
+    this->Disconnect();
+    status = PLUS_FAIL;
+  }
+  else
+  {
+    // Map the frame memory only after the buffers fit in the budget, so that the first seconds of the acquisition
+    // are not slowed down by page faults
+    std::vector<vtkPlusDataSource*> dataSources;
+    this->GetBufferedDataSources(dataSources);
+    for (std::vector<vtkPlusDataSource*>::iterator it = dataSources.begin(); it != dataSources.end(); ++it)
+    {
+      (*it)->GetBuffer()->PrefaultFrameMemory();
+    }
+  }
 
   if (this->SetLoopTimes() != PLUS_SUCCESS)
   {
@@ -387,23 +581,158 @@ PlusStatus vtkPlusDataCollector::Connect()
   return status;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::GetBufferedDataSources(std::vector<vtkPlusDataSource*>& dataSources) const
+{
+  dataSources.clear();
+  std::set<vtkPlusDataSource*> addedDataSources;
+  for (DeviceCollectionConstIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
+  {
+    vtkPlusDevice* device = *it;
+    DataSourceContainerConstIterator begins[3] = { device->GetVideoSourceIteratorBegin(), device->GetToolIteratorBegin(), device->GetFieldDataSourcessIteratorBegin() };
+    DataSourceContainerConstIterator ends[3] = { device->GetVideoSourceIteratorEnd(), device->GetToolIteratorEnd(), device->GetFieldDataSourcessIteratorEnd() };
+    for (int i = 0; i < 3; ++i)
+    {
+      for (DataSourceContainerConstIterator sourceIt = begins[i]; sourceIt != ends[i]; ++sourceIt)
+      {
+        // virtual devices (such as mixers) share the data sources of their input devices
+        if (sourceIt->second != NULL && addedDataSources.insert(sourceIt->second).second)
+        {
+          dataSources.push_back(sourceIt->second);
+        }
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusDataCollector::GetAllocatedBufferMemoryInBytes() const
+{
+  std::vector<vtkPlusDataSource*> dataSources;
+  this->GetBufferedDataSources(dataSources);
+  unsigned long long allocatedBytes(0);
+  for (std::vector<vtkPlusDataSource*>::iterator it = dataSources.begin(); it != dataSources.end(); ++it)
+  {
+    allocatedBytes += (*it)->GetBufferAllocatedMemoryInBytes();
+  }
+  return allocatedBytes;
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusDataCollector::GetUsedBufferMemoryInBytes() const
+{
+  std::vector<vtkPlusDataSource*> dataSources;
+  this->GetBufferedDataSources(dataSources);
+  unsigned long long usedBytes(0);
+  for (std::vector<vtkPlusDataSource*>::iterator it = dataSources.begin(); it != dataSources.end(); ++it)
+  {
+    usedBytes += (*it)->GetBufferUsedMemoryInBytes();
+  }
+  return usedBytes;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::EnforceBufferMemoryBudget()
+{
+  if (this->BufferMemoryBudgetBytes == 0)
+  {
+    // no limit
+    return PLUS_SUCCESS;
+  }
+
+  std::vector<vtkPlusDataSource*> dataSources;
+  this->GetBufferedDataSources(dataSources);
+  unsigned long long allocatedBytes = this->GetAllocatedBufferMemoryInBytes();
+  LOG_INFO("Buffer memory: " << std::fixed << std::setprecision(1) << allocatedBytes / BYTES_PER_MB << " MB allocated by " << dataSources.size()
+           << " buffers, budget: " << this->BufferMemoryBudgetBytes / BYTES_PER_MB << " MB");
+  if (allocatedBytes <= this->BufferMemoryBudgetBytes)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  // Lower priority first, larger buffers first within the same priority
+  std::stable_sort(dataSources.begin(), dataSources.end(), [](vtkPlusDataSource * a, vtkPlusDataSource * b) -> bool
+  {
+    if (a->GetBufferPriority() != b->GetBufferPriority())
+    {
+      return a->GetBufferPriority() < b->GetBufferPriority();
+    }
+    return a->GetBufferAllocatedMemoryInBytes() > b->GetBufferAllocatedMemoryInBytes();
+  });
+
+  if (this->BufferMemoryBudgetAction == BUFFER_MEMORY_BUDGET_FAIL)
+  {
+    for (std::vector<vtkPlusDataSource*>::iterator it = dataSources.begin(); it != dataSources.end(); ++it)
+    {
+      LOG_INFO("  " << ((*it)->GetDevice() ? (*it)->GetDevice()->GetDeviceId() : "") << "/" << (*it)->GetId() << ": " << (*it)->GetBufferSize() << " items, "
+               << (*it)->GetBufferAllocatedMemoryInBytes() / BYTES_PER_MB << " MB, priority " << (*it)->GetBufferPriority());
+    }
+    LOG_WARNING("Buffers allocate " << allocatedBytes / BYTES_PER_MB << " MB, which exceeds the buffer memory budget of " << this->BufferMemoryBudgetBytes / BYTES_PER_MB << " MB");
+    return PLUS_FAIL;
+  }
+
+  // Shrink the buffers of each priority level proportionally, until the buffers fit in the budget
+  for (std::vector<vtkPlusDataSource*>::iterator groupBegin = dataSources.begin(); groupBegin != dataSources.end() && allocatedBytes > this->BufferMemoryBudgetBytes;)
+  {
+    std::vector<vtkPlusDataSource*>::iterator groupEnd = groupBegin;
+    unsigned long long shrinkableBytes(0);
+    for (; groupEnd != dataSources.end() && (*groupEnd)->GetBufferPriority() == (*groupBegin)->GetBufferPriority(); ++groupEnd)
+    {
+      int bufferSize = (*groupEnd)->GetBufferSize();
+      shrinkableBytes += static_cast<unsigned long long>(bufferSize - std::min(bufferSize, MINIMUM_SHRUNK_BUFFER_SIZE)) * (*groupEnd)->GetBufferItemSizeInBytes();
+    }
+    if (shrinkableBytes > 0)
+    {
+      double shrinkRatio = std::min(1.0, static_cast<double>(allocatedBytes - this->BufferMemoryBudgetBytes) / shrinkableBytes);
+      for (std::vector<vtkPlusDataSource*>::iterator it = groupBegin; it != groupEnd; ++it)
+      {
+        int bufferSize = (*it)->GetBufferSize();
+        int removedItems = static_cast<int>(ceil(shrinkRatio * (bufferSize - std::min(bufferSize, MINIMUM_SHRUNK_BUFFER_SIZE))));
+        if (removedItems <= 0)
+        {
+          continue;
+        }
+        if ((*it)->SetBufferSize(bufferSize - removedItems) != PLUS_SUCCESS)
+        {
+          LOG_ERROR("Failed to shrink buffer of " << ((*it)->GetDevice() ? (*it)->GetDevice()->GetDeviceId() : "") << "/" << (*it)->GetId());
+          return PLUS_FAIL;
+        }
+        LOG_WARNING("Buffer size of " << ((*it)->GetDevice() ? (*it)->GetDevice()->GetDeviceId() : "") << "/" << (*it)->GetId() << " (priority " << (*it)->GetBufferPriority()
+                    << ") is reduced from " << bufferSize << " to " << bufferSize - removedItems << " items to fit in the buffer memory budget");
+      }
+    }
+    allocatedBytes = this->GetAllocatedBufferMemoryInBytes();
+    groupBegin = groupEnd;
+  }
+
+  if (allocatedBytes > this->BufferMemoryBudgetBytes)
+  {
+    LOG_WARNING("Buffers allocate " << allocatedBytes / BYTES_PER_MB << " MB with the minimum buffer size of " << MINIMUM_SHRUNK_BUFFER_SIZE
+              << " items, which exceeds the buffer memory budget of " << this->BufferMemoryBudgetBytes / BYTES_PER_MB << " MB");
+    return PLUS_FAIL;
+  }
+  LOG_INFO("Buffer memory after shrinking buffers: " << allocatedBytes / BYTES_PER_MB << " MB");
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::Disconnect()
 {
   LOG_TRACE("vtkPlusDataCollector::Disconnect()");
 
-  PlusStatus status = PLUS_SUCCESS;
+  // Event-driven devices are not updated anymore while the devices are disconnected
+  this->EventDrivenUpdateDispatcher->Stop();
 
-  for (DeviceCollectionIterator it = Devices.begin(); it != Devices.end(); ++ it)
+  // Virtual devices are disconnected before their input devices, so that they do not read the data of a disconnected device
+  PlusStatus status = this->ProcessDevices("Disconnect", [](vtkPlusDevice * device) -> PlusStatus
   {
-    vtkPlusDevice* device = *it;
-
-    if (device->Disconnect() != PLUS_SUCCESS)
+    PlusStatus deviceStatus = device->Disconnect();
+    if (deviceStatus != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to disconnect device: " << device->GetDeviceId() << ".");
-      status = PLUS_FAIL;
     }
-  }
+    return deviceStatus;
+  }, true, 0.0);
 
   Connected = false;
   LOG_DEBUG("vtkPlusDataCollector::Disconnect: All devices have been disconnected");
@@ -411,6 +740,234 @@ PlusStatus vtkPlusDataCollector::Disconnect()
   return status;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::ProcessDevices(const std::string& operationName, const DeviceOperationType& operation, bool reverseDependencies, double timeoutSec)
+{
+  if (this->Devices.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+
+  enum DeviceStateType
+  {
+    DEVICE_WAITING,
+    DEVICE_RUNNING,
+    DEVICE_SUCCEEDED,
+    DEVICE_FAILED,
+    DEVICE_SKIPPED
+  };
+  struct DeviceTask
+  {
+    DeviceTask() : Device(NULL), State(DEVICE_WAITING), NumberOfPendingDependencies(0), StartTime(0.0), EndTime(0.0) {}
+    vtkPlusDevice* Device;
+    DeviceStateType State;
+    int NumberOfPendingDependencies;
+    std::vector<size_t> Dependents; // tasks that wait for this task
+    double StartTime;
+    double EndTime;
+  };
+
+  const double operationStartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+  double deadline = (timeoutSec > 0 ? operationStartTime + timeoutSec : std::numeric_limits<double>::max());
+
+  // Build the dependency graph from the input channels of the devices
+  std::vector<DeviceTask> tasks(this->Devices.size());
+  std::map<vtkPlusDevice*, size_t> taskIndices;
+  for (size_t taskIndex = 0; taskIndex < this->Devices.size(); ++taskIndex)
+  {
+    tasks[taskIndex].Device = this->Devices[taskIndex];
+    taskIndices[this->Devices[taskIndex]] = taskIndex;
+  }
+  for (size_t taskIndex = 0; taskIndex < tasks.size(); ++taskIndex)
+  {
+    std::vector<vtkPlusDevice*> inputDevices;
+    tasks[taskIndex].Device->GetInputDevices(inputDevices);
+    std::set<size_t> inputTaskIndices;
+    for (std::vector<vtkPlusDevice*>::iterator it = inputDevices.begin(); it != inputDevices.end(); ++it)
+    {
+      std::map<vtkPlusDevice*, size_t>::iterator inputTask = taskIndices.find(*it);
+      if (inputTask != taskIndices.end() && inputTask->second != taskIndex)
+      {
+        inputTaskIndices.insert(inputTask->second);
+      }
+    }
+    for (std::set<size_t>::iterator it = inputTaskIndices.begin(); it != inputTaskIndices.end(); ++it)
+    {
+      const size_t waitingTaskIndex = (reverseDependencies ? *it : taskIndex);
+      const size_t awaitedTaskIndex = (reverseDependencies ? taskIndex : *it);
+      tasks[waitingTaskIndex].NumberOfPendingDependencies++;
+      tasks[awaitedTaskIndex].Dependents.push_back(waitingTaskIndex);
+    }
+  }
+
+  std::mutex tasksMutex;
+  std::condition_variable tasksChanged;
+  std::deque<size_t> readyTasks;
+  size_t numberOfFinishedTasks(0);
+  unsigned int numberOfRunningTasks(0);
+  bool noMoreTasks(false);
+  for (size_t taskIndex = 0; taskIndex < tasks.size(); ++taskIndex)
+  {
+    if (tasks[taskIndex].NumberOfPendingDependencies == 0)
+    {
+      readyTasks.push_back(taskIndex);
+    }
+  }
+
+  // The following functions must be called with tasksMutex locked
+  std::function<void(size_t)> skipDependents = [&](size_t taskIndex)
+  {
+    for (std::vector<size_t>::iterator it = tasks[taskIndex].Dependents.begin(); it != tasks[taskIndex].Dependents.end(); ++it)
+    {
+      if (tasks[*it].State == DEVICE_WAITING)
+      {
+        LOG_ERROR(operationName << " of device " << tasks[*it].Device->GetDeviceId() << " is skipped, because it depends on device " << tasks[taskIndex].Device->GetDeviceId());
+        tasks[*it].State = DEVICE_SKIPPED;
+        numberOfFinishedTasks++;
+        skipDependents(*it);
+      }
+    }
+  };
+  auto skipWaitingTasks = [&](const std::string& reason)
+  {
+    readyTasks.clear();
+    for (std::vector<DeviceTask>::iterator it = tasks.begin(); it != tasks.end(); ++it)
+    {
+      if (it->State == DEVICE_WAITING)
+      {
+        LOG_ERROR(operationName << " of device " << it->Device->GetDeviceId() << " is skipped: " << reason);
+        it->State = DEVICE_SKIPPED;
+        numberOfFinishedTasks++;
+      }
+    }
+  };
+  auto takeReadyTask = [&]() -> size_t
+  {
+    size_t taskIndex = readyTasks.front();
+    readyTasks.pop_front();
+    tasks[taskIndex].State = DEVICE_RUNNING;
+    tasks[taskIndex].StartTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    numberOfRunningTasks++;
+    return taskIndex;
+  };
+
+  // This function must be called with tasksMutex unlocked
+  auto runTask = [&](size_t taskIndex)
+  {
+    PlusStatus deviceStatus = operation(tasks[taskIndex].Device);
+    std::lock_guard<std::mutex> tasksLock(tasksMutex);
+    DeviceTask& task = tasks[taskIndex];
+    task.EndTime = vtkIGSIOAccurateTimer::GetSystemTime();
+    task.State = (deviceStatus == PLUS_SUCCESS ? DEVICE_SUCCEEDED : DEVICE_FAILED);
+    numberOfRunningTasks--;
+    numberOfFinishedTasks++;
+    if (task.State == DEVICE_FAILED && !reverseDependencies)
+    {
+      skipDependents(taskIndex);
+    }
+    else
+    {
+      // Devices are released in reverse order even if the operation failed, to make sure that all of them are disconnected
+      for (std::vector<size_t>::iterator it = task.Dependents.begin(); it != task.Dependents.end(); ++it)
+      {
+        if (tasks[*it].State == DEVICE_WAITING && --tasks[*it].NumberOfPendingDependencies == 0)
+        {
+          readyTasks.push_back(*it);
+        }
+      }
+    }
+    tasksChanged.notify_all();
+  };
+
+  std::vector<std::thread> workers;
+  const size_t numberOfWorkers = (this->ParallelDeviceStartup ? std::min<size_t>(tasks.size(), MAXIMUM_NUMBER_OF_DEVICE_WORKER_THREADS) : 0);
+  for (size_t workerIndex = 0; workerIndex < numberOfWorkers; ++workerIndex)
+  {
+    workers.push_back(std::thread([&]()
+    {
+      std::unique_lock<std::mutex> tasksLock(tasksMutex);
+      for (;;)
+      {
+        tasksChanged.wait(tasksLock, [&]() { return !readyTasks.empty() || noMoreTasks; });
+        if (readyTasks.empty())
+        {
+          return;
+        }
+        size_t taskIndex = takeReadyTask();
+        tasksLock.unlock();
+        runTask(taskIndex);
+        tasksLock.lock();
+      }
+    }));
+  }
+
+  {
+    std::unique_lock<std::mutex> tasksLock(tasksMutex);
+    while (numberOfFinishedTasks < tasks.size())
+    {
+      if (vtkIGSIOAccurateTimer::GetSystemTime() >= deadline)
+      {
+        // Devices that are being processed cannot be interrupted, wait until they are finished
+        std::ostringstream reason;
+        reason << "the timeout of " << std::fixed << std::setprecision(1) << timeoutSec << " sec expired";
+        skipWaitingTasks(reason.str());
+        deadline = std::numeric_limits<double>::max();
+        continue;
+      }
+      if (readyTasks.empty() && numberOfRunningTasks == 0)
+      {
+        skipWaitingTasks("circular dependency between the input channels of the devices");
+        break;
+      }
+      if (workers.empty())
+      {
+        // Process the devices one by one in the calling thread
+        size_t taskIndex = takeReadyTask();
+        tasksLock.unlock();
+        runTask(taskIndex);
+        tasksLock.lock();
+      }
+      else if (deadline == std::numeric_limits<double>::max())
+      {
+        tasksChanged.wait(tasksLock);
+      }
+      else
+      {
+        tasksChanged.wait_for(tasksLock, std::chrono::duration<double>(deadline - vtkIGSIOAccurateTimer::GetSystemTime()));
+      }
+    }
+    noMoreTasks = true;
+  }
+  tasksChanged.notify_all();
+  for (std::vector<std::thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+  {
+    it->join();
+  }
+
+  // Timing report
+  PlusStatus status = PLUS_SUCCESS;
+  LOG_INFO(operationName << " of " << tasks.size() << " devices took " << std::fixed << std::setprecision(3) << vtkIGSIOAccurateTimer::GetSystemTime() - operationStartTime
+           << " sec" << (workers.empty() ? "" : " (in parallel)"));
+  for (std::vector<DeviceTask>::iterator it = tasks.begin(); it != tasks.end(); ++it)
+  {
+    if (it->State == DEVICE_SKIPPED)
+    {
+      LOG_INFO("  " << it->Device->GetDeviceId() << ": skipped");
+    }
+    else
+    {
+      LOG_INFO("  " << it->Device->GetDeviceId() << ": " << (it->State == DEVICE_SUCCEEDED ? "succeeded" : "failed") << " in " << std::fixed << std::setprecision(3)
+               << it->EndTime - it->StartTime << " sec, after waiting " << it->StartTime - operationStartTime << " sec");
+    }
+    if (it->State != DEVICE_SUCCEEDED)
+    {
+      status = PLUS_FAIL;
+    }
+  }
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusDataCollector::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -474,33 +1031,170 @@ bool vtkPlusDataCollector::GetConnected() const
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataCollector::DumpBuffersToDirectory(const char* aDirectory)
 {
-  LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << aDirectory << ")");
+  LOG_TRACE("vtkPlusDataCollector::DumpBuffersToDirectory(" << (aDirectory ? aDirectory : "") << ")");
 
-  // Assemble file names
-  std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
+  if (this->StartDumpBuffersToDirectory(aDirectory) != PLUS_SUCCESS)
+  {
+    return PLUS_FAIL;
+  }
+  return this->WaitForDumpBuffers();
+}
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::StartDumpBuffersToDirectory(const char* aDirectory)
+{
+  LOG_TRACE("vtkPlusDataCollector::StartDumpBuffersToDirectory(" << (aDirectory ? aDirectory : "") << ")");
+
+  std::lock_guard<std::mutex> dumpBuffersThreadsLock(this->DumpBuffersThreadsMutex);
+  if (this->IsDumpBuffersInProgress())
+  {
+    LOG_ERROR("Unable to dump the buffers: the previous buffer dump is still in progress");
+    return PLUS_FAIL;
+  }
+  // Release the threads of the previous dump
+  this->JoinDumpBuffersThreads();
+
+  // Assemble file names, one file per device. If the channels of a device have different video sources
+  // then the files of the additional sources are distinguished by the source ID.
+  std::string dateAndTime = vtksys::SystemTools::GetCurrentDateTime("%Y%m%d_%H%M%S");
+  std::vector<DumpBuffersJob> jobs;
   for (DeviceCollectionIterator it = this->Devices.begin(); it != this->Devices.end(); ++it)
   {
     vtkPlusDevice* device = *it;
-
-    std::string outputDeviceBufferSequenceFileName = vtkPlusConfig::GetInstance()->GetOutputPath(std::string("BufferDump_") + device->GetDeviceId() + "_" + dateAndTime + ".nrrd");
-
-    LOG_INFO("Write device buffer to " << outputDeviceBufferSequenceFileName);
-    vtkPlusDataSource* aSource(NULL);
+    std::set<vtkPlusDataSource*> addedSources;
     for (ChannelContainerIterator chanIt = device->GetOutputChannelsStart(); chanIt != device->GetOutputChannelsEnd(); ++chanIt)
     {
-      if ((*chanIt)->GetVideoSource(aSource) != PLUS_SUCCESS)
+      vtkPlusDataSource* aSource(NULL);
+      if (!(*chanIt)->HasVideoSource() || (*chanIt)->GetVideoSource(aSource) != PLUS_SUCCESS || !addedSources.insert(aSource).second)
       {
-        LOG_ERROR("Unable to retrieve the video source in the device.");
-        return PLUS_FAIL;
+        continue;
       }
-      aSource->WriteToSequenceFile(outputDeviceBufferSequenceFileName.c_str(), false);
+      std::string fileName = std::string("BufferDump_") + device->GetDeviceId() + (addedSources.size() > 1 ? std::string("_") + aSource->GetId() : std::string()) + "_" + dateAndTime + ".nrrd";
+      DumpBuffersJob job;
+      job.Source = aSource;
+      job.FileName = (aDirectory != NULL && aDirectory[0] != 0 ? std::string(aDirectory) + "/" + fileName : vtkPlusConfig::GetInstance()->GetOutputPath(fileName));
+      job.NumberOfItems = aSource->GetNumberOfItems();
+      job.Progress = 0.0;
+      LOG_INFO("Write device buffer to " << job.FileName);
+      jobs.push_back(job);
     }
   }
 
+  {
+    std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+    this->DumpBuffersJobs = jobs;
+    this->NextDumpBuffersJobIndex = 0;
+    this->DumpBuffersStatus = PLUS_SUCCESS;
+  }
+  this->DumpBuffersCancelRequested = false;
+
+  const unsigned int numberOfThreads = std::min<unsigned int>(static_cast<unsigned int>(jobs.size()), MAXIMUM_NUMBER_OF_DUMP_BUFFERS_THREADS);
+  this->NumberOfRunningDumpBuffersThreads = numberOfThreads;
+  for (unsigned int threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex)
+  {
+    this->DumpBuffersThreads.push_back(std::thread(&vtkPlusDataCollector::DumpBuffersWorker, this));
+  }
+
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::DumpBuffersWorker()
+{
+  for (;;)
+  {
+    size_t jobIndex(0);
+    vtkPlusDataSource* source(NULL);
+    std::string fileName;
+    {
+      std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+      if (this->NextDumpBuffersJobIndex >= this->DumpBuffersJobs.size())
+      {
+        break;
+      }
+      if (this->DumpBuffersCancelRequested)
+      {
+        // the remaining buffers are not written
+        this->DumpBuffersStatus = PLUS_FAIL;
+        break;
+      }
+      jobIndex = this->NextDumpBuffersJobIndex++;
+      source = this->DumpBuffersJobs[jobIndex].Source;
+      fileName = this->DumpBuffersJobs[jobIndex].FileName;
+    }
+
+    PlusStatus status = source->WriteToSequenceFile(fileName.c_str(), false, [this, jobIndex](double progress) -> bool
+    {
+      std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+      this->DumpBuffersJobs[jobIndex].Progress = progress;
+      return !this->DumpBuffersCancelRequested;
+    });
+
+    std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+    if (status != PLUS_SUCCESS)
+    {
+      if (!this->DumpBuffersCancelRequested)
+      {
+        LOG_ERROR("Failed to write device buffer to " << fileName);
+      }
+      this->DumpBuffersStatus = PLUS_FAIL;
+    }
+  }
+  this->NumberOfRunningDumpBuffersThreads--;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDataCollector::IsDumpBuffersInProgress() const
+{
+  return this->NumberOfRunningDumpBuffersThreads > 0;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusDataCollector::GetDumpBuffersProgress() const
+{
+  std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+  double numberOfItems(0.0);
+  double numberOfWrittenItems(0.0);
+  for (std::vector<DumpBuffersJob>::const_iterator it = this->DumpBuffersJobs.begin(); it != this->DumpBuffersJobs.end(); ++it)
+  {
+    numberOfItems += it->NumberOfItems;
+    numberOfWrittenItems += it->Progress * it->NumberOfItems;
+  }
+  return (numberOfItems > 0 ? numberOfWrittenItems / numberOfItems : 1.0);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::CancelDumpBuffers()
+{
+  this->DumpBuffersCancelRequested = true;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDataCollector::WaitForDumpBuffers()
+{
+  {
+    std::lock_guard<std::mutex> dumpBuffersThreadsLock(this->DumpBuffersThreadsMutex);
+    this->JoinDumpBuffersThreads();
+  }
+
+  std::lock_guard<std::mutex> dumpBuffersLock(this->DumpBuffersMutex);
+  return this->DumpBuffersStatus;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDataCollector::JoinDumpBuffersThreads()
+{
+  // The workers only lock DumpBuffersMutex, so they can finish while the threads mutex is held
+  for (std::vector<std::thread>::iterator it = this->DumpBuffersThreads.begin(); it != this->DumpBuffersThreads.end(); ++it)
+  {
+    if (it->joinable())
+    {
+      it->join();
+    }
+  }
+  this->DumpBuffersThreads.clear();
+}
+
 //----------------------------------------------------------------------------
 DeviceCollectionConstIterator vtkPlusDataCollector::GetDeviceConstIteratorBegin() const
 {
@@ -514,7 +1208,7 @@ DeviceCollectionConstIterator vtkPlusDataCollector::GetDeviceConstIteratorEnd()
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList)
+PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames)
 {
   LOG_TRACE("vtkPlusDataCollector::GetTrackingData(" << aRequestedChannel->GetChannelId() << ", " << aTimestampFrom << ")");
 
@@ -542,13 +1236,33 @@ PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChann
   if (firstActiveTool->GetNumberOfItems() == 0)
   {
     LOG_DEBUG("vtkPlusDataCollector::GetTrackingData: the tracking buffer is empty, no items will be returned");
+    if (reuseFrames)
+    {
+      aTrackedFrameList->Clear();
+    }
     return PLUS_SUCCESS;
   }
 
-  PlusStatus status = PLUS_SUCCESS;
-  BufferItemUidType oldestItemUid = firstActiveTool->GetOldestItemUidInBuffer();
+  // Find the first item that is newer than the requested time instead of scanning the whole buffer
+  BufferItemUidType firstItemUid = 0;
+  if (firstActiveTool->GetFirstItemUidAfterTime(aTimestampFrom, firstItemUid) != ITEM_OK)
+  {
+    // no new items
+    if (reuseFrames)
+    {
+      aTrackedFrameList->Clear();
+    }
+    return PLUS_SUCCESS;
+  }
   BufferItemUidType latestItemUid = firstActiveTool->GetLatestItemUidInBuffer();
-  for (BufferItemUidType itemUid = oldestItemUid; itemUid <= latestItemUid; ++itemUid)
+
+  // Collect the timestamps of the new items, then get the transforms of all of them at once
+  std::vector<double> itemTimestamps;
+  if (latestItemUid >= firstItemUid)
+  {
+    itemTimestamps.reserve(latestItemUid - firstItemUid + 1);
+  }
+  for (BufferItemUidType itemUid = firstItemUid; itemUid <= latestItemUid; ++itemUid)
   {
     double itemTimestamp = 0;
     if (firstActiveTool->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
@@ -562,26 +1276,24 @@ PlusStatus vtkPlusDataCollector::GetTrackingData(vtkPlusChannel* aRequestedChann
       continue;
     }
     aTimestampFrom = itemTimestamp;
-    // Get tracked frame from buffer
-    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-    if (aRequestedChannel->GetTrackedFrame(itemTimestamp, *trackedFrame, false /* get tracking data only */) != PLUS_SUCCESS)
-    {
-      LOG_ERROR("Unable to get tracking data by time: " << std::fixed << itemTimestamp);
-      status = PLUS_FAIL;
-    }
-    // Add tracked frame to the list
-    if (aTrackedFrameList->TakeTrackedFrame(trackedFrame, vtkIGSIOTrackedFrameList::SKIP_INVALID_FRAME) != PLUS_SUCCESS)
+    itemTimestamps.push_back(itemTimestamp);
+  }
+
+  if (itemTimestamps.empty())
+  {
+    if (reuseFrames)
     {
-      LOG_ERROR("Unable to add tracking data to the list!");
-      status = PLUS_FAIL;
+      aTrackedFrameList->Clear();
     }
+    return PLUS_SUCCESS;
   }
 
-  return status;
+  // Tracking data only: the video source and the field data sources are not read
+  return aRequestedChannel->GetToolTrackedFrames(itemTimestamps, aTrackedFrameList, reuseFrames);
 }
 
 //----------------------------------------------------------------------------
-PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList)
+PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames)
 {
   LOG_TRACE("vtkPlusDataCollector::GetVideoData(" << aRequestedChannel->GetChannelId() << ", " << aTimestampFrom << ")");
 
@@ -591,18 +1303,41 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
     return PLUS_FAIL;
   }
 
-  // If the buffer is empty then don't display an error just return without adding any items to the output tracked frame list
   vtkPlusDataSource* aSource(NULL);
-  if (aRequestedChannel->GetVideoSource(aSource) == PLUS_SUCCESS && aSource->GetNumberOfItems() == 0)
+  if (aRequestedChannel->GetVideoSource(aSource) != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Unable to get tracked frame list - there is no video source in channel " << aRequestedChannel->GetChannelId());
+    return PLUS_FAIL;
+  }
+
+  // If the buffer is empty then don't display an error just return without adding any items to the output tracked frame list
+  if (aSource->GetNumberOfItems() == 0)
   {
     LOG_DEBUG("vtkPlusDataCollector::GetVideoData: the video buffer is empty, no items will be returned");
+    if (reuseFrames)
+    {
+      aTrackedFrameList->Clear();
+    }
+    return PLUS_SUCCESS;
+  }
+
+  // Find the first item that is newer than the requested time instead of scanning the whole buffer
+  BufferItemUidType firstItemUid = 0;
+  if (aSource->GetFirstItemUidAfterTime(aTimestampFrom, firstItemUid) != ITEM_OK)
+  {
+    // no new items
+    if (reuseFrames)
+    {
+      aTrackedFrameList->Clear();
+    }
     return PLUS_SUCCESS;
   }
 
   PlusStatus status = PLUS_SUCCESS;
-  BufferItemUidType oldestItemUid = aSource->GetOldestItemUidInBuffer();
+  // Index of the next frame to fill, the frames before it are kept
+  unsigned int frameIndex = (reuseFrames ? 0 : aTrackedFrameList->GetNumberOfTrackedFrames());
   BufferItemUidType latestItemUid = aSource->GetLatestItemUidInBuffer();
-  for (BufferItemUidType itemUid = oldestItemUid; itemUid <= latestItemUid; ++itemUid)
+  for (BufferItemUidType itemUid = firstItemUid; itemUid <= latestItemUid; ++itemUid)
   {
     double itemTimestamp = 0;
     if (aSource->GetTimeStamp(itemUid, itemTimestamp) != ITEM_OK)
@@ -616,25 +1351,27 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
       continue;
     }
     aTimestampFrom = itemTimestamp;
-    // Get tracked frame from buffer
-    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
-    StreamBufferItem currentStreamBufferItem;
-    if (aSource->GetStreamBufferItem(itemUid, &currentStreamBufferItem) != ITEM_OK)
+
+    // Copy the frame from the buffer into a frame of the list, a new frame is allocated only if there is no frame to reuse
+    if (frameIndex < aTrackedFrameList->GetNumberOfTrackedFrames())
     {
-      LOG_ERROR("Couldn't get video buffer item by frame UID: " << itemUid);
-      delete trackedFrame;
-      return PLUS_FAIL;
+      if (aSource->CopyItemToTrackedFrame(itemUid, *aTrackedFrameList->GetTrackedFrame(frameIndex)) != ITEM_OK)
+      {
+        LOG_ERROR("Couldn't get video buffer item by frame UID: " << itemUid);
+        status = PLUS_FAIL;
+        break;
+      }
+      ++frameIndex;
+      continue;
     }
 
-    // Copy frame
-    trackedFrame->SetImageData(currentStreamBufferItem.GetFrame());
-    trackedFrame->SetTimestamp(itemTimestamp);
-
-    // Copy all custom fields
-    igsioFieldMapType fieldMap = currentStreamBufferItem.GetFrameFieldMap();
-    for (igsioFieldMapType::const_iterator fieldIterator = fieldMap.begin(); fieldIterator != fieldMap.end(); fieldIterator++)
+    igsioTrackedFrame* trackedFrame = new igsioTrackedFrame;
+    if (aSource->CopyItemToTrackedFrame(itemUid, *trackedFrame) != ITEM_OK)
     {
-      trackedFrame->SetFrameField(fieldIterator->first, fieldIterator->second.second, fieldIterator->second.first);
+      LOG_ERROR("Couldn't get video buffer item by frame UID: " << itemUid);
+      delete trackedFrame;
+      status = PLUS_FAIL;
+      break;
     }
 
     // Add tracked frame to the list
@@ -643,6 +1380,13 @@ PlusStatus vtkPlusDataCollector::GetVideoData(vtkPlusChannel* aRequestedChannel,
       LOG_ERROR("Unable to add video data to the list!");
       status = PLUS_FAIL;
     }
+    frameIndex = aTrackedFrameList->GetNumberOfTrackedFrames();
+  }
+
+  // Remove the reused frames that were not filled
+  if (frameIndex < aTrackedFrameList->GetNumberOfTrackedFrames())
+  {
+    aTrackedFrameList->RemoveTrackedFrameRange(frameIndex, aTrackedFrameList->GetNumberOfTrackedFrames() - 1);
   }
 
   return status;
@@ -15,8 +15,16 @@ See License.txt for details.
 // VTK includes
 #include <vtkObject.h>
 
+// STL includes
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 //class igsioTrackedFrame; 
 class vtkPlusChannel;
+class vtkPlusDataSource;
 class vtkPlusDeviceFactory;
 //class vtkIGSIOTrackedFrameList;
 class vtkXMLDataElement;
@@ -113,25 +121,47 @@ public:
   DeviceCollectionConstIterator GetDeviceConstIteratorEnd() const;
 
   /*!
-    Have each device dump their buffers to disk
-    \param aDirectory directory to dump to
-    \param maxTimeLimitSec Maximum time spent in the function (in sec)
+    Have each device dump their buffers to disk. Returns when all the files are written.
+    \param aDirectory directory to dump to. If it is empty then the files are written to the output directory.
   */
   PlusStatus DumpBuffersToDirectory(const char* aDirectory);
 
+  /*!
+    Start writing the video buffer of each device to a separate sequence file (BufferDump_[DeviceId]_[date]_[time].nrrd),
+    on a pool of worker threads.
+    The method returns immediately, the acquisition continues while the files are written.
+    Returns PLUS_FAIL if a buffer dump is already in progress.
+    \param aDirectory directory to dump to. If it is empty then the files are written to the output directory.
+  */
+  PlusStatus StartDumpBuffersToDirectory(const char* aDirectory);
+  /*! Returns true if the buffer dump that was started by StartDumpBuffersToDirectory is not finished yet */
+  bool IsDumpBuffersInProgress() const;
+  /*! Get the fraction of the buffer items that are already written by the current (or last) buffer dump, between 0 and 1 */
+  double GetDumpBuffersProgress() const;
+  /*! Request cancelling the buffer dump. The files that are not completely written are removed. */
+  void CancelDumpBuffers();
+  /*! Wait until the buffer dump is finished. Returns PLUS_FAIL if writing any of the files failed or the dump was cancelled. */
+  PlusStatus WaitForDumpBuffers();
+
   /*!
     Get tracking data in a tracked frame list since time specified
     \param aTimestamp The oldest timestamp we search for in the buffer. If -1 get all frames in the time range since the most recent timestamp. Out parameter - changed to timestamp of last added frame
     \param aTrackedFrameList Tracked frame list used to get the newly acquired frames into. The new frames are appended to the tracked frame.
+    The frames contain the transforms of the tools only, the video source and the field data sources of the channel are not read.
+    \param reuseFrames If true then the frames that are already in the list are overwritten instead of appending new frames,
+    and the list is resized to the number of newly acquired frames (see vtkPlusChannel::GetToolTrackedFrames)
   */
-  PlusStatus GetTrackingData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList);
+  PlusStatus GetTrackingData(vtkPlusChannel* aRequestedChannel, double& aTimestampFrom, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames = false);
 
   /*!
     Get video data in a tracked frame list since time specified
     \param aTimestamp The oldest timestamp we search for in the buffer. If -1 get all frames in the time range since the most recent timestamp. Out parameter - changed to timestamp of last added frame
     \param aTrackedFrameList Tracked frame list used to get the newly acquired frames into. The new frames are appended to the tracked frame.
+    \param reuseFrames If true then the frames that are already in the list are overwritten instead of appending new frames,
+    and the list is resized to the number of newly acquired frames. The images of the reused frames are reused if they have the same size.
+    The fields of a reused frame are replaced by the fields of the new item.
   */
-  virtual PlusStatus GetVideoData(vtkPlusChannel* aRequestedChannel, double& aTimestamp, vtkIGSIOTrackedFrameList* aTrackedFrameList);
+  virtual PlusStatus GetVideoData(vtkPlusChannel* aRequestedChannel, double& aTimestamp, vtkIGSIOTrackedFrameList* aTrackedFrameList, bool reuseFrames = false);
 
   /*
   * Functions to manage the currently active stream mixers
@@ -154,13 +184,117 @@ public:
   /*! Get startup delay in sec to give some time to the buffers for proper initialization */
   vtkGetMacro(StartupDelaySec, double);
 
+  /*!
+    If enabled then the devices are connected, started and disconnected concurrently on a pool of worker threads.
+    A virtual device waits only for its own input devices. If disabled (this is the default) then the devices are processed
+    one by one in the calling thread. Enable it only if all the devices of the configuration can be connected from any thread:
+    some device SDKs must be called from the thread that initialized them (e.g., COM apartments).
+  */
+  vtkSetMacro(ParallelDeviceStartup, bool);
+  vtkGetMacro(ParallelDeviceStartup, bool);
+  vtkBooleanMacro(ParallelDeviceStartup, bool);
+
+  /*!
+    Set the maximum time in sec for connecting or starting all the devices (0 means no limit, this is the default).
+    Devices that are not processed before the deadline are skipped and the connection fails.
+  */
+  vtkSetMacro(StartupTimeoutSec, double);
+  /*! Get the maximum time in sec for connecting or starting all the devices */
+  vtkGetMacro(StartupTimeoutSec, double);
+
+  /*!
+    If enabled then the rate-driven devices that are created by ReadConfiguration are updated by the acquisition scheduler
+    of this data collector instead of a thread per device. Disabled by default. The number of scheduler threads is set by the AcquisitionSchedulerThreads attribute.
+  */
+  vtkSetMacro(UseAcquisitionScheduler, bool);
+  vtkGetMacro(UseAcquisitionScheduler, bool);
+  vtkBooleanMacro(UseAcquisitionScheduler, bool);
+
+  /*!
+    Acquisition mode that is requested for the virtual devices that are created by ReadConfiguration. With event-driven acquisition
+    a virtual device is updated when its input channels receive new data, so that data propagates through a chain of virtual devices
+    without waiting for the polling period of each device. The updates are run in dependency order by a pool of worker threads of the
+    data collector (see PlusEventDrivenUpdateDispatcher). Rate-driven by default. The AcquisitionMode attribute of a device overrides it.
+  */
+  vtkSetMacro(VirtualDeviceAcquisitionMode, vtkPlusDevice::AcquisitionModeType);
+  vtkGetMacro(VirtualDeviceAcquisitionMode, vtkPlusDevice::AcquisitionModeType);
+
+  /*! Action that is taken when the buffers of the devices do not fit in the buffer memory budget */
+  enum BufferMemoryBudgetActionType
+  {
+    BUFFER_MEMORY_BUDGET_SHRINK_BUFFERS, ///< reduce the size of buffers, buffers of lower priority first
+    BUFFER_MEMORY_BUDGET_FAIL ///< connection fails
+  };
+
+  /*!
+    Set the maximum number of bytes that the buffers of all data sources may allocate (0 means no limit, this is the default).
+    The budget is enforced when the devices are connected, after the frame sizes of the devices are known.
+  */
+  vtkSetMacro(BufferMemoryBudgetBytes, unsigned long long);
+  /*! Get the maximum number of bytes that the buffers of all data sources may allocate */
+  vtkGetMacro(BufferMemoryBudgetBytes, unsigned long long);
+  /*! Set the action that is taken when the buffers do not fit in the buffer memory budget */
+  vtkSetMacro(BufferMemoryBudgetAction, BufferMemoryBudgetActionType);
+  /*! Get the action that is taken when the buffers do not fit in the buffer memory budget */
+  vtkGetMacro(BufferMemoryBudgetAction, BufferMemoryBudgetActionType);
+
+  /*! Get all data sources of all devices that store items in a buffer. Data sources that are shared between devices are listed once. */
+  void GetBufferedDataSources(std::vector<vtkPlusDataSource*>& dataSources) const;
+  /*! Get the number of bytes that is allocated by the buffers of all data sources */
+  unsigned long long GetAllocatedBufferMemoryInBytes() const;
+  /*! Get the number of bytes that is occupied by the items that are currently stored in the buffers of all data sources */
+  unsigned long long GetUsedBufferMemoryInBytes() const;
+
+  /*!
+    Compute the memory that the buffers of all data sources allocate (from frame size, pixel type, number of components and buffer size)
+    and compare it to the buffer memory budget. If the budget is exceeded then buffers are shrunk or the method fails,
+    depending on the BufferMemoryBudgetAction. The reason of a failure is logged as a warning, the caller decides if it is an error.
+    Connect calls it before the frame memory of the buffers is mapped (see vtkPlusBuffer::PrefaultFrameMemory).
+  */
+  PlusStatus EnforceBufferMemoryBudget();
+
 protected:
   vtkPlusDataCollector();
   virtual ~vtkPlusDataCollector();
 
+  /*! Operation that is performed on a single device (connect, start, disconnect) */
+  typedef std::function<PlusStatus(vtkPlusDevice*)> DeviceOperationType;
+
+  /*!
+    Perform an operation on all the devices and log how long each device waited and how long the operation took.
+    A device is processed only after its input devices, or if reverseDependencies is set, only after all the devices that use it as input.
+    When processed in dependency order, the devices that depend on a failed device are skipped.
+    \param operationName Name of the operation, used in the log messages
+    \param timeoutSec Devices that are not started before this time are skipped and the method fails (0 means no limit). A device that is
+    already being processed cannot be interrupted, so the method returns after it has finished.
+  */
+  PlusStatus ProcessDevices(const std::string& operationName, const DeviceOperationType& operation, bool reverseDependencies, double timeoutSec);
+
+  /*! Write the buffers of the buffer dump jobs to file until there are no more jobs. Executed by the buffer dump worker threads. */
+  void DumpBuffersWorker();
+  /*! Join and release the buffer dump threads. DumpBuffersThreadsMutex must be locked by the caller. */
+  void JoinDumpBuffersThreads();
+
   /*! The timestamp filtering methods require some time to initialize. Synchronization will ignore data that are acquired during startup delay. */
   double StartupDelaySec;
 
+  /*! Process the devices concurrently in connect, start and disconnect (disabled by default) */
+  bool ParallelDeviceStartup;
+  /*! Maximum time for connecting or starting all the devices (0 means no limit) */
+  double StartupTimeoutSec;
+  /*! Update the rate-driven devices on the acquisition scheduler of the data collector */
+  bool UseAcquisitionScheduler;
+  /*! Runs the updates of the devices if UseAcquisitionScheduler is enabled, the devices share its ownership */
+  std::shared_ptr<PlusAcquisitionScheduler> AcquisitionScheduler;
+  /*! Acquisition mode that is requested for the virtual devices */
+  vtkPlusDevice::AcquisitionModeType VirtualDeviceAcquisitionMode;
+  /*! Runs the updates of the event-driven devices in dependency order while the devices are started, the devices share its ownership */
+  std::shared_ptr<PlusEventDrivenUpdateDispatcher> EventDrivenUpdateDispatcher;
+
+  /*! Maximum number of bytes that the buffers of all data sources may allocate (0 means no limit) */
+  unsigned long long BufferMemoryBudgetBytes;
+  BufferMemoryBudgetActionType BufferMemoryBudgetAction;
+
   vtkSmartPointer<vtkPlusDeviceFactory> DeviceFactory;
 
   DeviceCollection Devices;
@@ -168,6 +302,25 @@ protected:
   bool Connected;
   bool Started;
 
+  /*! Writing of a data source buffer to a sequence file */
+  struct DumpBuffersJob
+  {
+    vtkPlusDataSource* Source;
+    std::string FileName;
+    int NumberOfItems;
+    double Progress;
+  };
+  /*! Protects the buffer dump jobs and status */
+  mutable std::mutex DumpBuffersMutex;
+  std::vector<DumpBuffersJob> DumpBuffersJobs;
+  size_t NextDumpBuffersJobIndex;
+  PlusStatus DumpBuffersStatus;
+  /*! Protects the buffer dump threads, so that starting, joining and releasing them from different threads cannot overlap */
+  std::mutex DumpBuffersThreadsMutex;
+  std::vector<std::thread> DumpBuffersThreads;
+  std::atomic<int> NumberOfRunningDumpBuffersThreads;
+  std::atomic<bool> DumpBuffersCancelRequested;
+
 private:
   vtkPlusDataCollector(const vtkPlusDataCollector&);
   void operator=(const vtkPlusDataCollector&);
@@ -8,6 +8,7 @@ See License.txt for details.
 #include "PlusConfigure.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusDataSource.h"
+#include "vtkPlusTransformBuffer.h"
 
 // VTK includes
 #include <vtkMatrix4x4.h>
@@ -33,6 +34,7 @@ vtkPlusDataSource::vtkPlusDataSource()
   , Id("")
   , ReferenceCoordinateFrameName("")
   , Buffer(vtkPlusBuffer::New())
+  , BufferPriority(0)
 {
   this->ClipRectangleOrigin[0] = igsioCommon::NO_CLIP;
   this->ClipRectangleOrigin[1] = igsioCommon::NO_CLIP;
@@ -207,6 +209,34 @@ PlusStatus vtkPlusDataSource::SetPortName(const std::string& portName)
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusDataSource::SetType(DataSourceType type)
+{
+  if (this->Type == type)
+  {
+    return;
+  }
+  this->Type = type;
+
+  // Tools only store transforms, they use the compact transform buffer
+  bool transformBufferRequired = (type == DATA_SOURCE_TYPE_TOOL);
+  bool transformBufferUsed = (vtkPlusTransformBuffer::SafeDownCast(this->Buffer) != NULL);
+  if (transformBufferRequired != transformBufferUsed)
+  {
+    vtkPlusBuffer* newBuffer = transformBufferRequired ? vtkPlusTransformBuffer::New() : vtkPlusBuffer::New();
+    newBuffer->SetDescriptiveName(this->Buffer->GetDescriptiveName());
+    newBuffer->SetTimeStampReporting(this->Buffer->GetTimeStampReporting());
+    newBuffer->SetLockFreeReads(this->Buffer->GetLockFreeReads());
+    newBuffer->SetSpillDirectory(this->Buffer->GetSpillDirectory());
+    newBuffer->SetSpillBufferSize(this->Buffer->GetSpillBufferSize());
+    newBuffer->DeepCopy(this->Buffer);
+    this->Buffer->Delete();
+    this->Buffer = newBuffer;
+  }
+
+  this->Modified();
+}
+
 //----------------------------------------------------------------------------
 void vtkPlusDataSource::DeepCopy(const vtkPlusDataSource& aSource)
 {
@@ -219,6 +249,7 @@ void vtkPlusDataSource::DeepCopy(const vtkPlusDataSource& aSource)
   this->Buffer->DeepCopy(aSource.Buffer);
 
   this->SetFrameNumber(aSource.GetFrameNumber());
+  this->SetBufferPriority(aSource.BufferPriority);
 
   this->CustomProperties = aSource.CustomProperties;
 }
@@ -391,6 +422,12 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("Buffer size is not defined in source element \"" << this->GetId() << "\". Using default buffer size: " << this->GetBuffer()->GetBufferSize());
   }
 
+  int bufferPriority = 0;
+  if (sourceElement->GetScalarAttribute("BufferPriority", bufferPriority))
+  {
+    this->SetBufferPriority(bufferPriority);
+  }
+
   int averagedItemsForFiltering = 0;
   if (sourceElement->GetScalarAttribute("AveragedItemsForFiltering", averagedItemsForFiltering))
   {
@@ -401,6 +438,54 @@ PlusStatus vtkPlusDataSource::ReadConfiguration(vtkXMLDataElement* sourceElement
     LOG_DEBUG("AveragedItemsForFiltering is not defined in source element \"" << this->GetId() << "\". Using default value: " << this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  const char* timestampFilteringMethod = sourceElement->GetAttribute("TimestampFilteringMethod");
+  if (timestampFilteringMethod != NULL)
+  {
+    vtkPlusTimestampedCircularBuffer::TimestampFilteringMethodType method;
+    if (vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodFromString(timestampFilteringMethod, method) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid TimestampFilteringMethod \"" << timestampFilteringMethod << "\" in source element \"" << this->GetId() << "\". Valid values: "
+                << vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodAsString(vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_LINEAR_FIT) << ", "
+                << vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodAsString(vtkPlusTimestampedCircularBuffer::TIMESTAMP_FILTERING_CLOCK_RECOVERY));
+      return PLUS_FAIL;
+    }
+    this->GetBuffer()->SetTimestampFilteringMethod(method);
+  }
+
+  const char* spillDirectory = sourceElement->GetAttribute("SpillDirectory");
+  if (spillDirectory != NULL)
+  {
+    this->GetBuffer()->SetSpillDirectory(spillDirectory);
+  }
+
+  int spillBufferSize = 0;
+  if (sourceElement->GetScalarAttribute("SpillBufferSize", spillBufferSize))
+  {
+    if (this->GetBuffer()->SetSpillBufferSize(spillBufferSize) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Invalid SpillBufferSize " << spillBufferSize << " in source element \"" << this->GetId() << "\"");
+      return PLUS_FAIL;
+    }
+  }
+
+  bool lockFreeReads(false);
+  if (igsioCommon::XML::SafeCheckAttributeValueInsensitive(*sourceElement, "LockFreeReads", "TRUE", lockFreeReads) == PLUS_SUCCESS)
+  {
+    this->GetBuffer()->SetLockFreeReads(lockFreeReads);
+  }
+
+  bool hugePageFrameMemory(false);
+  if (igsioCommon::XML::SafeCheckAttributeValueInsensitive(*sourceElement, "HugePageFrameMemory", "TRUE", hugePageFrameMemory) == PLUS_SUCCESS)
+  {
+    this->GetBuffer()->SetHugePageFrameMemory(hugePageFrameMemory);
+  }
+
+  bool contiguousFrameMemory(false);
+  if (igsioCommon::XML::SafeCheckAttributeValueInsensitive(*sourceElement, "ContiguousFrameMemory", "TRUE", contiguousFrameMemory) == PLUS_SUCCESS)
+  {
+    this->GetBuffer()->SetContiguousFrameMemory(contiguousFrameMemory);
+  }
+
   std::string descName;
   if (!aDescriptiveNameForBuffer.empty())
   {
@@ -457,11 +542,46 @@ PlusStatus vtkPlusDataSource::WriteConfiguration(vtkXMLDataElement* aSourceEleme
   XML_WRITE_STRING_ATTRIBUTE_IF_NOT_EMPTY(PortName, aSourceElement);
   aSourceElement->SetIntAttribute("BufferSize", this->GetBuffer()->GetBufferSize());
 
+  if (aSourceElement->GetAttribute("BufferPriority") != NULL)
+  {
+    aSourceElement->SetIntAttribute("BufferPriority", this->GetBufferPriority());
+  }
+
   if (aSourceElement->GetAttribute("AveragedItemsForFiltering") != NULL)
   {
     aSourceElement->SetIntAttribute("AveragedItemsForFiltering", this->GetBuffer()->GetAveragedItemsForFiltering());
   }
 
+  if (aSourceElement->GetAttribute("TimestampFilteringMethod") != NULL)
+  {
+    aSourceElement->SetAttribute("TimestampFilteringMethod", vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodAsString(this->GetBuffer()->GetTimestampFilteringMethod()));
+  }
+
+  if (aSourceElement->GetAttribute("SpillBufferSize") != NULL)
+  {
+    aSourceElement->SetIntAttribute("SpillBufferSize", this->GetBuffer()->GetSpillBufferSize());
+  }
+
+  if (aSourceElement->GetAttribute("SpillDirectory") != NULL)
+  {
+    aSourceElement->SetAttribute("SpillDirectory", this->GetBuffer()->GetSpillDirectory().c_str());
+  }
+
+  if (aSourceElement->GetAttribute("LockFreeReads") != NULL)
+  {
+    aSourceElement->SetAttribute("LockFreeReads", this->GetBuffer()->GetLockFreeReads() ? "TRUE" : "FALSE");
+  }
+
+  if (aSourceElement->GetAttribute("ContiguousFrameMemory") != NULL)
+  {
+    aSourceElement->SetAttribute("ContiguousFrameMemory", this->GetBuffer()->GetContiguousFrameMemory() ? "TRUE" : "FALSE");
+  }
+
+  if (aSourceElement->GetAttribute("HugePageFrameMemory") != NULL)
+  {
+    aSourceElement->SetAttribute("HugePageFrameMemory", this->GetBuffer()->GetHugePageFrameMemory() ? "TRUE" : "FALSE");
+  }
+
   // Write custom properties
   if (this->CustomProperties.size() > 0)
   {
@@ -649,6 +769,10 @@ PlusStatus vtkPlusDataSource::SetInputFrameSize(unsigned int x, unsigned int y,
     outputFrameSizeInPx[1] = temp;
   }
 
+  // Select the copy kernel now instead of when the first frame is added
+  this->GetBuffer()->ConfigureFlipClipKernel(flipInfo, this->GetBuffer()->GetImageType(), this->GetBuffer()->GetPixelType(), this->GetBuffer()->GetNumberOfScalarComponents(),
+      this->InputFrameSize, this->ClipRectangleOrigin, this->ClipRectangleSize);
+
   return this->GetBuffer()->SetFrameSize(outputFrameSizeInPx[0], outputFrameSizeInPx[1], outputFrameSizeInPx[2]);
 }
 
@@ -784,9 +908,27 @@ BufferItemUidType vtkPlusDataSource::GetLatestItemUidInBuffer()
 }
 
 //-----------------------------------------------------------------------------
-ItemStatus vtkPlusDataSource::GetItemUidFromTime(double time, BufferItemUidType& uid)
+ItemStatus vtkPlusDataSource::GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/)
 {
-  return this->GetBuffer()->GetItemUidFromTime(time, uid);
+  return this->GetBuffer()->GetItemUidFromTime(time, uid, searchHintUid);
+}
+
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetFirstItemUidAfterTime(double time, BufferItemUidType& uid)
+{
+  return this->GetBuffer()->GetFirstItemUidAfterTime(time, uid);
+}
+
+//-----------------------------------------------------------------------------
+BufferItemUidType vtkPlusDataSource::PinItems()
+{
+  return this->GetBuffer()->PinItems();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::UnpinItems(BufferItemUidType pinnedItemUid)
+{
+  return this->GetBuffer()->UnpinItems(pinnedItemUid);
 }
 
 //-----------------------------------------------------------------------------
@@ -813,6 +955,18 @@ ItemStatus vtkPlusDataSource::GetStreamBufferItem(BufferItemUidType uid, StreamB
   return this->GetBuffer()->GetStreamBufferItem(uid, bufferItem);
 }
 
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  return this->GetBuffer()->GetStreamBufferItemView(uid, bufferItem);
+}
+
+//-----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::CopyItemToTrackedFrame(BufferItemUidType uid, igsioTrackedFrame& trackedFrame)
+{
+  return this->GetBuffer()->CopyItemToTrackedFrame(uid, trackedFrame);
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetLatestStreamBufferItem(StreamBufferItem* bufferItem)
 {
@@ -831,6 +985,12 @@ ItemStatus vtkPlusDataSource::GetStreamBufferItemFromTime(double time, StreamBuf
   return this->GetBuffer()->GetStreamBufferItemFromTime(time, bufferItem, interpolation);
 }
 
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusDataSource::GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample)
+{
+  return this->GetBuffer()->GetInterpolationSamplesFromTime(time, sample);
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDataSource::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
 {
@@ -855,6 +1015,24 @@ int vtkPlusDataSource::GetBufferSize()
   return this->GetBuffer()->GetBufferSize();
 }
 
+//-----------------------------------------------------------------------------
+unsigned long long vtkPlusDataSource::GetBufferItemSizeInBytes()
+{
+  return this->GetBuffer()->GetItemSizeInBytes();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long long vtkPlusDataSource::GetBufferAllocatedMemoryInBytes()
+{
+  return this->GetBuffer()->GetAllocatedMemoryInBytes();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long long vtkPlusDataSource::GetBufferUsedMemoryInBytes()
+{
+  return this->GetBuffer()->GetUsedMemoryInBytes();
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetLatestTimeStamp(double& latestTimestamp)
 {
@@ -867,6 +1045,12 @@ ItemStatus vtkPlusDataSource::GetOldestTimeStamp(double& oldestTimestamp)
   return this->GetBuffer()->GetOldestTimeStamp(oldestTimestamp);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::WaitForItemNewerThan(double timestamp, double timeoutSec)
+{
+  return this->GetBuffer()->WaitForItemNewerThan(timestamp, timeoutSec);
+}
+
 //-----------------------------------------------------------------------------
 ItemStatus vtkPlusDataSource::GetTimeStamp(BufferItemUidType uid, double& timestamp)
 {
@@ -904,9 +1088,9 @@ bool vtkPlusDataSource::GetTimeStampReporting()
 }
 
 //-----------------------------------------------------------------------------
-PlusStatus vtkPlusDataSource::WriteToSequenceFile(const char* filename, bool useCompression /*= false */)
+PlusStatus vtkPlusDataSource::WriteToSequenceFile(const char* filename, bool useCompression /*= false */, const vtkPlusBuffer::WriteProgressCallbackType& progressCallback /*= vtkPlusBuffer::WriteProgressCallbackType()*/)
 {
-  return this->GetBuffer()->WriteToSequenceFile(filename, useCompression);
+  return this->GetBuffer()->WriteToSequenceFile(filename, useCompression, progressCallback);
 }
 
 //-----------------------------------------------------------------------------
@@ -923,6 +1107,36 @@ PlusStatus vtkPlusDataSource::AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatu
   return this->GetBuffer()->AddTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
 }
 
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  return this->GetBuffer()->AddFilteredTimeStampedItem(matrix, status, frameNumber, unfilteredTimestamp, filteredTimestamp, customFields);
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusDataSource::LockBuffer()
+{
+  this->GetBuffer()->Lock();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusDataSource::UnlockBuffer()
+{
+  this->GetBuffer()->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+PlusStatus vtkPlusDataSource::CreateFilteredTimeStampForItem(unsigned long frameNumber, double unfilteredTimestamp, double& filteredTimestamp, bool& filteredTimestampProbablyValid)
+{
+  return this->GetBuffer()->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid);
+}
+
+//-----------------------------------------------------------------------------
+void vtkPlusDataSource::AddToTimeStampReport(unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp)
+{
+  this->GetBuffer()->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+}
+
 //-----------------------------------------------------------------------------
 int vtkPlusDataSource::GetNumberOfBytesPerPixel()
 {
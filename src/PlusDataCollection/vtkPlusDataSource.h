@@ -121,7 +121,13 @@ public:
   /*! Get buffer item unique ID */
   virtual BufferItemUidType GetOldestItemUidInBuffer();
   virtual BufferItemUidType GetLatestItemUidInBuffer();
-  virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid);
+  virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL);
+  /*! Get the UID of the oldest item that was acquired after the specified time, see vtkPlusBuffer::GetFirstItemUidAfterTime */
+  virtual ItemStatus GetFirstItemUidAfterTime(double time, BufferItemUidType& uid);
+
+  /*! Keep the items of the buffer available until UnpinItems is called, see vtkPlusBuffer::PinItems */
+  virtual BufferItemUidType PinItems();
+  virtual PlusStatus UnpinItems(BufferItemUidType pinnedItemUid);
 
   /*! Returns true if the latest item contains valid video data */
   virtual bool GetLatestItemHasValidVideoData();
@@ -134,12 +140,18 @@ public:
 
   /*! Get a frame with the specified frame uid from the buffer */
   virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*! Get a frame with the specified frame uid from the buffer without copying the pixel data, see vtkPlusBuffer::GetStreamBufferItemView */
+  virtual ItemStatus GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem);
+  /*! Copy the item with the specified frame uid into a tracked frame, see vtkPlusBuffer::CopyItemToTrackedFrame */
+  virtual ItemStatus CopyItemToTrackedFrame(BufferItemUidType uid, igsioTrackedFrame& trackedFrame);
   /*! Get the most recent frame from the buffer */
   virtual ItemStatus GetLatestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get the oldest frame from buffer */
   virtual ItemStatus GetOldestStreamBufferItem(StreamBufferItem* bufferItem);
   /*! Get a frame that was acquired at the specified time from buffer */
   virtual ItemStatus GetStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem, vtkPlusBuffer::DataItemTemporalInterpolationType interpolation);
+  /*! Get the data for interpolating the item at the specified time, see vtkPlusBuffer::GetInterpolationSamplesFromTime */
+  virtual ItemStatus GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample);
   /*! Update a field in the specified stream buffer item */
   virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value);
 
@@ -149,8 +161,8 @@ public:
   /*! Clear buffer (set the buffer pointer to the first element) */
   virtual void Clear();
 
-  /*! Dump the current state of the video buffer to metafile */
-  virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false);
+  /*! Dump the current state of the video buffer to metafile, see vtkPlusBuffer::WriteToSequenceFile */
+  virtual PlusStatus WriteToSequenceFile(const char* filename, bool useCompression = false, const vtkPlusBuffer::WriteProgressCallbackType& progressCallback = vtkPlusBuffer::WriteProgressCallbackType());
 
   /*! Get the table report of the timestamped buffer  */
   virtual PlusStatus GetTimeStampReportTable(vtkTable* timeStampReportTable);
@@ -168,12 +180,30 @@ public:
   /*! Get the size of the buffer */
   virtual int GetBufferSize();
 
+  /*!
+    Set the priority of the buffer in the buffer memory budget of the data collector (default: 0).
+    If the buffers do not fit in the budget then buffers of lower priority are shrunk first.
+  */
+  vtkSetMacro(BufferPriority, int);
+  /*! Get the priority of the buffer in the buffer memory budget of the data collector */
+  vtkGetMacro(BufferPriority, int);
+
+  /*! Get the number of bytes of memory that one item of the buffer occupies */
+  virtual unsigned long long GetBufferItemSizeInBytes();
+  /*! Get the number of bytes of memory that is allocated for the items of the buffer */
+  virtual unsigned long long GetBufferAllocatedMemoryInBytes();
+  /*! Get the number of bytes of memory that is occupied by the items that are currently stored in the buffer */
+  virtual unsigned long long GetBufferUsedMemoryInBytes();
+
   /*! Get latest timestamp in the buffer */
   virtual ItemStatus GetLatestTimeStamp(double& latestTimestamp);
 
   /*! Get oldest timestamp in the buffer */
   virtual ItemStatus GetOldestTimeStamp(double& oldestTimestamp);
 
+  /*! Block the calling thread until the buffer contains an item newer than the specified timestamp or the timeout expires */
+  virtual PlusStatus WaitForItemNewerThan(double timestamp, double timeoutSec);
+
   /*! Get video buffer item timestamp */
   virtual ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp);
 
@@ -260,6 +290,23 @@ public:
   */
   PlusStatus AddTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP, const igsioFieldMapType* customFields = NULL);
 
+  /*! Add a matrix plus status with the specified filtered timestamp, without timestamp filtering and reporting, see vtkPlusBuffer::AddFilteredTimeStampedItem */
+  PlusStatus AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields = NULL);
+
+  /*!
+    Acquire the lock of the buffer. Readers that acquire the lock of any of several buffers see all or none of the items
+    that were added to them while all of them were locked. The lock is recursive.
+  */
+  void LockBuffer();
+  /*! Release the lock of the buffer */
+  void UnlockBuffer();
+
+  /*! Compute the filtered timestamp of an item that is about to be added, using the timestamp filter of the buffer */
+  PlusStatus CreateFilteredTimeStampForItem(unsigned long frameNumber, double unfilteredTimestamp, double& filteredTimestamp, bool& filteredTimestampProbablyValid);
+
+  /*! Add an item whose filtered timestamp was not computed by the timestamp filter of the buffer to the timestamp report */
+  void AddToTimeStampReport(unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp);
+
   /*! Get the device which owns this source. */
   // TODO : consider a re-design of this idea
   void SetDevice(vtkPlusDevice* _arg) { this->Device = _arg; }
@@ -310,7 +357,11 @@ public:
 
   /*! Get type: video or tool. */
   vtkGetMacroConst(Type, DataSourceType);
-  vtkSetMacro(Type, DataSourceType);
+  /*!
+    Set type: video or tool.
+    Tool sources store their items in a vtkPlusTransformBuffer, the content of the current buffer is copied into the new buffer.
+  */
+  virtual void SetType(DataSourceType type);
 
   /*! Get the frame number (some devices have frame numbering, otherwise just increment if new frame received) */
   vtkGetMacroConst(FrameNumber, unsigned long);
@@ -379,6 +430,9 @@ protected:
 
   vtkPlusBuffer* Buffer;
 
+  /*! Buffers of lower priority are shrunk first to fit in the buffer memory budget */
+  int BufferPriority;
+
   CustomPropertyMap CustomProperties;
 
   /*! Crop rectangle origin for this data source */
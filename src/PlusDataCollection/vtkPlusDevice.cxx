@@ -6,6 +6,7 @@ See License.txt for details.
 
 // Local includes
 #include "PlusConfigure.h"
+#include "PlusEventDrivenUpdateDispatcher.h"
 #include "vtkPlusBuffer.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataSource.h"
@@ -26,6 +27,7 @@ See License.txt for details.
 #include <vtksys/SystemTools.hxx>
 
 // STD includes
+#include <algorithm>
 #include <set>
 
 // System includes
@@ -139,6 +141,14 @@ vtkPlusDevice::vtkPlusDevice()
   , OutputNeedsInitialization(1)
   , CorrectlyConfigured(true)
   , StartThreadForInternalUpdates(false)
+  , DedicatedUpdateThread(false)
+  , AcquisitionSchedulerTaskId(PlusAcquisitionScheduler::INVALID_TASK_ID)
+  , NumberOfUpdateOverruns(0)
+  , NumberOfMissedDeadlines(0)
+  , WakeupSpinTimeSec(0.0)
+  , RequestedAcquisitionMode(ACQUISITION_MODE_RATE_DRIVEN)
+  , NumberOfInternalUpdates(0)
+  , ToolBatchSequence(0)
   , LocalTimeOffsetSec(0.0)
   , MissingInputGracePeriodSec(0.0)
   , RequireImageOrientationInConfiguration(false)
@@ -200,6 +210,11 @@ void vtkPlusDevice::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "SDK version: " << this->GetSdkVersion() << std::endl;
   os << indent << "AcquisitionRate: " << this->AcquisitionRate << std::endl;
   os << indent << "Recording: " << (this->Recording ? "On\n" : "Off\n");
+  os << indent << "AcquisitionScheduler: " << (this->AcquisitionScheduler ? "Yes\n" : "No\n");
+  os << indent << "DedicatedUpdateThread: " << (this->DedicatedUpdateThread ? "Yes\n" : "No\n");
+  os << indent << "AcquisitionMode: " << GetAcquisitionModeAsString(this->GetAcquisitionMode()) << std::endl;
+  os << indent << "NumberOfUpdateOverruns: " << this->NumberOfUpdateOverruns << std::endl;
+  os << indent << "NumberOfMissedDeadlines: " << this->NumberOfMissedDeadlines << std::endl;
 
   for (ChannelContainerConstIterator it = this->OutputChannels.begin(); it != this->OutputChannels.end(); ++it)
   {
@@ -554,6 +569,32 @@ PlusStatus vtkPlusDevice::GetInputDevices(std::vector<vtkPlusDevice*>& outDevice
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::GetInputBuffers(std::vector<vtkPlusBuffer*>& outBufferList) const
+{
+  std::set<vtkPlusBuffer*> inputBuffers;
+  for (ChannelContainerConstIterator it = this->InputChannels.begin(); it != this->InputChannels.end(); ++it)
+  {
+    vtkPlusDataSource* videoSource(NULL);
+    if ((*it)->GetVideoSource(videoSource) == PLUS_SUCCESS && videoSource != NULL)
+    {
+      inputBuffers.insert(videoSource->GetBuffer());
+    }
+    for (DataSourceContainerConstIterator toolIt = (*it)->GetToolsStartConstIterator(); toolIt != (*it)->GetToolsEndConstIterator(); ++toolIt)
+    {
+      inputBuffers.insert(toolIt->second->GetBuffer());
+    }
+    for (DataSourceContainerConstIterator fieldIt = (*it)->GetFieldDataSourcesStartConstIterator(); fieldIt != (*it)->GetFieldDataSourcesEndConstIterator(); ++fieldIt)
+    {
+      inputBuffers.insert(fieldIt->second->GetBuffer());
+    }
+  }
+  inputBuffers.erase(NULL);
+  outBufferList.insert(outBufferList.end(), inputBuffers.begin(), inputBuffers.end());
+
+  return PLUS_SUCCESS;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusDevice::GetInputDevicesRecursive(std::vector<vtkPlusDevice*>& outDeviceList) const
 {
@@ -1050,6 +1091,21 @@ PlusStatus vtkPlusDevice::ReadConfiguration(vtkXMLDataElement* rootXMLElement)
     LOCAL_LOG_DEBUG("Unable to find acquisition rate in device element when it is required, using default " << this->GetAcquisitionRate());
   }
 
+  XML_READ_BOOL_ATTRIBUTE_OPTIONAL(DedicatedUpdateThread, deviceXMLElement);
+  XML_READ_SCALAR_ATTRIBUTE_OPTIONAL(double, WakeupSpinTimeSec, deviceXMLElement);
+  const char* acquisitionMode = deviceXMLElement->GetAttribute("AcquisitionMode");
+  if (acquisitionMode != NULL && GetAcquisitionModeFromString(acquisitionMode, this->RequestedAcquisitionMode) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("Invalid AcquisitionMode attribute: " << acquisitionMode << ". Valid values are " << GetAcquisitionModeAsString(ACQUISITION_MODE_RATE_DRIVEN)
+                    << " and " << GetAcquisitionModeAsString(ACQUISITION_MODE_EVENT_DRIVEN) << ".");
+    return PLUS_FAIL;
+  }
+  if (this->UpdateThreadSettings.ReadConfiguration(deviceXMLElement) != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_ERROR("Invalid update thread settings");
+    return PLUS_FAIL;
+  }
+
   vtkXMLDataElement* outputChannelsElement = deviceXMLElement->FindNestedElementWithName("OutputChannels");
   if (outputChannelsElement != NULL)
   {
@@ -1201,6 +1257,12 @@ PlusStatus vtkPlusDevice::WriteConfiguration(vtkXMLDataElement* config)
     deviceDataElement->SetDoubleAttribute("LocalTimeOffsetSec", this->GetLocalTimeOffsetSec());
   }
 
+  this->UpdateThreadSettings.WriteConfiguration(deviceDataElement);
+  if (this->RequestedAcquisitionMode != ACQUISITION_MODE_RATE_DRIVEN || deviceDataElement->GetAttribute("AcquisitionMode") != NULL)
+  {
+    deviceDataElement->SetAttribute("AcquisitionMode", GetAcquisitionModeAsString(this->RequestedAcquisitionMode).c_str());
+  }
+
   // Parameters writing
   XML_FIND_NESTED_ELEMENT_CREATE_IF_MISSING(parameterList, deviceDataElement, PARAMETERS_XML_ELEMENT_TAG.c_str());
 
@@ -1267,6 +1329,30 @@ PlusStatus vtkPlusDevice::Disconnect()
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void vtkPlusDevice::SetAcquisitionScheduler(const std::shared_ptr<PlusAcquisitionScheduler>& scheduler)
+{
+  this->AcquisitionScheduler = scheduler;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<PlusAcquisitionScheduler> vtkPlusDevice::GetAcquisitionScheduler() const
+{
+  return this->AcquisitionScheduler;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::SetEventDrivenUpdateDispatcher(const std::shared_ptr<PlusEventDrivenUpdateDispatcher>& dispatcher)
+{
+  this->EventDrivenUpdateDispatcher = dispatcher;
+}
+
+//----------------------------------------------------------------------------
+std::shared_ptr<PlusEventDrivenUpdateDispatcher> vtkPlusDevice::GetEventDrivenUpdateDispatcher() const
+{
+  return this->EventDrivenUpdateDispatcher;
+}
+
 //----------------------------------------------------------------------------
 // Set the source to acquire data continuously.
 // You should override this as appropriate for your device.
@@ -1300,9 +1386,33 @@ PlusStatus vtkPlusDevice::StartRecording()
 
   if (this->StartThreadForInternalUpdates)
   {
-    this->ThreadId =
-      this->Threader->SpawnThread((vtkThreadFunctionType)\
-                                  &vtkDataCaptureThread, this);
+    this->NumberOfUpdateOverruns = 0;
+    this->NumberOfMissedDeadlines = 0;
+    this->NumberOfInternalUpdates = 0;
+    this->RecentUpdateTimes.assign(FRAME_RATE_AVERAGING, 0.0);
+    if (this->GetAcquisitionMode() == ACQUISITION_MODE_EVENT_DRIVEN)
+    {
+      // The acquisition rate only sets the minimum update rate
+      LOCAL_LOG_DEBUG("Internal updates are run by the event-driven update dispatcher when the input channels receive new data");
+    }
+    else if (this->AcquisitionScheduler && !this->DedicatedUpdateThread && this->UpdateThreadSettings.IsDefault() && this->AcquisitionRate > 0)
+    {
+      LOCAL_LOG_DEBUG("Internal updates are run by the acquisition scheduler");
+      this->TaskAcquisitionScheduler = this->AcquisitionScheduler;
+      this->AcquisitionSchedulerTaskId = this->TaskAcquisitionScheduler->AddTask(1.0 / this->AcquisitionRate, [this](double scheduledTime, unsigned int numberOfMissedDeadlines)
+      {
+        if (this->GetCorrectlyConfigured())
+        {
+          this->RunInternalUpdate(scheduledTime, numberOfMissedDeadlines);
+        }
+      });
+    }
+    else
+    {
+      this->ThreadId =
+        this->Threader->SpawnThread((vtkThreadFunctionType)\
+                                    &vtkDataCaptureThread, this);
+    }
   }
 
   this->Modified();
@@ -1326,7 +1436,19 @@ PlusStatus vtkPlusDevice::StopRecording()
   this->ThreadId = -1;
   this->Recording = 0;
 
-  if (this->GetStartThreadForInternalUpdates())
+  if (this->AcquisitionSchedulerTaskId != PlusAcquisitionScheduler::INVALID_TASK_ID)
+  {
+    // Returns when the update that may be in progress is completed
+    this->TaskAcquisitionScheduler->RemoveTask(this->AcquisitionSchedulerTaskId);
+    this->AcquisitionSchedulerTaskId = PlusAcquisitionScheduler::INVALID_TASK_ID;
+    this->TaskAcquisitionScheduler.reset();
+  }
+  else if (this->GetAcquisitionMode() == ACQUISITION_MODE_EVENT_DRIVEN)
+  {
+    // Wait until an update that the dispatcher may be running returns, the next updates do nothing as recording is stopped
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+  }
+  else if (this->GetStartThreadForInternalUpdates())
   {
     LOCAL_LOG_DEBUG("Wait for internal update thread to terminate");
     // Let's give a chance to the thread to stop before we kill the connection
@@ -1356,44 +1478,144 @@ void* vtkPlusDevice::vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data)
   vtkPlusDevice* self = (vtkPlusDevice*)(data->UserData);
 
   double rate = self->GetAcquisitionRate();
-  double currtime[FRAME_RATE_AVERAGING] = {0};
-  unsigned long updatecount = 0;
   self->ThreadAlive = true;
 
+  // Failures are already logged, the updates run with the default thread settings then
+  self->UpdateThreadSettings.ApplyToCurrentThread();
+
+  // The updates are due at absolute deadlines, so that the time spent in the updates and the wakeup latencies do not accumulate
+  PlusDeadlineTimer timer(1.0 / rate, self->WakeupSpinTimeSec);
+  timer.Start();
+  unsigned int numberOfMissedDeadlines(0);
   while (self->IsRecording() && self->GetCorrectlyConfigured())
   {
-    double newtime = vtkIGSIOAccurateTimer::GetSystemTime();
-    // get current tracking rate over last few updates
-    double difftime = newtime - currtime[updatecount % FRAME_RATE_AVERAGING];
-    currtime[updatecount % FRAME_RATE_AVERAGING] = newtime;
-    if (updatecount > FRAME_RATE_AVERAGING && difftime != 0)
+    // The deadline of the timer is converted to system time, which is the time base of the timestamps
+    double scheduledTime = vtkIGSIOAccurateTimer::GetSystemTime() - (PlusDeadlineTimer::GetMonotonicTime() - timer.GetCurrentDeadline());
+    if (!self->RunInternalUpdate(scheduledTime, numberOfMissedDeadlines))
     {
-      self->InternalUpdateRate = (FRAME_RATE_AVERAGING / difftime);
+      // recording has been stopped
+      break;
     }
 
-    {
-      // Lock before update
-      igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(self->UpdateMutex);
-      if (!self->Recording)
-      {
-        // recording has been stopped
-        break;
-      }
-      self->InternalUpdate();
-      self->UpdateTime.Modified();
-    }
+    numberOfMissedDeadlines = timer.WaitForNextDeadline();
+  }
 
-    double delay = (newtime + 1.0 / rate - vtkIGSIOAccurateTimer::GetSystemTime());
-    if (delay > 0)
+  self->ThreadAlive = false;
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::RunInternalUpdate(double scheduledTime, unsigned int numberOfMissedDeadlines)
+{
+  this->NumberOfMissedDeadlines += numberOfMissedDeadlines;
+
+  // get current tracking rate over last few updates
+  double newtime = vtkIGSIOAccurateTimer::GetSystemTime();
+  double& oldestUpdateTime = this->RecentUpdateTimes[this->NumberOfInternalUpdates % FRAME_RATE_AVERAGING];
+  double difftime = newtime - oldestUpdateTime;
+  oldestUpdateTime = newtime;
+  if (this->NumberOfInternalUpdates > FRAME_RATE_AVERAGING && difftime != 0)
+  {
+    this->InternalUpdateRate = (FRAME_RATE_AVERAGING / difftime);
+  }
+  this->NumberOfInternalUpdates++;
+
+  {
+    // Lock before update
+    igsioLockGuard<vtkIGSIORecursiveCriticalSection> updateMutexGuardedLock(this->UpdateMutex);
+    if (!this->Recording)
     {
-      vtkIGSIOAccurateTimer::Delay(delay);
+      return false;
     }
+    this->InternalUpdate();
+    this->UpdateTime.Modified();
+  }
 
-    updatecount++;
+  // Event-driven updates have no deadline
+  if (this->GetAcquisitionMode() == ACQUISITION_MODE_RATE_DRIVEN && vtkIGSIOAccurateTimer::GetSystemTime() >= scheduledTime + 1.0 / this->AcquisitionRate)
+  {
+    this->NumberOfUpdateOverruns++;
   }
+  return true;
+}
 
-  self->ThreadAlive = false;
-  return NULL;
+//----------------------------------------------------------------------------
+bool vtkPlusDevice::RunEventDrivenUpdate()
+{
+  if (!this->GetCorrectlyConfigured())
+  {
+    return false;
+  }
+  return this->RunInternalUpdate(vtkIGSIOAccurateTimer::GetSystemTime(), 0);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusDevice::AcquisitionModeType vtkPlusDevice::GetAcquisitionMode() const
+{
+  if (!this->StartThreadForInternalUpdates)
+  {
+    return ACQUISITION_MODE_EVENT_DRIVEN;
+  }
+  // Only devices that have input channels can be notified about new data
+  if (this->RequestedAcquisitionMode == ACQUISITION_MODE_EVENT_DRIVEN && !this->InputChannels.empty() && this->EventDrivenUpdateDispatcher)
+  {
+    return ACQUISITION_MODE_EVENT_DRIVEN;
+  }
+  return ACQUISITION_MODE_RATE_DRIVEN;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusDevice::GetAcquisitionModeAsString(AcquisitionModeType mode)
+{
+  switch (mode)
+  {
+    case ACQUISITION_MODE_RATE_DRIVEN:
+      return "RATE_DRIVEN";
+    case ACQUISITION_MODE_EVENT_DRIVEN:
+      return "EVENT_DRIVEN";
+  }
+  return "UNKNOWN";
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::GetAcquisitionModeFromString(const std::string& modeString, AcquisitionModeType& mode)
+{
+  if (STRCASECMP(modeString.c_str(), "RATE_DRIVEN") == 0)
+  {
+    mode = ACQUISITION_MODE_RATE_DRIVEN;
+    return PLUS_SUCCESS;
+  }
+  if (STRCASECMP(modeString.c_str(), "EVENT_DRIVEN") == 0)
+  {
+    mode = ACQUISITION_MODE_EVENT_DRIVEN;
+    return PLUS_SUCCESS;
+  }
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusDevice::GetNumberOfUpdateOverruns() const
+{
+  return this->NumberOfUpdateOverruns;
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusDevice::GetNumberOfMissedDeadlines() const
+{
+  return this->NumberOfMissedDeadlines;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusDevice::SetUpdateThreadSettings(const PlusThreadSettings& settings)
+{
+  this->UpdateThreadSettings = settings;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const PlusThreadSettings& vtkPlusDevice::GetUpdateThreadSettings() const
+{
+  return this->UpdateThreadSettings;
 }
 
 //----------------------------------------------------------------------------
@@ -1700,6 +1922,92 @@ PlusStatus vtkPlusDevice::ToolTimeStampedUpdate(const std::string& aToolSourceId
   return bufferStatus;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusDevice::ToolTimeStampedUpdate(const std::vector<ToolTimeStampedUpdateItem>& toolUpdates, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp/*=UNDEFINED_TIMESTAMP*/)
+{
+  if (toolUpdates.empty())
+  {
+    return PLUS_SUCCESS;
+  }
+  for (std::vector<ToolTimeStampedUpdateItem>::const_iterator it = toolUpdates.begin(); it != toolUpdates.end(); ++it)
+  {
+    if (it->Tool == NULL || it->Matrix == NULL)
+    {
+      LOCAL_LOG_ERROR("Failed to update tools - tool or matrix is NULL!");
+      return PLUS_FAIL;
+    }
+  }
+
+  if (unfilteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    unfilteredTimestamp = vtkIGSIOAccurateTimer::GetSystemTime();
+  }
+  // Tool whose timestamp filter computed the filtered timestamp and reported the sample
+  vtkPlusDataSource* filteredTimestampReportedTool = NULL;
+  if (filteredTimestamp == UNDEFINED_TIMESTAMP)
+  {
+    // All the tools have the same frame number and unfiltered timestamp, so the filtered timestamp is computed only once
+    filteredTimestampReportedTool = toolUpdates[0].Tool;
+    bool filteredTimestampProbablyValid = true;
+    if (toolUpdates[0].Tool->CreateFilteredTimeStampForItem(frameNumber, unfilteredTimestamp, filteredTimestamp, filteredTimestampProbablyValid) != PLUS_SUCCESS)
+    {
+      LOCAL_LOG_DEBUG("Failed to create filtered timestamp for tool update with item index: " << frameNumber);
+      return PLUS_FAIL;
+    }
+    if (!filteredTimestampProbablyValid)
+    {
+      LOG_INFO("Filtered timestamp is probably invalid for tool update with item index=" << frameNumber << ", time=" << unfilteredTimestamp << ". The items may have been tagged with an inaccurate timestamp, therefore they will not be recorded.");
+      return PLUS_SUCCESS;
+    }
+  }
+
+  // Lock the buffers in a consistent (address) order to avoid deadlock with other threads that lock multiple buffers
+  std::vector<vtkPlusDataSource*> lockedTools;
+  lockedTools.reserve(toolUpdates.size());
+  for (std::vector<ToolTimeStampedUpdateItem>::const_iterator it = toolUpdates.begin(); it != toolUpdates.end(); ++it)
+  {
+    lockedTools.push_back(it->Tool);
+  }
+  std::sort(lockedTools.begin(), lockedTools.end());
+  lockedTools.erase(std::unique(lockedTools.begin(), lockedTools.end()), lockedTools.end());
+  for (std::vector<vtkPlusDataSource*>::iterator it = lockedTools.begin(); it != lockedTools.end(); ++it)
+  {
+    (*it)->LockBuffer();
+  }
+
+  // Readers that do not hold the buffer locks (e.g., lock-free readers) see an odd sequence number until all the items are added
+  this->ToolBatchSequence.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // The timestamp filter of the first tool reported the sample already, the other tools get the shared filtered timestamp
+  for (std::vector<vtkPlusDataSource*>::iterator it = lockedTools.begin(); it != lockedTools.end(); ++it)
+  {
+    if (*it != filteredTimestampReportedTool)
+    {
+      (*it)->AddToTimeStampReport(frameNumber, unfilteredTimestamp, filteredTimestamp);
+    }
+  }
+
+  PlusStatus status = PLUS_SUCCESS;
+  for (std::vector<ToolTimeStampedUpdateItem>::const_iterator it = toolUpdates.begin(); it != toolUpdates.end(); ++it)
+  {
+    if (it->Tool->AddFilteredTimeStampedItem(it->Matrix, it->Status, frameNumber, unfilteredTimestamp, filteredTimestamp, it->CustomFields) != PLUS_SUCCESS)
+    {
+      status = PLUS_FAIL;
+    }
+    it->Tool->SetFrameNumber(frameNumber);
+  }
+
+  // The items are published to lock-free readers when the buffers are unlocked
+  for (std::vector<vtkPlusDataSource*>::reverse_iterator it = lockedTools.rbegin(); it != lockedTools.rend(); ++it)
+  {
+    (*it)->UnlockBuffer();
+  }
+  this->ToolBatchSequence.fetch_add(1, std::memory_order_release);
+
+  return status;
+}
+
 //----------------------------------------------------------------------------
 // This method returns the largest data that can be generated.
 int vtkPlusDevice::RequestInformation(vtkInformation* vtkNotUsed(request), vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
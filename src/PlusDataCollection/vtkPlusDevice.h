@@ -9,8 +9,11 @@ See License.txt for details.
 
 // Local includes
 #include "igsioCommon.h"
+#include "PlusAcquisitionScheduler.h"
 #include "PlusConfigure.h"
+#include "PlusDeadlineTimer.h"
 #include "PlusStreamBufferItem.h"
+#include "PlusThreadSettings.h"
 #include "vtkPlusChannel.h"
 #include "vtkPlusDataCollectionExport.h"
 
@@ -22,8 +25,11 @@ See License.txt for details.
 #include <set>
 
 // STL includes
+#include <atomic>
+#include <memory>
 #include <string>
 
+class PlusEventDrivenUpdateDispatcher;
 class vtkPlusBuffer;
 class vtkPlusDataCollector;
 class vtkPlusDataSource;
@@ -69,6 +75,18 @@ public:
   static const std::string PARAMETERS_XML_ELEMENT_TAG;
   static const std::string PARAMETER_XML_ELEMENT_TAG;
 
+  /*! Transform of one tool in a batched tool update, see ToolTimeStampedUpdate(const std::vector<ToolTimeStampedUpdateItem>&, ...) */
+  struct ToolTimeStampedUpdateItem
+  {
+    ToolTimeStampedUpdateItem() : Tool(NULL), Matrix(NULL), Status(TOOL_OK), CustomFields(NULL) {}
+    ToolTimeStampedUpdateItem(vtkPlusDataSource* tool, vtkMatrix4x4* matrix, ToolStatus status, const igsioFieldMapType* customFields = NULL)
+      : Tool(tool), Matrix(matrix), Status(status), CustomFields(customFields) {}
+    vtkPlusDataSource* Tool;
+    vtkMatrix4x4* Matrix;
+    ToolStatus Status;
+    const igsioFieldMapType* CustomFields;
+  };
+
   /*!
   Probe to see to see if the device is connected to the
   computer.  This method should be overridden in subclasses.
@@ -274,6 +292,10 @@ public:
   Recursively assemble all devices that feed into this device (if any)
   */
   PlusStatus GetInputDevicesRecursive(std::vector<vtkPlusDevice*>& outDeviceList) const;
+  /*!
+  Build a list of the buffers of the video, tool and field data sources of the input channels (each buffer is listed once)
+  */
+  PlusStatus GetInputBuffers(std::vector<vtkPlusBuffer*>& outBufferList) const;
 
   // Parameter interface
   virtual PlusStatus SetParameter(const std::string& key, const std::string& value);
@@ -297,6 +319,80 @@ public:
   /*! Get whether recording is underway */
   virtual bool IsRecording() const;
 
+  /*! How the device acquires its data */
+  enum AcquisitionModeType
+  {
+    ACQUISITION_MODE_RATE_DRIVEN, ///< InternalUpdate is called periodically, at the acquisition rate, to poll the hardware
+    ACQUISITION_MODE_EVENT_DRIVEN ///< data is added when the hardware provides it (e.g., in a callback function of the device SDK)
+  };
+  /*!
+    Devices that start a thread for internal updates are rate-driven, all the other devices are event-driven.
+    A device that polls its input channels is event-driven if event-driven acquisition is requested for it
+    and an event-driven update dispatcher is set.
+  */
+  virtual AcquisitionModeType GetAcquisitionMode() const;
+
+  /*!
+    Request event-driven acquisition for a device that polls its input channels (typically a virtual device): the internal update
+    runs as soon as any of the input channels receives new data, instead of waiting for the next period of the acquisition rate.
+    The acquisition rate remains the minimum update rate, so devices that rely on periodic updates (e.g., for detecting inactive
+    inputs) keep working. Devices without input channels or without an event-driven update dispatcher stay rate-driven.
+    Read from the AcquisitionMode attribute (RATE_DRIVEN or EVENT_DRIVEN) of the device element. Takes effect when recording is started.
+  */
+  vtkSetMacro(RequestedAcquisitionMode, AcquisitionModeType);
+  vtkGetMacro(RequestedAcquisitionMode, AcquisitionModeType);
+
+  static std::string GetAcquisitionModeAsString(AcquisitionModeType mode);
+  /*! Returns PLUS_FAIL if the string is not a valid acquisition mode */
+  static PlusStatus GetAcquisitionModeFromString(const std::string& modeString, AcquisitionModeType& mode);
+
+  /*!
+    If a scheduler is set then the internal updates of a rate-driven device are run by the scheduler instead of
+    a dedicated thread of the device (unless DedicatedUpdateThread is enabled). Takes effect when recording is started.
+    The data collector sets its own scheduler if its UseAcquisitionScheduler option is enabled.
+  */
+  void SetAcquisitionScheduler(const std::shared_ptr<PlusAcquisitionScheduler>& scheduler);
+  std::shared_ptr<PlusAcquisitionScheduler> GetAcquisitionScheduler() const;
+  /*!
+    Dispatcher that runs the internal updates of the device in event-driven acquisition mode, instead of an update thread
+    of the device. The internal updates only run while the dispatcher is started (see PlusEventDrivenUpdateDispatcher::Start).
+    The data collector sets its own dispatcher for all its devices.
+  */
+  void SetEventDrivenUpdateDispatcher(const std::shared_ptr<PlusEventDrivenUpdateDispatcher>& dispatcher);
+  std::shared_ptr<PlusEventDrivenUpdateDispatcher> GetEventDrivenUpdateDispatcher() const;
+  /*!
+    Run a single internal update of an event-driven device, called by the event-driven update dispatcher.
+    Returns false if the recording has been stopped.
+  */
+  bool RunEventDrivenUpdate();
+  /*!
+    If enabled then the device always runs its internal updates in a dedicated thread. Devices whose InternalUpdate
+    blocks for a long time (e.g., waiting for I/O) should enable it, so that they do not occupy a worker of the scheduler.
+  */
+  vtkSetMacro(DedicatedUpdateThread, bool);
+  vtkGetMacro(DedicatedUpdateThread, bool);
+
+  /*!
+    CPU affinity, scheduling policy, priority and name of the internal update thread. Read from the CpuAffinity, ThreadSchedulingPolicy,
+    ThreadPriority and ThreadName attributes of the device element. A device with non-default settings always gets a dedicated
+    update thread, as the settings cannot be applied to the shared threads of the acquisition scheduler. Takes effect when recording is started.
+  */
+  void SetUpdateThreadSettings(const PlusThreadSettings& settings);
+  const PlusThreadSettings& GetUpdateThreadSettings() const;
+
+  /*! Number of internal updates since the recording was started that finished after the next update was due */
+  unsigned long GetNumberOfUpdateOverruns() const;
+  /*! Number of update deadlines since the recording was started that were skipped, because the update thread was late */
+  unsigned long GetNumberOfMissedDeadlines() const;
+
+  /*!
+    The dedicated update thread wakes up this much earlier than the next update is due and polls the clock until the
+    deadline, which reduces the wakeup jitter below the sleep granularity of the operating system at the cost of CPU time.
+    Useful for high-rate devices, such as 1 kHz trackers. 0 (the default) disables spinning.
+  */
+  vtkSetMacro(WakeupSpinTimeSec, double);
+  vtkGetMacro(WakeupSpinTimeSec, double);
+
   /* Return the id of the device */
   virtual std::string GetDeviceId() const;
   // Set the device Id
@@ -442,9 +538,24 @@ public:
   */
   virtual PlusStatus SendText(const std::string& textToSend, std::string* textReceived = NULL);
 
+  /*!
+    Get the batch sequence number of the tools of this device. It is odd while a batched ToolTimeStampedUpdate adds its items.
+    A reader that reads several tools of the device without locking all of them has read the same batches of all the tools
+    if the sequence number was even before the read and did not change until the end of the read (see vtkPlusChannel::GetTrackedFrame).
+  */
+  unsigned long GetToolBatchSequence() const { return this->ToolBatchSequence.load(std::memory_order_acquire); }
+
 protected:
   static void* vtkDataCaptureThread(vtkMultiThreader::ThreadInfo* data);
 
+  /*!
+    Run a single internal update, called from the update thread, by the acquisition scheduler or by the event-driven update dispatcher.
+    \param scheduledTime time when the update was due, used for detecting overruns
+    \param numberOfMissedDeadlines number of deadlines that were skipped since the previous update
+    Returns false if the recording has been stopped.
+  */
+  bool RunInternalUpdate(double scheduledTime, unsigned int numberOfMissedDeadlines);
+
   /*! Should be overridden to connect to the hardware */
   virtual PlusStatus InternalConnect();
 
@@ -483,6 +594,18 @@ protected:
   */
   virtual PlusStatus ToolTimeStampedUpdate(const std::string& aToolSourceId, vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredtimestamp, const igsioFieldMapType* customFields = NULL);
 
+  /*!
+  Batched version of ToolTimeStampedUpdate for devices that measure several tools at the same time.
+  The tools are specified directly (no lookup by source ID) and the filtered timestamp is computed only once,
+  with the timestamp filter of the first tool, unless it is specified by filteredTimestamp. The timestamp filters
+  of the other tools are not used. All the items of the batch get the same filtered timestamp, and the sample is
+  added once to the timestamp report of each tool.
+  The items are added while the buffers of all the tools are locked and ToolBatchSequence is odd, so a reader that
+  holds the lock of any of these buffers sees either all or none of the new items in them, and a reader that reads
+  the tools one after the other can detect that a batch was added meanwhile (see GetToolBatchSequence).
+  */
+  virtual PlusStatus ToolTimeStampedUpdate(const std::vector<ToolTimeStampedUpdateItem>& toolUpdates, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp = UNDEFINED_TIMESTAMP);
+
   /*!
   This function is called by InternalUpdate() so that the subclasses
   can communicate information back to the vtkPlusDevice base class, which
@@ -587,6 +710,33 @@ protected:
   */
   bool StartThreadForInternalUpdates;
 
+  /*! Run the internal updates by the shared acquisition scheduler */
+  /*! Scheduler that runs the internal updates, NULL if the device uses its own thread */
+  std::shared_ptr<PlusAcquisitionScheduler> AcquisitionScheduler;
+  /*! Run the internal updates in a dedicated thread, even if an acquisition scheduler is set */
+  bool DedicatedUpdateThread;
+  /*! Settings that the internal update thread applies to itself when it starts */
+  PlusThreadSettings UpdateThreadSettings;
+  /*! Task of the device in the acquisition scheduler, while recording */
+  PlusAcquisitionScheduler::TaskIdType AcquisitionSchedulerTaskId;
+  /*! Scheduler that runs the task, kept until the task is removed even if AcquisitionScheduler is changed meanwhile */
+  std::shared_ptr<PlusAcquisitionScheduler> TaskAcquisitionScheduler;
+  /*! Number of internal updates that finished after the next update was due */
+  std::atomic<unsigned long> NumberOfUpdateOverruns;
+  /*! Number of update deadlines that were skipped */
+  std::atomic<unsigned long> NumberOfMissedDeadlines;
+  /*! Time before the deadline when the dedicated update thread stops sleeping and starts polling the clock */
+  double WakeupSpinTimeSec;
+  /*! Acquisition mode that is used if the device supports it */
+  AcquisitionModeType RequestedAcquisitionMode;
+  /*! Dispatcher that runs the internal updates in event-driven acquisition mode, NULL if the device cannot be event-driven */
+  std::shared_ptr<PlusEventDrivenUpdateDispatcher> EventDrivenUpdateDispatcher;
+  /*! Start times of the most recent internal updates, for computing the internal update rate */
+  std::vector<double> RecentUpdateTimes;
+  unsigned long NumberOfInternalUpdates;
+  /*! Incremented when a batched tool update starts and when it is finished, see GetToolBatchSequence */
+  std::atomic<unsigned long> ToolBatchSequence;
+
   /*! Value to use when mixing data with another temporally calibrated device*/
   double LocalTimeOffsetSec;
 
@@ -0,0 +1,243 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusFrameSlab.h"
+
+// IGSIO includes
+#include <igsioVideoFrame.h>
+
+// VTK includes
+#include <vtkDataArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationObjectBaseKey.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STL includes
+#include <cstdlib>
+
+#ifdef _WIN32
+  #include <malloc.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+namespace
+{
+  const unsigned long HUGE_PAGE_SIZE_BYTES = 2 * 1024 * 1024;
+  const unsigned long PREFAULT_STRIDE_BYTES = 4096;
+
+  //----------------------------------------------------------------------------
+  unsigned long RoundUp(unsigned long value, unsigned long alignment)
+  {
+    return ((value + alignment - 1) / alignment) * alignment;
+  }
+}
+
+vtkStandardNewMacro(vtkPlusFrameSlab);
+vtkInformationKeyMacro(vtkPlusFrameSlab, FRAME_SLAB, ObjectBase);
+
+//----------------------------------------------------------------------------
+vtkPlusFrameSlab::vtkPlusFrameSlab()
+  : Memory(NULL)
+  , NumberOfFrames(0)
+  , FrameStrideInBytes(0)
+  , SizeInBytes(0)
+  , MappedSizeInBytes(0)
+  , HugePagesUsed(false)
+  , MemoryMapped(false)
+{
+}
+
+//----------------------------------------------------------------------------
+vtkPlusFrameSlab::~vtkPlusFrameSlab()
+{
+  this->Free();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusFrameSlab::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfFrames: " << this->NumberOfFrames << std::endl;
+  os << indent << "FrameStrideInBytes: " << this->FrameStrideInBytes << std::endl;
+  os << indent << "SizeInBytes: " << this->SizeInBytes << std::endl;
+  os << indent << "HugePagesUsed: " << (this->HugePagesUsed ? "TRUE" : "FALSE") << std::endl;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusFrameSlab::Free()
+{
+  if (this->Memory != NULL)
+  {
+#ifdef _WIN32
+    _aligned_free(this->Memory);
+#else
+    if (this->MemoryMapped)
+    {
+      munmap(this->Memory, this->MappedSizeInBytes);
+    }
+    else
+    {
+      free(this->Memory);
+    }
+#endif
+  }
+  this->Memory = NULL;
+  this->NumberOfFrames = 0;
+  this->FrameStrideInBytes = 0;
+  this->SizeInBytes = 0;
+  this->MappedSizeInBytes = 0;
+  this->HugePagesUsed = false;
+  this->MemoryMapped = false;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusFrameSlab::Allocate(unsigned int numberOfFrames, unsigned long frameSizeInBytes, bool useHugePages)
+{
+  if (this->Memory != NULL)
+  {
+    // Images created from the slab may still reference the memory
+    LOG_ERROR("Video frame slab is already allocated, create a new slab instead");
+    return PLUS_FAIL;
+  }
+  if (numberOfFrames == 0 || frameSizeInBytes == 0)
+  {
+    return PLUS_SUCCESS;
+  }
+
+  unsigned long frameStrideInBytes = RoundUp(frameSizeInBytes, FRAME_ALIGNMENT_BYTES);
+  unsigned long sizeInBytes = frameStrideInBytes * numberOfFrames;
+  void* memory(NULL);
+
+#ifdef _WIN32
+  if (useHugePages)
+  {
+    LOG_WARNING("Huge pages are not supported for video buffers on this platform, regular pages are used");
+  }
+  memory = _aligned_malloc(sizeInBytes, FRAME_ALIGNMENT_BYTES);
+#else
+  if (useHugePages)
+  {
+#ifdef MAP_HUGETLB
+    // Use explicitly reserved huge pages if available
+    unsigned long mappedSizeInBytes = RoundUp(sizeInBytes, HUGE_PAGE_SIZE_BYTES);
+    void* mapped = mmap(NULL, mappedSizeInBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mapped != MAP_FAILED)
+    {
+      memory = mapped;
+      this->MappedSizeInBytes = mappedSizeInBytes;
+      this->MemoryMapped = true;
+      this->HugePagesUsed = true;
+    }
+    else
+    {
+      LOG_DEBUG("No reserved huge pages are available for a " << sizeInBytes << " byte video buffer, transparent huge pages are requested instead");
+    }
+#endif
+    if (memory == NULL)
+    {
+      // Align to the huge page size so that the kernel can back the slab with transparent huge pages
+      if (posix_memalign(&memory, HUGE_PAGE_SIZE_BYTES, sizeInBytes) != 0)
+      {
+        memory = NULL;
+      }
+#ifdef MADV_HUGEPAGE
+      else if (madvise(memory, sizeInBytes, MADV_HUGEPAGE) == 0)
+      {
+        this->HugePagesUsed = true;
+      }
+#endif
+      if (memory != NULL && !this->HugePagesUsed)
+      {
+        LOG_WARNING("Huge pages are not available for video buffers, regular pages are used");
+      }
+    }
+  }
+  else if (posix_memalign(&memory, FRAME_ALIGNMENT_BYTES, sizeInBytes) != 0)
+  {
+    memory = NULL;
+  }
+#endif
+
+  if (memory == NULL)
+  {
+    LOG_ERROR("Failed to allocate " << sizeInBytes << " bytes of contiguous memory for " << numberOfFrames << " video frames");
+    this->Free();
+    return PLUS_FAIL;
+  }
+
+  this->Memory = memory;
+  this->NumberOfFrames = numberOfFrames;
+  this->FrameStrideInBytes = frameStrideInBytes;
+  this->SizeInBytes = sizeInBytes;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void* vtkPlusFrameSlab::GetFramePointer(unsigned int frameIndex)
+{
+  if (this->Memory == NULL || frameIndex >= this->NumberOfFrames)
+  {
+    return NULL;
+  }
+  return static_cast<unsigned char*>(this->Memory) + static_cast<size_t>(frameIndex) * this->FrameStrideInBytes;
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkPlusFrameSlab::CreateFrameImage(unsigned int frameIndex, const FrameSizeType& frameSize, igsioCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents)
+{
+  void* framePointer = this->GetFramePointer(frameIndex);
+  if (framePointer == NULL)
+  {
+    LOG_ERROR("Invalid frame index requested from video frame slab: " << frameIndex << " (number of frames: " << this->NumberOfFrames << ")");
+    return NULL;
+  }
+
+  unsigned long numberOfTuples = static_cast<unsigned long>(frameSize[0]) * frameSize[1] * frameSize[2];
+  unsigned long frameSizeInBytes = numberOfTuples * numberOfScalarComponents * igsioVideoFrame::GetNumberOfBytesPerScalar(pixelType);
+  if (frameSizeInBytes == 0 || frameSizeInBytes > this->FrameStrideInBytes)
+  {
+    LOG_ERROR("Frame of " << frameSizeInBytes << " bytes does not fit in a video frame slab slot of " << this->FrameStrideInBytes << " bytes");
+    return NULL;
+  }
+
+  vtkDataArray* scalars = vtkDataArray::CreateDataArray(pixelType);
+  if (scalars == NULL)
+  {
+    LOG_ERROR("Failed to create pixel array of type " << vtkImageScalarTypeNameMacro(pixelType));
+    return NULL;
+  }
+  scalars->SetNumberOfComponents(numberOfScalarComponents);
+  // The array does not own the memory (save=1), it keeps the slab alive instead
+  scalars->SetVoidArray(framePointer, numberOfTuples * numberOfScalarComponents, 1);
+  scalars->GetInformation()->Set(vtkPlusFrameSlab::FRAME_SLAB(), this);
+
+  vtkImageData* image = vtkImageData::New();
+  image->SetExtent(0, frameSize[0] - 1, 0, frameSize[1] - 1, 0, frameSize[2] - 1);
+  image->GetPointData()->SetScalars(scalars);
+  scalars->Delete();
+  return image;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusFrameSlab::Prefault()
+{
+  if (this->Memory == NULL)
+  {
+    return;
+  }
+  // Write back the current value of one byte per page, which forces the page to be mapped without modifying pixel values
+  volatile unsigned char* bytes = static_cast<volatile unsigned char*>(this->Memory);
+  for (unsigned long offset = 0; offset < this->SizeInBytes; offset += PREFAULT_STRIDE_BYTES)
+  {
+    bytes[offset] = bytes[offset];
+  }
+  bytes[this->SizeInBytes - 1] = bytes[this->SizeInBytes - 1];
+}
@@ -0,0 +1,97 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusFrameSlab_h
+#define __vtkPlusFrameSlab_h
+
+// Local includes
+#include "igsioCommon.h"
+#include "PlusConfigure.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+class vtkInformationObjectBaseKey;
+
+/*!
+  \class vtkPlusFrameSlab
+  \brief Single contiguous memory block that holds the pixel data of all frames of a video buffer
+
+  Frames are stored one after the other with a 64-byte aligned stride, so that every frame
+  starts on a cache line boundary. Optionally the slab is backed by huge pages (MAP_HUGETLB,
+  or madvise(MADV_HUGEPAGE) if no huge pages are reserved on the system; Linux only).
+
+  Images created by CreateFrameImage reference the slab memory and keep the slab alive
+  (the slab is stored in the information of their scalar array), therefore the slab is only
+  released when the buffer and all images that were created from it are deleted.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusFrameSlab : public vtkObject
+{
+public:
+  static vtkPlusFrameSlab* New();
+  vtkTypeMacro(vtkPlusFrameSlab, vtkObject);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /*! Key that stores the slab in the information of scalar arrays that reference the slab memory */
+  static vtkInformationObjectBaseKey* FRAME_SLAB();
+
+  /*!
+    Allocate memory for the specified number of frames in one block.
+    The memory can be allocated only once, a new slab has to be created for a different frame format.
+  */
+  PlusStatus Allocate(unsigned int numberOfFrames, unsigned long frameSizeInBytes, bool useHugePages);
+
+  /*! Get the pointer to the pixel data of the specified frame. Returns NULL if the index is out of range. */
+  void* GetFramePointer(unsigned int frameIndex);
+
+  /*!
+    Create an image that uses the memory of the specified frame as pixel data.
+    Returns NULL if the index is out of range or the frame format does not fit in a frame of the slab.
+  */
+  vtkImageData* CreateFrameImage(unsigned int frameIndex, const FrameSizeType& frameSize, igsioCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents);
+
+  /*! Touch every memory page of the slab, so that the first frames of the acquisition do not cause page faults. The pixel values are not modified. */
+  void Prefault();
+
+  /*! Get the number of frames in the slab */
+  vtkGetMacro(NumberOfFrames, unsigned int);
+  /*! Get the distance between the first bytes of two consecutive frames (frame size rounded up to the alignment) */
+  vtkGetMacro(FrameStrideInBytes, unsigned long);
+  /*! Get the total size of the slab */
+  vtkGetMacro(SizeInBytes, unsigned long);
+  /*! Returns true if the slab is backed by huge pages (or huge pages were requested with madvise) */
+  vtkGetMacro(HugePagesUsed, bool);
+
+  /*! Alignment of the slab and of each frame in bytes */
+  static const unsigned long FRAME_ALIGNMENT_BYTES = 64;
+
+protected:
+  vtkPlusFrameSlab();
+  ~vtkPlusFrameSlab();
+
+  /*! Release the slab memory */
+  void Free();
+
+  void* Memory;
+  unsigned int NumberOfFrames;
+  unsigned long FrameStrideInBytes;
+  unsigned long SizeInBytes;
+  /*! Number of bytes that have been mapped (may be larger than SizeInBytes if the slab is allocated with MAP_HUGETLB) */
+  unsigned long MappedSizeInBytes;
+  bool HugePagesUsed;
+  /*! True if the memory has to be released with munmap */
+  bool MemoryMapped;
+
+private:
+  vtkPlusFrameSlab(const vtkPlusFrameSlab&);
+  void operator=(const vtkPlusFrameSlab&);
+};
+
+#endif
@@ -12,11 +12,23 @@ See License.txt for details.
 #include "vtkTable.h"
 #include "vtkVariantArray.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 vtkStandardNewMacro(vtkPlusTimestampedCircularBuffer);
 
+namespace
+{
+  // Number of times a lock-free lookup is restarted if the writer overwrote the inspected items
+  // before falling back to a locked lookup
+  const int MAX_LOCK_FREE_READ_ATTEMPTS = 10;
+}
+
 //----------------------------------------------------------------------------
 vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   : Mutex(vtkIGSIORecursiveCriticalSection::New())
+  , LockDepth(0)
   , NumberOfItems(0)
   , WritePointer(0)
   , CurrentTimeStamp(0.0)
@@ -29,12 +41,37 @@ vtkPlusTimestampedCircularBuffer::vtkPlusTimestampedCircularBuffer()
   , TimeStampLogging(false)
   , StartTime(0)
   , NegligibleTimeDifferenceSec(1e-5)
+  , LockFreeReads(false)
+  , LockFreeSlots(std::make_shared<LockFreeSlotArray>(0, 0))
+  , PublishedLatestItemUid(0)
+  , PublishedNumberOfItems(0)
+  , PublishedStateSequence(0)
+  , LockedPublishedLatestItemUid(0)
+  , LockedPublishedNumberOfItems(0)
+  , PendingItemBufferIndex(-1)
+  , PendingItemUid(0)
+  , PendingItemPreviousNumberOfItems(0)
+  , PendingItemPreviousTimeStamp(0.0)
+  , NewItemSignalCount(0)
+  , NumberOfNewItemWaiters(0)
+  , LastNewItemCallbackId(0)
+  , NumberOfNewItemCallbacks(0)
+  , NewItemCallbacksPending(false)
 {
   this->BufferItemContainer.resize(0);
   this->FilterContainerIndexVector.set_size(0);
   this->FilterContainerTimestampVector.set_size(0);
   this->FilterContainersOldestIndex = 0;
   this->FilterContainersNumberOfValidElements = 0;
+  this->FilterSumIndex = 0;
+  this->FilterSumTimestamp = 0;
+  this->FilterSumIndexSquared = 0;
+  this->FilterSumIndexTimestamp = 0;
+  this->FilterOriginIndex = 0;
+  this->FilterOriginTimestamp = 0;
+  this->FilterItemsSinceRenormalization = 0;
+  this->TimestampFilteringMethod = TIMESTAMP_FILTERING_LINEAR_FIT;
+  this->ResetClockRecovery();
 }
 
 //----------------------------------------------------------------------------
@@ -65,8 +102,24 @@ void vtkPlusTimestampedCircularBuffer::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "BufferSize: " << this->GetBufferSize() << "\n";
   os << indent << "NumberOfItems: " << this->NumberOfItems << "\n";
   os << indent << "CurrentTimeStamp: " << this->CurrentTimeStamp << "\n";
-  os << indent << "Local time offset: " << this->LocalTimeOffsetSec << "\n";
+  os << indent << "Local time offset: " << this->LocalTimeOffsetSec.load() << "\n";
   os << indent << "Latest Item Uid: " << this->LatestItemUid << "\n";
+  os << indent << "LockFreeReads: " << (this->LockFreeReads.load() ? "true" : "false") << "\n";
+  os << indent << "TimestampFilteringMethod: " << GetTimestampFilteringMethodAsString(this->TimestampFilteringMethod) << "\n";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTimestampedCircularBuffer::LockFreeSlotArray::LockFreeSlotArray(int bufferSize, int firstUidBufferIndex)
+  : Slots(bufferSize)
+  , FirstUidBufferIndex(firstUidBufferIndex)
+{
+  for (std::vector<LockFreeSlot>::iterator it = this->Slots.begin(); it != this->Slots.end(); ++it)
+  {
+    it->Sequence.store(0, std::memory_order_relaxed);
+    it->FilteredTimestamp.store(0, std::memory_order_relaxed);
+    it->UnfilteredTimestamp.store(0, std::memory_order_relaxed);
+    it->Index.store(0, std::memory_order_relaxed);
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -80,11 +133,30 @@ PlusStatus vtkPlusTimestampedCircularBuffer::PrepareForNewItem(const double time
     return PLUS_FAIL;
   }
 
+  if (this->PendingItemBufferIndex >= 0)
+  {
+    // the previously prepared item is complete now
+    this->PublishPendingItem();
+  }
+
   // Increase frame unique ID
   newFrameUid = ++this->LatestItemUid;
   bufferIndex = this->WritePointer;
+  this->PendingItemPreviousNumberOfItems = this->NumberOfItems;
+  this->PendingItemPreviousTimeStamp = this->CurrentTimeStamp;
   this->CurrentTimeStamp = timestamp;
 
+  // The writer is the only thread that replaces the lock-free slots (with the lock held), so it can read the pointer directly
+  if (bufferIndex < static_cast<int>(this->LockFreeSlots->Slots.size()))
+  {
+    // Mark the slot as being written, lock-free readers of the item that is overwritten will retry or fail.
+    // The item is published when the writer releases the buffer lock.
+    this->LockFreeSlots->Slots[bufferIndex].Sequence.store(2 * newFrameUid - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->PendingItemBufferIndex = bufferIndex;
+    this->PendingItemUid = newFrameUid;
+  }
+
   this->NumberOfItems++;
   if (this->NumberOfItems > this->GetBufferSize())
   {
@@ -161,6 +233,8 @@ PlusStatus vtkPlusTimestampedCircularBuffer::SetBufferSize(int newBufferSize)
     this->NumberOfItems = this->GetBufferSize();
   }
 
+  this->ResetSlotSequences();
+
   this->Modified();
 
   return PLUS_SUCCESS;
@@ -206,9 +280,61 @@ StreamBufferItem* vtkPlusTimestampedCircularBuffer::GetBufferItemPointerFromBuff
   return &this->BufferItemContainer[bufferIndex];
 }
 
+//----------------------------------------------------------------------------
+template<typename SlotReader>
+ItemStatus vtkPlusTimestampedCircularBuffer::ReadItemLockFree(const BufferItemUidType uid, SlotReader reader)
+{
+  BufferItemUidType latestUid(0);
+  int numberOfItems(0);
+  this->GetPublishedState(latestUid, numberOfItems);
+  if (uid > latestUid)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  // The slots are loaded after the published state, so they are not older than the published state
+  std::shared_ptr<LockFreeSlotArray> lockFreeSlots = std::atomic_load(&this->LockFreeSlots);
+  const int bufferSize = lockFreeSlots->Slots.size();
+  // A slot may still hold an item that is not in the buffer anymore (the buffer is not full, see vtkPlusTransformBuffer)
+  if (uid == 0 || bufferSize == 0 || latestUid - uid >= static_cast<BufferItemUidType>(std::min(bufferSize, numberOfItems)))
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+
+  const int bufferIndex = (lockFreeSlots->FirstUidBufferIndex + (uid - 1) % bufferSize) % bufferSize;
+  const LockFreeSlot& slot = lockFreeSlots->Slots[bufferIndex];
+  const BufferItemUidType expectedSequence = 2 * uid;
+  BufferItemUidType sequenceBeforeRead = slot.Sequence.load(std::memory_order_acquire);
+  if (sequenceBeforeRead != expectedSequence)
+  {
+    return (sequenceBeforeRead < expectedSequence ? ITEM_NOT_AVAILABLE_YET : ITEM_NOT_AVAILABLE_ANYMORE);
+  }
+
+  reader(slot);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.Sequence.load(std::memory_order_relaxed) != sequenceBeforeRead)
+  {
+    // the writer started to overwrite the slot while we were reading it
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  return ITEM_OK;
+}
+
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferItemUidType uid, double& filteredTimestamp)
 {
+  if (this->LockFreeReads.load(std::memory_order_relaxed))
+  {
+    const double localTimeOffsetSec = this->LocalTimeOffsetSec.load(std::memory_order_relaxed);
+    double timestamp(0);
+    ItemStatus status = this->ReadItemLockFree(uid, [&timestamp, localTimeOffsetSec](const LockFreeSlot& slot)
+    {
+      timestamp = slot.FilteredTimestamp.load(std::memory_order_relaxed) + localTimeOffsetSec;
+    });
+    filteredTimestamp = (status == ITEM_OK ? timestamp : 0);
+    return status;
+  }
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -224,6 +350,18 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetFilteredTimeStamp(const BufferIt
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetUnfilteredTimeStamp(const BufferItemUidType uid, double& unfilteredTimestamp)
 {
+  if (this->LockFreeReads.load(std::memory_order_relaxed))
+  {
+    const double localTimeOffsetSec = this->LocalTimeOffsetSec.load(std::memory_order_relaxed);
+    double timestamp(0);
+    ItemStatus status = this->ReadItemLockFree(uid, [&timestamp, localTimeOffsetSec](const LockFreeSlot& slot)
+    {
+      timestamp = slot.UnfilteredTimestamp.load(std::memory_order_relaxed) + localTimeOffsetSec;
+    });
+    unfilteredTimestamp = (status == ITEM_OK ? timestamp : 0);
+    return status;
+  }
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -275,6 +413,17 @@ bool vtkPlusTimestampedCircularBuffer::GetLatestItemHasValidFieldData()
 //----------------------------------------------------------------------------
 ItemStatus vtkPlusTimestampedCircularBuffer::GetIndex(const BufferItemUidType uid, unsigned long& index)
 {
+  if (this->LockFreeReads.load(std::memory_order_relaxed))
+  {
+    unsigned long itemIndex(0);
+    ItemStatus status = this->ReadItemLockFree(uid, [&itemIndex](const LockFreeSlot& slot)
+    {
+      itemIndex = slot.Index.load(std::memory_order_relaxed);
+    });
+    index = (status == ITEM_OK ? itemIndex : 0);
+    return status;
+  }
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   StreamBufferItem* itemPtr = NULL;
   ItemStatus status = GetBufferItemPointerFromUid(uid, itemPtr);
@@ -310,88 +459,346 @@ ItemStatus vtkPlusTimestampedCircularBuffer::GetBufferIndexFromTime(const double
 }
 
 //----------------------------------------------------------------------------
-// do a simple divide-and-conquer search for the transform
-// that best matches the given timestamp
-ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double time, BufferItemUidType& uid)
+// find the item that best matches the given timestamp, starting from the item found by the caller's previous search
+ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTime(const double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/)
 {
+  if (this->LockFreeReads.load(std::memory_order_relaxed))
+  {
+    ItemStatus status = this->FindItemUidFromTimeLockFree(time, uid, searchHintUid);
+    if (status != ITEM_UNKNOWN_ERROR)
+    {
+      return status;
+    }
+    // The writer kept overwriting the inspected items, search with the lock held
+  }
+  const BufferItemUidType hintUid = (searchHintUid != NULL ? *searchHintUid : 0);
+
   igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
 
-  if (this->NumberOfItems == 1)
+  if (this->NumberOfItems < 1)
   {
-    // There is only one item, it's the closest one to any timestamp
-    uid = this->LatestItemUid;
-    return ITEM_OK;
+    return ITEM_NOT_AVAILABLE_YET;
   }
 
-  BufferItemUidType lo = this->LatestItemUid - (this->NumberOfItems - 1);   // oldest item UID
-  BufferItemUidType hi = this->LatestItemUid; // latest item UID
+  // This method is called often, therefore instead of calling this->GetTimeStamp(uid, timestamp) we perform low-level operations to get the timestamp
+  auto readTimestamp = [this](BufferItemUidType probedUid, double & timestamp) -> bool
+  {
+    int bufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - probedUid);
+    if (bufferIndex < 0)
+    {
+      bufferIndex += this->BufferItemContainer.size();
+    }
+    timestamp = this->BufferItemContainer[bufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+    return true;
+  };
 
-  // minimum time
-  // This method is called often, therefore instead of calling this->GetTimeStamp(lo, tlo) we perform low-level operations to get the timestamp
-  int loBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - lo);
-  if (loBufferIndex < 0)
+  BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfItems - 1);
+  ItemStatus status = FindItemUidFromTime(time, oldestUid, this->LatestItemUid, hintUid,
+                                          this->NegligibleTimeDifferenceSec, readTimestamp, uid);
+  if (status == ITEM_OK && searchHintUid != NULL)
   {
-    loBufferIndex += this->BufferItemContainer.size();
+    *searchHintUid = uid;
   }
-  double tlo = this->BufferItemContainer[loBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+  return status;
+}
 
-  // This method is called often, therefore instead of calling this->GetTimeStamp(hi, thi) we perform low-level operations to get the timestamp
-  int hiBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - hi);
-  if (hiBufferIndex < 0)
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::FindItemUidFromTimeLockFree(const double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/)
+{
+  const BufferItemUidType hintUid = (searchHintUid != NULL ? *searchHintUid : 0);
+  for (int attempt = 0; attempt < MAX_LOCK_FREE_READ_ATTEMPTS; ++attempt)
   {
-    hiBufferIndex += this->BufferItemContainer.size();
+    ItemStatus status = this->GetItemUidFromTimeLockFree(time, hintUid, uid);
+    if (status != ITEM_UNKNOWN_ERROR)
+    {
+      if (status == ITEM_OK && searchHintUid != NULL)
+      {
+        *searchHintUid = uid;
+      }
+      return status;
+    }
   }
-  double thi = this->BufferItemContainer[hiBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+  return ITEM_UNKNOWN_ERROR;
+}
 
-  // If the timestamp is slightly out of range then still accept it
-  // (due to errors in conversions there could be slight differences)
-  if (time < tlo - this->NegligibleTimeDifferenceSec)
+//----------------------------------------------------------------------------
+// Same search as the locked GetItemUidFromTime, but on published items only.
+// Returns ITEM_UNKNOWN_ERROR if the search has to be restarted because the writer overwrote an inspected item.
+ItemStatus vtkPlusTimestampedCircularBuffer::GetItemUidFromTimeLockFree(const double time, BufferItemUidType hintUid, BufferItemUidType& uid)
+{
+  BufferItemUidType latestUid(0);
+  int numberOfItems(0);
+  this->GetPublishedState(latestUid, numberOfItems);
+  if (numberOfItems < 1)
   {
-    return ITEM_NOT_AVAILABLE_ANYMORE;
+    return ITEM_NOT_AVAILABLE_YET;
   }
-  else if (time > thi + this->NegligibleTimeDifferenceSec)
+
+  const double localTimeOffsetSec = this->LocalTimeOffsetSec.load(std::memory_order_relaxed);
+  auto readTimestamp = [this, localTimeOffsetSec](BufferItemUidType probedUid, double & timestamp) -> bool
   {
-    return ITEM_NOT_AVAILABLE_YET;
+    return this->ReadItemLockFree(probedUid, [&timestamp, localTimeOffsetSec](const LockFreeSlot & slot)
+    {
+      timestamp = slot.FilteredTimestamp.load(std::memory_order_relaxed) + localTimeOffsetSec;
+    }) == ITEM_OK;
+  };
+
+  return FindItemUidFromTime(time, latestUid - (numberOfItems - 1), latestUid, hintUid,
+                             this->NegligibleTimeDifferenceSec, readTimestamp, uid);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTimestampedCircularBuffer::GetOldestTimeStampLockFree(double& timestamp)
+{
+  // The oldest item may be overwritten at any moment, retry with the new oldest item then
+  ItemStatus status = ITEM_NOT_AVAILABLE_ANYMORE;
+  for (int attempt = 0; attempt < MAX_LOCK_FREE_READ_ATTEMPTS && status == ITEM_NOT_AVAILABLE_ANYMORE; ++attempt)
+  {
+    status = this->GetFilteredTimeStamp(this->GetOldestItemUidInBuffer(), timestamp);
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::PublishPendingItem()
+{
+  // the caller must have locked the buffer
+  StreamBufferItem& item = this->BufferItemContainer[this->PendingItemBufferIndex];
+  LockFreeSlot& slot = this->LockFreeSlots->Slots[this->PendingItemBufferIndex];
+  slot.FilteredTimestamp.store(item.GetFilteredTimestamp(0), std::memory_order_relaxed);
+  slot.UnfilteredTimestamp.store(item.GetUnfilteredTimestamp(0), std::memory_order_relaxed);
+  slot.Index.store(item.GetIndex(), std::memory_order_relaxed);
+  slot.Sequence.store(2 * this->PendingItemUid, std::memory_order_release);
+  this->FramePeriodStatistics.AddItem(item.GetFilteredTimestamp(0), item.GetIndex());
+  this->PendingItemBufferIndex = -1;
+  this->PublishState(this->PendingItemUid, this->NumberOfItems);
+  this->SignalNewItem();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::CancelPendingItem()
+{
+  // the caller must have locked the buffer, the item has just been prepared
+  --this->LatestItemUid;
+  this->CurrentTimeStamp = this->PendingItemPreviousTimeStamp;
+  if (this->PendingItemBufferIndex < 0)
+  {
+    // the buffer has no slots, nothing was overwritten
+    return;
+  }
+  this->WritePointer = this->PendingItemBufferIndex;
+  // The slot keeps its odd sequence number, so lock-free readers report its previous item as not available anymore
+  this->NumberOfItems = std::min(this->PendingItemPreviousNumberOfItems, this->GetBufferSize() - 1);
+  this->PendingItemBufferIndex = -1;
+  this->PublishState(this->LatestItemUid, this->NumberOfItems);
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusTimestampedCircularBuffer::DiscardOldestItems(int numberOfItems)
+{
+  // the caller must have locked the buffer, the item has just been prepared
+  const int numberOfPreviousItems = std::min(this->PendingItemPreviousNumberOfItems, this->GetBufferSize() - 1);
+  numberOfItems = std::min(numberOfItems, numberOfPreviousItems);
+  if (numberOfItems <= 0)
+  {
+    return 0;
   }
+  this->NumberOfItems -= numberOfItems;
+  // CancelPendingItem must not restore the removed items
+  this->PendingItemPreviousNumberOfItems = numberOfPreviousItems - numberOfItems;
+  this->PublishState(this->LatestItemUid - 1, this->PendingItemPreviousNumberOfItems);
+  return numberOfItems;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::PublishState(BufferItemUidType latestUid, int numberOfItems)
+{
+  // the caller must have locked the buffer, so there is a single writer of the sequence
+  const unsigned long sequence = this->PublishedStateSequence.load(std::memory_order_relaxed);
+  this->PublishedStateSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  this->PublishedNumberOfItems.store(numberOfItems, std::memory_order_relaxed);
+  this->PublishedLatestItemUid.store(latestUid, std::memory_order_release);
+  this->PublishedStateSequence.store(sequence + 2, std::memory_order_release);
+  this->LockedPublishedLatestItemUid = latestUid;
+  this->LockedPublishedNumberOfItems = numberOfItems;
+}
 
-  for (;;)
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::GetPublishedState(BufferItemUidType& latestUid, int& numberOfItems)
+{
+  for (int attempt = 0; attempt < MAX_LOCK_FREE_READ_ATTEMPTS; ++attempt)
   {
-    if (hi - lo <= 1)
+    const unsigned long sequenceBeforeRead = this->PublishedStateSequence.load(std::memory_order_acquire);
+    latestUid = this->PublishedLatestItemUid.load(std::memory_order_acquire);
+    numberOfItems = this->PublishedNumberOfItems.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((sequenceBeforeRead & 1) == 0 && this->PublishedStateSequence.load(std::memory_order_relaxed) == sequenceBeforeRead)
     {
-      if (time - tlo > thi - time)
-      {
-        uid = hi;
-        return ITEM_OK;
-      }
-      else
-      {
-        uid = lo;
-        return ITEM_OK;
-      }
+      return;
     }
+    // the writer is updating the published state, it takes only a few stores
+    std::this_thread::yield();
+  }
 
-    int mid = (lo + hi) / 2;
+  // The writer was preempted while updating the published state, read the state under the lock.
+  // The writer publishes its pending item when it releases the lock, so the locked copy is up to date.
+  this->Lock();
+  latestUid = this->LockedPublishedLatestItemUid;
+  numberOfItems = this->LockedPublishedNumberOfItems;
+  this->Unlock();
+}
 
-    // This is a hot loop, therefore instead of calling this->GetTimeStamp(mid, tmid) we perform low-level operations to get the timestamp
-    int midBufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - mid);
-    if (midBufferIndex < 0)
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SignalNewItem()
+{
+  // the caller must have locked the buffer
+  this->NewItemSignalCount.fetch_add(1);
+  if (this->NumberOfNewItemWaiters.load() > 0)
+  {
+    // Waiters check the signal count with NewItemMutex held, lock it to make sure that the notification is not lost
+    // (waiters never acquire the buffer lock while holding NewItemMutex, so this cannot deadlock)
     {
-      midBufferIndex += this->BufferItemContainer.size();
+      std::lock_guard<std::mutex> newItemLock(this->NewItemMutex);
     }
-    double tmid = this->BufferItemContainer[midBufferIndex].GetFilteredTimestamp(this->LocalTimeOffsetSec);
+    this->NewItemCondition.notify_all();
+  }
+
+  if (this->NumberOfNewItemCallbacks.load() > 0)
+  {
+    // Callbacks are run by Unlock, so that they do not extend the time the buffer is locked
+    this->NewItemCallbacksPending = true;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RunNewItemCallbacks()
+{
+  std::lock_guard<std::mutex> callbacksLock(this->NewItemCallbacksMutex);
+  for (std::map<unsigned long, NewItemCallbackType>::iterator it = this->NewItemCallbacks.begin(); it != this->NewItemCallbacks.end(); ++it)
+  {
+    it->second();
+  }
+}
+
+//----------------------------------------------------------------------------
+unsigned long vtkPlusTimestampedCircularBuffer::AddNewItemCallback(const NewItemCallbackType& callback)
+{
+  std::lock_guard<std::mutex> callbacksLock(this->NewItemCallbacksMutex);
+  unsigned long callbackId = ++this->LastNewItemCallbackId;
+  this->NewItemCallbacks[callbackId] = callback;
+  this->NumberOfNewItemCallbacks.store(static_cast<int>(this->NewItemCallbacks.size()));
+  return callbackId;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RemoveNewItemCallback(unsigned long callbackId)
+{
+  std::lock_guard<std::mutex> callbacksLock(this->NewItemCallbacksMutex);
+  this->NewItemCallbacks.erase(callbackId);
+  this->NumberOfNewItemCallbacks.store(static_cast<int>(this->NewItemCallbacks.size()));
+}
 
-    if (time < tmid)
+//----------------------------------------------------------------------------
+bool vtkPlusTimestampedCircularBuffer::WaitForNewItemSignal(unsigned long signalCount, double timeoutSec)
+{
+  if (timeoutSec <= 0)
+  {
+    return this->NewItemSignalCount.load() != signalCount;
+  }
+  this->NumberOfNewItemWaiters.fetch_add(1);
+  bool signaled(false);
+  {
+    std::unique_lock<std::mutex> newItemLock(this->NewItemMutex);
+    signaled = this->NewItemCondition.wait_for(newItemLock, std::chrono::duration<double>(timeoutSec), [this, signalCount]()
     {
-      hi = mid;
-      thi = tmid;
-    }
-    else
+      return this->NewItemSignalCount.load() != signalCount;
+    });
+  }
+  this->NumberOfNewItemWaiters.fetch_sub(1);
+  return signaled;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ResetSlotSequences()
+{
+  // the caller must have locked the buffer
+  const int bufferSize = this->GetBufferSize();
+  this->PendingItemBufferIndex = -1;
+
+  // Lock-free readers may still use the current slots, so new slots are created instead of modifying them in place
+  // WritePointer is the buffer index of LatestItemUid+1
+  const int firstUidBufferIndex = (bufferSize > 0 ? (this->WritePointer - static_cast<int>(this->LatestItemUid % bufferSize) + bufferSize) % bufferSize : 0);
+  std::shared_ptr<LockFreeSlotArray> lockFreeSlots = std::make_shared<LockFreeSlotArray>(bufferSize, firstUidBufferIndex);
+  for (int i = 0; i < this->NumberOfItems && bufferSize > 0; ++i)
+  {
+    BufferItemUidType uid = this->LatestItemUid - i;
+    const int bufferIndex = (firstUidBufferIndex + (uid - 1) % bufferSize) % bufferSize;
+    StreamBufferItem& item = this->BufferItemContainer[bufferIndex];
+    LockFreeSlot& slot = lockFreeSlots->Slots[bufferIndex];
+    slot.FilteredTimestamp.store(item.GetFilteredTimestamp(0), std::memory_order_relaxed);
+    slot.UnfilteredTimestamp.store(item.GetUnfilteredTimestamp(0), std::memory_order_relaxed);
+    slot.Index.store(item.GetIndex(), std::memory_order_relaxed);
+    slot.Sequence.store(2 * uid, std::memory_order_relaxed);
+  }
+  std::atomic_store(&this->LockFreeSlots, lockFreeSlots);
+
+  this->PublishState(this->LatestItemUid, this->NumberOfItems);
+
+  // Compute the frame period statistics of the items that remained in the buffer
+  if (this->FramePeriodStatistics.GetWindowSize() != std::max(bufferSize - 1, 0))
+  {
+    this->FramePeriodStatistics.SetWindowSize(std::max(bufferSize - 1, 0));
+  }
+  else
+  {
+    this->FramePeriodStatistics.Clear();
+  }
+  for (BufferItemUidType uid = this->LatestItemUid - (this->NumberOfItems - 1); uid <= this->LatestItemUid; ++uid)
+  {
+    int bufferIndex = (this->WritePointer - 1) - (this->LatestItemUid - uid);
+    if (bufferIndex < 0)
     {
-      lo = mid;
-      tlo = tmid;
+      bufferIndex += bufferSize;
     }
+    this->FramePeriodStatistics.AddItem(this->BufferItemContainer[bufferIndex].GetFilteredTimestamp(0), this->BufferItemContainer[bufferIndex].GetIndex());
   }
+}
 
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ResetExternalItems(int firstUidSlotIndex, BufferItemUidType latestUid, int numberOfItems, const std::vector<double>& filteredTimestamps,
+    const std::vector<double>& unfilteredTimestamps, const std::vector<unsigned long>& indices)
+{
+  // the caller must have locked the buffer
+  const int numberOfSlots = static_cast<int>(filteredTimestamps.size());
+  std::shared_ptr<LockFreeSlotArray> lockFreeSlots = std::make_shared<LockFreeSlotArray>(numberOfSlots, firstUidSlotIndex);
+  for (int i = 0; i < numberOfItems && numberOfSlots > 0; ++i)
+  {
+    BufferItemUidType uid = latestUid - i;
+    const int slotIndex = (firstUidSlotIndex + (uid - 1) % numberOfSlots) % numberOfSlots;
+    LockFreeSlot& slot = lockFreeSlots->Slots[slotIndex];
+    slot.FilteredTimestamp.store(filteredTimestamps[slotIndex], std::memory_order_relaxed);
+    slot.UnfilteredTimestamp.store(unfilteredTimestamps[slotIndex], std::memory_order_relaxed);
+    slot.Index.store(indices[slotIndex], std::memory_order_relaxed);
+    slot.Sequence.store(2 * uid, std::memory_order_relaxed);
+  }
+  std::atomic_store(&this->LockFreeSlots, lockFreeSlots);
+  this->PublishState(latestUid, numberOfItems);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::PublishExternalItem(BufferItemUidType uid, int slotIndex, double filteredTimestamp, double unfilteredTimestamp, unsigned long index, int numberOfItems)
+{
+  // the caller must have locked the buffer, the writer is the only thread that replaces the slots
+  LockFreeSlot& slot = this->LockFreeSlots->Slots[slotIndex];
+  // Readers of the item that is overwritten retry or fail, same as for the items of this buffer (see PrepareForNewItem)
+  slot.Sequence.store(2 * uid - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.FilteredTimestamp.store(filteredTimestamp, std::memory_order_relaxed);
+  slot.UnfilteredTimestamp.store(unfilteredTimestamp, std::memory_order_relaxed);
+  slot.Index.store(index, std::memory_order_relaxed);
+  slot.Sequence.store(2 * uid, std::memory_order_release);
+  this->PublishState(uid, numberOfItems);
 }
 
 //----------------------------------------------------------------------------
@@ -402,7 +809,7 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
   this->WritePointer = buffer->WritePointer;
   this->NumberOfItems = buffer->NumberOfItems;
   this->CurrentTimeStamp = buffer->CurrentTimeStamp;
-  this->LocalTimeOffsetSec = buffer->LocalTimeOffsetSec;
+  this->LocalTimeOffsetSec.store(buffer->LocalTimeOffsetSec.load());
   this->LatestItemUid = buffer->LatestItemUid;
   this->StartTime = buffer->StartTime;
   this->AveragedItemsForFiltering = buffer->AveragedItemsForFiltering;
@@ -410,8 +817,23 @@ void vtkPlusTimestampedCircularBuffer::DeepCopy(vtkPlusTimestampedCircularBuffer
   this->FilterContainersOldestIndex = buffer->FilterContainersOldestIndex;
   this->FilterContainerTimestampVector = buffer->FilterContainerTimestampVector;
   this->FilterContainerIndexVector = buffer->FilterContainerIndexVector;
+  this->FilterSumIndex = buffer->FilterSumIndex;
+  this->FilterSumTimestamp = buffer->FilterSumTimestamp;
+  this->FilterSumIndexSquared = buffer->FilterSumIndexSquared;
+  this->FilterSumIndexTimestamp = buffer->FilterSumIndexTimestamp;
+  this->FilterOriginIndex = buffer->FilterOriginIndex;
+  this->FilterOriginTimestamp = buffer->FilterOriginTimestamp;
+  this->FilterItemsSinceRenormalization = buffer->FilterItemsSinceRenormalization;
+  this->TimestampFilteringMethod = buffer->TimestampFilteringMethod;
+  this->ClockEstimatedTimestamp = buffer->ClockEstimatedTimestamp;
+  this->ClockEstimatedFramePeriod = buffer->ClockEstimatedFramePeriod;
+  this->ClockLatestItemIndex = buffer->ClockLatestItemIndex;
+  this->ClockNumberOfItems = buffer->ClockNumberOfItems;
+  this->ClockInnovationVariance = buffer->ClockInnovationVariance;
+  this->ClockNumberOfConsecutiveOutliers = buffer->ClockNumberOfConsecutiveOutliers;
 
   this->BufferItemContainer = buffer->BufferItemContainer;
+  this->ResetSlotSequences();
   this->Unlock();
   buffer->Unlock();
 }
@@ -424,99 +846,32 @@ void vtkPlusTimestampedCircularBuffer::Clear()
   this->NumberOfItems = 0;
   this->CurrentTimeStamp = 0;
   this->LatestItemUid = 0;
+  this->ResetSlotSequences();
   this->Unlock();
 }
 
 //----------------------------------------------------------------------------
 double vtkPlusTimestampedCircularBuffer::GetFrameRate(bool ideal /*=false*/, double* framePeriodStdevSecPtr /* =NULL */)
 {
-  // TODO: Start the frame rate computation from the latest frame UID with using a few seconds of items in the buffer
-  bool cannotComputeIdealFrameRateDueToInvalidFrameNumbers = false;
-
-  std::vector<double> framePeriods;
-  for (BufferItemUidType frame = this->GetLatestItemUidInBuffer(); frame > this->GetOldestItemUidInBuffer(); --frame)
-  {
-    double time(0);
-    if (this->GetTimeStamp(frame, time) != ITEM_OK)
-    {
-      continue;
-    }
-
-    unsigned long framenum(0);
-    if (this->GetIndex(frame, framenum) != ITEM_OK)
-    {
-      continue;
-    }
-
-    double prevtime(0);
-    if (this->GetTimeStamp(frame - 1, prevtime) != ITEM_OK)
-    {
-      continue;
-    }
-
-    unsigned long prevframenum(0);
-    if (this->GetIndex(frame - 1, prevframenum) != ITEM_OK)
-    {
-      continue;
-    }
-
-    double frameperiod = (time - prevtime);
-    int frameDiff = framenum - prevframenum;
-
-    if (ideal)
-    {
-      if (frameDiff > 0)
-      {
-        frameperiod /= (1.0 * frameDiff);
-      }
-      else
-      {
-        // the same frame number was set for different frame indexes; this should not happen (probably no frame number is available)
-        cannotComputeIdealFrameRateDueToInvalidFrameNumbers = true;
-      }
-    }
-
-    if (frameperiod > 0)
-    {
-      framePeriods.push_back(frameperiod);
-    }
-  }
+  // The frame period statistics are updated when items are added, no need to lock the buffer
+  double frameRate(0);
+  double framePeriodStdev(0);
+  bool frameIndicesValid(true);
+  PlusStatus status = this->FramePeriodStatistics.GetFrameRate(ideal, frameRate, framePeriodStdev, frameIndicesValid);
 
-  if (cannotComputeIdealFrameRateDueToInvalidFrameNumbers)
+  if (!frameIndicesValid)
   {
     LOG_WARNING("Cannot compute ideal frame rate acurately, as frame numbers are invalid or missing");
   }
 
-  const int numberOfFramePeriods =  framePeriods.size();
-  if (numberOfFramePeriods < 1)
+  if (status != PLUS_SUCCESS)
   {
     LOG_WARNING("Failed to compute frame rate. Not enough samples.");
     return 0;
   }
 
-  double samplingPeriod(0);
-  for (int i = 0; i < numberOfFramePeriods; i++)
-  {
-    samplingPeriod += framePeriods[i];
-  }
-  samplingPeriod /= 1.0 * numberOfFramePeriods;
-
-  double frameRate(0);
-  if (samplingPeriod != 0)
-  {
-    frameRate = 1.0 / samplingPeriod;
-  }
-
   if (framePeriodStdevSecPtr != NULL)
   {
-    // Standard deviation of sampling period
-    // stdev = sqrt ( 1/N * sum[ (xi-mean)^2 ] ) = sqrt ( 1/N * sumOfXiMeanDiffSquare )
-    double sumOfXiMeanDiffSquare = 0;
-    for (int i = 0; i < numberOfFramePeriods; i++)
-    {
-      sumOfXiMeanDiffSquare += (framePeriods[i] - samplingPeriod) * (framePeriods[i] - samplingPeriod);
-    }
-    double framePeriodStdev = sqrt(sumOfXiMeanDiffSquare / numberOfFramePeriods);
     (*framePeriodStdevSecPtr) = framePeriodStdev;
   }
 
@@ -531,6 +886,13 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   this->Lock();
   filteredTimestampProbablyValid = true;
 
+  if (this->TimestampFilteringMethod == TIMESTAMP_FILTERING_CLOCK_RECOVERY && this->AveragedItemsForFiltering > 1)
+  {
+    PlusStatus status = this->CreateClockRecoveryTimeStampForItem(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp, filteredTimestampProbablyValid);
+    this->Unlock();
+    return status;
+  }
+
   if (this->FilterContainerIndexVector.size() != this->AveragedItemsForFiltering
       || this->FilterContainerTimestampVector.size() != this->AveragedItemsForFiltering)
   {
@@ -542,13 +904,42 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   }
 
   // We store the last AveragedItemsForFiltering unfiltered timestamp and item indexes, because these are used for computing the filtered timestamp.
+  // The sums that are needed for the line fitting are updated as items enter and leave the containers.
   if (this->AveragedItemsForFiltering > 1)
   {
+    if (this->FilterContainersNumberOfValidElements == 0)
+    {
+      this->FilterOriginIndex = itemIndex;
+      this->FilterOriginTimestamp = inUnfilteredTimestamp;
+      this->FilterSumIndex = 0;
+      this->FilterSumTimestamp = 0;
+      this->FilterSumIndexSquared = 0;
+      this->FilterSumIndexTimestamp = 0;
+      this->FilterItemsSinceRenormalization = 0;
+    }
+    else if (this->FilterContainersNumberOfValidElements == this->AveragedItemsForFiltering)
+    {
+      // the oldest item is overwritten, remove it from the sums
+      double oldestX = this->FilterContainerIndexVector(this->FilterContainersOldestIndex) - this->FilterOriginIndex;
+      double oldestY = this->FilterContainerTimestampVector(this->FilterContainersOldestIndex) - this->FilterOriginTimestamp;
+      this->FilterSumIndex -= oldestX;
+      this->FilterSumTimestamp -= oldestY;
+      this->FilterSumIndexSquared -= oldestX * oldestX;
+      this->FilterSumIndexTimestamp -= oldestX * oldestY;
+    }
+
     this->FilterContainerIndexVector(this->FilterContainersOldestIndex) = itemIndex;
     this->FilterContainerTimestampVector[this->FilterContainersOldestIndex] = inUnfilteredTimestamp;
     this->FilterContainersNumberOfValidElements++;
     this->FilterContainersOldestIndex++;
 
+    double newX = itemIndex - this->FilterOriginIndex;
+    double newY = inUnfilteredTimestamp - this->FilterOriginTimestamp;
+    this->FilterSumIndex += newX;
+    this->FilterSumTimestamp += newY;
+    this->FilterSumIndexSquared += newX * newX;
+    this->FilterSumIndexTimestamp += newX * newY;
+
     if (this->FilterContainersNumberOfValidElements > this->AveragedItemsForFiltering)
     {
       this->FilterContainersNumberOfValidElements = this->AveragedItemsForFiltering;
@@ -558,6 +949,14 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
     {
       this->FilterContainersOldestIndex = 0;
     }
+
+    // All the items are replaced in every AveragedItemsForFiltering steps, recompute the sums at the same rate
+    // (it does not change the amortized cost and the rounding errors of the updates cannot accumulate)
+    this->FilterItemsSinceRenormalization++;
+    if (this->FilterItemsSinceRenormalization >= this->AveragedItemsForFiltering)
+    {
+      this->RenormalizeFilterSums();
+    }
   }
 
   // If we don't have enough unfiltered timestamps or we don't want to use afiltering then just use the unfiltered timestamps
@@ -590,21 +989,27 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   //   a = sum( (x(i)-xMean) * (y(i)-yMean) ) / sum( (x(i)-xMean) * (x(i)-xMean) )
   //   b = yMean - a*xMean
   //
+  // The sums are computed from the running sums (x and y are relative to the filter origin):
+  //   sum( (x(i)-xMean) * (y(i)-yMean) ) = sum( x(i)*y(i) ) - sum( x(i) ) * sum( y(i) ) / n
+  //   sum( (x(i)-xMean) * (x(i)-xMean) ) = sum( x(i)*x(i) ) - sum( x(i) ) * sum( x(i) ) / n
+  //
 
-  double xMean = this->FilterContainerIndexVector.mean();
-  double yMean = this->FilterContainerTimestampVector.mean();
-  double covarianceXY = 0;
-  double varianceX = 0;
-  for (int i = this->FilterContainerTimestampVector.size() - 1; i >= 0; i--)
+  const double n = this->FilterContainersNumberOfValidElements;
+  double covarianceXY = this->FilterSumIndexTimestamp - this->FilterSumIndex * this->FilterSumTimestamp / n;
+  double varianceX = this->FilterSumIndexSquared - this->FilterSumIndex * this->FilterSumIndex / n;
+  if (varianceX <= 0)
   {
-    double xiMinusXmean = (this->FilterContainerIndexVector(i) - xMean);
-    covarianceXY += xiMinusXmean * (this->FilterContainerTimestampVector(i) - yMean);
-    varianceX += xiMinusXmean * xiMinusXmean;
+    // all the item indexes are the same, the line cannot be fitted: use the unfiltered timestamp, as without filtering
+    outFilteredTimestamp = inUnfilteredTimestamp;
+    LOG_DEBUG("Timestamp filtering is not possible, the item indexes of the last " << this->AveragedItemsForFiltering << " items are identical (item index: " << itemIndex << ")");
+    AddToTimeStampReport(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp);
+    this->Unlock();
+    return PLUS_SUCCESS;
   }
   double a = covarianceXY / varianceX;
-  double b = yMean - a * xMean;
+  double b = (this->FilterSumTimestamp - a * this->FilterSumIndex) / n;
 
-  outFilteredTimestamp = a * itemIndex + b;
+  outFilteredTimestamp = a * (itemIndex - this->FilterOriginIndex) + b + this->FilterOriginTimestamp;
 
   if (this->TimeStampLogging)
   {
@@ -612,7 +1017,7 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
     LOG_TRACE("frameindexes = [" << std::fixed << this->FilterContainerIndexVector << "];");
   }
 
-  AddToTimeStampReport(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp);
+  AddToTimeStampReport(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp, a);
 
   if (fabs(outFilteredTimestamp - inUnfilteredTimestamp) > this->MaxAllowedFilteringTimeDifference)
   {
@@ -628,6 +1033,196 @@ PlusStatus vtkPlusTimestampedCircularBuffer::CreateFilteredTimeStampForItem(unsi
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::CreateClockRecoveryTimeStampForItem(unsigned long itemIndex, double inUnfilteredTimestamp, double& outFilteredTimestamp, bool& filteredTimestampProbablyValid)
+{
+  // the caller must have locked the buffer
+  //
+  // The item timestamps are modeled as a clock with a slowly drifting frame period:
+  //   timestamp(k) = timestamp(k-1) + framePeriod * (itemIndex(k) - itemIndex(k-1)) + delay(k)
+  // The timestamp and the frame period are tracked by an alpha-beta filter. While less than AveragedItemsForFiltering
+  // items are received, the gains of a growing memory least squares fit are used, then they remain constant
+  // (steady-state Kalman filter with a memory of about AveragedItemsForFiltering items):
+  //   alpha = 2*(2n-1) / (n*(n+1))
+  //   beta = 6 / (n*(n+1))
+  // If the difference between the unfiltered and predicted timestamps (innovation) is larger than
+  // CLOCK_RECOVERY_OUTLIER_THRESHOLD standard deviations then the item is an outlier (e.g., delivered in a burst):
+  // it does not change the timestamp and frame period estimates and its filtered timestamp is the predicted timestamp,
+  // therefore it does not have to be dropped. The innovation of an outlier is clamped to the threshold and updates the
+  // innovation variance with a lower gain, so that the threshold widens if the jitter increases, but a short burst
+  // does not open it. A long series of outliers means that the clock has jumped and clock recovery is restarted.
+  // Items are never rejected: if the filtered timestamp differs from the unfiltered timestamp by more than
+  // MaxAllowedFilteringTimeDifference, then an outlier keeps the predicted timestamp, any other item gets its unfiltered timestamp.
+
+  static const double CLOCK_RECOVERY_OUTLIER_THRESHOLD = 3.0;
+  static const unsigned int CLOCK_RECOVERY_MIN_ITEMS_FOR_OUTLIER_DETECTION = 20;
+
+  if (this->ClockNumberOfItems == 0 || itemIndex <= this->ClockLatestItemIndex)
+  {
+    // first item or the item index has been reset
+    this->ResetClockRecovery();
+    this->ClockEstimatedTimestamp = inUnfilteredTimestamp;
+    this->ClockLatestItemIndex = itemIndex;
+    this->ClockNumberOfItems = 1;
+    outFilteredTimestamp = inUnfilteredTimestamp;
+    AddToTimeStampReport(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp);
+    return PLUS_SUCCESS;
+  }
+
+  const double itemIndexDifference = itemIndex - this->ClockLatestItemIndex;
+  const double predictedTimestamp = this->ClockEstimatedTimestamp + this->ClockEstimatedFramePeriod * itemIndexDifference;
+  const double innovation = inUnfilteredTimestamp - predictedTimestamp;
+
+  // outliers are only detected when the frame period and the innovation variance estimates are settled
+  bool outlier = (this->ClockNumberOfItems >= std::min(this->AveragedItemsForFiltering, CLOCK_RECOVERY_MIN_ITEMS_FOR_OUTLIER_DETECTION)
+                  && fabs(innovation) > CLOCK_RECOVERY_OUTLIER_THRESHOLD * sqrt(this->ClockInnovationVariance));
+
+  const double n = std::min(this->ClockNumberOfItems + 1, this->AveragedItemsForFiltering);
+  if (outlier)
+  {
+    this->ClockEstimatedTimestamp = predictedTimestamp;
+    const double clampedInnovationSquared = CLOCK_RECOVERY_OUTLIER_THRESHOLD * CLOCK_RECOVERY_OUTLIER_THRESHOLD * this->ClockInnovationVariance;
+    this->ClockInnovationVariance += (clampedInnovationSquared - this->ClockInnovationVariance) / (std::max(n - 2.0, 1.0) * CLOCK_RECOVERY_OUTLIER_THRESHOLD * CLOCK_RECOVERY_OUTLIER_THRESHOLD);
+  }
+  else
+  {
+    const double alpha = 2.0 * (2.0 * n - 1.0) / (n * (n + 1.0));
+    const double beta = 6.0 / (n * (n + 1.0));
+    this->ClockEstimatedTimestamp = predictedTimestamp + alpha * innovation;
+    this->ClockEstimatedFramePeriod += beta * innovation / itemIndexDifference;
+    if (this->ClockNumberOfItems > 1)
+    {
+      // the first innovation is the frame period itself, it is not used for the variance estimation
+      this->ClockInnovationVariance += (innovation * innovation - this->ClockInnovationVariance) / std::max(n - 2.0, 1.0);
+    }
+  }
+  this->ClockLatestItemIndex = itemIndex;
+  this->ClockNumberOfItems++;
+
+  if (outlier)
+  {
+    this->ClockNumberOfConsecutiveOutliers++;
+    if (this->ClockNumberOfConsecutiveOutliers > this->AveragedItemsForFiltering)
+    {
+      // the timestamps are consistently different from the prediction, the clock has jumped
+      LOG_DEBUG("Timestamps of the last " << this->ClockNumberOfConsecutiveOutliers << " items differ from the predicted timestamps, restart clock recovery at item index " << itemIndex);
+      this->ResetClockRecovery();
+      this->ClockEstimatedTimestamp = inUnfilteredTimestamp;
+      this->ClockLatestItemIndex = itemIndex;
+      this->ClockNumberOfItems = 1;
+    }
+  }
+  else
+  {
+    this->ClockNumberOfConsecutiveOutliers = 0;
+  }
+
+  outFilteredTimestamp = this->ClockEstimatedTimestamp;
+  if (fabs(outFilteredTimestamp - inUnfilteredTimestamp) > this->MaxAllowedFilteringTimeDifference)
+  {
+    // The item is kept, with the predicted timestamp if the unfiltered timestamp is a spike, otherwise with the unfiltered timestamp
+    LOG_DEBUG("Difference between unfiltered timestamp is larger than the threshold. The " << (outlier ? "unfiltered" : "filtered") << " timestamp may be incorrect."
+              << " Unfiltered timestamp: " << inUnfilteredTimestamp << ", filtered timestamp: " << outFilteredTimestamp << ", difference: " << fabs(outFilteredTimestamp - inUnfilteredTimestamp) << ", threshold: " << this->MaxAllowedFilteringTimeDifference << ".");
+    if (!outlier)
+    {
+      outFilteredTimestamp = inUnfilteredTimestamp;
+    }
+  }
+  AddToTimeStampReport(itemIndex, inUnfilteredTimestamp, outFilteredTimestamp, this->ClockEstimatedFramePeriod, outlier);
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::ResetClockRecovery()
+{
+  this->ClockEstimatedTimestamp = 0.0;
+  this->ClockEstimatedFramePeriod = 0.0;
+  this->ClockLatestItemIndex = 0;
+  this->ClockNumberOfItems = 0;
+  this->ClockInnovationVariance = 0.0;
+  this->ClockNumberOfConsecutiveOutliers = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::SetTimestampFilteringMethod(TimestampFilteringMethodType method)
+{
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
+  if (this->TimestampFilteringMethod == method)
+  {
+    return;
+  }
+  this->TimestampFilteringMethod = method;
+  // the state of the previous filter is not valid for the new one
+  this->FilterContainersOldestIndex = 0;
+  this->FilterContainersNumberOfValidElements = 0;
+  this->ResetClockRecovery();
+  if (this->TimeStampReportTable != NULL)
+  {
+    // the reported values of the previous filter would not match the columns of the new one
+    this->CreateTimeStampReportTable();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodAsString(TimestampFilteringMethodType method)
+{
+  switch (method)
+  {
+    case TIMESTAMP_FILTERING_LINEAR_FIT:
+      return "LinearFit";
+    case TIMESTAMP_FILTERING_CLOCK_RECOVERY:
+      return "ClockRecovery";
+    default:
+      return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTimestampedCircularBuffer::GetTimestampFilteringMethodFromString(const char* methodName, TimestampFilteringMethodType& method)
+{
+  if (methodName == NULL)
+  {
+    return PLUS_FAIL;
+  }
+  if (STRCASECMP(methodName, GetTimestampFilteringMethodAsString(TIMESTAMP_FILTERING_LINEAR_FIT)) == 0)
+  {
+    method = TIMESTAMP_FILTERING_LINEAR_FIT;
+    return PLUS_SUCCESS;
+  }
+  if (STRCASECMP(methodName, GetTimestampFilteringMethodAsString(TIMESTAMP_FILTERING_CLOCK_RECOVERY)) == 0)
+  {
+    method = TIMESTAMP_FILTERING_CLOCK_RECOVERY;
+    return PLUS_SUCCESS;
+  }
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::RenormalizeFilterSums()
+{
+  // the caller must have locked the buffer
+  unsigned int latestIndex = (this->FilterContainersOldestIndex > 0 ? this->FilterContainersOldestIndex : this->AveragedItemsForFiltering) - 1;
+  this->FilterOriginIndex = this->FilterContainerIndexVector(latestIndex);
+  this->FilterOriginTimestamp = this->FilterContainerTimestampVector(latestIndex);
+  this->FilterSumIndex = 0;
+  this->FilterSumTimestamp = 0;
+  this->FilterSumIndexSquared = 0;
+  this->FilterSumIndexTimestamp = 0;
+  // valid elements are always stored from the beginning of the containers
+  for (unsigned int i = 0; i < this->FilterContainersNumberOfValidElements; i++)
+  {
+    double x = this->FilterContainerIndexVector(i) - this->FilterOriginIndex;
+    double y = this->FilterContainerTimestampVector(i) - this->FilterOriginTimestamp;
+    this->FilterSumIndex += x;
+    this->FilterSumTimestamp += y;
+    this->FilterSumIndexSquared += x * x;
+    this->FilterSumIndexTimestamp += x * y;
+  }
+  this->FilterItemsSinceRenormalization = 0;
+}
+
 //----------------------------------------------------------------------------
 PlusStatus vtkPlusTimestampedCircularBuffer::GetTimeStampReportTable(vtkTable* timeStampReportTable)
 {
@@ -651,7 +1246,51 @@ PlusStatus vtkPlusTimestampedCircularBuffer::GetTimeStampReportTable(vtkTable* t
 }
 
 //----------------------------------------------------------------------------
-void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp)
+void vtkPlusTimestampedCircularBuffer::CreateTimeStampReportTable()
+{
+  if (this->TimeStampReportTable != NULL)
+  {
+    this->TimeStampReportTable->Delete();
+  }
+  this->TimeStampReportTable = vtkTable::New();
+
+  const char* colFrameNumberName = "FrameNumber";
+  vtkSmartPointer<vtkDoubleArray> colFrameNumber = vtkSmartPointer<vtkDoubleArray>::New();
+  colFrameNumber->SetName(colFrameNumberName);
+  this->TimeStampReportTable->AddColumn(colFrameNumber);
+
+  const char* colUnfilteredTimestampName = "UnfilteredTimestamp";
+  vtkSmartPointer<vtkDoubleArray> colUnfilteredTimestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  colUnfilteredTimestamp->SetName(colUnfilteredTimestampName);
+  this->TimeStampReportTable->AddColumn(colUnfilteredTimestamp);
+
+  const char* colFilteredTimestampName = "FilteredTimestamp";
+  vtkSmartPointer<vtkDoubleArray> colFilteredTimestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  colFilteredTimestamp->SetName(colFilteredTimestampName);
+  this->TimeStampReportTable->AddColumn(colFilteredTimestamp);
+
+  // The filter diagnostics are appended after the original columns, so that consumers of the first columns are not affected
+  const char* colTimestampJitterName = "TimestampJitter";
+  vtkSmartPointer<vtkDoubleArray> colTimestampJitter = vtkSmartPointer<vtkDoubleArray>::New();
+  colTimestampJitter->SetName(colTimestampJitterName);
+  this->TimeStampReportTable->AddColumn(colTimestampJitter);
+
+  const char* colEstimatedFramePeriodName = "EstimatedFramePeriod";
+  vtkSmartPointer<vtkDoubleArray> colEstimatedFramePeriod = vtkSmartPointer<vtkDoubleArray>::New();
+  colEstimatedFramePeriod->SetName(colEstimatedFramePeriodName);
+  this->TimeStampReportTable->AddColumn(colEstimatedFramePeriod);
+
+  if (this->TimestampFilteringMethod == TIMESTAMP_FILTERING_CLOCK_RECOVERY)
+  {
+    const char* colOutlierName = "Outlier";
+    vtkSmartPointer<vtkDoubleArray> colOutlier = vtkSmartPointer<vtkDoubleArray>::New();
+    colOutlier->SetName(colOutlierName);
+    this->TimeStampReportTable->AddColumn(colOutlier);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp, double estimatedFramePeriodSec /*=0.0*/, bool outlier /*=false*/)
 {
   if (!this->TimeStampReporting)
   {
@@ -659,24 +1298,10 @@ void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIn
     return;
   }
 
+  igsioLockGuard< vtkPlusTimestampedCircularBuffer > bufferGuardedLock(this);
   if (this->TimeStampReportTable == NULL)
   {
-    this->TimeStampReportTable = vtkTable::New();
-
-    const char* colFrameNumberName = "FrameNumber";
-    vtkSmartPointer<vtkDoubleArray> colFrameNumber = vtkSmartPointer<vtkDoubleArray>::New();
-    colFrameNumber->SetName(colFrameNumberName);
-    this->TimeStampReportTable->AddColumn(colFrameNumber);
-
-    const char* colUnfilteredTimestampName = "UnfilteredTimestamp";
-    vtkSmartPointer<vtkDoubleArray> colUnfilteredTimestamp = vtkSmartPointer<vtkDoubleArray>::New();
-    colUnfilteredTimestamp->SetName(colUnfilteredTimestampName);
-    this->TimeStampReportTable->AddColumn(colUnfilteredTimestamp);
-
-    const char* colFilteredTimestampName = "FilteredTimestamp";
-    vtkSmartPointer<vtkDoubleArray> colFilteredTimestamp = vtkSmartPointer<vtkDoubleArray>::New();
-    colFilteredTimestamp->SetName(colFilteredTimestampName);
-    this->TimeStampReportTable->AddColumn(colFilteredTimestamp);
+    this->CreateTimeStampReportTable();
   }
 
   // create a new row for the timestamp report table
@@ -685,6 +1310,12 @@ void vtkPlusTimestampedCircularBuffer::AddToTimeStampReport(unsigned long itemIn
   timeStampReportTableRow->InsertNextValue(itemIndex);
   timeStampReportTableRow->InsertNextValue(unfilteredTimestamp - this->StartTime);
   timeStampReportTableRow->InsertNextValue(filteredTimestamp - this->StartTime);
+  timeStampReportTableRow->InsertNextValue(unfilteredTimestamp - filteredTimestamp);
+  timeStampReportTableRow->InsertNextValue(estimatedFramePeriodSec);
+  if (this->TimestampFilteringMethod == TIMESTAMP_FILTERING_CLOCK_RECOVERY)
+  {
+    timeStampReportTableRow->InsertNextValue(outlier ? 1.0 : 0.0);
+  }
 
   this->TimeStampReportTable->InsertNextRow(timeStampReportTableRow);
 
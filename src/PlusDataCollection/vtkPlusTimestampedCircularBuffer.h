@@ -8,9 +8,17 @@
 #define __vtkPlusTimestampedCircularBuffer_h
 
 #include "PlusConfigure.h"
+#include "PlusFramePeriodStatistics.h"
 #include "PlusStreamBufferItem.h"
 #include "vtkObject.h"
+#include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "vnl/vnl_matrix.h"
 #include "vnl/vnl_vector.h"
@@ -37,6 +45,20 @@ enum ItemStatus { ITEM_OK, ITEM_NOT_AVAILABLE_YET, ITEM_NOT_AVAILABLE_ANYMORE, I
 class vtkPlusTimestampedCircularBuffer: public vtkObject
 {
 public:
+  /*! Method used for computing filtered timestamps from the unfiltered timestamps of the items */
+  enum TimestampFilteringMethodType
+  {
+    /*! Least squares line fit to the index and timestamp of the last AveragedItemsForFiltering items */
+    TIMESTAMP_FILTERING_LINEAR_FIT = 0,
+    /*!
+      Clock recovery: the timestamp and the frame period are tracked by an alpha-beta (steady-state Kalman) filter
+      with a memory of AveragedItemsForFiltering items. Timestamps that deviate from the prediction by more than
+      a few standard deviations (delivery bursts) are ignored by the estimator and the item gets the predicted
+      timestamp instead of being dropped. Items are never reported as probably invalid, see CreateFilteredTimeStampForItem.
+    */
+    TIMESTAMP_FILTERING_CLOCK_RECOVERY
+  };
+
   static vtkPlusTimestampedCircularBuffer* New();
   void PrintSelf( ostream& os, vtkIndent indent );
 
@@ -58,12 +80,30 @@ public:
   /*!
     Given a timestamp, compute the nearest frame UID
     This assumes that the times motonically increase
+    If searchHintUid is specified then the search starts from that item and it is updated to the found item,
+    so that a reader can continue its consecutive lookups from its own previous result (0 means no hint).
+  */
+  virtual ItemStatus GetItemUidFromTime( const double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL );
+
+  /*!
+    Find the UID of the item that has the closest timestamp to the specified time among the items
+    oldestUid...latestUid (the timestamps must increase monotonically).
+    readTimestamp( uid, timestamp ) must return false if the timestamp of the item cannot be read.
+    The search starts at hintUid (typically the result of the previous search), then continues with interpolation search:
+    if the timestamps are nearly uniform then the item is found in one or two probes. Two consecutive interpolation steps that do not
+    halve the search range are followed by a bisection step, so the number of probes is at most about three times of a binary search.
+    Returns ITEM_UNKNOWN_ERROR if a timestamp could not be read.
   */
-  virtual ItemStatus GetItemUidFromTime( const double time, BufferItemUidType& uid );
+  template<typename TimestampReader> static ItemStatus FindItemUidFromTime( const double time, BufferItemUidType oldestUid, BufferItemUidType latestUid,
+      BufferItemUidType hintUid, double negligibleTimeDifferenceSec, TimestampReader readTimestamp, BufferItemUidType& uid );
 
   /*! Get the most recent frame UID that is already in the buffer */
   virtual BufferItemUidType GetLatestItemUidInBuffer()
   {
+    if ( this->LockFreeReads.load( std::memory_order_relaxed ) )
+    {
+      return this->PublishedLatestItemUid.load( std::memory_order_acquire );
+    }
     this->Lock();
     BufferItemUidType latestUid = this->LatestItemUid;
     this->Unlock();
@@ -73,6 +113,13 @@ public:
   /*! Get the oldest frame UID in the buffer  */
   virtual BufferItemUidType GetOldestItemUidInBuffer()
   {
+    if ( this->LockFreeReads.load( std::memory_order_relaxed ) )
+    {
+      BufferItemUidType latestUid( 0 );
+      int numberOfItems( 0 );
+      this->GetPublishedState( latestUid, numberOfItems );
+      return latestUid - ( numberOfItems - 1 );
+    }
     this->Lock();
     // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
     BufferItemUidType oldestUid = this->LatestItemUid - ( this->NumberOfItems - 1 );
@@ -88,6 +135,10 @@ public:
 
   virtual ItemStatus GetOldestTimeStamp( double& timestamp )
   {
+    if ( this->LockFreeReads.load( std::memory_order_relaxed ) )
+    {
+      return this->GetOldestTimeStampLockFree( timestamp );
+    }
     // The oldest item may be removed from the buffer at any moment
     // therefore we need to retrieve its UID and timestamp within a single lock
     this->Lock();
@@ -116,6 +167,34 @@ public:
   */
   virtual ItemStatus GetBufferIndexFromTime( const double time, int& bufferIndex );
 
+  /*! Get the number of SignalNewItem calls, pass it to WaitForNewItemSignal to wait for the next item */
+  unsigned long GetNewItemSignalCount() { return this->NewItemSignalCount.load(); }
+
+  /*!
+    Wake up all threads that wait in WaitForNewItemSignal. Called when an item is published,
+    buffers that do not store their items in this buffer call it when they add an item.
+    The caller must hold the lock, the new item callbacks are run when the outermost lock is released.
+  */
+  void SignalNewItem();
+
+  /*!
+    Block the calling thread until SignalNewItem is called after GetNewItemSignalCount returned signalCount,
+    or the timeout expires. Returns false on timeout. The buffer lock must not be held by the calling thread.
+  */
+  bool WaitForNewItemSignal( unsigned long signalCount, double timeoutSec );
+
+  typedef std::function<void()> NewItemCallbackType;
+
+  /*!
+    Register a function that is called after a new item is signaled, in the thread that adds the item, once that thread
+    has released the buffer lock. The function must return quickly, it may read this buffer but it must not add or remove
+    callbacks. Returns an id for RemoveNewItemCallback.
+  */
+  unsigned long AddNewItemCallback( const NewItemCallbackType& callback );
+
+  /*! Unregister a function. When the method returns, the function is not running and will not be called anymore. */
+  void RemoveNewItemCallback( unsigned long callbackId );
+
   /*!
     Make this buffer into a copy of another buffer.  You should
     Lock both of the buffers before doing this.
@@ -123,9 +202,15 @@ public:
   virtual void DeepCopy( vtkPlusTimestampedCircularBuffer* buffer );
 
   /*!  Set the local time offset in seconds (global = local + offset) */
-  vtkSetMacro( LocalTimeOffsetSec, double );
+  virtual void SetLocalTimeOffsetSec( double offsetSec )
+  {
+    if ( this->LocalTimeOffsetSec.exchange( offsetSec ) != offsetSec )
+    {
+      this->Modified();
+    }
+  }
   /*!  Get the local time offset in seconds (global = local + offset) */
-  vtkGetMacro( LocalTimeOffsetSec, double );
+  virtual double GetLocalTimeOffsetSec() { return this->LocalTimeOffsetSec.load(); }
 
   /*!
     Get the frame rate from the buffer based on the number of frames in the buffer
@@ -135,6 +220,7 @@ public:
     if frames were not dropped).
     If framePeriodStdevSecPtr is not null, then the standard deviation of the frame period is computed as well (in seconds) and
     stored at the specified address.
+    The statistics are updated as items are added, so this method takes constant time and does not lock the buffer.
   */
   virtual double GetFrameRate( bool ideal = false, double* framePeriodStdevSecPtr = NULL );
 
@@ -146,13 +232,67 @@ public:
     the data in the buffer if the buffer is being used from multiple
     threads.
   */
-  inline void Lock() { this->Mutex->Lock(); };
+  inline void Lock() { this->Mutex->Lock(); ++this->LockDepth; };
   /*!
     Unlock the buffer: this should be done before changing or accessing
     the data in the buffer if the buffer is being used from multiple
     threads.
+    When the outermost lock is released the item that was prepared by PrepareForNewItem
+    (and filled by the writer while holding the lock) is published to lock-free readers.
+  */
+  inline void Unlock()
+  {
+    bool runNewItemCallbacks( false );
+    if ( --this->LockDepth == 0 )
+    {
+      if ( this->PendingItemBufferIndex >= 0 )
+      {
+        this->PublishPendingItem();
+      }
+      runNewItemCallbacks = this->NewItemCallbacksPending;
+      this->NewItemCallbacksPending = false;
+    }
+    this->Mutex->Unlock();
+    if ( runNewItemCallbacks )
+    {
+      this->RunNewItemCallbacks();
+    }
+  };
+
+  /*!
+    If LockFreeReads is enabled then timestamp, index and UID queries (GetTimeStamp, GetIndex,
+    GetItemUidFromTime, GetLatestItemUidInBuffer, ...) do not acquire the buffer lock, so they never
+    block the acquisition thread. Each slot carries a sequence number that the writer makes odd
+    while it fills the slot; readers retry (or report ITEM_NOT_AVAILABLE_ANYMORE) if the slot
+    was overwritten during their read. Only a single writer thread is supported.
+    Lock-free readers read atomic copies of the timestamps and the index (see LockFreeSlot), never the items.
+    Full item copies still acquire the lock. SetBufferSize, Clear and DeepCopy replace the slots,
+    lock-free readers that are in progress finish on the previous slots.
+  */
+  virtual void SetLockFreeReads( bool enable ) { this->LockFreeReads.store( enable ); }
+  virtual bool GetLockFreeReads() { return this->LockFreeReads.load(); }
+  vtkBooleanMacro( LockFreeReads, bool );
+
+  /*!
+    Lock-free search of the item that is closest to the specified time, see GetItemUidFromTime.
+    Returns ITEM_UNKNOWN_ERROR if the writer kept overwriting the inspected items, the caller has to search with the lock held then.
+  */
+  ItemStatus FindItemUidFromTimeLockFree( const double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL );
+
+  /*!
+    Replace the lock-free slots with the timestamps and indices of items that are stored outside of this buffer
+    (see vtkPlusTransformBuffer), so that lock-free readers of this buffer can access them. The vectors hold one element
+    per slot, the item with the specified UID is in slot (firstUidSlotIndex + uid - 1) modulo the number of slots.
+    INTERNAL USE ONLY! The caller must hold the lock. The buffer must not store items itself (its buffer size is 0).
+  */
+  void ResetExternalItems( int firstUidSlotIndex, BufferItemUidType latestUid, int numberOfItems, const std::vector<double>& filteredTimestamps,
+                           const std::vector<double>& unfilteredTimestamps, const std::vector<unsigned long>& indices );
+
+  /*!
+    Make an item that is stored outside of this buffer visible to lock-free readers, see ResetExternalItems.
+    INTERNAL USE ONLY! The caller must hold the lock.
   */
-  inline void Unlock() { this->Mutex->Unlock(); };
+  void PublishExternalItem( BufferItemUidType uid, int slotIndex, double filteredTimestamp, double unfilteredTimestamp, unsigned long index, int numberOfItems );
 
   /*!
     Get next writable buffer object
@@ -160,6 +300,12 @@ public:
   */
   virtual StreamBufferItem* GetBufferItemPointerFromBufferIndex( const int bufferIndex );
 
+  /*!
+    Get the buffer index that the next prepared item is written to (see PrepareForNewItem)
+    INTERNAL USE ONLY! Need to lock buffer until we use the buffer index
+  */
+  virtual int GetNextWritableBufferIndex() { return this->WritePointer; }
+
   /*!
     Get next writable buffer object
     INTERNAL USE ONLY! Need to lock buffer until we use the buffer index
@@ -168,22 +314,48 @@ public:
 
   virtual PlusStatus PrepareForNewItem( const double timestamp, BufferItemUidType& newFrameUid, int& bufferIndex );
 
+  /*!
+    Discard the item that was prepared by PrepareForNewItem, if filling it failed. The UID is reused by the next item
+    and the item is not published. The slot does not hold the item that it contained before anymore, so that item
+    is removed from the buffer as well. INTERNAL USE ONLY! The caller must hold the lock since PrepareForNewItem.
+  */
+  virtual void CancelPendingItem();
+
+  /*!
+    Remove the oldest items from the buffer while an item is pending (see PrepareForNewItem), so that their slots can be
+    reused before they would be overwritten. The pending item is not removed. Returns the number of removed items.
+    INTERNAL USE ONLY! The caller must hold the lock since PrepareForNewItem.
+  */
+  virtual int DiscardOldestItems( int numberOfItems );
+
   /*!
     Create filtered and unfiltered timestamp for accurate timing of the buffer item.
     The timing may be inaccurate because the timestamp is attached to the item when Plus receives it
     and so the timestamp is affected by data transfer speed (which may slightly vary).
-    A line is fitted to the index and timestamp of the last (AveragedItemsForFiltering) items.
-    The filtered timestamp is the time value that corresponds to the frame index according to the fitted line.
+    By default a line is fitted to the index and timestamp of the last (AveragedItemsForFiltering) items and
+    the filtered timestamp is the time value that corresponds to the frame index according to the fitted line
+    (see TimestampFilteringMethodType for the alternatives). If the line cannot be fitted, because the item indexes
+    of all the items are identical, then the filtered timestamp is the unfiltered timestamp.
     If the filtered timestamp is very different from the non-filtered timestamp then
     filteredTimestampProbablyValid will be false and it is recommended not to use that item,
-    because its timestamp is probably incorrect.
+    because its timestamp is probably incorrect. Clock recovery keeps these items instead: an outlier
+    gets the predicted timestamp, any other item gets its unfiltered timestamp.
   */
   virtual PlusStatus CreateFilteredTimeStampForItem( unsigned long itemIndex, double inUnfilteredTimestamp, double& outFilteredTimestamp, bool& filteredTimestampProbablyValid );
 
-  /*! Add values to the timestamp report. If reporting is not enabled then no values will be added. This should only be called if an item is added without calling CreateFilteredTimeStampForItem. */
-  void AddToTimeStampReport( unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp );
+  /*!
+    Add values to the timestamp report. If reporting is not enabled then no values will be added. This should only be called if an item is added without calling CreateFilteredTimeStampForItem.
+    The estimated frame period and the outlier flag are provided by the timestamp filter (0 and false if the item was not filtered).
+  */
+  void AddToTimeStampReport( unsigned long itemIndex, double unfilteredTimestamp, double filteredTimestamp, double estimatedFramePeriodSec = 0.0, bool outlier = false );
 
-  /*! Get the table report of the timestamped buffer. To fill this table TimeStampReporting has to be enabled.  */
+  /*!
+    Get the table report of the timestamped buffer. To fill this table TimeStampReporting has to be enabled.
+    Columns: FrameNumber, UnfilteredTimestamp, FilteredTimestamp, TimestampJitter (unfiltered - filtered) and
+    EstimatedFramePeriod (the slope of the fitted line or the frame period of the clock recovery filter).
+    If the clock recovery filtering method is used then they are followed by Outlier (1 if the unfiltered timestamp
+    was rejected as a delivery spike). The table is emptied when the filtering method is changed.
+  */
   PlusStatus GetTimeStampReportTable( vtkTable* timeStampReportTable );
 
   /*! If TimeStampReporting is enabled then all filtered and unfiltered timestamp values will be saved in a table for diagnostic purposes. */
@@ -201,6 +373,15 @@ public:
   /*! Get number of items used for timestamp filtering (with LSQR mimimizer) */
   vtkGetMacro( AveragedItemsForFiltering, int );
 
+  /*! Set the timestamp filtering method. The filter state is reset. */
+  void SetTimestampFilteringMethod( TimestampFilteringMethodType method );
+  vtkGetMacro( TimestampFilteringMethod, TimestampFilteringMethodType );
+
+  /*! Get the timestamp filtering method name that is used in configuration files */
+  static const char* GetTimestampFilteringMethodAsString( TimestampFilteringMethodType method );
+  /*! Get the timestamp filtering method from its name in configuration files (case insensitive) */
+  static PlusStatus GetTimestampFilteringMethodFromString( const char* methodName, TimestampFilteringMethodType& method );
+
   /*! Set recording start time */
   vtkSetMacro( StartTime, double );
   /*! Get recording start time */
@@ -210,9 +391,51 @@ protected:
   vtkPlusTimestampedCircularBuffer();
   ~vtkPlusTimestampedCircularBuffer();
 
+  /*! Make the item that was prepared last visible to lock-free readers. The caller must hold the lock. */
+  void PublishPendingItem();
+
+  /*! Replace the lock-free slots and the published counters with ones computed from the current buffer state. The caller must hold the lock. */
+  void ResetSlotSequences();
+
+  /*! Update the latest UID and number of items that lock-free readers may access. The caller must hold the lock. */
+  void PublishState( BufferItemUidType latestUid, int numberOfItems );
+
+  /*! Get the latest UID and number of items that were published together, without locking */
+  void GetPublishedState( BufferItemUidType& latestUid, int& numberOfItems );
+
+  /*! Call the new item callbacks. The caller must not hold the lock. */
+  void RunNewItemCallbacks();
+
+  /*!
+    Lock-free read of the slot that holds the item with the specified UID.
+    The reader function is called on the slot and its result is discarded if the slot was overwritten meanwhile.
+  */
+  template<typename SlotReader> ItemStatus ReadItemLockFree( const BufferItemUidType uid, SlotReader reader );
+
+  ItemStatus GetItemUidFromTimeLockFree( const double time, BufferItemUidType hintUid, BufferItemUidType& uid );
+  ItemStatus GetOldestTimeStampLockFree( double& timestamp );
+
+  /*! Compute the filtered timestamp with the clock recovery filter. The caller must hold the lock. */
+  PlusStatus CreateClockRecoveryTimeStampForItem( unsigned long itemIndex, double inUnfilteredTimestamp, double& outFilteredTimestamp, bool& filteredTimestampProbablyValid );
+
+  /*! Clear the clock recovery state, the next item restarts clock recovery. The caller must hold the lock. */
+  void ResetClockRecovery();
+
+  /*! Create an empty timestamp report table with the columns of the current filtering method. The caller must hold the lock. */
+  void CreateTimeStampReportTable();
+
+  /*!
+    Recompute the running sums of the timestamp filter from the filter containers, relative to the latest item.
+    Called periodically, so that rounding errors of the incremental updates do not accumulate in long acquisitions.
+  */
+  void RenormalizeFilterSums();
+
 protected:
   vtkIGSIORecursiveCriticalSection* Mutex;
 
+  /*! Number of nested locks held by the owner of Mutex */
+  int LockDepth;
+
   int NumberOfItems;
 
   /*! Next image will be written here */
@@ -220,8 +443,8 @@ protected:
 
   double CurrentTimeStamp;
 
-  /*! Time offset of the buffer in seconds */
-  double LocalTimeOffsetSec;
+  /*! Time offset of the buffer in seconds, lock-free readers read it without locking */
+  std::atomic<double> LocalTimeOffsetSec;
 
   /*!
     This will be the UID of the next item that will be added.
@@ -243,6 +466,33 @@ protected:
   /*! Number of valid elements in the frame index and timestamp containers (maximum can be equal to AveragedItemsForFiltering) */
   unsigned int FilterContainersNumberOfValidElements;
 
+  /*!
+    Running sums of the frame indexes and timestamps in the filter containers, used for fitting the line in constant time.
+    Values are relative to FilterOriginIndex and FilterOriginTimestamp to keep the sums small.
+  */
+  double FilterSumIndex;
+  double FilterSumTimestamp;
+  double FilterSumIndexSquared;
+  double FilterSumIndexTimestamp;
+  double FilterOriginIndex;
+  double FilterOriginTimestamp;
+
+  /*! Number of items added to the running sums since they were last recomputed from the filter containers */
+  unsigned int FilterItemsSinceRenormalization;
+
+  TimestampFilteringMethodType TimestampFilteringMethod;
+
+  /*! Clock recovery state: estimated timestamp and frame period at the index of the latest item */
+  double ClockEstimatedTimestamp;
+  double ClockEstimatedFramePeriod;
+  unsigned long ClockLatestItemIndex;
+  /*! Number of items that clock recovery processed since it was (re)started */
+  unsigned int ClockNumberOfItems;
+  /*! Running estimate of the variance of the difference between the unfiltered and the predicted timestamps */
+  double ClockInnovationVariance;
+  /*! Number of consecutive items that were treated as outliers, a long run of outliers means that the clock has jumped */
+  unsigned int ClockNumberOfConsecutiveOutliers;
+
   /*! Number of averaged items used for filtering - read from config files */
   unsigned int AveragedItemsForFiltering;
 
@@ -276,9 +526,160 @@ protected:
   */
   double NegligibleTimeDifferenceSec;
 
+  /*! Readers access timestamps, indices and UIDs without locking (single writer is assumed). Can be changed while readers access the buffer. */
+  std::atomic<bool> LockFreeReads;
+
+  /*! The part of a slot of BufferItemContainer that lock-free readers access */
+  struct LockFreeSlot
+  {
+    /*!
+      2*uid if the slot contains the item with the given uid, 2*uid-1 while the writer is filling the slot
+      with that item, 0 if the slot has never been written
+    */
+    std::atomic<BufferItemUidType> Sequence;
+    /*! Copies of the item fields, written by the writer before the sequence number becomes even */
+    std::atomic<double> FilteredTimestamp;
+    std::atomic<double> UnfilteredTimestamp;
+    std::atomic<unsigned long> Index;
+  };
+
+  /*! Lock-free slots of all the items, they are replaced by a new instance when the buffer is resized or cleared */
+  struct LockFreeSlotArray
+  {
+    LockFreeSlotArray( int bufferSize, int firstUidBufferIndex );
+    std::vector<LockFreeSlot> Slots;
+    /*! Buffer index of the item with UID=1 */
+    const int FirstUidBufferIndex;
+  };
+
+  /*! Accessed with std::atomic_load and std::atomic_store, so readers can keep using the previous array while it is replaced */
+  std::shared_ptr<LockFreeSlotArray> LockFreeSlots;
+
+  /*! Frame period statistics of the items in the buffer, updated when an item is published */
+  PlusFramePeriodStatistics FramePeriodStatistics;
+
+  /*!
+    Latest UID and number of items that lock-free readers may access. PublishedStateSequence is odd while
+    the writer updates them, readers retry if it was odd or changed during their read (see GetPublishedState).
+  */
+  std::atomic<BufferItemUidType> PublishedLatestItemUid;
+  std::atomic<int> PublishedNumberOfItems;
+  std::atomic<unsigned long> PublishedStateSequence;
+  /*! Copies of the published state for readers that hold the lock (see GetPublishedState) */
+  BufferItemUidType LockedPublishedLatestItemUid;
+  int LockedPublishedNumberOfItems;
+
+  /*! Buffer index and UID of the item that has been prepared but not yet published (index is -1 if there is none) */
+  int PendingItemBufferIndex;
+  BufferItemUidType PendingItemUid;
+  /*! State before the pending item was prepared, restored by CancelPendingItem */
+  int PendingItemPreviousNumberOfItems;
+  double PendingItemPreviousTimeStamp;
+
+  /*! Incremented by SignalNewItem, waiting threads are woken up when it changes */
+  std::atomic<unsigned long> NewItemSignalCount;
+  /*! Number of threads in WaitForNewItemSignal, the writer does not notify if there are none */
+  std::atomic<int> NumberOfNewItemWaiters;
+  std::mutex NewItemMutex;
+  std::condition_variable NewItemCondition;
+
+  /*! Functions that are called when a new item is signaled, guarded by NewItemCallbacksMutex */
+  std::map<unsigned long, NewItemCallbackType> NewItemCallbacks;
+  unsigned long LastNewItemCallbackId;
+  /*! Number of registered callbacks, the writer does not lock NewItemCallbacksMutex if there are none */
+  std::atomic<int> NumberOfNewItemCallbacks;
+  std::mutex NewItemCallbacksMutex;
+  /*! A new item was signaled while the lock was held, the callbacks are run when the outermost lock is released */
+  bool NewItemCallbacksPending;
+
 private:
   vtkPlusTimestampedCircularBuffer( const vtkPlusTimestampedCircularBuffer& );
   void operator=( const vtkPlusTimestampedCircularBuffer& );
 };
 
+//----------------------------------------------------------------------------
+template<typename TimestampReader>
+ItemStatus vtkPlusTimestampedCircularBuffer::FindItemUidFromTime( const double time, BufferItemUidType oldestUid, BufferItemUidType latestUid,
+    BufferItemUidType hintUid, double negligibleTimeDifferenceSec, TimestampReader readTimestamp, BufferItemUidType& uid )
+{
+  if ( oldestUid == latestUid )
+  {
+    // There is only one item, it's the closest one to any timestamp
+    uid = latestUid;
+    return ITEM_OK;
+  }
+
+  BufferItemUidType lo = oldestUid;
+  BufferItemUidType hi = latestUid;
+  double tlo( 0 );
+  double thi( 0 );
+  if ( !readTimestamp( lo, tlo ) || !readTimestamp( hi, thi ) )
+  {
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  // If the timestamp is slightly out of range then still accept it
+  // (due to errors in conversions there could be slight differences)
+  if ( time < tlo - negligibleTimeDifferenceSec )
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  else if ( time > thi + negligibleTimeDifferenceSec )
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+
+  // Consecutive searches usually request nearby times, narrow the range at the previously found item
+  if ( hintUid > lo && hintUid < hi )
+  {
+    double thint( 0 );
+    if ( !readTimestamp( hintUid, thint ) )
+    {
+      return ITEM_UNKNOWN_ERROR;
+    }
+    if ( time < thint )
+    {
+      hi = hintUid;
+      thi = thint;
+    }
+    else
+    {
+      lo = hintUid;
+      tlo = thint;
+    }
+  }
+
+  int numberOfSlowSteps = 0;
+  while ( hi - lo > 1 )
+  {
+    const BufferItemUidType range = hi - lo;
+    BufferItemUidType mid = lo + range / 2;
+    if ( numberOfSlowSteps < 2 && thi > tlo )
+    {
+      // Estimate the position assuming uniform timestamps in the range
+      double position = ( time - tlo ) / ( thi - tlo ) * range;
+      mid = ( position < 1.0 ? lo + 1 : ( position > range - 1.0 ? hi - 1 : lo + static_cast<BufferItemUidType>( position ) ) );
+    }
+    double tmid( 0 );
+    if ( !readTimestamp( mid, tmid ) )
+    {
+      return ITEM_UNKNOWN_ERROR;
+    }
+    if ( time < tmid )
+    {
+      hi = mid;
+      thi = tmid;
+    }
+    else
+    {
+      lo = mid;
+      tlo = tmid;
+    }
+    numberOfSlowSteps = ( ( hi - lo ) * 2 > range ? numberOfSlowSteps + 1 : 0 );
+  }
+
+  uid = ( time - tlo > thi - time ) ? hi : lo;
+  return ITEM_OK;
+}
+
 #endif
@@ -0,0 +1,987 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "igsioMath.h"
+#include "PlusPoseInterpolator.h"
+#include "vtkPlusBufferLogMacros.h"
+#include "vtkPlusTransformBuffer.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STL includes
+#include <algorithm>
+
+static const double NEGLIGIBLE_TIME_DIFFERENCE = 0.00001; // in seconds, used for comparing between exact timestamps
+static const double ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG = 10; // if the interpolated orientation differs from both the interpolated orientation by more than this threshold then display a warning
+static const int MATRIX_ELEMENT_COUNT = 16;
+
+vtkStandardNewMacro(vtkPlusTransformBuffer);
+
+//----------------------------------------------------------------------------
+vtkPlusTransformBuffer::vtkPlusTransformBuffer()
+  : Capacity(0)
+  , AllocatedCapacity(0)
+  , NumberOfTransformItems(0)
+  , WritePointer(0)
+  , LatestItemUid(0)
+  , CurrentTimeStamp(0.0)
+  , MaxNumberOfPinnedItems(-1)
+{
+  // The circular buffer of the base class is only used for locking and timestamp filtering, it does not store any items
+  this->StreamBuffer->SetBufferSize(0);
+  this->SetBufferSize(150);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusTransformBuffer::~vtkPlusTransformBuffer()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Capacity: " << this->Capacity << std::endl;
+  os << indent << "AllocatedCapacity: " << this->AllocatedCapacity << std::endl;
+  os << indent << "MaxNumberOfPinnedItems: " << this->MaxNumberOfPinnedItems << std::endl;
+  os << indent << "NumberOfItems: " << this->NumberOfTransformItems << std::endl;
+  os << indent << "LatestItemUid: " << this->LatestItemUid << std::endl;
+  os << indent << "NumberOfItemsWithCustomFields: " << this->CustomFields.size() << std::endl;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusTransformBuffer::GetBufferSize()
+{
+  return this->Capacity - this->SpillBufferSize;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::SetBufferSize(int bufsize)
+{
+  if (bufsize < 0)
+  {
+    LOCAL_LOG_ERROR("Invalid buffer size requested: " << bufsize);
+    return PLUS_FAIL;
+  }
+  return this->SetCapacity(bufsize + this->SpillBufferSize);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusTransformBuffer::GetItemSizeInBytes()
+{
+  // custom fields are not included, they are rare in tool buffers
+  return MATRIX_ELEMENT_COUNT * sizeof(double) + sizeof(ToolStatus) + sizeof(unsigned long) + 2 * sizeof(double);
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusTransformBuffer::GetAllocatedMemoryInBytes()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return static_cast<unsigned long long>(this->AllocatedCapacity) * this->GetItemSizeInBytes();
+}
+
+//----------------------------------------------------------------------------
+unsigned long long vtkPlusTransformBuffer::GetUsedMemoryInBytes()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return static_cast<unsigned long long>(this->NumberOfTransformItems) * this->GetItemSizeInBytes();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::SetSpillBufferSize(int n)
+{
+  if (n < 0)
+  {
+    LOCAL_LOG_ERROR("Invalid spill buffer size requested: " << n);
+    return PLUS_FAIL;
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferSize = this->GetBufferSize();
+  this->SpillBufferSize = n;
+  return this->SetCapacity(bufferSize + n);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::SetCapacity(int capacity)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->Capacity == capacity && this->AllocatedCapacity == capacity)
+  {
+    // no change
+    return PLUS_SUCCESS;
+  }
+
+  this->Capacity = capacity;
+  this->Reallocate(capacity);
+  this->ResetFramePeriodStatistics();
+
+  this->Modified();
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::Reallocate(int allocatedCapacity)
+{
+  // the caller must have locked the buffer
+
+  // Keep the most recent items, stored from the oldest to the latest at the beginning of the new arrays
+  int numberOfKeptItems = std::min(this->NumberOfTransformItems, allocatedCapacity);
+  std::vector<double> matrixElements(static_cast<size_t>(allocatedCapacity) * MATRIX_ELEMENT_COUNT, 0.0);
+  std::vector<ToolStatus> statuses(allocatedCapacity, TOOL_OK);
+  std::vector<unsigned long> indices(allocatedCapacity, 0);
+  std::vector<double> filteredTimestamps(allocatedCapacity, 0.0);
+  std::vector<double> unfilteredTimestamps(allocatedCapacity, 0.0);
+  std::map<int, igsioFieldMapType> customFields;
+  for (int newBufferIndex = 0; newBufferIndex < numberOfKeptItems; ++newBufferIndex)
+  {
+    BufferItemUidType uid = this->LatestItemUid - (numberOfKeptItems - 1) + newBufferIndex;
+    int oldBufferIndex(0);
+    this->GetBufferIndexFromUid(uid, oldBufferIndex);
+    std::copy(this->MatrixElements.begin() + oldBufferIndex * MATRIX_ELEMENT_COUNT, this->MatrixElements.begin() + (oldBufferIndex + 1) * MATRIX_ELEMENT_COUNT,
+              matrixElements.begin() + newBufferIndex * MATRIX_ELEMENT_COUNT);
+    statuses[newBufferIndex] = this->Statuses[oldBufferIndex];
+    indices[newBufferIndex] = this->Indices[oldBufferIndex];
+    filteredTimestamps[newBufferIndex] = this->FilteredTimestamps[oldBufferIndex];
+    unfilteredTimestamps[newBufferIndex] = this->UnfilteredTimestamps[oldBufferIndex];
+    std::map<int, igsioFieldMapType>::iterator fieldsIt = this->CustomFields.find(oldBufferIndex);
+    if (fieldsIt != this->CustomFields.end())
+    {
+      customFields[newBufferIndex].swap(fieldsIt->second);
+    }
+  }
+
+  this->MatrixElements.swap(matrixElements);
+  this->Statuses.swap(statuses);
+  this->Indices.swap(indices);
+  this->FilteredTimestamps.swap(filteredTimestamps);
+  this->UnfilteredTimestamps.swap(unfilteredTimestamps);
+  this->CustomFields.swap(customFields);
+  this->AllocatedCapacity = allocatedCapacity;
+  this->NumberOfTransformItems = numberOfKeptItems;
+  this->WritePointer = (allocatedCapacity > 0 ? numberOfKeptItems % allocatedCapacity : 0);
+  this->ResetLockFreeSlots();
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddItem(vtkImageData* frame, US_IMAGE_ORIENTATION usImageOrientation, US_IMAGE_TYPE imageType, long frameNumber, const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add video frame to a transform buffer!");
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddItem(const igsioVideoFrame* frame, long frameNumber, const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add video frame to a transform buffer!");
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddItem(void* imageDataPtr, US_IMAGE_ORIENTATION usImageOrientation, const FrameSizeType& inputFrameSizeInPx, igsioCommon::VTKScalarPixelType pixelType, unsigned int numberOfScalarComponents, US_IMAGE_TYPE imageType, int numberOfBytesToSkip, long frameNumber, const std::array<int, 3>& clipRectangleOrigin, const std::array<int, 3>& clipRectangleSize, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/, vtkStreamingVolumeFrame* encodedFrame /*= NULL*/)
+{
+  LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add video frame to a transform buffer!");
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddItem(void* imageDataPtr, const FrameSizeType& frameSize, unsigned int frameSizeInBytes, US_IMAGE_TYPE imageType, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add video frame to a transform buffer!");
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddItem(const igsioFieldMapType& fields, long frameNumber, double unfilteredTimestamp /*= UNDEFINED_TIMESTAMP*/, double filteredTimestamp /*= UNDEFINED_TIMESTAMP*/)
+{
+  LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add an item without transform to a transform buffer!");
+  return PLUS_FAIL;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields /*= NULL*/)
+{
+  // Timestamp filtering and reporting are done by vtkPlusBuffer::AddTimeStampedItem, the same way as for the other buffers
+  if (matrix == NULL)
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add NULL matrix to tracker buffer!");
+    return PLUS_FAIL;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  if (this->Capacity <= 0)
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Unable to add item to a buffer of size 0!");
+    return PLUS_FAIL;
+  }
+  if (filteredTimestamp <= this->CurrentTimeStamp)
+  {
+    // Just a debug message, because we want to avoid unnecessary warning messages if the timestamp is the same as last one
+    LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Need to skip newly added item - new timestamp (" << std::fixed << filteredTimestamp << ") is not newer than the last one (" << this->CurrentTimeStamp << ")!");
+    return PLUS_FAIL;
+  }
+
+  BufferItemUidType oldestPinnedUid(0);
+  bool pinned = this->GetOldestPinnedItemUid(oldestPinnedUid);
+  if (this->NumberOfTransformItems >= this->AllocatedCapacity && pinned && oldestPinnedUid <= this->LatestItemUid - (this->NumberOfTransformItems - 1))
+  {
+    // The oldest item would be overwritten, but a reader still needs it
+    const int maxNumberOfPinnedItems = (this->MaxNumberOfPinnedItems < 0 ? 4 * this->Capacity : std::max(this->MaxNumberOfPinnedItems, this->Capacity));
+    if (this->AllocatedCapacity < maxNumberOfPinnedItems)
+    {
+      const int allocatedCapacity = std::min(2 * this->AllocatedCapacity, maxNumberOfPinnedItems);
+      LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Buffer is pinned, growing it to " << allocatedCapacity << " items");
+      this->Reallocate(allocatedCapacity);
+    }
+    else
+    {
+      // The reader is too slow, its pin fails instead of the acquisition allocating more memory
+      LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Buffer is pinned, but it cannot grow beyond " << maxNumberOfPinnedItems << " items, the oldest pinned item is overwritten");
+      this->ExpirePins(this->LatestItemUid - (this->NumberOfTransformItems - 1));
+      pinned = this->GetOldestPinnedItemUid(oldestPinnedUid);
+    }
+  }
+
+  const int bufferIndex = this->WritePointer;
+  vtkMatrix4x4::DeepCopy(&this->MatrixElements[bufferIndex * MATRIX_ELEMENT_COUNT], matrix);
+  this->Statuses[bufferIndex] = status;
+  this->Indices[bufferIndex] = frameNumber;
+  this->FilteredTimestamps[bufferIndex] = filteredTimestamp;
+  this->UnfilteredTimestamps[bufferIndex] = unfilteredTimestamp;
+  if (customFields != NULL && !customFields->empty())
+  {
+    this->CustomFields[bufferIndex] = *customFields;
+  }
+  else if (!this->CustomFields.empty())
+  {
+    this->CustomFields.erase(bufferIndex);
+  }
+
+  this->CurrentTimeStamp = filteredTimestamp;
+  this->LatestItemUid++;
+  this->FramePeriodStatistics.AddItem(filteredTimestamp, frameNumber);
+  // Discard the oldest items beyond the capacity, unless they are pinned
+  int numberOfKeptItems = this->Capacity;
+  if (pinned && oldestPinnedUid <= this->LatestItemUid)
+  {
+    numberOfKeptItems = std::max(numberOfKeptItems, static_cast<int>(this->LatestItemUid - oldestPinnedUid) + 1);
+  }
+  this->NumberOfTransformItems = std::min(this->NumberOfTransformItems + 1, std::min(numberOfKeptItems, this->AllocatedCapacity));
+  if (++this->WritePointer >= this->AllocatedCapacity)
+  {
+    this->WritePointer = 0;
+  }
+  // The item is stored in this buffer, not in the circular buffer, so it is published and waiting readers are notified here
+  this->StreamBuffer->PublishExternalItem(this->LatestItemUid, bufferIndex, filteredTimestamp, unfilteredTimestamp, frameNumber, this->NumberOfTransformItems);
+  this->StreamBuffer->SignalNewItem();
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetBufferIndexFromUid(BufferItemUidType uid, int& bufferIndex) const
+{
+  // the caller must have locked the buffer
+  if (this->NumberOfTransformItems < 1 || uid > this->LatestItemUid)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  if (uid < this->LatestItemUid - (this->NumberOfTransformItems - 1))
+  {
+    return ITEM_NOT_AVAILABLE_ANYMORE;
+  }
+  bufferIndex = (this->WritePointer - 1) - static_cast<int>(this->LatestItemUid - uid);
+  if (bufferIndex < 0)
+  {
+    bufferIndex += this->AllocatedCapacity;
+  }
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::FindItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/) const
+{
+  // the caller must have locked the buffer
+  if (this->NumberOfTransformItems < 1)
+  {
+    return ITEM_NOT_AVAILABLE_YET;
+  }
+  if (this->NumberOfTransformItems == 1)
+  {
+    // There is only one item, it's the closest one to any timestamp
+    uid = this->LatestItemUid;
+    return ITEM_OK;
+  }
+
+  // Search in local time, the timestamps are stored that way
+  const double localTime = time - this->StreamBuffer->GetLocalTimeOffsetSec();
+
+  const BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfTransformItems - 1);
+  int oldestBufferIndex = this->WritePointer - this->NumberOfTransformItems;
+  if (oldestBufferIndex < 0)
+  {
+    oldestBufferIndex += this->AllocatedCapacity;
+  }
+  const double* timestamps = &this->FilteredTimestamps[0];
+  const int capacity = this->AllocatedCapacity;
+  auto readTimestamp = [timestamps, oldestUid, oldestBufferIndex, capacity](BufferItemUidType probedUid, double & timestamp) -> bool
+  {
+    int bufferIndex = oldestBufferIndex + static_cast<int>(probedUid - oldestUid);
+    if (bufferIndex >= capacity)
+    {
+      bufferIndex -= capacity;
+    }
+    timestamp = timestamps[bufferIndex];
+    return true;
+  };
+
+  ItemStatus status = vtkPlusTimestampedCircularBuffer::FindItemUidFromTime(localTime, oldestUid, this->LatestItemUid, (searchHintUid != NULL ? *searchHintUid : 0),
+                      NEGLIGIBLE_TIME_DIFFERENCE, readTimestamp, uid);
+  if (status == ITEM_OK && searchHintUid != NULL)
+  {
+    *searchHintUid = uid;
+  }
+  return status;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::CopyToStreamBufferItem(int bufferIndex, BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  // the caller must have locked the buffer
+  bufferItem->SetMatrix(&this->MatrixElements[bufferIndex * MATRIX_ELEMENT_COUNT]);
+  bufferItem->SetStatus(this->Statuses[bufferIndex]);
+  bufferItem->SetIndex(this->Indices[bufferIndex]);
+  bufferItem->SetFilteredTimestamp(this->FilteredTimestamps[bufferIndex]);
+  bufferItem->SetUnfilteredTimestamp(this->UnfilteredTimestamps[bufferIndex]);
+  bufferItem->SetUid(uid);
+  std::map<int, igsioFieldMapType>::const_iterator fieldsIt = this->CustomFields.find(bufferIndex);
+  bufferItem->SetFrameFieldMap(fieldsIt != this->CustomFields.end() ? fieldsIt->second : igsioFieldMapType());
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  if (bufferItem == NULL)
+  {
+    LOCAL_LOG_ERROR("Unable to copy data buffer item into a NULL data buffer item!");
+    return ITEM_UNKNOWN_ERROR;
+  }
+
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferIndex(0);
+  ItemStatus itemStatus = this->GetBufferIndexFromUid(uid, bufferIndex);
+  if (itemStatus != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Failed to retrieve data item");
+    return itemStatus;
+  }
+  this->CopyToStreamBufferItem(bufferIndex, uid, bufferItem);
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem)
+{
+  return this->GetStreamBufferItem(uid, bufferItem);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferIndex(0);
+  if (this->GetBufferIndexFromUid(uid, bufferIndex) != ITEM_OK)
+  {
+    return PLUS_FAIL;
+  }
+  igsioFieldMapType& fields = this->CustomFields[bufferIndex];
+  fields[key].first = FRAMEFIELD_NONE;
+  fields[key].second = value;
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetTimeStamp(BufferItemUidType uid, double& timestamp)
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetTimeStamp(uid, timestamp);
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferIndex(0);
+  ItemStatus status = this->GetBufferIndexFromUid(uid, bufferIndex);
+  if (status != ITEM_OK)
+  {
+    timestamp = 0;
+    return status;
+  }
+  timestamp = this->FilteredTimestamps[bufferIndex] + this->StreamBuffer->GetLocalTimeOffsetSec();
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetLatestTimeStamp(double& latestTimestamp)
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetLatestTimeStamp(latestTimestamp);
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->GetTimeStamp(this->LatestItemUid, latestTimestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetOldestTimeStamp(double& oldestTimestamp)
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetOldestTimeStamp(oldestTimestamp);
+  }
+  // The oldest item may be removed from the buffer at any moment
+  // therefore we need to retrieve its UID and timestamp within a single lock
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->GetTimeStamp(this->LatestItemUid - (this->NumberOfTransformItems - 1), oldestTimestamp);
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetIndex(const BufferItemUidType uid, unsigned long& index)
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetIndex(uid, index);
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferIndex(0);
+  ItemStatus status = this->GetBufferIndexFromUid(uid, bufferIndex);
+  if (status != ITEM_OK)
+  {
+    index = 0;
+    return status;
+  }
+  index = this->Indices[bufferIndex];
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetBufferIndexFromTime(const double time, int& bufferIndex)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  bufferIndex = -1;
+  BufferItemUidType itemUid(0);
+  ItemStatus status = this->FindItemUidFromTime(time, itemUid);
+  if (status != ITEM_OK)
+  {
+    LOCAL_LOG_WARNING("Buffer item is not in the buffer (time: " << std::fixed << time << ")!");
+    return status;
+  }
+  return this->GetBufferIndexFromUid(itemUid, bufferIndex);
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTransformBuffer::GetLatestItemHasValidVideoData()
+{
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTransformBuffer::GetLatestItemHasValidTransformData()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->NumberOfTransformItems > 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkPlusTransformBuffer::GetLatestItemHasValidFieldData()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  int bufferIndex(0);
+  if (this->GetBufferIndexFromUid(this->LatestItemUid, bufferIndex) != ITEM_OK)
+  {
+    return false;
+  }
+  std::map<int, igsioFieldMapType>::const_iterator fieldsIt = this->CustomFields.find(bufferIndex);
+  return fieldsIt != this->CustomFields.end() && !fieldsIt->second.empty();
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTransformBuffer::GetOldestItemUidInBuffer()
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetOldestItemUidInBuffer();
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  // LatestItemUid - ( NumberOfItems - 1 ) is the oldest element in the buffer
+  return this->LatestItemUid - (this->NumberOfTransformItems - 1);
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTransformBuffer::GetLatestItemUidInBuffer()
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    return this->StreamBuffer->GetLatestItemUidInBuffer();
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->LatestItemUid;
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid /*=NULL*/)
+{
+  if (this->StreamBuffer->GetLockFreeReads())
+  {
+    ItemStatus status = this->StreamBuffer->FindItemUidFromTimeLockFree(time, uid, searchHintUid);
+    if (status != ITEM_UNKNOWN_ERROR)
+    {
+      return status;
+    }
+    // The writer kept overwriting the inspected items, search with the lock held
+  }
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->FindItemUidFromTime(time, uid, searchHintUid);
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusTransformBuffer::GetNumberOfItems()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->NumberOfTransformItems;
+}
+
+//----------------------------------------------------------------------------
+BufferItemUidType vtkPlusTransformBuffer::PinItems()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  // All the items that are in the buffer now are kept (if the buffer is empty then nothing has to be kept)
+  BufferItemUidType oldestUid = this->LatestItemUid - (this->NumberOfTransformItems - 1);
+  this->AddPin(oldestUid);
+  return oldestUid;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::UnpinItems(BufferItemUidType pinnedItemUid)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  bool expired(false);
+  if (!this->RemovePin(pinnedItemUid, expired))
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Items are not pinned from UID " << pinnedItemUid);
+    return PLUS_FAIL;
+  }
+
+  BufferItemUidType oldestPinnedUid(0);
+  if (!this->GetOldestPinnedItemUid(oldestPinnedUid) && this->AllocatedCapacity > this->Capacity)
+  {
+    // The memory is released by the reader, not by the acquisition thread
+    this->Reallocate(this->Capacity);
+  }
+
+  if (expired)
+  {
+    LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Pinned items from UID " << pinnedItemUid << " were overwritten while the pin was held");
+    return PLUS_FAIL;
+  }
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::SetMaxNumberOfPinnedItems(int maxNumberOfPinnedItems)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->MaxNumberOfPinnedItems = maxNumberOfPinnedItems;
+}
+
+//----------------------------------------------------------------------------
+int vtkPlusTransformBuffer::GetMaxNumberOfPinnedItems()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  return this->MaxNumberOfPinnedItems;
+}
+
+//----------------------------------------------------------------------------
+double vtkPlusTransformBuffer::GetFrameRate(bool ideal /*=false*/, double* framePeriodStdevSecPtr /*=NULL*/)
+{
+  // The frame period statistics are updated when items are added, no need to lock the buffer
+  double frameRate(0);
+  double framePeriodStdev(0);
+  bool frameIndicesValid(true);
+  PlusStatus status = this->FramePeriodStatistics.GetFrameRate(ideal, frameRate, framePeriodStdev, frameIndicesValid);
+
+  if (!frameIndicesValid)
+  {
+    LOCAL_LOG_WARNING("Cannot compute ideal frame rate acurately, as frame numbers are invalid or missing");
+  }
+
+  if (status != PLUS_SUCCESS)
+  {
+    LOCAL_LOG_WARNING("Failed to compute frame rate. Not enough samples.");
+    return 0;
+  }
+
+  if (framePeriodStdevSecPtr != NULL)
+  {
+    (*framePeriodStdevSecPtr) = framePeriodStdev;
+  }
+
+  return frameRate;
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::ResetFramePeriodStatistics()
+{
+  // the caller must have locked the buffer
+  this->FramePeriodStatistics.SetWindowSize(std::max(this->Capacity - 1, 0));
+  for (BufferItemUidType uid = this->LatestItemUid - (this->NumberOfTransformItems - 1); uid <= this->LatestItemUid; ++uid)
+  {
+    int bufferIndex(0);
+    this->GetBufferIndexFromUid(uid, bufferIndex);
+    this->FramePeriodStatistics.AddItem(this->FilteredTimestamps[bufferIndex], this->Indices[bufferIndex]);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::ResetLockFreeSlots()
+{
+  // the caller must have locked the buffer
+  // The item with UID=1 would be in the slot that is LatestItemUid-1 slots before the latest item (WritePointer-1)
+  const int firstUidSlotIndex = (this->AllocatedCapacity > 0 ?
+                                 ((this->WritePointer - static_cast<int>(this->LatestItemUid % this->AllocatedCapacity)) % this->AllocatedCapacity + this->AllocatedCapacity) % this->AllocatedCapacity : 0);
+  this->StreamBuffer->ResetExternalItems(firstUidSlotIndex, this->LatestItemUid, this->NumberOfTransformItems, this->FilteredTimestamps, this->UnfilteredTimestamps, this->Indices);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::DeepCopy(vtkPlusBuffer* buffer)
+{
+  LOG_TRACE("vtkPlusTransformBuffer::DeepCopy");
+
+  vtkPlusTransformBuffer* transformBuffer = vtkPlusTransformBuffer::SafeDownCast(buffer);
+  if (transformBuffer == NULL)
+  {
+    // Different storage, copy the transforms item by item
+    this->DeepCopyItems(buffer);
+    return;
+  }
+
+  // Copy the timestamp filtering state (the circular buffers do not contain items)
+  this->StreamBuffer->DeepCopy(transformBuffer->StreamBuffer);
+
+  igsioLockGuard<StreamItemCircularBuffer> sourceGuardedLock(transformBuffer->StreamBuffer);
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->Capacity = transformBuffer->Capacity;
+  this->AllocatedCapacity = transformBuffer->AllocatedCapacity;
+  this->SpillBufferSize = transformBuffer->SpillBufferSize;
+  this->NumberOfTransformItems = transformBuffer->NumberOfTransformItems;
+  this->WritePointer = transformBuffer->WritePointer;
+  this->LatestItemUid = transformBuffer->LatestItemUid;
+  this->CurrentTimeStamp = transformBuffer->CurrentTimeStamp;
+  this->MatrixElements = transformBuffer->MatrixElements;
+  this->Statuses = transformBuffer->Statuses;
+  this->Indices = transformBuffer->Indices;
+  this->FilteredTimestamps = transformBuffer->FilteredTimestamps;
+  this->UnfilteredTimestamps = transformBuffer->UnfilteredTimestamps;
+  this->CustomFields = transformBuffer->CustomFields;
+  this->MaxAllowedTimeDifference = transformBuffer->MaxAllowedTimeDifference;
+  this->ResetFramePeriodStatistics();
+  this->ResetLockFreeSlots();
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusTransformBuffer::Clear()
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+  this->StreamBuffer->Clear();
+  this->WritePointer = 0;
+  this->NumberOfTransformItems = 0;
+  this->CurrentTimeStamp = 0;
+  this->LatestItemUid = 0;
+  this->CustomFields.clear();
+  this->FramePeriodStatistics.Clear();
+  this->ResetLockFreeSlots();
+}
+
+//----------------------------------------------------------------------------
+ItemStatus vtkPlusTransformBuffer::GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  BufferItemUidType itemUid(0);
+  ItemStatus status = this->FindItemUidFromTime(time, itemUid);
+  if (status != ITEM_OK)
+  {
+    switch (status)
+    {
+      case ITEM_NOT_AVAILABLE_YET:
+        LOCAL_LOG_WARNING("vtkPlusTransformBuffer: Cannot get any item from the buffer for time: " << std::fixed << time << ". Item is not available yet.");
+        break;
+      case ITEM_NOT_AVAILABLE_ANYMORE:
+        LOCAL_LOG_WARNING("vtkPlusTransformBuffer: Cannot get any item from the buffer for time: " << std::fixed << time << ". Item is not available anymore.");
+        break;
+      default:
+        break;
+    }
+    return status;
+  }
+
+  return this->GetStreamBufferItem(itemUid, bufferItem);
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusTransformBuffer::GetPrevNextItemUidFromTime(double time, BufferItemUidType& itemAuid, BufferItemUidType& itemBuid, BufferItemUidType* searchHintUid /*=NULL*/)
+{
+  // the caller must have locked the buffer
+
+  // itemA is the item that is the closest to the requested time
+  ItemStatus status = this->FindItemUidFromTime(time, itemAuid, searchHintUid);
+  if (status != ITEM_OK)
+  {
+    switch (status)
+    {
+      case ITEM_NOT_AVAILABLE_YET:
+        LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Cannot get any item from the data buffer for time: " << std::fixed << time << ". Item is not available yet.");
+        break;
+      case ITEM_NOT_AVAILABLE_ANYMORE:
+        LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Cannot get any item from the data buffer for time: " << std::fixed << time << ". Item is not available anymore.");
+        break;
+      default:
+        break;
+    }
+    return PLUS_FAIL;
+  }
+  int itemAbufferIndex(0);
+  this->GetBufferIndexFromUid(itemAuid, itemAbufferIndex);
+
+  // If tracker is out of view, etc. then we don't have a valid before and after the requested time, so we cannot do interpolation
+  if (this->Statuses[itemAbufferIndex] != TOOL_OK)
+  {
+    LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Cannot do data interpolation. The closest item to the requested time (time: " << std::fixed << time << ", uid: " << itemAuid << ") is invalid.");
+    return PLUS_FAIL;
+  }
+
+  const double localTimeOffsetSec = this->StreamBuffer->GetLocalTimeOffsetSec();
+  double itemAtime = this->FilteredTimestamps[itemAbufferIndex] + localTimeOffsetSec;
+
+  // If the time difference is negligible then don't interpolate, just return the closest item
+  if (fabs(itemAtime - time) < NEGLIGIBLE_TIME_DIFFERENCE)
+  {
+    itemBuid = itemAuid;
+    return PLUS_SUCCESS;
+  }
+
+  // If the closest item is too far, then we don't do interpolation
+  if (fabs(itemAtime - time) > this->GetMaxAllowedTimeDifference())
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Cannot perform interpolation, time difference compared to itemA is too big " << std::fixed << fabs(itemAtime - time) << " ( closest item time: " << itemAtime << ", requested time: " << time << ").");
+    return PLUS_FAIL;
+  }
+
+  // Find the closest item on the other side of the timescale (so that time is between itemAtime and itemBtime)
+  itemBuid = (time < itemAtime ? itemAuid - 1 : itemAuid + 1);
+  int itemBbufferIndex(0);
+  if (this->GetBufferIndexFromUid(itemBuid, itemBbufferIndex) != ITEM_OK)
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Cannot perform interpolation, itemB is not available " << std::fixed << " ( itemBuid: " << itemBuid << ", oldest UID: " << this->LatestItemUid - (this->NumberOfTransformItems - 1) << ", latest UID: " << this->LatestItemUid);
+    return PLUS_FAIL;
+  }
+
+  // If the next closest item is too far, then we don't do interpolation
+  double itemBtime = this->FilteredTimestamps[itemBbufferIndex] + localTimeOffsetSec;
+  if (fabs(itemBtime - time) > this->GetMaxAllowedTimeDifference())
+  {
+    LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Cannot perform interpolation, time difference compared to itemB is too big " << std::fixed << fabs(itemBtime - time) << " ( itemBtime: " << itemBtime << ", requested time: " << time << ").");
+    return PLUS_FAIL;
+  }
+
+  // If there is no valid element on the other side of the requested time, then we cannot do an interpolation
+  if (this->Statuses[itemBbufferIndex] != TOOL_OK)
+  {
+    LOCAL_LOG_DEBUG("vtkPlusTransformBuffer: Cannot get a second element (uid=" << itemBuid << ") on the other side of the requested time (" << std::fixed << time << ")");
+    return PLUS_FAIL;
+  }
+
+  return PLUS_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Interpolate the matrix for the given timestamp from the two nearest
+// transforms in the buffer, same as vtkPlusBuffer::GetInterpolatedStreamBufferItemFromTime,
+// but the matrices are read directly from the packed arrays.
+ItemStatus vtkPlusTransformBuffer::GetInterpolatedStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  BufferItemUidType itemAuid(0);
+  BufferItemUidType itemBuid(0);
+  if (this->GetPrevNextItemUidFromTime(time, itemAuid, itemBuid) != PLUS_SUCCESS)
+  {
+    // cannot get two neighbors, so cannot do interpolation
+    // it may be normal (e.g., when tracker out of view), so don't return with an error
+    ItemStatus status = this->GetStreamBufferItemFromClosestTime(time, bufferItem);
+    // Update the timestamp to match the requested time
+    bufferItem->SetFilteredTimestamp(time);
+    bufferItem->SetUnfilteredTimestamp(time);
+    if (status != ITEM_OK)
+    {
+      LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ")");
+      return status;
+    }
+    bufferItem->SetStatus(TOOL_MISSING);   // if we return at any point due to an error then it means that the interpolation is not successful, so the item is missing
+    return ITEM_OK;
+  }
+
+  int itemAbufferIndex(0);
+  this->GetBufferIndexFromUid(itemAuid, itemAbufferIndex);
+  this->CopyToStreamBufferItem(itemAbufferIndex, itemAuid, bufferItem);
+  if (itemAuid == itemBuid)
+  {
+    // exact match, no need for interpolation
+    return ITEM_OK;
+  }
+
+  int itemBbufferIndex(0);
+  this->GetBufferIndexFromUid(itemBuid, itemBbufferIndex);
+
+  //============== Get item weights ==================
+
+  const double itemAtime = this->FilteredTimestamps[itemAbufferIndex] + this->StreamBuffer->GetLocalTimeOffsetSec();
+  const double itemBtime = this->FilteredTimestamps[itemBbufferIndex] + this->StreamBuffer->GetLocalTimeOffsetSec();
+  if (fabs(itemAtime - itemBtime) < NEGLIGIBLE_TIME_DIFFERENCE)
+  {
+    // exact time match, no need for interpolation
+    bufferItem->SetFilteredTimestamp(time);
+    bufferItem->SetUnfilteredTimestamp(time);
+    return ITEM_OK;
+  }
+
+  double itemAweight = fabs(itemBtime - time) / fabs(itemAtime - itemBtime);
+  double itemBweight = 1 - itemAweight;
+
+  //============== Interpolate rotation ==================
+
+  const double* elementsA = &this->MatrixElements[itemAbufferIndex * MATRIX_ELEMENT_COUNT];
+  const double* elementsB = &this->MatrixElements[itemBbufferIndex * MATRIX_ELEMENT_COUNT];
+  double matrixA[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  double matrixB[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      matrixA[i][j] = elementsA[i * 4 + j];
+      matrixB[i][j] = elementsB[i * 4 + j];
+    }
+  }
+
+  double matrixAquat[4] = {0, 0, 0, 0};
+  vtkMath::Matrix3x3ToQuaternion(matrixA, matrixAquat);
+  double matrixBquat[4] = {0, 0, 0, 0};
+  vtkMath::Matrix3x3ToQuaternion(matrixB, matrixBquat);
+  double interpolatedRotationQuat[4] = {0, 0, 0, 0};
+  igsioMath::Slerp(interpolatedRotationQuat, itemBweight, matrixAquat, matrixBquat);
+  double interpolatedRotation[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  vtkMath::QuaternionToMatrix3x3(interpolatedRotationQuat, interpolatedRotation);
+
+  double interpolatedElements[MATRIX_ELEMENT_COUNT] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+  for (int i = 0; i < 3; i++)
+  {
+    interpolatedElements[i * 4 + 0] = interpolatedRotation[i][0];
+    interpolatedElements[i * 4 + 1] = interpolatedRotation[i][1];
+    interpolatedElements[i * 4 + 2] = interpolatedRotation[i][2];
+    interpolatedElements[i * 4 + 3] = elementsA[i * 4 + 3] * itemAweight + elementsB[i * 4 + 3] * itemBweight;
+  }
+
+  //============== Interpolate time ==================
+
+  double interpolatedUnfilteredTimestamp = this->UnfilteredTimestamps[itemAbufferIndex] * itemAweight + this->UnfilteredTimestamps[itemBbufferIndex] * itemBweight;
+
+  //============== Write interpolated results into the bufferItem ==================
+
+  bufferItem->SetMatrix(interpolatedElements);
+  bufferItem->SetFilteredTimestamp(time - this->StreamBuffer->GetLocalTimeOffsetSec());   // global = local + offset => local = global - offset
+  bufferItem->SetUnfilteredTimestamp(interpolatedUnfilteredTimestamp);
+
+  // Rotation angle between the interpolated and the original orientations: 2*acos(|<q1,q2>|)
+  double angleDiffA = 2.0 * vtkMath::DegreesFromRadians(acos(std::min(1.0, fabs(vtkMath::Dot(interpolatedRotationQuat, matrixAquat) + interpolatedRotationQuat[3] * matrixAquat[3]))));
+  double angleDiffB = 2.0 * vtkMath::DegreesFromRadians(acos(std::min(1.0, fabs(vtkMath::Dot(interpolatedRotationQuat, matrixBquat) + interpolatedRotationQuat[3] * matrixBquat[3]))));
+  if (angleDiffA > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG && angleDiffB > ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG)
+  {
+    static vtkIGSIOLogHelper helper(5.f, 5000, vtkPlusLogger::LOG_LEVEL_WARNING);
+    if (helper.ShouldWeLog(true))
+    {
+      LOCAL_LOG_WARNING("Angle difference between interpolated orientations is large (" << angleDiffA << " and " << angleDiffB << " deg, warning threshold is " << ANGLE_INTERPOLATION_WARNING_THRESHOLD_DEG << "), interpolation may be inaccurate. Consider moving the tools slower.");
+    }
+  }
+
+  return ITEM_OK;
+}
+
+//----------------------------------------------------------------------------
+// Same cases as GetInterpolatedStreamBufferItemFromTime, but the interpolation itself
+// is left to PlusPoseInterpolator, so that the poses of all tools can be interpolated at once.
+ItemStatus vtkPlusTransformBuffer::GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample)
+{
+  igsioLockGuard<StreamItemCircularBuffer> dataBufferGuardedLock(this->StreamBuffer);
+
+  sample.InterpolationRequired = false;
+  StreamBufferItem* bufferItem = &sample.Item;
+
+  BufferItemUidType itemAuid(0);
+  BufferItemUidType itemBuid(0);
+  if (this->GetPrevNextItemUidFromTime(time, itemAuid, itemBuid, &sample.SearchHintUid) != PLUS_SUCCESS)
+  {
+    // cannot get two neighbors, so cannot do interpolation
+    // it may be normal (e.g., when tracker out of view), so don't return with an error
+    ItemStatus status = this->GetStreamBufferItemFromClosestTime(time, bufferItem);
+    // Update the timestamp to match the requested time
+    bufferItem->SetFilteredTimestamp(time);
+    bufferItem->SetUnfilteredTimestamp(time);
+    if (status != ITEM_OK)
+    {
+      LOCAL_LOG_ERROR("vtkPlusTransformBuffer: Failed to get data buffer timestamp (time: " << std::fixed << time << ")");
+      return status;
+    }
+    bufferItem->SetStatus(TOOL_MISSING);   // if we return at any point due to an error then it means that the interpolation is not successful, so the item is missing
+    return ITEM_OK;
+  }
+
+  int itemAbufferIndex(0);
+  this->GetBufferIndexFromUid(itemAuid, itemAbufferIndex);
+  this->CopyToStreamBufferItem(itemAbufferIndex, itemAuid, bufferItem);
+  if (itemAuid == itemBuid)
+  {
+    // exact match, no need for interpolation
+    return ITEM_OK;
+  }
+
+  int itemBbufferIndex(0);
+  this->GetBufferIndexFromUid(itemBuid, itemBbufferIndex);
+
+  const double itemAtime = this->FilteredTimestamps[itemAbufferIndex] + this->StreamBuffer->GetLocalTimeOffsetSec();
+  const double itemBtime = this->FilteredTimestamps[itemBbufferIndex] + this->StreamBuffer->GetLocalTimeOffsetSec();
+  if (fabs(itemAtime - itemBtime) < NEGLIGIBLE_TIME_DIFFERENCE)
+  {
+    // exact time match, no need for interpolation
+    bufferItem->SetFilteredTimestamp(time);
+    bufferItem->SetUnfilteredTimestamp(time);
+    return ITEM_OK;
+  }
+
+  double itemAweight = fabs(itemBtime - time) / fabs(itemAtime - itemBtime);
+  sample.ItemBWeight = 1 - itemAweight;
+  std::copy(&this->MatrixElements[itemAbufferIndex * MATRIX_ELEMENT_COUNT], &this->MatrixElements[itemAbufferIndex * MATRIX_ELEMENT_COUNT] + MATRIX_ELEMENT_COUNT, sample.MatrixA);
+  std::copy(&this->MatrixElements[itemBbufferIndex * MATRIX_ELEMENT_COUNT], &this->MatrixElements[itemBbufferIndex * MATRIX_ELEMENT_COUNT] + MATRIX_ELEMENT_COUNT, sample.MatrixB);
+  sample.UnfilteredTimestampA = this->UnfilteredTimestamps[itemAbufferIndex];
+  sample.UnfilteredTimestampB = this->UnfilteredTimestamps[itemBbufferIndex];
+  sample.InterpolationRequired = true;
+
+  // The filtered timestamp is known already, the transform and the unfiltered timestamp are computed by the interpolator
+  bufferItem->SetFilteredTimestamp(time - this->StreamBuffer->GetLocalTimeOffsetSec());   // global = local + offset => local = global - offset
+
+  return ITEM_OK;
+}
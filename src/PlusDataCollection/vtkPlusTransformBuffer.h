@@ -0,0 +1,234 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusTransformBuffer_h
+#define __vtkPlusTransformBuffer_h
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusBuffer.h"
+#include "vtkPlusDataCollectionExport.h"
+
+// STL includes
+#include <map>
+#include <vector>
+
+/*!
+  \class vtkPlusTransformBuffer
+  \brief Compact buffer for tracker tools that only stores transforms
+
+  Items are stored in a structure of arrays (transform matrix elements, tool status, frame index,
+  filtered and unfiltered timestamps) instead of StreamBufferItem objects, which carry an
+  image, a frame field map and a heap-allocated matrix each. Lookup by time and interpolation
+  are performed directly on the packed arrays. Custom fields are kept only for the items that have any.
+
+  The buffer cannot store video frames or field-only items. Timestamp filtering, timestamp reporting
+  and the local time offset are the same as in vtkPlusBuffer. Reads acquire the buffer lock, except GetFrameRate,
+  which returns incrementally updated statistics. If LockFreeReads is enabled then the timestamp, index and UID queries
+  do not acquire the lock: the timestamps and indices are published to the lock-free slots of the circular buffer
+  of the base class (see vtkPlusTimestampedCircularBuffer::ResetExternalItems), which do the lookups.
+
+  Readers can pin the items (see PinItems): while the buffer is pinned and full, the arrays grow instead of
+  overwriting the oldest pinned item, up to MaxNumberOfPinnedItems. Beyond that the oldest items are overwritten
+  and the pins that needed them fail (see UnpinItems). The arrays shrink back to the buffer size when no pins remain.
+
+  vtkPlusDataSource uses this buffer for tool sources.
+
+  \ingroup PlusLibDataCollection
+*/
+class vtkPlusDataCollectionExport vtkPlusTransformBuffer : public vtkPlusBuffer
+{
+public:
+  static vtkPlusTransformBuffer* New();
+  vtkTypeMacro(vtkPlusTransformBuffer, vtkPlusBuffer);
+  virtual void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual PlusStatus SetBufferSize(int n) VTK_OVERRIDE;
+  virtual int GetBufferSize() VTK_OVERRIDE;
+
+  /*!
+    Transform items are small (a few hundred bytes), so the items that a video buffer would spill to disk
+    are kept in memory instead: the buffer holds BufferSize + SpillBufferSize items.
+  */
+  virtual PlusStatus SetSpillBufferSize(int n) VTK_OVERRIDE;
+
+  virtual unsigned long long GetItemSizeInBytes() VTK_OVERRIDE;
+  /*! Includes the items that are kept in memory instead of the spill file */
+  virtual unsigned long long GetAllocatedMemoryInBytes() VTK_OVERRIDE;
+  virtual unsigned long long GetUsedMemoryInBytes() VTK_OVERRIDE;
+
+  /*! Video frames cannot be stored in a transform buffer, always fails */
+  virtual PlusStatus AddItem(vtkImageData* frame,
+                             US_IMAGE_ORIENTATION usImageOrientation,
+                             US_IMAGE_TYPE imageType,
+                             long frameNumber,
+                             const std::array<int, 3>& clipRectangleOrigin,
+                             const std::array<int, 3>& clipRectangleSize,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL) VTK_OVERRIDE;
+  /*! Video frames cannot be stored in a transform buffer, always fails */
+  virtual PlusStatus AddItem(const igsioVideoFrame* frame,
+                             long frameNumber,
+                             const std::array<int, 3>& clipRectangleOrigin,
+                             const std::array<int, 3>& clipRectangleSize,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL) VTK_OVERRIDE;
+  /*! Video frames cannot be stored in a transform buffer, always fails */
+  virtual PlusStatus AddItem(void* imageDataPtr,
+                             US_IMAGE_ORIENTATION usImageOrientation,
+                             const FrameSizeType& inputFrameSizeInPx,
+                             igsioCommon::VTKScalarPixelType pixelType,
+                             unsigned int numberOfScalarComponents,
+                             US_IMAGE_TYPE imageType,
+                             int numberOfBytesToSkip,
+                             long frameNumber,
+                             const std::array<int, 3>& clipRectangleOrigin,
+                             const std::array<int, 3>& clipRectangleSize,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL,
+                             vtkStreamingVolumeFrame* encodedFrame = NULL) VTK_OVERRIDE;
+  /*! Video frames cannot be stored in a transform buffer, always fails */
+  virtual PlusStatus AddItem(void* imageDataPtr,
+                             const FrameSizeType& frameSize,
+                             unsigned int frameSizeInBytes,
+                             US_IMAGE_TYPE imageType,
+                             long frameNumber,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP,
+                             const igsioFieldMapType* customFields = NULL) VTK_OVERRIDE;
+  /*! Items without a transform cannot be stored in a transform buffer, always fails */
+  virtual PlusStatus AddItem(const igsioFieldMapType& fields,
+                             long frameNumber,
+                             double unfilteredTimestamp = UNDEFINED_TIMESTAMP,
+                             double filteredTimestamp = UNDEFINED_TIMESTAMP) VTK_OVERRIDE;
+
+  /*!
+    Add a matrix plus status to the buffer with the specified filtered timestamp, see vtkPlusBuffer::AddFilteredTimeStampedItem.
+    If the timestamp is less than or equal to the previous timestamp, then nothing will be done.
+  */
+  virtual PlusStatus AddFilteredTimeStampedItem(vtkMatrix4x4* matrix, ToolStatus status, unsigned long frameNumber, double unfilteredTimestamp, double filteredTimestamp, const igsioFieldMapType* customFields = NULL) VTK_OVERRIDE;
+
+  /*! Get an item with the specified uid from the buffer */
+  virtual ItemStatus GetStreamBufferItem(BufferItemUidType uid, StreamBufferItem* bufferItem) VTK_OVERRIDE;
+  /*! Same as GetStreamBufferItem, as transform buffer items have no pixel data */
+  virtual ItemStatus GetStreamBufferItemView(BufferItemUidType uid, StreamBufferItem* bufferItem) VTK_OVERRIDE;
+  virtual PlusStatus ModifyBufferItemFrameField(BufferItemUidType uid, const std::string& key, const std::string& value) VTK_OVERRIDE;
+
+  virtual ItemStatus GetLatestTimeStamp(double& latestTimestamp) VTK_OVERRIDE;
+  virtual ItemStatus GetOldestTimeStamp(double& oldestTimestamp) VTK_OVERRIDE;
+  virtual ItemStatus GetTimeStamp(BufferItemUidType uid, double& timestamp) VTK_OVERRIDE;
+  virtual ItemStatus GetIndex(const BufferItemUidType uid, unsigned long& index) VTK_OVERRIDE;
+  virtual ItemStatus GetBufferIndexFromTime(const double time, int& bufferIndex) VTK_OVERRIDE;
+
+  virtual bool GetLatestItemHasValidVideoData() VTK_OVERRIDE;
+  virtual bool GetLatestItemHasValidTransformData() VTK_OVERRIDE;
+  virtual bool GetLatestItemHasValidFieldData() VTK_OVERRIDE;
+
+  virtual BufferItemUidType GetOldestItemUidInBuffer() VTK_OVERRIDE;
+  virtual BufferItemUidType GetLatestItemUidInBuffer() VTK_OVERRIDE;
+  virtual ItemStatus GetItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL) VTK_OVERRIDE;
+  virtual int GetNumberOfItems() VTK_OVERRIDE;
+
+  /*! Keep the items that are currently in the buffer available until UnpinItems is called, see vtkPlusBuffer::PinItems */
+  virtual BufferItemUidType PinItems() VTK_OVERRIDE;
+  virtual PlusStatus UnpinItems(BufferItemUidType pinnedItemUid) VTK_OVERRIDE;
+
+  /*!
+    Set the maximum number of items that the buffer may hold while it is pinned. Limits the memory that slow readers
+    can make the acquisition thread allocate. Negative value means 4 times the number of items of the unpinned buffer (default).
+  */
+  void SetMaxNumberOfPinnedItems(int maxNumberOfPinnedItems);
+  /*! Get the maximum number of items that the buffer may hold while it is pinned (negative: 4 times the unpinned capacity) */
+  int GetMaxNumberOfPinnedItems();
+  virtual double GetFrameRate(bool ideal = false, double* framePeriodStdevSecPtr = NULL) VTK_OVERRIDE;
+
+  /*! Make this buffer into a copy of another buffer. Only the transforms, statuses, timestamps, indices and custom fields are copied. */
+  virtual void DeepCopy(vtkPlusBuffer* buffer) VTK_OVERRIDE;
+
+  /*! Clear buffer (set the buffer pointer to the first element) */
+  virtual void Clear() VTK_OVERRIDE;
+
+  /*! Reads the two bracketing poses directly from the packed arrays, see vtkPlusBuffer::GetInterpolationSamplesFromTime */
+  virtual ItemStatus GetInterpolationSamplesFromTime(double time, PlusPoseInterpolationSample& sample) VTK_OVERRIDE;
+
+protected:
+  vtkPlusTransformBuffer();
+  ~vtkPlusTransformBuffer();
+
+  virtual ItemStatus GetInterpolatedStreamBufferItemFromTime(double time, StreamBufferItem* bufferItem) VTK_OVERRIDE;
+  virtual ItemStatus GetStreamBufferItemFromClosestTime(double time, StreamBufferItem* bufferItem) VTK_OVERRIDE;
+
+  /*! Set the number of items that the buffer holds, the most recent items are kept */
+  PlusStatus SetCapacity(int capacity);
+
+  /*! Resize the arrays to hold the specified number of items, the most recent items are kept. The caller must hold the lock. */
+  void Reallocate(int allocatedCapacity);
+
+  /*! Get the buffer index of the item with the specified UID. The caller must hold the lock. */
+  ItemStatus GetBufferIndexFromUid(BufferItemUidType uid, int& bufferIndex) const;
+
+  /*!
+    Find the UID of the item with the closest timestamp (timestamps are in global time), using interpolation search.
+    The search starts from searchHintUid if it is specified, and it is updated to the found item. The caller must hold the lock.
+  */
+  ItemStatus FindItemUidFromTime(double time, BufferItemUidType& uid, BufferItemUidType* searchHintUid = NULL) const;
+
+  /*! Copy the item at the specified buffer index into a stream buffer item. The caller must hold the lock. */
+  void CopyToStreamBufferItem(int bufferIndex, BufferItemUidType uid, StreamBufferItem* bufferItem);
+
+  /*!
+    Returns the UIDs of the closest previous and next items relative to the specified time (itemA is the closest item),
+    same as vtkPlusBuffer::GetPrevNextBufferItemFromTime. The caller must hold the lock.
+  */
+  PlusStatus GetPrevNextItemUidFromTime(double time, BufferItemUidType& itemAuid, BufferItemUidType& itemBuid, BufferItemUidType* searchHintUid = NULL);
+
+  /*! Recompute the frame period statistics from the items in the buffer. The caller must hold the lock. */
+  void ResetFramePeriodStatistics();
+
+  /*! Publish the timestamps and indices of all the items to lock-free readers, after the arrays are replaced. The caller must hold the lock. */
+  void ResetLockFreeSlots();
+
+protected:
+  /*! Number of items that the buffer holds when it is not pinned */
+  int Capacity;
+  /*! Number of items that the arrays can hold, larger than Capacity if the buffer had to grow while it was pinned */
+  int AllocatedCapacity;
+  /*! Number of valid items in the arrays */
+  int NumberOfTransformItems;
+  /*! Next item will be written here */
+  int WritePointer;
+  /*! UID of the latest item (UIDs increase by one for each added item) */
+  BufferItemUidType LatestItemUid;
+  /*! Filtered timestamp of the latest item in local time, new items must be newer */
+  double CurrentTimeStamp;
+
+  /*! Transform matrix elements, 16 values (row-major) for each item */
+  std::vector<double> MatrixElements;
+  std::vector<ToolStatus> Statuses;
+  /*! Index assigned by the data acquisition system (usually a counter) */
+  std::vector<unsigned long> Indices;
+  /*! Filtered timestamps in local time */
+  std::vector<double> FilteredTimestamps;
+  /*! Unfiltered timestamps in local time */
+  std::vector<double> UnfilteredTimestamps;
+  /*! Custom fields of the items that have any, by buffer index */
+  std::map<int, igsioFieldMapType> CustomFields;
+
+  /*! Maximum number of items that the buffer may hold while it is pinned (negative: 4 times Capacity) */
+  int MaxNumberOfPinnedItems;
+
+  /*! Frame period statistics of the items in the buffer, updated when an item is added */
+  PlusFramePeriodStatistics FramePeriodStatistics;
+
+private:
+  vtkPlusTransformBuffer(const vtkPlusTransformBuffer&);
+  void operator=(const vtkPlusTransformBuffer&);
+};
+
+#endif
@@ -226,12 +226,29 @@ PlusStatus PlusIgtlClientInfo::SetClientInfoFromXmlData(vtkXMLDataElement* xmlda
     }
   }
 
+  clientInfo.UpdateStreamNames();
+
   // Copy over the new client info
   (*this) = clientInfo;
 
   return PLUS_SUCCESS;
 }
 
+//----------------------------------------------------------------------------
+void PlusIgtlClientInfo::UpdateStreamNames()
+{
+  for (std::vector<ImageStream>::iterator imageStreamIterator = this->ImageStreams.begin(); imageStreamIterator != this->ImageStreams.end(); ++imageStreamIterator)
+  {
+    imageStreamIterator->TransformName = igsioTransformName(imageStreamIterator->Name, imageStreamIterator->EmbeddedTransformToFrame);
+    imageStreamIterator->DeviceName = imageStreamIterator->TransformName.From() + std::string("_") + imageStreamIterator->TransformName.To();
+  }
+  for (std::vector<VideoStream>::iterator videoStreamIterator = this->VideoStreams.begin(); videoStreamIterator != this->VideoStreams.end(); ++videoStreamIterator)
+  {
+    videoStreamIterator->TransformName = igsioTransformName(videoStreamIterator->Name, videoStreamIterator->EmbeddedTransformToFrame);
+    videoStreamIterator->DeviceName = videoStreamIterator->TransformName.From() + std::string("_") + videoStreamIterator->TransformName.To();
+  }
+}
+
 //----------------------------------------------------------------------------
 void PlusIgtlClientInfo::GetClientInfoInXmlData(std::string& strXmlData)
 {
@@ -68,6 +68,10 @@ public:
     std::string Name;
     /*! Name of the IGTL image message embedded transform "To" frame */
     std::string EmbeddedTransformToFrame;
+    /*! Embedded transform name ([Name]To[EmbeddedTransformToFrame]), set by PlusIgtlClientInfo::UpdateStreamNames */
+    igsioTransformName TransformName;
+    /*! IGTL message device name ([Name]_[EmbeddedTransformToFrame]), set by PlusIgtlClientInfo::UpdateStreamNames */
+    std::string DeviceName;
     /*! Class for decoding and encoding frames */
     vtkSmartPointer<vtkIGSIOFrameConverter> FrameConverter;
     ImageStream()
@@ -87,6 +91,10 @@ public:
     std::string EmbeddedTransformToFrame;
     /*! Parameters for how to encode video for compressed streams*/
     EncodingParameters EncodeVideoParameters;
+    /*! Embedded transform name ([Name]To[EmbeddedTransformToFrame]), set by PlusIgtlClientInfo::UpdateStreamNames */
+    igsioTransformName TransformName;
+    /*! IGTL message device name ([Name]_[EmbeddedTransformToFrame]), set by PlusIgtlClientInfo::UpdateStreamNames */
+    std::string DeviceName;
     /*! Class for decoding and encoding frames */
     vtkSmartPointer<vtkIGSIOFrameConverter> FrameConverter;
     VideoStream()
@@ -106,6 +114,13 @@ public:
   /*! Serialize client info data to xml data and return in string */
   void GetClientInfoInXmlData(std::string& strXmlData);
 
+  /*!
+    Resolve the transform and device names of the image and video streams from their Name and EmbeddedTransformToFrame,
+    so that they are not parsed again for every sent frame. Must be called after the streams are modified
+    (SetClientInfoFromXmlData calls it automatically).
+  */
+  void UpdateStreamNames();
+
   virtual void PrintSelf(ostream& os, vtkIndent indent);
 
   /*! IGTL header version supported by the client */
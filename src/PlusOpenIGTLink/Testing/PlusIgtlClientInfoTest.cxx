@@ -0,0 +1,113 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file PlusIgtlClientInfoTest.cxx
+  \brief Test that the resolved transform and device names of the client image and video streams follow the client info.
+
+  The names are resolved when the client info is set from XML and when UpdateStreamNames is called after the streams
+  are modified. The test fails if a stream keeps the names of the previous client info.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "PlusIgtlClientInfo.h"
+
+// VTK includes
+#include <vtksys/CommandLineArguments.hxx>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  template<class StreamType>
+  int CheckStreamNames(const std::vector<StreamType>& streams, const std::string& step, const std::string& expectedTransformName, const std::string& expectedDeviceName)
+  {
+    if (streams.size() != 1)
+    {
+      LOG_ERROR("Number of streams after " << step << " is " << streams.size() << " (expected: 1)");
+      return 1;
+    }
+    if (streams[0].TransformName.GetTransformName() != expectedTransformName || streams[0].DeviceName != expectedDeviceName)
+    {
+      LOG_ERROR("Stream names after " << step << " are " << streams[0].TransformName.GetTransformName() << " and " << streams[0].DeviceName
+                << " (expected: " << expectedTransformName << " and " << expectedDeviceName << ")");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+  PlusIgtlClientInfo clientInfo;
+
+  if (clientInfo.SetClientInfoFromXmlData(
+        "<ClientInfo>"
+        "  <ImageNames><Image Name=\"Image\" EmbeddedTransformToFrame=\"Reference\" /></ImageNames>"
+        "  <VideoNames><Video Name=\"Video\" EmbeddedTransformToFrame=\"Tracker\" /></VideoNames>"
+        "</ClientInfo>") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to set the client info");
+    return EXIT_FAILURE;
+  }
+  numberOfErrors += CheckStreamNames(clientInfo.ImageStreams, "setting the client info", "ImageToReference", "Image_Reference");
+  numberOfErrors += CheckStreamNames(clientInfo.VideoStreams, "setting the client info", "VideoToTracker", "Video_Tracker");
+
+  // The client sends new client info
+  if (clientInfo.SetClientInfoFromXmlData(
+        "<ClientInfo>"
+        "  <ImageNames><Image Name=\"Probe\" EmbeddedTransformToFrame=\"Tracker\" /></ImageNames>"
+        "  <VideoNames><Video Name=\"Camera\" EmbeddedTransformToFrame=\"Reference\" /></VideoNames>"
+        "</ClientInfo>") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to change the client info");
+    return EXIT_FAILURE;
+  }
+  numberOfErrors += CheckStreamNames(clientInfo.ImageStreams, "changing the client info", "ProbeToTracker", "Probe_Tracker");
+  numberOfErrors += CheckStreamNames(clientInfo.VideoStreams, "changing the client info", "CameraToReference", "Camera_Reference");
+
+  // The streams are modified directly
+  clientInfo.ImageStreams[0].EmbeddedTransformToFrame = "Reference";
+  clientInfo.VideoStreams[0].Name = "Endoscope";
+  clientInfo.UpdateStreamNames();
+  numberOfErrors += CheckStreamNames(clientInfo.ImageStreams, "modifying the streams", "ProbeToReference", "Probe_Reference");
+  numberOfErrors += CheckStreamNames(clientInfo.VideoStreams, "modifying the streams", "EndoscopeToReference", "Endoscope_Reference");
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
@@ -282,7 +282,7 @@ int vtkPlusIgtlMessageFactory::PackTrackedFrameMessage(igtl::MessageBase::Pointe
   if (!clientInfo.ImageStreams.empty())
   {
     ToolStatus status(TOOL_INVALID);
-    if (transformRepository.GetTransform(igsioTransformName(clientInfo.ImageStreams[0].Name, clientInfo.ImageStreams[0].EmbeddedTransformToFrame), imageMatrix, &status) != PLUS_SUCCESS)
+    if (transformRepository.GetTransform(clientInfo.ImageStreams[0].TransformName, imageMatrix, &status) != PLUS_SUCCESS)
     {
       LOG_ERROR("Unable to retrieve embedded image transform: " << clientInfo.ImageStreams[0].Name << "To" << clientInfo.ImageStreams[0].EmbeddedTransformToFrame << ".");
       numberOfErrors++;
@@ -310,7 +310,7 @@ int vtkPlusIgtlMessageFactory::PackPositionMessage(const PlusIgtlClientInfo& cli
       the POSITION data type has the advantage of smaller data size (19%). It is therefore more suitable for
       pushing high frame-rate data from tracking devices.
     */
-    igsioTransformName transformName = (*transformNameIterator);
+    const igsioTransformName& transformName = (*transformNameIterator);
     igtl::Matrix4x4 igtlMatrix;
     vtkPlusIgtlMessageCommon::GetIgtlMatrix(igtlMatrix, &transformRepository, transformName);
 
@@ -340,7 +340,7 @@ int vtkPlusIgtlMessageFactory::PackTrackingDataMessage(const PlusIgtlClientInfo&
     std::map<std::string, vtkSmartPointer<vtkMatrix4x4> > transforms;
     for (std::vector<igsioTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
     {
-      igsioTransformName transformName = (*transformNameIterator);
+      const igsioTransformName& transformName = (*transformNameIterator);
 
       ToolStatus status(TOOL_INVALID);
       vtkSmartPointer<vtkMatrix4x4> mat = vtkSmartPointer<vtkMatrix4x4>::New();
@@ -367,7 +367,7 @@ int vtkPlusIgtlMessageFactory::PackTransformMessage(const PlusIgtlClientInfo& cl
 {
   for (std::vector<igsioTransformName>::const_iterator transformNameIterator = clientInfo.TransformNames.begin(); transformNameIterator != clientInfo.TransformNames.end(); ++transformNameIterator)
   {
-    igsioTransformName transformName = (*transformNameIterator);
+    const igsioTransformName& transformName = (*transformNameIterator);
     ToolStatus status(TOOL_UNKNOWN);
     vtkNew<vtkMatrix4x4> temp;
     transformRepository.GetTransform(transformName, temp.GetPointer(), &status);
@@ -407,10 +407,10 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
   int numberOfErrors = 0;
   for (std::vector<PlusIgtlClientInfo::ImageStream>::const_iterator imageStreamIterator = clientInfo.ImageStreams.begin(); imageStreamIterator != clientInfo.ImageStreams.end(); ++imageStreamIterator)
   {
-    PlusIgtlClientInfo::ImageStream imageStream = (*imageStreamIterator);
+    const PlusIgtlClientInfo::ImageStream& imageStream = (*imageStreamIterator);
 
-    // Set transform name to [Name]To[CoordinateFrame]
-    igsioTransformName imageTransformName = igsioTransformName(imageStream.Name, imageStream.EmbeddedTransformToFrame);
+    // Transform name is [Name]To[CoordinateFrame], resolved when the client info is set
+    const igsioTransformName& imageTransformName = imageStream.TransformName;
 
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     ToolStatus status;
@@ -421,7 +421,7 @@ int vtkPlusIgtlMessageFactory::PackImageMessage(const PlusIgtlClientInfo& client
       continue;
     }
 
-    std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
+    std::string deviceName = imageStream.DeviceName;
 
     igtl::ImageMessage::Pointer imageMessage = dynamic_cast<igtl::ImageMessage*>(igtlMessage->Clone().GetPointer());
     if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
@@ -464,10 +464,10 @@ int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& client
   int numberOfErrors = 0;
   for (std::vector<PlusIgtlClientInfo::VideoStream>::const_iterator videoStreamIterator = clientInfo.VideoStreams.begin(); videoStreamIterator != clientInfo.VideoStreams.end(); ++videoStreamIterator)
   {
-    PlusIgtlClientInfo::VideoStream videoStream = (*videoStreamIterator);
+    const PlusIgtlClientInfo::VideoStream& videoStream = (*videoStreamIterator);
 
-    // Set transform name to [Name]To[CoordinateFrame]
-    igsioTransformName imageTransformName = igsioTransformName(videoStream.Name, videoStream.EmbeddedTransformToFrame);
+    // Transform name is [Name]To[CoordinateFrame], resolved when the client info is set
+    const igsioTransformName& imageTransformName = videoStream.TransformName;
 
     vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
     if (transformRepository.GetTransform(imageTransformName, matrix.Get()) != PLUS_SUCCESS)
@@ -477,7 +477,7 @@ int vtkPlusIgtlMessageFactory::PackVideoMessage(const PlusIgtlClientInfo& client
       continue;
     }
 
-    std::string deviceName = imageTransformName.From() + std::string("_") + imageTransformName.To();
+    std::string deviceName = videoStream.DeviceName;
 
     igtl::VideoMessage::Pointer videoMessage = dynamic_cast<igtl::VideoMessage*>(igtlMessage->Clone().GetPointer());
     if (trackedFrame.IsFrameFieldDefined(igsioTrackedFrame::FIELD_FRIENDLY_DEVICE_NAME))
@@ -0,0 +1,106 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+#include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusGetBufferMemoryUsageCommand.h"
+
+#include <iomanip>
+
+vtkStandardNewMacro(vtkPlusGetBufferMemoryUsageCommand);
+
+namespace
+{
+  static const std::string GET_BUFFER_MEMORY_USAGE_CMD = "GetBufferMemoryUsage";
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetBufferMemoryUsageCommand::vtkPlusGetBufferMemoryUsageCommand()
+{
+  // It handles only one command, set its name by default
+  this->SetName(GET_BUFFER_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+vtkPlusGetBufferMemoryUsageCommand::~vtkPlusGetBufferMemoryUsageCommand()
+{
+
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetBufferMemoryUsageCommand::SetNameToGetBufferMemoryUsage()
+{
+  this->SetName(GET_BUFFER_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+void vtkPlusGetBufferMemoryUsageCommand::GetCommandNames(std::list<std::string>& cmdNames)
+{
+  cmdNames.clear();
+  cmdNames.push_back(GET_BUFFER_MEMORY_USAGE_CMD);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkPlusGetBufferMemoryUsageCommand::GetDescription(const std::string& commandName)
+{
+  std::string desc;
+  if (commandName.empty() || igsioCommon::IsEqualInsensitive(commandName, GET_BUFFER_MEMORY_USAGE_CMD))
+  {
+    desc += GET_BUFFER_MEMORY_USAGE_CMD;
+    desc += ": Request the number of bytes allocated and used by the buffers of all data sources and the buffer memory budget."
+            " The response contains one parameter for each data source (DeviceId/SourceId) with the buffer size, priority, allocated and used bytes.";
+  }
+  return desc;
+}
+
+//----------------------------------------------------------------------------
+PlusStatus vtkPlusGetBufferMemoryUsageCommand::Execute()
+{
+  vtkPlusDataCollector* dataCollector = this->GetDataCollector();
+  if (dataCollector == NULL)
+  {
+    this->QueueCommandResponse(PLUS_FAIL, "Command failed. See error message.", "No data collector.");
+    return PLUS_FAIL;
+  }
+
+  std::vector<vtkPlusDataSource*> dataSources;
+  dataCollector->GetBufferedDataSources(dataSources);
+
+  igtl::MessageBase::MetaDataMap metadata;
+  unsigned long long allocatedBytes(0);
+  unsigned long long usedBytes(0);
+  for (std::vector<vtkPlusDataSource*>::iterator it = dataSources.begin(); it != dataSources.end(); ++it)
+  {
+    vtkPlusDataSource* dataSource = *it;
+    unsigned long long sourceAllocatedBytes = dataSource->GetBufferAllocatedMemoryInBytes();
+    unsigned long long sourceUsedBytes = dataSource->GetBufferUsedMemoryInBytes();
+    allocatedBytes += sourceAllocatedBytes;
+    usedBytes += sourceUsedBytes;
+
+    std::ostringstream sourceName;
+    sourceName << (dataSource->GetDevice() ? dataSource->GetDevice()->GetDeviceId() : "") << "/" << dataSource->GetId();
+    std::ostringstream sourceUsage;
+    sourceUsage << "BufferSize=" << dataSource->GetBufferSize() << ";BufferPriority=" << dataSource->GetBufferPriority()
+                << ";AllocatedBytes=" << sourceAllocatedBytes << ";UsedBytes=" << sourceUsedBytes;
+    metadata[sourceName.str()] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, sourceUsage.str());
+  }
+  metadata["AllocatedBytes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long long>(allocatedBytes));
+  metadata["UsedBytes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long long>(usedBytes));
+  metadata["BudgetBytes"] = std::pair<IANA_ENCODING_TYPE, std::string>(IANA_TYPE_US_ASCII, igsioCommon::ToString<unsigned long long>(dataCollector->GetBufferMemoryBudgetBytes()));
+
+  std::ostringstream responseMessage;
+  responseMessage << std::fixed << std::setprecision(1) << "Buffers: " << dataSources.size() << ", allocated: " << allocatedBytes / (1024.0 * 1024.0)
+                  << " MB, used: " << usedBytes / (1024.0 * 1024.0) << " MB";
+  if (dataCollector->GetBufferMemoryBudgetBytes() > 0)
+  {
+    responseMessage << ", budget: " << dataCollector->GetBufferMemoryBudgetBytes() / (1024.0 * 1024.0) << " MB";
+  }
+  this->QueueCommandResponse(PLUS_SUCCESS, responseMessage.str(), "", &metadata);
+  return PLUS_SUCCESS;
+}
@@ -0,0 +1,48 @@
+/*=Plus=header=begin======================================================
+  Program: Plus
+  Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+  See License.txt for details.
+=========================================================Plus=header=end*/
+
+#ifndef __vtkPlusGetBufferMemoryUsageCommand_h
+#define __vtkPlusGetBufferMemoryUsageCommand_h
+
+#include "vtkPlusServerExport.h"
+
+#include "vtkPlusCommand.h"
+
+/*!
+  \class vtkPlusGetBufferMemoryUsageCommand
+  \brief This command reports the memory that is allocated and used by the buffers of all data sources
+  \ingroup PlusLibPlusServer
+ */
+class vtkPlusServerExport vtkPlusGetBufferMemoryUsageCommand : public vtkPlusCommand
+{
+public:
+
+  static vtkPlusGetBufferMemoryUsageCommand* New();
+  vtkTypeMacro(vtkPlusGetBufferMemoryUsageCommand, vtkPlusCommand);
+  virtual vtkPlusCommand* Clone() { return New(); }
+
+  /*! Executes the command  */
+  virtual PlusStatus Execute();
+
+  /*! Get all the command names that this class can execute */
+  virtual void GetCommandNames(std::list<std::string>& cmdNames);
+
+  /*! Gets the description for the specified command name. */
+  virtual std::string GetDescription(const std::string& commandName);
+
+  void SetNameToGetBufferMemoryUsage();
+
+protected:
+  vtkPlusGetBufferMemoryUsageCommand();
+  virtual ~vtkPlusGetBufferMemoryUsageCommand();
+
+private:
+  vtkPlusGetBufferMemoryUsageCommand(const vtkPlusGetBufferMemoryUsageCommand&);
+  void operator=(const vtkPlusGetBufferMemoryUsageCommand&);
+};
+
+
+#endif
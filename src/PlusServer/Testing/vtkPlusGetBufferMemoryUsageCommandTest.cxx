@@ -0,0 +1,173 @@
+/*=Plus=header=begin======================================================
+Program: Plus
+Copyright (c) Laboratory for Percutaneous Surgery. All rights reserved.
+See License.txt for details.
+=========================================================Plus=header=end*/
+
+/*!
+  \file vtkPlusGetBufferMemoryUsageCommandTest.cxx
+  \brief Test the reply of the GetBufferMemoryUsage command.
+
+  The command is executed on a data collector with two video sources. The reply has to contain the total allocated and used bytes,
+  the buffer memory budget and one parameter for each data source with its buffer size, priority, allocated and used bytes.
+*/
+
+// Local includes
+#include "PlusConfigure.h"
+#include "vtkPlusCommandProcessor.h"
+#include "vtkPlusCommandResponse.h"
+#include "vtkPlusDataCollector.h"
+#include "vtkPlusDataSource.h"
+#include "vtkPlusDevice.h"
+#include "vtkPlusGetBufferMemoryUsageCommand.h"
+#include "vtkPlusOpenIGTLinkServer.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+#include <vtksys/CommandLineArguments.hxx>
+
+// STL includes
+#include <vector>
+
+namespace
+{
+  const unsigned int FRAME_WIDTH = 64;
+  const unsigned int FRAME_HEIGHT = 48;
+
+  //----------------------------------------------------------------------------
+  int CheckParameter(const igtl::MessageBase::MetaDataMap& parameters, const std::string& name, const std::string& expectedValue)
+  {
+    igtl::MessageBase::MetaDataMap::const_iterator parameter = parameters.find(name);
+    if (parameter == parameters.end())
+    {
+      LOG_ERROR("Parameter " << name << " is missing from the reply");
+      return 1;
+    }
+    if (parameter->second.second != expectedValue)
+    {
+      LOG_ERROR("Parameter " << name << " is " << parameter->second.second << " (expected: " << expectedValue << ")");
+      return 1;
+    }
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+  bool printHelp(false);
+  int verboseLevel = vtkPlusLogger::LOG_LEVEL_UNDEFINED;
+
+  vtksys::CommandLineArguments args;
+  args.Initialize(argc, argv);
+
+  args.AddArgument("--help", vtksys::CommandLineArguments::NO_ARGUMENT, &printHelp, "Print this help.");
+  args.AddArgument("--verbose", vtksys::CommandLineArguments::EQUAL_ARGUMENT, &verboseLevel, "Verbose level (1=error only, 2=warning, 3=info, 4=debug, 5=trace)");
+
+  if (!args.Parse())
+  {
+    std::cerr << "Problem parsing arguments" << std::endl;
+    std::cout << "Help: " << args.GetHelp() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (printHelp)
+  {
+    std::cout << args.GetHelp() << std::endl;
+    exit(EXIT_SUCCESS);
+  }
+
+  vtkPlusLogger::Instance()->SetLogLevel(verboseLevel);
+
+  int numberOfErrors(0);
+
+  // The data collector deletes the device
+  vtkSmartPointer<vtkPlusDataCollector> dataCollector = vtkSmartPointer<vtkPlusDataCollector>::New();
+  vtkPlusDevice* device = vtkPlusDevice::New();
+  device->SetDeviceId("ImagingDevice");
+  dataCollector->AddDevice(device);
+  const unsigned long long budgetBytes = 1024 * 1024;
+  dataCollector->SetBufferMemoryBudgetBytes(budgetBytes);
+
+  std::vector<vtkPlusDataSource*> sources;
+  for (int sourceIndex = 0; sourceIndex < 2; ++sourceIndex)
+  {
+    vtkSmartPointer<vtkPlusDataSource> source = vtkSmartPointer<vtkPlusDataSource>::New();
+    source->SetId("Video" + igsioCommon::ToString<int>(sourceIndex));
+    source->SetType(DATA_SOURCE_TYPE_VIDEO);
+    source->SetBufferSize(10 + sourceIndex);
+    source->SetInputFrameSize(FRAME_WIDTH, FRAME_HEIGHT, 1);
+    source->SetPixelType(VTK_UNSIGNED_CHAR);
+    source->SetNumberOfScalarComponents(1);
+    source->SetBufferPriority(sourceIndex);
+    if (device->AddVideoSource(source) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add video source " << source->GetId());
+      exit(EXIT_FAILURE);
+    }
+    sources.push_back(source);
+  }
+
+  // Add a few frames, so that the used memory is not zero
+  std::vector<unsigned char> pixels(FRAME_WIDTH * FRAME_HEIGHT, 0);
+  FrameSizeType frameSize = { FRAME_WIDTH, FRAME_HEIGHT, 1 };
+  for (long frameNumber = 0; frameNumber < 3; ++frameNumber)
+  {
+    if (sources[0]->AddItem(&pixels[0], US_IMG_ORIENT_MF, frameSize, VTK_UNSIGNED_CHAR, 1, US_IMG_BRIGHTNESS, 0, frameNumber, frameNumber * 0.1, frameNumber * 0.1) != PLUS_SUCCESS)
+    {
+      LOG_ERROR("Failed to add frame " << frameNumber);
+      numberOfErrors++;
+    }
+  }
+
+  vtkSmartPointer<vtkPlusOpenIGTLinkServer> server = vtkSmartPointer<vtkPlusOpenIGTLinkServer>::New();
+  server->SetDataCollector(dataCollector);
+  vtkSmartPointer<vtkPlusCommandProcessor> commandProcessor = vtkSmartPointer<vtkPlusCommandProcessor>::New();
+  commandProcessor->SetPlusServer(server);
+
+  vtkSmartPointer<vtkPlusGetBufferMemoryUsageCommand> command = vtkSmartPointer<vtkPlusGetBufferMemoryUsageCommand>::New();
+  command->SetCommandProcessor(commandProcessor);
+  if (command->Execute() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Failed to execute the GetBufferMemoryUsage command");
+    numberOfErrors++;
+  }
+
+  PlusCommandResponseList responses;
+  command->PopCommandResponses(responses);
+  vtkPlusCommandRTSCommandResponse* response = (responses.size() == 1 ? vtkPlusCommandRTSCommandResponse::SafeDownCast(responses.front()) : NULL);
+  if (response == NULL || response->GetStatus() != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Expected one successful command response, received " << responses.size() << " responses");
+    numberOfErrors++;
+  }
+  else
+  {
+    LOG_INFO("Reply: " << response->GetResultString());
+    const igtl::MessageBase::MetaDataMap& parameters = response->GetParameters();
+    numberOfErrors += CheckParameter(parameters, "AllocatedBytes", igsioCommon::ToString<unsigned long long>(dataCollector->GetAllocatedBufferMemoryInBytes()));
+    numberOfErrors += CheckParameter(parameters, "UsedBytes", igsioCommon::ToString<unsigned long long>(dataCollector->GetUsedBufferMemoryInBytes()));
+    numberOfErrors += CheckParameter(parameters, "BudgetBytes", igsioCommon::ToString<unsigned long long>(budgetBytes));
+    for (std::vector<vtkPlusDataSource*>::iterator it = sources.begin(); it != sources.end(); ++it)
+    {
+      std::ostringstream expectedUsage;
+      expectedUsage << "BufferSize=" << (*it)->GetBufferSize() << ";BufferPriority=" << (*it)->GetBufferPriority()
+                    << ";AllocatedBytes=" << (*it)->GetBufferAllocatedMemoryInBytes() << ";UsedBytes=" << (*it)->GetBufferUsedMemoryInBytes();
+      numberOfErrors += CheckParameter(parameters, "ImagingDevice/" + (*it)->GetId(), expectedUsage.str());
+    }
+    if (dataCollector->GetUsedBufferMemoryInBytes() == 0)
+    {
+      LOG_ERROR("Used buffer memory is not reported");
+      numberOfErrors++;
+    }
+  }
+
+  if (numberOfErrors > 0)
+  {
+    LOG_ERROR("Test failed with " << numberOfErrors << " errors");
+    return EXIT_FAILURE;
+  }
+
+  LOG_INFO("Test completed successfully");
+  return EXIT_SUCCESS;
+}
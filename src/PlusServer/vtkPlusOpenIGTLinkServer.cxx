@@ -57,6 +57,7 @@ See License.txt for details.
 namespace
 {
   const double DELAY_ON_SENDING_ERROR_SEC = 0.02;
+  // Maximum time to wait for new frames, so that message and command responses and keep alive packets are still sent
   const double DELAY_ON_NO_NEW_FRAMES_SEC = 0.005;
   const int NUMBER_OF_RECENT_COMMAND_IDS_STORED = 10;
   const int IGTL_EMPTY_DATA_SIZE = -1;
@@ -319,6 +320,7 @@ void* vtkPlusOpenIGTLinkServer::ConnectionReceiverThread(vtkMultiThreader::Threa
 void* vtkPlusOpenIGTLinkServer::DataSenderThread(vtkMultiThreader::ThreadInfo* data)
 {
   vtkPlusOpenIGTLinkServer* self = (vtkPlusOpenIGTLinkServer*)(data->UserData);
+  self->DataSenderThreadSettings.ApplyToCurrentThread();
   self->DataSenderActive.Respond = true;
 
   vtkPlusDevice* aDevice(NULL);
@@ -451,7 +453,8 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
           self.LastSentTrackedFrameTimestamp = oldestDataTimestamp + SAMPLING_SKIPPING_MARGIN_SEC;
         }
         static vtkIGSIOLogHelper logHelper(60.0, 500000);
-        CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet) != PLUS_SUCCESS,
+        // The frames are only sent, so they can reference the pixel data in the video buffer
+        CUSTOM_RETURN_WITH_FAIL_IF(self.BroadcastChannel->GetTrackedFrameList(self.LastSentTrackedFrameTimestamp, trackedFrameList, numberOfFramesToGet, true) != PLUS_SUCCESS,
                                    "Failed to get tracked frame list from data collector (last recorded timestamp: " << std::fixed << self.LastSentTrackedFrameTimestamp);
       }
     }
@@ -460,7 +463,15 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendLatestFramesToClients(vtkPlusOpenIGTLin
   // There is no new frame in the buffer
   if (trackedFrameList->GetNumberOfTrackedFrames() == 0)
   {
-    vtkIGSIOAccurateTimer::Delay(DELAY_ON_NO_NEW_FRAMES_SEC);
+    if (self.BroadcastChannel != NULL)
+    {
+      // Return as soon as new data is available instead of sleeping for a fixed time
+      self.BroadcastChannel->WaitForItemNewerThan(self.LastSentTrackedFrameTimestamp, DELAY_ON_NO_NEW_FRAMES_SEC);
+    }
+    else
+    {
+      vtkIGSIOAccurateTimer::Delay(DELAY_ON_NO_NEW_FRAMES_SEC);
+    }
     elapsedTimeSinceLastPacketSentSec += vtkIGSIOAccurateTimer::GetSystemTime() - startTimeSec;
 
     // Send keep alive packet to clients
@@ -576,6 +587,7 @@ void* vtkPlusOpenIGTLinkServer::DataReceiverThread(vtkMultiThreader::ThreadInfo*
   ClientData* client = (ClientData*)(data->UserData);
   client->DataReceiverActive.second = true;
   vtkPlusOpenIGTLinkServer* self = client->Server;
+  self->DataReceiverThreadSettings.ApplyToCurrentThread();
 
   /*! Store the IDs of recent commands to be able to detect duplicate command IDs */
   std::deque<uint32_t> previousCommandIds;
@@ -1031,7 +1043,7 @@ PlusStatus vtkPlusOpenIGTLinkServer::SendTrackedFrame(igsioTrackedFrame& tracked
     {
       for (std::list<ClientData>::iterator clientIterator = this->IgtlClients.begin(); clientIterator != this->IgtlClients.end(); ++clientIterator)
       {
-        std::vector<PlusIgtlClientInfo::VideoStream> videoStreams = (*clientIterator).ClientInfo.VideoStreams;
+        std::vector<PlusIgtlClientInfo::VideoStream>& videoStreams = (*clientIterator).ClientInfo.VideoStreams;
         for (std::vector<PlusIgtlClientInfo::VideoStream>::iterator videoStream = videoStreams.begin(); videoStream != videoStreams.end(); ++videoStream)
         {
           vtkIGSIOFrameConverter* frameConverter = videoStream->FrameConverter;
@@ -1270,6 +1282,13 @@ PlusStatus vtkPlusOpenIGTLinkServer::ReadConfiguration(vtkXMLDataElement* server
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(IgtlMessageCrcCheckEnabled, serverElement);
   XML_READ_BOOL_ATTRIBUTE_OPTIONAL(LogWarningOnNoDataAvailable, serverElement);
 
+  if (this->DataSenderThreadSettings.ReadConfiguration(serverElement, "DataSender") != PLUS_SUCCESS
+      || this->DataReceiverThreadSettings.ReadConfiguration(serverElement, "DataReceiver") != PLUS_SUCCESS)
+  {
+    LOG_ERROR("Invalid thread settings in PlusOpenIGTLinkServer configuration");
+    return PLUS_FAIL;
+  }
+
   this->DefaultClientInfo.IgtlMessageTypes.clear();
   this->DefaultClientInfo.TransformNames.clear();
   this->DefaultClientInfo.ImageStreams.clear();
@@ -12,6 +12,7 @@
 #include "PlusIgtlClientInfo.h"
 #include "vtkPlusDataCollector.h"
 #include "vtkPlusIgtlMessageFactory.h"
+#include "PlusThreadSettings.h"
 #include "vtkIGSIOTransformRepository.h"
 
 // VTK includes
@@ -322,6 +323,11 @@ private:
 
   double KeepAliveIntervalSec;
 
+  /*! Settings of the data sender thread, read from the DataSender* attributes (e.g., DataSenderCpuAffinity) */
+  PlusThreadSettings DataSenderThreadSettings;
+  /*! Settings of the data receiver thread of each client, read from the DataReceiver* attributes (e.g., DataReceiverThreadPriority) */
+  PlusThreadSettings DataReceiverThreadSettings;
+
   std::string ConfigFilename;
 
   vtkPlusLogger::LogLevelType GracePeriodLogLevel;
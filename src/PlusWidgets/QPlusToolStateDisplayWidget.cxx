@@ -96,7 +96,7 @@ PlusStatus QPlusToolStateDisplayWidget::InitializeTools(vtkPlusChannel* aChannel
   // Get transforms
   std::vector<igsioTransformName> transformNames;
   igsioTrackedFrame trackedFrame;
-  m_SelectedChannel->GetTrackedFrame(trackedFrame);
+  m_SelectedChannel->GetTrackedFrameView(trackedFrame);
   trackedFrame.GetFrameTransformNameList(transformNames);
 
   // Set up layout
@@ -171,7 +171,7 @@ PlusStatus QPlusToolStateDisplayWidget::Update()
   // Get transforms
   std::vector<igsioTransformName> transformNames;
   igsioTrackedFrame trackedFrame;
-  m_SelectedChannel->GetTrackedFrame(trackedFrame);
+  m_SelectedChannel->GetTrackedFrameView(trackedFrame);
   trackedFrame.GetFrameTransformNameList(transformNames);
 
   if (transformNames.size() != m_ToolStateLabels.size())